@@ -0,0 +1,95 @@
+// Per-call overhead of the logger's binary trace mode.
+//
+// Wraps an empty "driver call" in ApiTraceScope and captures four arguments,
+// the way a generated logger hook does, and reports ns per call with tracing
+// off (null trace) and on, for one or more calling threads. Calls are issued
+// back to back, far faster than the drain thread empties the rings, so most
+// records are dropped; that is the bounded-memory policy and does not change
+// the per-call cost.
+//
+// Usage: api_trace_bench [calls per thread] [threads] [trace path]
+
+#include "api_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Stands in for the next layer; kept out of line so the call is not elided
+__attribute__((noinline)) static int32_t NextLayerCall(uint64_t i) {
+    asm volatile("" ::: "memory");
+    return static_cast<int32_t>(i & 1);
+}
+
+// The one function the bench records, shaped like the vkQueueSubmit hook
+enum class BenchFunction : uint16_t { vkQueueSubmit };
+static const char kBenchSchema[] = "vkQueueSubmit queue:x submitCount pSubmits[0].commandBufferCount fence:x\n";
+
+static int32_t HookedCall(ApiTrace* trace, uint64_t i) {
+    ApiTraceScope scope(trace, BenchFunction::vkQueueSubmit);
+    if (scope.Active()) {
+        scope.Arg(&scope);
+        scope.Arg(1u);
+        scope.Arg(static_cast<uint32_t>(i));
+        scope.Arg(i);
+    }
+    return scope.Result(NextLayerCall(i));
+}
+
+// Average ns per call, each of `threads` threads making `calls` calls
+static double Run(ApiTrace* trace, uint64_t calls, unsigned threads) {
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([trace, calls] {
+            int32_t sink = 0;
+            for (uint64_t i = 0; i < calls; i++) {
+                sink += HookedCall(trace, i);
+            }
+            if (sink < 0) std::printf(" ");
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // Same normalization as dispatch_map_bench: busy core time per call
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    unsigned busy_cores = std::min(threads, cores);
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns * busy_cores / (static_cast<double>(calls) * threads);
+}
+
+int main(int argc, char** argv) {
+    uint64_t calls = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    unsigned max_threads = (argc > 2) ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 4;
+    const char* path = (argc > 3) ? argv[3] : "api_trace_bench.trace";
+    if (calls == 0) calls = 1;
+    if (max_threads == 0) max_threads = 1;
+
+    std::printf("%8s %14s %14s %12s\n", "threads", "off ns/call", "on ns/call", "recorded");
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        double off_ns = Run(nullptr, calls, threads);
+
+        uint64_t dropped = 0;
+        double on_ns = 0.0;
+        {
+            std::unique_ptr<ApiTrace> trace = ApiTrace::Open(path, kBenchSchema);
+            if (!trace) return 1;
+            on_ns = Run(trace.get(), calls, threads);
+            dropped = trace->Dropped();
+        }
+
+        uint64_t issued = calls * threads;
+        std::printf("%8u %14.2f %14.2f %11.1f%%\n", threads, off_ns, on_ns,
+                    100.0 * static_cast<double>(issued - dropped) / static_cast<double>(issued));
+    }
+
+    std::remove(path);
+    return 0;
+}
@@ -0,0 +1,157 @@
+// Swapchain capture cost on the CPU side.
+//
+// Writer: CaptureFile::Write per frame at 1080p and 4K, reading from a
+// four-frame ring like FrameCapture's staging buffers, plus the final
+// msync spread over the frames. It has to stay under a 60 Hz frame (16.7 ms)
+// or FrameCapture starts dropping frames.
+//
+// Application: a thread doing a fixed 8 ms of work per 60 Hz frame, alone
+// and then with the writer streaming a 1080p frame per frame alongside it
+// the way FrameCapture's writer thread does, at the same low priority. The
+// present-time part of a capture (recording and submitting one copy) is a
+// few microseconds and is not modelled. Reports the mean work time of each
+// run and the increase, against a 5% budget; on a machine with one core the
+// two threads share it, so the writer only runs while the application sleeps.
+//
+// Usage: capture_file_bench [frames] [path]
+//        (path defaults to capture_bench.cap, removed afterwards)
+
+#include "capture_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint32_t kRingFrames = 4;
+
+// Mean milliseconds per Write for `frames` frames, including the close
+static double WriteCost(const std::string& path, uint32_t width, uint32_t height, uint32_t frames) {
+    size_t frame_size = static_cast<size_t>(width) * height * 4;
+    std::vector<uint8_t> ring(frame_size * kRingFrames);
+    for (size_t i = 0; i < ring.size(); i++) {
+        ring[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+    }
+
+    auto start = Clock::now();
+    {
+        std::unique_ptr<CaptureFile> file =
+            CaptureFile::Create(path, width, height, CaptureLayout::Bgra8, 44, frames);
+        if (!file) return -1.0;
+        for (uint32_t i = 0; i < frames; i++) {
+            file->Write(i + 1, 0, &ring[(i % kRingFrames) * frame_size]);
+        }
+    }
+    auto elapsed = Clock::now() - start;
+    std::remove(path.c_str());
+    return std::chrono::duration<double, std::milli>(elapsed).count() / frames;
+}
+
+// Mean milliseconds of a fixed 8 ms workload per 60 Hz frame, with or
+// without a 1080p writer running alongside
+static double AppWorkTime(const std::string& path, uint32_t frames, bool capture) {
+    constexpr uint32_t kWidth = 1920;
+    constexpr uint32_t kHeight = 1080;
+    const auto frame_interval = std::chrono::microseconds(16667);
+
+    std::unique_ptr<CaptureFile> file;
+    std::vector<uint8_t> ring;
+    if (capture) {
+        file = CaptureFile::Create(path, kWidth, kHeight, CaptureLayout::Bgra8, 44, frames);
+        if (!file) return -1.0;
+        ring.assign(file->FrameSize() * kRingFrames, 0x5a);
+    }
+
+    std::atomic<uint32_t> presented{0};
+    std::atomic<bool> done{false};
+    std::thread writer;
+    if (capture) {
+        writer = std::thread([&]() {
+            CaptureFile::LowerWriterPriority();
+            uint32_t written = 0;
+            while (!done.load() || written < presented.load()) {
+                if (written < presented.load()) {
+                    file->Write(written + 1, 0, &ring[(written % kRingFrames) * file->FrameSize()]);
+                    written++;
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                }
+            }
+        });
+    }
+
+    // Calibrate once: iterations of a dependent integer chain per 8 ms
+    static const uint64_t work_iterations = []() {
+        volatile uint64_t sink = 0;
+        uint64_t x = 1;
+        auto start = Clock::now();
+        uint64_t n = 0;
+        while (Clock::now() - start < std::chrono::milliseconds(100)) {
+            for (int i = 0; i < 10000; i++) x = x * 6364136223846793005ull + 1442695040888963407ull;
+            n += 10000;
+        }
+        sink = x;
+        (void)sink;
+        return n * 8 / 100;
+    }();
+
+    double total_ms = 0.0;
+    volatile uint64_t sink = 0;
+    auto next = Clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        auto start = Clock::now();
+        uint64_t x = frame;
+        for (uint64_t i = 0; i < work_iterations; i++) x = x * 6364136223846793005ull + 1442695040888963407ull;
+        sink = x;
+        total_ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        presented.store(frame + 1);
+        next += frame_interval;
+        std::this_thread::sleep_until(next);
+    }
+    (void)sink;
+
+    done.store(true);
+    if (writer.joinable()) writer.join();
+    file.reset();
+    std::remove(path.c_str());
+    return total_ms / frames;
+}
+
+int main(int argc, char** argv) {
+    uint32_t frames = (argc > 1) ? static_cast<uint32_t>(std::max(8, std::atoi(argv[1]))) : 120;
+    std::string path = (argc > 2) ? argv[2] : "capture_bench.cap";
+
+    const struct { uint32_t width, height; const char* name; } resolutions[] = {
+        {1920, 1080, "1080p"},
+        {3840, 2160, "4K"},
+    };
+
+    std::printf("%u frames per run\n", frames);
+    std::printf("%-6s %12s %14s\n", "res", "write ms", "of 16.7 ms");
+    for (const auto& resolution : resolutions) {
+        double ms = WriteCost(path, resolution.width, resolution.height, frames);
+        if (ms < 0.0) {
+            std::printf("%-6s cannot create %s\n", resolution.name, path.c_str());
+            return 1;
+        }
+        std::printf("%-6s %12.3f %13.1f%%\n", resolution.name, ms, 100.0 * ms / 16.667);
+    }
+
+    double baseline = AppWorkTime(path, frames, false);
+    double captured = AppWorkTime(path, frames, true);
+    if (captured < 0.0) {
+        std::printf("cannot create %s\n", path.c_str());
+        return 1;
+    }
+    double increase = 100.0 * (captured - baseline) / baseline;
+    std::printf("\n1080p60 app work: %.3f ms alone, %.3f ms capturing (%+.1f%%, budget 5%%, %u cores)\n",
+                baseline, captured, increase, std::thread::hardware_concurrency());
+    return 0;
+}
@@ -0,0 +1,83 @@
+// What the on-disk cache adds to a layer's device creation and teardown:
+// loading and storing its VkPipelineCache blob. The cold run starts from an
+// empty cache directory, so it misses and stores. The warm run opens a fresh
+// DiskCache, as a new process would, and loads what the cold run left. Both
+// runs find the files in the page cache, so warm is the best case for I/O.
+// Pipeline compile time belongs to the driver and isn't measured.
+//
+// Usage: disk_cache_bench [iterations]
+
+#include "disk_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static void RemoveCacheDirectory(const std::string& root) {
+    std::string directory = root + "/v" + std::to_string(kDiskCacheVersion);
+    if (DIR* listing = ::opendir(directory.c_str())) {
+        while (dirent* entry = ::readdir(listing)) {
+            if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0) {
+                ::unlink((directory + "/" + entry->d_name).c_str());
+            }
+        }
+        ::closedir(listing);
+    }
+    ::rmdir(directory.c_str());
+    ::rmdir(root.c_str());
+}
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 20;
+    if (iterations < 1) iterations = 1;
+
+    char root_template[] = "/tmp/disk_cache_bench.XXXXXX";
+    if (!::mkdtemp(root_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string root = root_template;
+    std::printf("pipeline cache blobs, best of %d, cache in %s\n", iterations, root.c_str());
+    std::printf("%-8s %14s %12s  %s\n", "blob", "cold ms", "warm ms", "");
+
+    // Pipeline cache blobs as drivers produce them: tens of KB to a few MB
+    bool ok = true;
+    for (size_t blob_size : {size_t(64) << 10, size_t(256) << 10, size_t(1) << 20, size_t(4) << 20}) {
+        std::vector<uint8_t> blob(blob_size);
+        for (size_t i = 0; i < blob.size(); i++) blob[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+        ContentHash device_key = HashBytes(&blob_size, sizeof(blob_size));
+        std::vector<uint8_t> loaded;
+
+        double best_cold = 1e30, best_warm = 1e30;
+        bool cold_hit = false, stored = true, warm_hit = true;
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            RemoveCacheDirectory(root);
+            auto start = std::chrono::steady_clock::now();
+            std::unique_ptr<DiskCache> disk = DiskCache::Open(root);
+            cold_hit = cold_hit || (disk && disk->Load(DiskCacheKind::PipelineCache, device_key, &loaded));
+            stored = stored && disk && disk->Store(DiskCacheKind::PipelineCache, device_key, blob.data(), blob.size());
+            auto middle = std::chrono::steady_clock::now();
+            disk = DiskCache::Open(root);
+            warm_hit = warm_hit && disk && disk->Load(DiskCacheKind::PipelineCache, device_key, &loaded) &&
+                       loaded == blob;
+            auto end = std::chrono::steady_clock::now();
+            best_cold = std::min(best_cold, std::chrono::duration<double, std::milli>(middle - start).count());
+            best_warm = std::min(best_warm, std::chrono::duration<double, std::milli>(end - middle).count());
+        }
+
+        bool row_ok = !cold_hit && stored && warm_hit;
+        ok = ok && row_ok;
+        std::printf("%6zuK %14.3f %12.3f  %s\n", blob_size >> 10, best_cold, best_warm,
+                    row_ok ? "identical" : "UNEXPECTED");
+    }
+
+    RemoveCacheDirectory(root);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// Contention benchmark for per-call layer data lookup.
+//
+// Compares the old global_mutex + unordered_map lookup against DispatchMap
+// with 1..32 threads hammering Get() on a handful of device keys, the way
+// command buffer recording threads hit GetDeviceData() on every vkCmd* call.
+//
+// Usage: dispatch_map_bench [lookups_per_thread]
+
+#include "dispatch_map.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct FakeDeviceData {
+    uint64_t id;
+};
+
+static const int kDeviceCount = 4;
+
+// Stand-ins for dispatch table pointers
+static void* device_tables[kDeviceCount];
+
+class LockedMap {
+public:
+    FakeDeviceData* Get(void* key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = map_.find(key);
+        return (it != map_.end()) ? it->second : nullptr;
+    }
+
+    void Insert(void* key, FakeDeviceData* value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        map_[key] = value;
+    }
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<void*, FakeDeviceData*> map_;
+};
+
+template <typename Map>
+double RunLookups(Map& map, int thread_count, uint64_t lookups) {
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> sums(thread_count);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&map, &sums, t, lookups]() {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < lookups; i++) {
+                FakeDeviceData* data = map.Get(&device_tables[(i + t) % kDeviceCount]);
+                sum += data->id;
+            }
+            sums[t] = sum;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // Keep the lookups from being optimized away
+    uint64_t total = 0;
+    for (uint64_t sum : sums) total += sum;
+    if (total == 0) std::printf(" ");
+
+    // Normalize to busy core time per call so oversubscribed runs stay
+    // comparable; a flat column means lookups do not contend.
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    unsigned busy_cores = std::min(static_cast<unsigned>(thread_count), cores);
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns * busy_cores / (static_cast<double>(lookups) * thread_count);
+}
+
+int main(int argc, char** argv) {
+    uint64_t lookups = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+
+    FakeDeviceData devices[kDeviceCount];
+    LockedMap locked_map;
+    DispatchMap<FakeDeviceData> dispatch_map;
+    for (int i = 0; i < kDeviceCount; i++) {
+        devices[i].id = i + 1;
+        locked_map.Insert(&device_tables[i], &devices[i]);
+        dispatch_map.Insert(&device_tables[i], &devices[i]);
+    }
+
+    unsigned cores = std::thread::hardware_concurrency();
+    std::printf("lookups/thread: %llu, hardware threads: %u\n",
+                static_cast<unsigned long long>(lookups), cores);
+    std::printf("%8s %18s %18s\n", "threads", "mutex ns/call", "dispatch ns/call");
+
+    for (int threads = 1; threads <= 32; threads *= 2) {
+        double locked_ns = RunLookups(locked_map, threads, lookups);
+        double dispatch_ns = RunLookups(dispatch_map, threads, lookups);
+        std::printf("%8d %18.2f %18.2f\n", threads, locked_ns, dispatch_ns);
+    }
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+// Presented frame intervals under the stage A2 scheduler.
+//
+// An application thread presents at a steady 60 FPS with up to +/-1 ms of
+// arrival jitter; each present goes through FramePacer and onto a queue
+// that a present thread drains at the scheduled times, like
+// FrameGenerator's present thread. Reports the intervals between the
+// resulting presents (ideally 8.33 ms each, for 120 FPS) with the hybrid
+// sleep-then-spin timer and with a plain sleep_until, then repeats the
+// hybrid run with a 40 ms hitch every 120 frames. The first second is
+// warmup (the pacer needs a few intervals before it generates) and is left
+// out of the stats.
+//
+// Usage: frame_pacing_bench [frames]
+
+#include "frame_pacing.h"
+#include "frame_stats.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+
+using Clock = std::chrono::steady_clock;
+
+static constexpr uint64_t kWarmupFrames = 60;
+
+struct BenchResult {
+    FrameStatsReport presented;
+    uint64_t synthetic = 0;
+    uint64_t hitches = 0;
+};
+
+static BenchResult Run(uint64_t frames, bool hybrid_timer, uint64_t hitch_every) {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::pair<uint64_t, PacingDecision>> jobs;
+    bool done = false;
+
+    BenchResult result;
+    FrameStatsEngine presented;
+
+    std::thread present_thread([&] {
+        auto wait_until = [&](Clock::time_point deadline) {
+            if (hybrid_timer) {
+                SleepUntilPrecise(deadline);
+            } else {
+                std::this_thread::sleep_until(deadline);
+            }
+        };
+        Clock::time_point last{};
+        auto record = [&](uint64_t frame) {
+            Clock::time_point now = Clock::now();
+            if (frame >= kWarmupFrames && last != Clock::time_point{}) {
+                presented.Record(std::chrono::duration<float, std::milli>(now - last).count());
+            }
+            last = now;
+        };
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            ready.wait(lock, [&] { return done || !jobs.empty(); });
+            if (jobs.empty()) return;
+            uint64_t frame = jobs.front().first;
+            PacingDecision job = jobs.front().second;
+            jobs.pop_front();
+            lock.unlock();
+
+            if (job.generate) {
+                wait_until(job.synthetic_at);
+                record(frame);
+                result.synthetic++;
+            }
+            wait_until(job.real_at);
+            record(frame);
+            lock.lock();
+        }
+    });
+
+    FramePacer pacer;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> jitter_ms(-1.0f, 1.0f);
+    const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(1000.0 / 60.0));
+    Clock::time_point frame_start = Clock::now();
+    for (uint64_t frame = 0; frame < frames; frame++) {
+        frame_start += interval;
+        if (hitch_every != 0 && frame % hitch_every == hitch_every - 1) {
+            frame_start += std::chrono::milliseconds(40) - interval;
+        }
+        auto arrival = frame_start + std::chrono::duration_cast<Clock::duration>(
+                                         std::chrono::duration<float, std::milli>(jitter_ms(rng)));
+        SleepUntilPrecise(arrival);
+
+        PacingDecision decision = pacer.OnFrame(Clock::now());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.emplace_back(frame, decision);
+        }
+        ready.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    ready.notify_one();
+    present_thread.join();
+
+    result.presented = presented.Report();
+    result.hitches = pacer.Hitches();
+    return result;
+}
+
+static void Print(const char* label, const BenchResult& result) {
+    std::printf("%-22s %8llu %9llu %8llu %9.3f %9.3f %9.3f %9.3f\n", label,
+                static_cast<unsigned long long>(result.presented.frames),
+                static_cast<unsigned long long>(result.synthetic),
+                static_cast<unsigned long long>(result.hitches),
+                result.presented.mean_ms, result.presented.stddev_ms,
+                result.presented.p99_ms, result.presented.max_ms);
+}
+
+int main(int argc, char** argv) {
+    uint64_t frames = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 600;
+
+    std::printf("%-22s %8s %9s %8s %9s %9s %9s %9s\n", "run (60 fps app)", "presents", "synthetic",
+                "hitches", "mean ms", "stddev ms", "p99 ms", "max ms");
+    Print("hybrid timer", Run(frames, true, 0));
+    Print("sleep_until only", Run(frames, false, 0));
+    Print("hybrid, 40 ms hitches", Run(frames, true, 120));
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Per-frame cost of LogFrameTiming() over a long run.
+//
+// Drives LogFrameTiming() back to back (far above 1000 FPS) with a live
+// TelemetryWriter and reports the average cost per frame for consecutive
+// windows. The ring buffers make the cost independent of how many frames
+// have been recorded, and file output stays on the writer thread (at this
+// rate most samples are dropped, which is the bounded-memory policy). The
+// legacy column replays the old vector push_back + erase(begin()) trimming
+// for comparison.
+//
+// Usage: frame_timing_bench [frames] [window]
+
+#include "frame_timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <vector>
+
+// Swallows the layer's periodic console output
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+// Old bookkeeping: unbounded vectors trimmed from the front
+struct LegacyHistory {
+    std::vector<FrameTimingData> frameHistory;
+    std::vector<float> frametimes;
+
+    void Record(const FrameTimingData& timing_data) {
+        frameHistory.push_back(timing_data);
+        if (frameHistory.size() > 1000) {
+            frameHistory.erase(frameHistory.begin());
+        }
+        frametimes.push_back(static_cast<float>(timing_data.frametime_ms));
+        if (frametimes.size() > 120) {
+            frametimes.erase(frametimes.begin());
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    uint64_t frames = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    uint64_t window = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 20000;
+    if (window == 0) window = 1;
+
+    NullBuffer null_buffer;
+    std::streambuf* cout_buffer = std::cout.rdbuf(&null_buffer);
+
+    auto swapchain_data = std::make_unique<SwapchainData>();
+    swapchain_data->presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    swapchain_data->lastFrameTime = std::chrono::high_resolution_clock::now();
+    swapchain_data->telemetry = std::make_unique<TelemetryWriter>("frame_timing_bench.bin");
+
+    LegacyHistory legacy;
+    FrameTimingData timing_data = {};
+
+    std::vector<double> ring_ns;
+    std::vector<double> legacy_ns;
+
+    for (uint64_t start = 0; start < frames; start += window) {
+        uint64_t count = std::min(window, frames - start);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < count; i++) {
+            LogFrameTiming(swapchain_data.get(), static_cast<uint32_t>(i % 3));
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < count; i++) {
+            timing_data.frameNumber = start + i;
+            timing_data.frametime_ms = 1.0 + (i % 7) * 0.1;
+            legacy.Record(timing_data);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        ring_ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / count);
+        legacy_ns.push_back(std::chrono::duration<double, std::nano>(t2 - t1).count() / count);
+    }
+
+    uint64_t dropped = swapchain_data->telemetry->Dropped();
+    swapchain_data->telemetry.reset();
+    std::cout.rdbuf(cout_buffer);
+
+    FrameTimeStats stats = swapchain_data->hud.frametimes.Stats();
+    std::printf("frames: %llu, window: %llu, hud min/avg/max: %.5f/%.5f/%.5f ms\n",
+                static_cast<unsigned long long>(frames), static_cast<unsigned long long>(window),
+                stats.min, stats.avg, stats.max);
+    std::printf("telemetry samples dropped: %llu\n", static_cast<unsigned long long>(dropped));
+    std::printf("%12s %16s %18s\n", "frames", "ring ns/frame", "legacy ns/frame");
+    for (size_t w = 0; w < ring_ns.size(); w++) {
+        std::printf("%12llu %16.1f %18.1f\n",
+                    static_cast<unsigned long long>(std::min(frames, (w + 1) * window)),
+                    ring_ns[w], legacy_ns[w]);
+    }
+
+    return 0;
+}
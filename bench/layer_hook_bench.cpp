@@ -0,0 +1,695 @@
+// Per-hook cost of each layer, from 1 to N threads, over the mock ICD.
+//
+// Loads VK_ICD_mock and each of VK_LAYER_logger, VK_LAYER_green_tint,
+// VK_LAYER_text_overlay and VK_LAYER_frame_interpolation on its own, chained
+// the way the loader does through a terminator defined here. With no layer
+// at all the same loops give the baseline. Each configuration runs tight
+// loops of
+//   vkCmdDraw               inside one render pass
+//   vkCmdBeginRenderPass    begin/end pairs, timed per pair
+//   vkAcquireNextImageKHR   one frame per iteration, each call timed on its
+//   vkQueuePresentKHR       own (so both include one clock read)
+//   vkGetDeviceProcAddr     cycling over hooked and pass-through names
+// on 1, 2, 4 .. --threads threads at once. Each thread has its own command
+// buffer, surface, swapchain and queue. The bench reports ns per call and
+// the overhead against the baseline at the same thread count. It also
+// reports scaling efficiency: throughput at N threads over N times the
+// single-thread throughput, where 1.0 is linear.
+//
+// The display runs on the mock's virtual clock, so FIFO acquires never
+// sleep. Frame generation only runs with --present-mode mailbox or
+// immediate. The logger writes its binary trace (VK_LOGGER_TRACE) and
+// layer console output goes to /dev/null while the clock runs. Everything
+// runs in a temporary directory, which is removed afterwards together with
+// the trace and telemetry files. With -o the results are also written as
+// JSON, for comparing releases.
+//
+// Usage: layer_hook_bench [--threads N] [--iterations N] [--frames N]
+//                         [--present-mode fifo|mailbox|immediate]
+//                         [-o out.json] [lib dir]
+//        (lib dir defaults to ./lib, i.e. run from the build directory)
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_layer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#ifndef LAYER_VERSION
+#define LAYER_VERSION "unknown"
+#endif
+
+// The mock ICD's queue count; one queue per thread
+static constexpr uint32_t kMaxThreads = 16;
+
+// Loader side. Layers find their data through the dispatch pointer at the
+// start of every dispatchable handle. The loader writes one per instance
+// and one per device over the ICD's magic value, and this terminator does
+// the same. One instance and device exist at a time.
+static int instance_table, device_table;
+static PFN_vkGetInstanceProcAddr icd_gipa;
+static PFN_vkGetDeviceProcAddr icd_gdpa;
+
+static void SetLoaderData(void* object, void* table) {
+    *static_cast<void**>(object) = table;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL TermCreateInstance(const VkInstanceCreateInfo* pCreateInfo,
+                                                         const VkAllocationCallbacks* pAllocator, VkInstance* pInstance) {
+    auto create = reinterpret_cast<PFN_vkCreateInstance>(icd_gipa(VK_NULL_HANDLE, "vkCreateInstance"));
+    VkResult result = create(pCreateInfo, pAllocator, pInstance);
+    if (result == VK_SUCCESS) SetLoaderData(*pInstance, &instance_table);
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL TermEnumeratePhysicalDevices(VkInstance instance, uint32_t* pCount,
+                                                                   VkPhysicalDevice* pPhysicalDevices) {
+    auto enumerate = reinterpret_cast<PFN_vkEnumeratePhysicalDevices>(icd_gipa(instance, "vkEnumeratePhysicalDevices"));
+    VkResult result = enumerate(instance, pCount, pPhysicalDevices);
+    if (pPhysicalDevices) {
+        for (uint32_t i = 0; i < *pCount; i++) SetLoaderData(pPhysicalDevices[i], &instance_table);
+    }
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL TermCreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* pCreateInfo,
+                                                       const VkAllocationCallbacks* pAllocator, VkDevice* pDevice) {
+    auto create = reinterpret_cast<PFN_vkCreateDevice>(icd_gipa(VK_NULL_HANDLE, "vkCreateDevice"));
+    VkResult result = create(physicalDevice, pCreateInfo, pAllocator, pDevice);
+    if (result == VK_SUCCESS) SetLoaderData(*pDevice, &device_table);
+    return result;
+}
+
+static VKAPI_ATTR void VKAPI_CALL TermGetDeviceQueue(VkDevice device, uint32_t queueFamilyIndex, uint32_t queueIndex,
+                                                     VkQueue* pQueue) {
+    reinterpret_cast<PFN_vkGetDeviceQueue>(icd_gdpa(device, "vkGetDeviceQueue"))(device, queueFamilyIndex, queueIndex, pQueue);
+    SetLoaderData(*pQueue, &device_table);
+}
+
+static VKAPI_ATTR void VKAPI_CALL TermGetDeviceQueue2(VkDevice device, const VkDeviceQueueInfo2* pQueueInfo, VkQueue* pQueue) {
+    reinterpret_cast<PFN_vkGetDeviceQueue2>(icd_gdpa(device, "vkGetDeviceQueue2"))(device, pQueueInfo, pQueue);
+    SetLoaderData(*pQueue, &device_table);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL TermAllocateCommandBuffers(VkDevice device, const VkCommandBufferAllocateInfo* pAllocateInfo,
+                                                                 VkCommandBuffer* pCommandBuffers) {
+    auto allocate = reinterpret_cast<PFN_vkAllocateCommandBuffers>(icd_gdpa(device, "vkAllocateCommandBuffers"));
+    VkResult result = allocate(device, pAllocateInfo, pCommandBuffers);
+    if (result == VK_SUCCESS) {
+        for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; i++) SetLoaderData(pCommandBuffers[i], &device_table);
+    }
+    return result;
+}
+
+// Handed to layers that create their own dispatchable objects
+static VKAPI_ATTR VkResult VKAPI_CALL SetDeviceLoaderData(VkDevice, void* object) {
+    SetLoaderData(object, &device_table);
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL TermGetDeviceProcAddr(VkDevice device, const char* pName) {
+    if (!strcmp(pName, "vkGetDeviceProcAddr")) return reinterpret_cast<PFN_vkVoidFunction>(TermGetDeviceProcAddr);
+    if (!strcmp(pName, "vkGetDeviceQueue")) return reinterpret_cast<PFN_vkVoidFunction>(TermGetDeviceQueue);
+    if (!strcmp(pName, "vkGetDeviceQueue2")) return reinterpret_cast<PFN_vkVoidFunction>(TermGetDeviceQueue2);
+    if (!strcmp(pName, "vkAllocateCommandBuffers")) return reinterpret_cast<PFN_vkVoidFunction>(TermAllocateCommandBuffers);
+    return icd_gdpa(device, pName);
+}
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL TermGetInstanceProcAddr(VkInstance instance, const char* pName) {
+    if (!strcmp(pName, "vkGetInstanceProcAddr")) return reinterpret_cast<PFN_vkVoidFunction>(TermGetInstanceProcAddr);
+    if (!strcmp(pName, "vkCreateInstance")) return reinterpret_cast<PFN_vkVoidFunction>(TermCreateInstance);
+    if (!strcmp(pName, "vkEnumeratePhysicalDevices")) return reinterpret_cast<PFN_vkVoidFunction>(TermEnumeratePhysicalDevices);
+    if (!strcmp(pName, "vkCreateDevice")) return reinterpret_cast<PFN_vkVoidFunction>(TermCreateDevice);
+    PFN_vkVoidFunction device_function = TermGetDeviceProcAddr(VK_NULL_HANDLE, pName);
+    return device_function ? device_function : icd_gipa(instance, pName);
+}
+
+static bool LoadIcd(const std::string& lib_dir) {
+    std::string path = lib_dir + "/VK_ICD_mock.so";
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        std::fprintf(stderr, "%s\n", dlerror());
+        return false;
+    }
+    auto negotiate = reinterpret_cast<VkResult (*)(uint32_t*)>(dlsym(handle, "vk_icdNegotiateLoaderICDInterfaceVersion"));
+    uint32_t version = 5;
+    if (!negotiate || negotiate(&version) != VK_SUCCESS) return false;
+    icd_gipa = reinterpret_cast<PFN_vkGetInstanceProcAddr>(dlsym(handle, "vk_icdGetInstanceProcAddr"));
+    if (!icd_gipa) return false;
+    icd_gdpa = reinterpret_cast<PFN_vkGetDeviceProcAddr>(icd_gipa(VK_NULL_HANDLE, "vkGetDeviceProcAddr"));
+    return icd_gdpa != nullptr;
+}
+
+// What each thread drives
+struct Worker {
+    VkQueue queue = VK_NULL_HANDLE;
+    VkCommandPool command_pool = VK_NULL_HANDLE;
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    VkSemaphore acquired = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+};
+
+// An instance and device through at most one layer, with kMaxThreads workers
+struct Chain {
+    PFN_vkGetInstanceProcAddr gipa = TermGetInstanceProcAddr;
+    PFN_vkGetDeviceProcAddr gdpa = TermGetDeviceProcAddr;
+    bool layered = false;
+    VkInstance instance = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkRenderPass render_pass = VK_NULL_HANDLE;
+    std::vector<Worker> workers;
+
+    PFN_vkCmdDraw CmdDraw = nullptr;
+    PFN_vkCmdBeginRenderPass CmdBeginRenderPass = nullptr;
+    PFN_vkCmdEndRenderPass CmdEndRenderPass = nullptr;
+    PFN_vkAcquireNextImageKHR AcquireNextImageKHR = nullptr;
+    PFN_vkQueuePresentKHR QueuePresentKHR = nullptr;
+
+    bool Load(const std::string& lib_dir, const char* layer) {
+        if (!layer) return true;
+        std::string path = lib_dir + "/" + layer + ".so";
+        void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            std::fprintf(stderr, "%s\n", dlerror());
+            return false;
+        }
+        gipa = reinterpret_cast<PFN_vkGetInstanceProcAddr>(dlsym(handle, "vkGetInstanceProcAddr"));
+        gdpa = reinterpret_cast<PFN_vkGetDeviceProcAddr>(dlsym(handle, "vkGetDeviceProcAddr"));
+        layered = true;
+        return gipa && gdpa;
+    }
+
+    template <typename T>
+    T Instance(const char* name) const {
+        return reinterpret_cast<T>(gipa(instance, name));
+    }
+
+    template <typename T>
+    T Device(const char* name) const {
+        return reinterpret_cast<T>(gdpa(device, name));
+    }
+
+    bool CreateInstanceAndDevice() {
+        VkLayerInstanceLink instance_link{};
+        instance_link.pfnNextGetInstanceProcAddr = TermGetInstanceProcAddr;
+        VkLayerInstanceCreateInfo instance_link_info{};
+        instance_link_info.sType = VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO;
+        instance_link_info.function = VK_LAYER_LINK_INFO;
+        instance_link_info.u.pLayerInfo = &instance_link;
+
+        const char* instance_extensions[] = {"VK_KHR_surface", "VK_EXT_headless_surface"};
+        VkApplicationInfo app_info{};
+        app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        app_info.pApplicationName = "layer_hook_bench";
+        app_info.apiVersion = VK_API_VERSION_1_2;
+        VkInstanceCreateInfo instance_info{};
+        instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instance_info.pNext = layered ? &instance_link_info : nullptr;
+        instance_info.pApplicationInfo = &app_info;
+        instance_info.enabledExtensionCount = 2;
+        instance_info.ppEnabledExtensionNames = instance_extensions;
+        if (Instance<PFN_vkCreateInstance>("vkCreateInstance")(&instance_info, nullptr, &instance) != VK_SUCCESS) {
+            return false;
+        }
+
+        uint32_t physical_device_count = 1;
+        VkPhysicalDevice physical_device;
+        if (Instance<PFN_vkEnumeratePhysicalDevices>("vkEnumeratePhysicalDevices")(instance, &physical_device_count,
+                                                                                   &physical_device) != VK_SUCCESS) {
+            return false;
+        }
+
+        VkLayerDeviceLink device_link{};
+        device_link.pfnNextGetInstanceProcAddr = TermGetInstanceProcAddr;
+        device_link.pfnNextGetDeviceProcAddr = TermGetDeviceProcAddr;
+        VkLayerDeviceCreateInfo loader_data_info{};
+        loader_data_info.sType = VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO;
+        loader_data_info.function = VK_LOADER_DATA_CALLBACK;
+        loader_data_info.u.pfnSetDeviceLoaderData = SetDeviceLoaderData;
+        VkLayerDeviceCreateInfo device_link_info{};
+        device_link_info.sType = VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO;
+        device_link_info.pNext = &loader_data_info;
+        device_link_info.function = VK_LAYER_LINK_INFO;
+        device_link_info.u.pLayerInfo = &device_link;
+
+        float priorities[kMaxThreads];
+        std::fill(std::begin(priorities), std::end(priorities), 1.0f);
+        VkDeviceQueueCreateInfo queue_info{};
+        queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queue_info.queueFamilyIndex = 0;
+        queue_info.queueCount = kMaxThreads;
+        queue_info.pQueuePriorities = priorities;
+
+        const char* device_extensions[] = {"VK_KHR_swapchain"};
+        VkDeviceCreateInfo device_info{};
+        device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        device_info.pNext = layered ? &device_link_info : nullptr;
+        device_info.queueCreateInfoCount = 1;
+        device_info.pQueueCreateInfos = &queue_info;
+        device_info.enabledExtensionCount = 1;
+        device_info.ppEnabledExtensionNames = device_extensions;
+        auto create_device = Instance<PFN_vkCreateDevice>("vkCreateDevice");
+        if (create_device(physical_device, &device_info, nullptr, &device) != VK_SUCCESS) return false;
+
+        CmdDraw = Device<PFN_vkCmdDraw>("vkCmdDraw");
+        CmdBeginRenderPass = Device<PFN_vkCmdBeginRenderPass>("vkCmdBeginRenderPass");
+        CmdEndRenderPass = Device<PFN_vkCmdEndRenderPass>("vkCmdEndRenderPass");
+        AcquireNextImageKHR = Device<PFN_vkAcquireNextImageKHR>("vkAcquireNextImageKHR");
+        QueuePresentKHR = Device<PFN_vkQueuePresentKHR>("vkQueuePresentKHR");
+        return CmdDraw && CmdBeginRenderPass && CmdEndRenderPass && AcquireNextImageKHR && QueuePresentKHR;
+    }
+
+    bool CreateWorkers(VkPresentModeKHR present_mode) {
+        VkAttachmentDescription attachment{};
+        attachment.format = VK_FORMAT_B8G8R8A8_UNORM;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        VkAttachmentReference color_reference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &color_reference;
+        VkRenderPassCreateInfo render_pass_info{};
+        render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        render_pass_info.attachmentCount = 1;
+        render_pass_info.pAttachments = &attachment;
+        render_pass_info.subpassCount = 1;
+        render_pass_info.pSubpasses = &subpass;
+        if (Device<PFN_vkCreateRenderPass>("vkCreateRenderPass")(device, &render_pass_info, nullptr, &render_pass) !=
+            VK_SUCCESS) {
+            return false;
+        }
+
+        auto create_surface = Instance<PFN_vkCreateHeadlessSurfaceEXT>("vkCreateHeadlessSurfaceEXT");
+        auto get_queue = Device<PFN_vkGetDeviceQueue>("vkGetDeviceQueue");
+        auto create_pool = Device<PFN_vkCreateCommandPool>("vkCreateCommandPool");
+        auto allocate = Device<PFN_vkAllocateCommandBuffers>("vkAllocateCommandBuffers");
+        auto begin = Device<PFN_vkBeginCommandBuffer>("vkBeginCommandBuffer");
+        auto create_swapchain = Device<PFN_vkCreateSwapchainKHR>("vkCreateSwapchainKHR");
+        auto create_semaphore = Device<PFN_vkCreateSemaphore>("vkCreateSemaphore");
+        auto create_framebuffer = Device<PFN_vkCreateFramebuffer>("vkCreateFramebuffer");
+        if (!create_surface) return false;
+
+        workers.resize(kMaxThreads);
+        for (uint32_t i = 0; i < kMaxThreads; i++) {
+            Worker& worker = workers[i];
+            get_queue(device, 0, i, &worker.queue);
+
+            VkCommandPoolCreateInfo pool_info{};
+            pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            if (create_pool(device, &pool_info, nullptr, &worker.command_pool) != VK_SUCCESS) return false;
+            VkCommandBufferAllocateInfo allocate_info{};
+            allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocate_info.commandPool = worker.command_pool;
+            allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocate_info.commandBufferCount = 1;
+            if (allocate(device, &allocate_info, &worker.command_buffer) != VK_SUCCESS) return false;
+            VkCommandBufferBeginInfo begin_info{};
+            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            if (begin(worker.command_buffer, &begin_info) != VK_SUCCESS) return false;
+
+            VkHeadlessSurfaceCreateInfoEXT surface_info{};
+            surface_info.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+            if (create_surface(instance, &surface_info, nullptr, &worker.surface) != VK_SUCCESS) return false;
+
+            VkSwapchainCreateInfoKHR swapchain_info{};
+            swapchain_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+            swapchain_info.surface = worker.surface;
+            swapchain_info.minImageCount = 3;
+            swapchain_info.imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+            swapchain_info.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+            swapchain_info.imageExtent = {1280, 720};
+            swapchain_info.imageArrayLayers = 1;
+            swapchain_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            swapchain_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            swapchain_info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+            swapchain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+            swapchain_info.presentMode = present_mode;
+            swapchain_info.clipped = VK_TRUE;
+            if (create_swapchain(device, &swapchain_info, nullptr, &worker.swapchain) != VK_SUCCESS) return false;
+
+            VkSemaphoreCreateInfo semaphore_info{};
+            semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+            if (create_semaphore(device, &semaphore_info, nullptr, &worker.acquired) != VK_SUCCESS) return false;
+
+            VkFramebufferCreateInfo framebuffer_info{};
+            framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebuffer_info.renderPass = render_pass;
+            framebuffer_info.width = 1280;
+            framebuffer_info.height = 720;
+            framebuffer_info.layers = 1;
+            if (create_framebuffer(device, &framebuffer_info, nullptr, &worker.framebuffer) != VK_SUCCESS) return false;
+        }
+        return true;
+    }
+
+    void Destroy() {
+        if (device) {
+            Device<PFN_vkDeviceWaitIdle>("vkDeviceWaitIdle")(device);
+            auto end = Device<PFN_vkEndCommandBuffer>("vkEndCommandBuffer");
+            auto destroy_pool = Device<PFN_vkDestroyCommandPool>("vkDestroyCommandPool");
+            auto destroy_swapchain = Device<PFN_vkDestroySwapchainKHR>("vkDestroySwapchainKHR");
+            auto destroy_semaphore = Device<PFN_vkDestroySemaphore>("vkDestroySemaphore");
+            auto destroy_framebuffer = Device<PFN_vkDestroyFramebuffer>("vkDestroyFramebuffer");
+            auto destroy_surface = Instance<PFN_vkDestroySurfaceKHR>("vkDestroySurfaceKHR");
+            for (Worker& worker : workers) {
+                if (worker.command_buffer) end(worker.command_buffer);
+                if (worker.command_pool) destroy_pool(device, worker.command_pool, nullptr);
+                if (worker.framebuffer) destroy_framebuffer(device, worker.framebuffer, nullptr);
+                if (worker.acquired) destroy_semaphore(device, worker.acquired, nullptr);
+                if (worker.swapchain) destroy_swapchain(device, worker.swapchain, nullptr);
+                if (worker.surface) destroy_surface(instance, worker.surface, nullptr);
+            }
+            if (render_pass) Device<PFN_vkDestroyRenderPass>("vkDestroyRenderPass")(device, render_pass, nullptr);
+            Device<PFN_vkDestroyDevice>("vkDestroyDevice")(device, nullptr);
+        }
+        if (instance) Instance<PFN_vkDestroyInstance>("vkDestroyInstance")(instance, nullptr);
+        workers.clear();
+        device = VK_NULL_HANDLE;
+        instance = VK_NULL_HANDLE;
+    }
+};
+
+enum class Hook { CmdDraw, CmdBeginRenderPass, AcquireNextImage, QueuePresent, GetDeviceProcAddr };
+
+struct HookInfo {
+    Hook hook;
+    const char* name;
+    bool per_frame;   // --frames iterations rather than --iterations
+};
+
+static const HookInfo kHooks[] = {
+    {Hook::CmdDraw, "vkCmdDraw", false},
+    {Hook::CmdBeginRenderPass, "vkCmdBeginRenderPass", false},
+    {Hook::AcquireNextImage, "vkAcquireNextImageKHR", true},
+    {Hook::QueuePresent, "vkQueuePresentKHR", true},
+    {Hook::GetDeviceProcAddr, "vkGetDeviceProcAddr", false},
+};
+
+// Hooked by some layer, and not hooked by any
+static const char* const kProcNames[] = {
+    "vkCmdDraw", "vkCmdBeginRenderPass", "vkQueuePresentKHR", "vkAcquireNextImageKHR",
+    "vkCmdDispatch", "vkCreateBuffer", "vkCmdCopyBuffer", "vkResetFences",
+};
+
+static double NowNs() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Runs `iterations` of `hook` on one worker; returns the timed ns
+static double RunHook(const Chain& chain, Worker& worker, Hook hook, uint64_t iterations) {
+    VkRenderPassBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    begin_info.renderPass = chain.render_pass;
+    begin_info.framebuffer = worker.framebuffer;
+    begin_info.renderArea.extent = {1280, 720};
+    VkClearValue clear{};
+    begin_info.clearValueCount = 1;
+    begin_info.pClearValues = &clear;
+
+    switch (hook) {
+    case Hook::CmdDraw: {
+        chain.CmdBeginRenderPass(worker.command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+        double start = NowNs();
+        for (uint64_t i = 0; i < iterations; i++) chain.CmdDraw(worker.command_buffer, 3, 1, 0, 0);
+        double elapsed = NowNs() - start;
+        chain.CmdEndRenderPass(worker.command_buffer);
+        return elapsed;
+    }
+    case Hook::CmdBeginRenderPass: {
+        double start = NowNs();
+        for (uint64_t i = 0; i < iterations; i++) {
+            chain.CmdBeginRenderPass(worker.command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+            chain.CmdEndRenderPass(worker.command_buffer);
+        }
+        return NowNs() - start;
+    }
+    case Hook::AcquireNextImage:
+    case Hook::QueuePresent: {
+        VkPresentInfoKHR present_info{};
+        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        present_info.waitSemaphoreCount = 1;
+        present_info.pWaitSemaphores = &worker.acquired;
+        present_info.swapchainCount = 1;
+        present_info.pSwapchains = &worker.swapchain;
+        uint32_t image_index = 0;
+        present_info.pImageIndices = &image_index;
+
+        double acquire_ns = 0.0;
+        double present_ns = 0.0;
+        for (uint64_t i = 0; i < iterations; i++) {
+            double t0 = NowNs();
+            chain.AcquireNextImageKHR(chain.device, worker.swapchain, UINT64_MAX, worker.acquired, VK_NULL_HANDLE,
+                                      &image_index);
+            double t1 = NowNs();
+            chain.QueuePresentKHR(worker.queue, &present_info);
+            double t2 = NowNs();
+            acquire_ns += t1 - t0;
+            present_ns += t2 - t1;
+        }
+        return hook == Hook::AcquireNextImage ? acquire_ns : present_ns;
+    }
+    case Hook::GetDeviceProcAddr: {
+        constexpr size_t kNameCount = sizeof(kProcNames) / sizeof(kProcNames[0]);
+        uintptr_t sink = 0;
+        double start = NowNs();
+        for (uint64_t i = 0; i < iterations; i++) {
+            sink ^= reinterpret_cast<uintptr_t>(chain.gdpa(chain.device, kProcNames[i % kNameCount]));
+        }
+        double elapsed = NowNs() - start;
+        static volatile uintptr_t keep;
+        keep = sink;
+        return elapsed;
+    }
+    }
+    return 0.0;
+}
+
+struct Measurement {
+    double ns_per_call;       // Mean over threads
+    double calls_per_second;  // Summed over threads
+};
+
+// All `threads` workers start together; each times its own loop
+static Measurement MeasureHook(Chain& chain, Hook hook, uint32_t threads, uint64_t iterations) {
+    std::vector<double> elapsed(threads, 0.0);
+    std::atomic<uint32_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> pool;
+    for (uint32_t t = 0; t < threads; t++) {
+        pool.emplace_back([&, t]() {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            elapsed[t] = RunHook(chain, chain.workers[t], hook, iterations);
+        });
+    }
+    while (ready.load() < threads) std::this_thread::yield();
+    go.store(true, std::memory_order_release);
+    for (std::thread& thread : pool) thread.join();
+
+    Measurement measurement{0.0, 0.0};
+    for (double ns : elapsed) {
+        measurement.ns_per_call += ns / static_cast<double>(iterations) / threads;
+        measurement.calls_per_second += static_cast<double>(iterations) * 1e9 / std::max(ns, 1.0);
+    }
+    return measurement;
+}
+
+// Layers print to stdout; keep that out of the table and the timing
+static int SilenceStdout() {
+    std::fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved;
+}
+
+static void RestoreStdout(int saved) {
+    std::fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+static void RemoveDirectory(const std::string& path) {
+    if (DIR* dir = opendir(path.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) unlink((path + "/" + entry->d_name).c_str());
+        }
+        closedir(dir);
+    }
+    rmdir(path.c_str());
+}
+
+struct Result {
+    const char* layer;
+    const char* hook;
+    uint32_t threads;
+    Measurement measurement;
+    double overhead_ns = 0.0;
+    double scaling = 1.0;
+    double baseline_scaling = 1.0;
+};
+
+static const Result* FindResult(const std::vector<Result>& results, const char* layer, const char* hook, uint32_t threads) {
+    for (const Result& result : results) {
+        if (!strcmp(result.layer, layer) && !strcmp(result.hook, hook) && result.threads == threads) return &result;
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv) {
+    uint32_t max_threads = std::min(kMaxThreads, std::max(1u, std::thread::hardware_concurrency()));
+    uint64_t iterations = 1000000;
+    uint64_t frames = 20000;
+    VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
+    const char* present_mode_name = "fifo";
+    std::string output_path;
+    std::string lib_dir = "lib";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--threads" && has_value) {
+            max_threads = std::min<uint32_t>(kMaxThreads, std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--iterations" && has_value) {
+            iterations = std::max<long long>(1, std::atoll(argv[++i]));
+        } else if (arg == "--frames" && has_value) {
+            frames = std::max<long long>(1, std::atoll(argv[++i]));
+        } else if (arg == "--present-mode" && has_value) {
+            present_mode_name = argv[++i];
+            if (!strcmp(present_mode_name, "fifo")) present_mode = VK_PRESENT_MODE_FIFO_KHR;
+            else if (!strcmp(present_mode_name, "mailbox")) present_mode = VK_PRESENT_MODE_MAILBOX_KHR;
+            else if (!strcmp(present_mode_name, "immediate")) present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            else return 2;
+        } else if (arg == "-o" && has_value) {
+            output_path = argv[++i];
+        } else if (arg[0] != '-') {
+            lib_dir = arg;
+        } else {
+            std::fprintf(stderr,
+                         "Usage: %s [--threads N] [--iterations N] [--frames N]\n"
+                         "          [--present-mode fifo|mailbox|immediate] [-o out.json] [lib dir]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Resolved before moving into the scratch directory
+    char cwd[PATH_MAX];
+    char resolved[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) return 1;
+    if (!realpath(lib_dir.c_str(), resolved)) {
+        std::fprintf(stderr, "No library directory %s\n", lib_dir.c_str());
+        return 1;
+    }
+    lib_dir = resolved;
+    if (!output_path.empty() && output_path[0] != '/') output_path = std::string(cwd) + "/" + output_path;
+    if (!LoadIcd(lib_dir)) return 1;
+
+    char scratch[] = "/tmp/layer_hook_bench_XXXXXX";
+    if (!mkdtemp(scratch) || chdir(scratch) != 0) return 1;
+    setenv("VK_LOGGER_TRACE", "layer_hook_bench.trace", 0);
+    setenv("MOCK_ICD_CLOCK", "virtual", 1);
+    setenv("MOCK_ICD_FRAME_US", "0", 1);
+    setenv("MOCK_ICD_HITCHES", "", 1);
+
+    std::vector<uint32_t> thread_counts;
+    for (uint32_t threads = 1; threads < max_threads; threads *= 2) thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+
+    const char* const configurations[] = {
+        nullptr, "VK_LAYER_logger", "VK_LAYER_green_tint", "VK_LAYER_text_overlay", "VK_LAYER_frame_interpolation",
+    };
+
+    std::vector<Result> results;
+    for (const char* layer : configurations) {
+        Chain chain;
+        if (!chain.Load(lib_dir, layer)) {
+            std::fprintf(stderr, "%s skipped\n", layer);
+            continue;
+        }
+        int saved = SilenceStdout();
+        bool created = chain.CreateInstanceAndDevice() && chain.CreateWorkers(present_mode);
+        if (created) {
+            for (const HookInfo& hook : kHooks) {
+                for (uint32_t threads : thread_counts) {
+                    Result result{layer ? layer : "none", hook.name, threads, {}};
+                    result.measurement = MeasureHook(chain, hook.hook, threads, hook.per_frame ? frames : iterations);
+                    results.push_back(result);
+                }
+            }
+        }
+        chain.Destroy();
+        RestoreStdout(saved);
+        if (!created) std::fprintf(stderr, "%s: instance, device or swapchain setup failed\n", layer ? layer : "none");
+    }
+
+    if (chdir(cwd) != 0) return 1;
+    RemoveDirectory(scratch);
+
+    // Overhead against the baseline at the same thread count; scaling against
+    // the same configuration on one thread
+    for (Result& result : results) {
+        const Result* baseline = FindResult(results, "none", result.hook, result.threads);
+        const Result* single = FindResult(results, result.layer, result.hook, 1);
+        const Result* baseline_single = FindResult(results, "none", result.hook, 1);
+        if (baseline) result.overhead_ns = result.measurement.ns_per_call - baseline->measurement.ns_per_call;
+        if (single) {
+            result.scaling = result.measurement.calls_per_second / (result.threads * single->measurement.calls_per_second);
+        }
+        if (baseline && baseline_single) {
+            result.baseline_scaling =
+                baseline->measurement.calls_per_second / (result.threads * baseline_single->measurement.calls_per_second);
+        }
+    }
+
+    std::printf("%llu iterations, %llu frames, %s swapchains, %u hardware threads\n\n",
+                static_cast<unsigned long long>(iterations), static_cast<unsigned long long>(frames), present_mode_name,
+                std::thread::hardware_concurrency());
+    std::printf("%-30s %-22s %7s %10s %11s %8s %9s\n", "layer", "hook", "threads", "ns/call", "ns overhead", "scaling",
+                "baseline");
+    for (const Result& result : results) {
+        std::printf("%-30s %-22s %7u %10.2f %11.2f %8.2f %9.2f\n", result.layer, result.hook, result.threads,
+                    result.measurement.ns_per_call, result.overhead_ns, result.scaling, result.baseline_scaling);
+    }
+
+    if (!output_path.empty()) {
+        std::FILE* out = std::fopen(output_path.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "Cannot write %s\n", output_path.c_str());
+            return 1;
+        }
+        std::fprintf(out, "{\n  \"tool\": \"layer_hook_bench\",\n  \"layer_version\": \"%s\",\n", LAYER_VERSION);
+        std::fprintf(out, "  \"iterations\": %llu,\n  \"frames\": %llu,\n  \"present_mode\": \"%s\",\n",
+                     static_cast<unsigned long long>(iterations), static_cast<unsigned long long>(frames),
+                     present_mode_name);
+        std::fprintf(out, "  \"hardware_threads\": %u,\n  \"results\": [\n", std::thread::hardware_concurrency());
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& result = results[i];
+            std::fprintf(out, "    {\"layer\": \"%s\", \"hook\": \"%s\", \"threads\": %u, \"ns_per_call\": %.3f, ",
+                         result.layer, result.hook, result.threads, result.measurement.ns_per_call);
+            std::fprintf(out, "\"overhead_ns\": %.3f, \"calls_per_second\": %.0f, \"scaling_efficiency\": %.4f, ",
+                         result.overhead_ns, result.measurement.calls_per_second, result.scaling);
+            std::fprintf(out, "\"baseline_scaling_efficiency\": %.4f}%s\n", result.baseline_scaling,
+                         i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]\n}\n");
+        std::fclose(out);
+    }
+    return 0;
+}
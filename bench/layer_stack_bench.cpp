@@ -0,0 +1,239 @@
+// Per-draw cost of three stacked layers against one combined layer.
+//
+// Loads VK_LAYER_logger, VK_LAYER_text_overlay and VK_LAYER_frame_interpolation
+// and chains them the way the loader does, on top of a null driver defined
+// here, then does the same for VK_LAYER_combined with the matching modules
+// (VK_COMBINED_MODULES=overlay,interpolation,logger unless already set).
+// Both configurations log through the binary trace (VK_LOGGER_TRACE points
+// at temporary files), and layer console output goes to /dev/null while the
+// clock runs. Reports ns per vkCmdDraw as resolved through each chain's
+// vkGetDeviceProcAddr.
+//
+// Usage: layer_stack_bench [lib dir] [draws]
+//        (lib dir defaults to ./lib, i.e. run from the build directory)
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_layer.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Null driver. Dispatchable handles only need the loader's dispatch pointer
+// first; instances and physical devices share one, devices and their
+// children another.
+struct NullDispatchable {
+    void* loader_data;
+};
+
+static int instance_table, device_table;
+static NullDispatchable null_instance{&instance_table}, null_physical_device{&instance_table};
+static NullDispatchable null_device{&device_table}, null_command_buffer{&device_table};
+
+static uint64_t driver_draws = 0;
+
+static VKAPI_ATTR VkResult VKAPI_CALL NullCreateInstance(const VkInstanceCreateInfo*, const VkAllocationCallbacks*,
+                                                         VkInstance* pInstance) {
+    *pInstance = reinterpret_cast<VkInstance>(&null_instance);
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL NullDestroyInstance(VkInstance, const VkAllocationCallbacks*) {}
+
+static VKAPI_ATTR VkResult VKAPI_CALL NullEnumeratePhysicalDevices(VkInstance, uint32_t* pCount,
+                                                                   VkPhysicalDevice* pPhysicalDevices) {
+    if (pPhysicalDevices) pPhysicalDevices[0] = reinterpret_cast<VkPhysicalDevice>(&null_physical_device);
+    *pCount = 1;
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL NullCreateDevice(VkPhysicalDevice, const VkDeviceCreateInfo*,
+                                                       const VkAllocationCallbacks*, VkDevice* pDevice) {
+    *pDevice = reinterpret_cast<VkDevice>(&null_device);
+    return VK_SUCCESS;
+}
+
+static VKAPI_ATTR void VKAPI_CALL NullDestroyDevice(VkDevice, const VkAllocationCallbacks*) {}
+
+static VKAPI_ATTR void VKAPI_CALL NullCmdDraw(VkCommandBuffer, uint32_t, uint32_t, uint32_t, uint32_t) {
+    driver_draws++;
+}
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL NullGetDeviceProcAddr(VkDevice, const char* pName) {
+    if (!strcmp(pName, "vkGetDeviceProcAddr")) return reinterpret_cast<PFN_vkVoidFunction>(NullGetDeviceProcAddr);
+    if (!strcmp(pName, "vkDestroyDevice")) return reinterpret_cast<PFN_vkVoidFunction>(NullDestroyDevice);
+    if (!strcmp(pName, "vkCmdDraw")) return reinterpret_cast<PFN_vkVoidFunction>(NullCmdDraw);
+    return nullptr;
+}
+
+static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL NullGetInstanceProcAddr(VkInstance, const char* pName) {
+    if (!strcmp(pName, "vkGetInstanceProcAddr")) return reinterpret_cast<PFN_vkVoidFunction>(NullGetInstanceProcAddr);
+    if (!strcmp(pName, "vkCreateInstance")) return reinterpret_cast<PFN_vkVoidFunction>(NullCreateInstance);
+    if (!strcmp(pName, "vkDestroyInstance")) return reinterpret_cast<PFN_vkVoidFunction>(NullDestroyInstance);
+    if (!strcmp(pName, "vkEnumeratePhysicalDevices")) return reinterpret_cast<PFN_vkVoidFunction>(NullEnumeratePhysicalDevices);
+    if (!strcmp(pName, "vkCreateDevice")) return reinterpret_cast<PFN_vkVoidFunction>(NullCreateDevice);
+    return NullGetDeviceProcAddr(VK_NULL_HANDLE, pName);
+}
+
+// One chain of layers over the null driver, as the loader would build it
+struct LayerChain {
+    std::vector<PFN_vkGetInstanceProcAddr> gipas;
+    std::vector<PFN_vkGetDeviceProcAddr> gdpas;
+    VkInstance instance = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+
+    bool Load(const std::string& lib_dir, const std::vector<const char*>& layers) {
+        for (const char* layer : layers) {
+            std::string path = lib_dir + "/" + layer + ".so";
+            void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+            if (!handle) {
+                std::fprintf(stderr, "%s\n", dlerror());
+                return false;
+            }
+            gipas.push_back(reinterpret_cast<PFN_vkGetInstanceProcAddr>(dlsym(handle, "vkGetInstanceProcAddr")));
+            gdpas.push_back(reinterpret_cast<PFN_vkGetDeviceProcAddr>(dlsym(handle, "vkGetDeviceProcAddr")));
+        }
+        return true;
+    }
+
+    bool Create() {
+        size_t count = gipas.size();
+
+        // Each link names the element below the layer it is handed to
+        std::vector<VkLayerInstanceLink> instance_links(count);
+        for (size_t i = 0; i < count; i++) {
+            instance_links[i].pNext = (i + 1 < count) ? &instance_links[i + 1] : nullptr;
+            instance_links[i].pfnNextGetInstanceProcAddr = (i + 1 < count) ? gipas[i + 1] : NullGetInstanceProcAddr;
+            instance_links[i].pfnNextGetPhysicalDeviceProcAddr = nullptr;
+        }
+        VkLayerInstanceCreateInfo instance_link_info{};
+        instance_link_info.sType = VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO;
+        instance_link_info.function = VK_LAYER_LINK_INFO;
+        instance_link_info.u.pLayerInfo = instance_links.data();
+        VkInstanceCreateInfo instance_info{};
+        instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instance_info.pNext = &instance_link_info;
+
+        auto create_instance = reinterpret_cast<PFN_vkCreateInstance>(gipas[0](VK_NULL_HANDLE, "vkCreateInstance"));
+        if (create_instance(&instance_info, nullptr, &instance) != VK_SUCCESS) return false;
+
+        auto enumerate = reinterpret_cast<PFN_vkEnumeratePhysicalDevices>(gipas[0](instance, "vkEnumeratePhysicalDevices"));
+        uint32_t physical_device_count = 1;
+        VkPhysicalDevice physical_device;
+        if (enumerate(instance, &physical_device_count, &physical_device) != VK_SUCCESS) return false;
+
+        std::vector<VkLayerDeviceLink> device_links(count);
+        for (size_t i = 0; i < count; i++) {
+            device_links[i].pNext = (i + 1 < count) ? &device_links[i + 1] : nullptr;
+            device_links[i].pfnNextGetInstanceProcAddr = (i + 1 < count) ? gipas[i + 1] : NullGetInstanceProcAddr;
+            device_links[i].pfnNextGetDeviceProcAddr = (i + 1 < count) ? gdpas[i + 1] : NullGetDeviceProcAddr;
+        }
+        VkLayerDeviceCreateInfo device_link_info{};
+        device_link_info.sType = VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO;
+        device_link_info.function = VK_LAYER_LINK_INFO;
+        device_link_info.u.pLayerInfo = device_links.data();
+        VkDeviceCreateInfo device_info{};
+        device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        device_info.pNext = &device_link_info;
+
+        auto create_device = reinterpret_cast<PFN_vkCreateDevice>(gipas[0](instance, "vkCreateDevice"));
+        return create_device(physical_device, &device_info, nullptr, &device) == VK_SUCCESS;
+    }
+
+    void Destroy() {
+        reinterpret_cast<PFN_vkDestroyDevice>(gdpas[0](device, "vkDestroyDevice"))(device, nullptr);
+        reinterpret_cast<PFN_vkDestroyInstance>(gipas[0](instance, "vkDestroyInstance"))(instance, nullptr);
+    }
+
+    PFN_vkCmdDraw CmdDraw() const {
+        return reinterpret_cast<PFN_vkCmdDraw>(gdpas[0](device, "vkCmdDraw"));
+    }
+};
+
+static double NsPerDraw(PFN_vkCmdDraw draw, uint64_t draws) {
+    VkCommandBuffer command_buffer = reinterpret_cast<VkCommandBuffer>(&null_command_buffer);
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < draws; i++) {
+        draw(command_buffer, 3, 1, 0, 0);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(draws);
+}
+
+// Layers print to stdout; keep that out of the table and the timing
+static int SilenceStdout() {
+    std::fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+    return saved;
+}
+
+static void RestoreStdout(int saved) {
+    std::fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+// Sets up `layers`, times vkCmdDraw through them and tears them down.
+// Returns a negative value if the chain cannot be built.
+static double MeasureChain(const std::string& lib_dir, const std::vector<const char*>& layers,
+                           const char* trace_path, uint64_t draws) {
+    setenv("VK_LOGGER_TRACE", trace_path, 1);
+
+    LayerChain chain;
+    if (!chain.Load(lib_dir, layers)) return -1.0;
+
+    int saved = SilenceStdout();
+    double ns = -1.0;
+    if (chain.Create()) {
+        ns = NsPerDraw(chain.CmdDraw(), draws);
+        chain.Destroy();
+    }
+    RestoreStdout(saved);
+    return ns;
+}
+
+static void PrintRow(const char* label, double ns, double baseline) {
+    if (ns < 0) {
+        std::printf("%-48s %10s\n", label, "skipped");
+        return;
+    }
+    std::printf("%-48s %10.2f %12.2f\n", label, ns, ns - baseline);
+}
+
+int main(int argc, char** argv) {
+    std::string lib_dir = (argc > 1) ? argv[1] : "lib";
+    long long draws_arg = (argc > 2) ? std::atoll(argv[2]) : 2000000;
+    uint64_t draws = draws_arg > 0 ? static_cast<uint64_t>(draws_arg) : 1;
+
+    setenv("VK_COMBINED_MODULES", "overlay,interpolation,logger", 0);
+
+    std::string stack_trace = "layer_stack_bench_stack_" + std::to_string(getpid()) + ".trace";
+    std::string combined_trace = "layer_stack_bench_combined_" + std::to_string(getpid()) + ".trace";
+
+    std::printf("%llu draws, combined modules: %s\n\n", static_cast<unsigned long long>(draws),
+                std::getenv("VK_COMBINED_MODULES"));
+    std::printf("%-48s %10s %12s\n", "vkCmdDraw through", "ns/draw", "ns overhead");
+
+    double driver = NsPerDraw(NullCmdDraw, draws);
+    PrintRow("null driver", driver, driver);
+
+    double stacked = MeasureChain(lib_dir, {"VK_LAYER_logger", "VK_LAYER_text_overlay", "VK_LAYER_frame_interpolation"},
+                                  stack_trace.c_str(), draws);
+    PrintRow("logger + text_overlay + frame_interpolation", stacked, driver);
+
+    double combined = MeasureChain(lib_dir, {"VK_LAYER_combined"}, combined_trace.c_str(), draws);
+    PrintRow("VK_LAYER_combined", combined, driver);
+
+    unlink(stack_trace.c_str());
+    unlink(combined_trace.c_str());
+    return 0;
+}
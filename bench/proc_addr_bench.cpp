@@ -0,0 +1,120 @@
+// Startup cost of resolving entry points through the layers.
+//
+// Replays the full Vulkan 1.3 (+ swapchain) command set through
+// vkGetInstanceProcAddr and vkGetDeviceProcAddr, the way a loader or a
+// translation layer does at startup, and reports ns per lookup and us per
+// full pass.
+//
+// The first table compares the old linear strcmp chain against ProcHash in
+// process, using the largest hook list (green tint's device functions). The
+// second dlopen()s each built layer and resolves through its real exports
+// with null handles, so no driver is needed: hooked names come from the
+// layer's table and everything else misses.
+//
+// Usage: proc_addr_bench [lib dir] [passes]
+//        (lib dir defaults to ./lib, i.e. run from the build directory)
+
+#include "proc_table.h"
+#include "vulkan_commands.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <string>
+
+static void Dummy() {}
+
+#define BENCH_DEVICE_PROCS(X) \
+    X(vkDestroyDevice, Dummy) \
+    X(vkGetDeviceQueue, Dummy) \
+    X(vkGetDeviceQueue2, Dummy) \
+    X(vkCreateShaderModule, Dummy) \
+    X(vkDestroyShaderModule, Dummy) \
+    X(vkCreateRenderPass, Dummy) \
+    X(vkDestroyRenderPass, Dummy) \
+    X(vkCmdBeginRenderPass, Dummy) \
+    X(vkCmdEndRenderPass, Dummy) \
+    X(vkCmdDraw, Dummy) \
+    X(vkCmdDrawIndexed, Dummy) \
+    X(vkQueuePresentKHR, Dummy) \
+    X(vkGetDeviceProcAddr, Dummy)
+
+DECLARE_PROC_TABLE(bench_procs, BENCH_DEVICE_PROCS);
+
+// What every layer did before: one strcmp per hooked name until a match
+static PFN_vkVoidFunction LinearFind(const char* name) {
+    for (size_t i = 0; i < std::size(bench_procs_names); i++) {
+        if (strcmp(name, bench_procs_names[i]) == 0) return bench_procs_functions[i];
+    }
+    return nullptr;
+}
+
+static PFN_vkVoidFunction HashFind(const char* name) {
+    return bench_procs.Find(name);
+}
+
+template <typename Resolve>
+static double NsPerLookup(Resolve resolve, int passes, size_t* found) {
+    size_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (const char* name : kVulkanCommands) {
+            if (resolve(name)) hits++;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    *found = hits / static_cast<size_t>(passes);
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           (static_cast<double>(passes) * std::size(kVulkanCommands));
+}
+
+static void PrintRow(const char* label, double ns, size_t found) {
+    std::printf("%-38s %10.2f %12.2f %8zu\n", label, ns, ns * std::size(kVulkanCommands) / 1000.0, found);
+}
+
+int main(int argc, char** argv) {
+    std::string lib_dir = (argc > 1) ? argv[1] : "lib";
+    int passes = (argc > 2) ? std::atoi(argv[2]) : 20000;
+    if (passes <= 0) passes = 1;
+
+    std::printf("%zu commands, %d passes\n\n", std::size(kVulkanCommands), passes);
+    std::printf("%-38s %10s %12s %8s\n", "lookup", "ns/name", "us/pass", "hooked");
+
+    size_t found = 0;
+    double ns = NsPerLookup(LinearFind, passes, &found);
+    PrintRow("strcmp chain (13 hooks)", ns, found);
+    ns = NsPerLookup(HashFind, passes, &found);
+    PrintRow("ProcHash (13 hooks)", ns, found);
+
+    static const char* const layers[] = {
+        "VK_LAYER_logger",
+        "VK_LAYER_green_tint",
+        "VK_LAYER_text_overlay",
+        "VK_LAYER_frame_interpolation",
+    };
+
+    std::printf("\n");
+    for (const char* layer : layers) {
+        std::string path = lib_dir + "/" + layer + ".so";
+        void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            std::printf("%-38s skipped (%s)\n", layer, dlerror());
+            continue;
+        }
+
+        auto gipa = reinterpret_cast<PFN_vkGetInstanceProcAddr>(dlsym(handle, "vkGetInstanceProcAddr"));
+        auto gdpa = reinterpret_cast<PFN_vkGetDeviceProcAddr>(dlsym(handle, "vkGetDeviceProcAddr"));
+        if (gipa) {
+            ns = NsPerLookup([gipa](const char* name) { return gipa(VK_NULL_HANDLE, name); }, passes, &found);
+            PrintRow((std::string(layer) + " instance").c_str(), ns, found);
+        }
+        if (gdpa) {
+            ns = NsPerLookup([gdpa](const char* name) { return gdpa(VK_NULL_HANDLE, name); }, passes, &found);
+            PrintRow((std::string(layer) + " device").c_str(), ns, found);
+        }
+        dlclose(handle);
+    }
+    return 0;
+}
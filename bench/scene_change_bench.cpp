@@ -0,0 +1,176 @@
+// Scene change detection cost and accuracy.
+//
+// Cost: SceneChangeDetector::AddFrame (histogram plus compare) per frame at
+// 1080p and 4K, 8 and 10 bits per channel. The GPU passes sample the same
+// grid; this is the software backend's cost per application frame, against
+// a budget of 0.1 ms at 1080p.
+//
+// Accuracy: pairs that must not be cuts (a pan, a small brightness step)
+// and pairs that must (a change of palette, a fade to black), with the
+// histogram distance as a share of the cut threshold. Histograms are
+// also checked bin for bin against a plain per-pixel reference.
+//
+// Usage: scene_change_bench [iterations]
+
+#include "scene_change.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static uint32_t Hash(int x, int y) {
+    uint32_t h = static_cast<uint32_t>(x) * 0x8da6b343u ^ static_cast<uint32_t>(y) * 0xd8163841u;
+    h ^= h >> 13;
+    h *= 0x85ebca6bu;
+    return h ^ (h >> 16);
+}
+
+// Bilinear value noise over a `cell`-pixel lattice
+static float ValueNoise(int x, int y, int cell) {
+    int cx = x >= 0 ? x / cell : (x - cell + 1) / cell;
+    int cy = y >= 0 ? y / cell : (y - cell + 1) / cell;
+    float fx = static_cast<float>(x - cx * cell) / cell;
+    float fy = static_cast<float>(y - cy * cell) / cell;
+    auto corner = [](int i, int j) { return static_cast<float>(Hash(i, j) & 0xff); };
+    float top = corner(cx, cy) + (corner(cx + 1, cy) - corner(cx, cy)) * fx;
+    float bottom = corner(cx, cy + 1) + (corner(cx + 1, cy + 1) - corner(cx, cy + 1)) * fx;
+    return top + (bottom - top) * fy;
+}
+
+struct Scene {
+    int pan_x = 0;
+    int pan_y = 0;
+    float gain = 1.0f;        // Applied to every channel
+    bool other_palette = false;
+};
+
+// The noise texture through one of two palettes, 8 or 10 bits per channel
+static std::vector<uint8_t> MakeFrame(uint32_t width, uint32_t height, SoftwareFormat format, const Scene& scene) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            int u = static_cast<int>(x) - scene.pan_x;
+            int v = static_cast<int>(y) - scene.pan_y;
+            float value = 0.5f * ValueNoise(u, v, 32) + 0.3f * ValueNoise(u, v, 8) + 0.2f * ValueNoise(u, v, 2);
+            float r = value;
+            float g = 255.0f - value;
+            float b = value * 0.5f;
+            if (scene.other_palette) {
+                // Bright sky over dark ground: luma far from the first palette's
+                r = 200.0f + value * 0.2f;
+                g = y < height / 3 ? 230.0f : 40.0f + value * 0.1f;
+                b = y < height / 3 ? 255.0f : 20.0f;
+            }
+            r = std::min(r * scene.gain, 255.0f);
+            g = std::min(g * scene.gain, 255.0f);
+            b = std::min(b * scene.gain, 255.0f);
+
+            uint8_t* p = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+            if (format == SoftwareFormat::Rgb10A2) {
+                uint32_t packed = static_cast<uint32_t>(r * 4.0f) | static_cast<uint32_t>(g * 4.0f) << 10 |
+                                  static_cast<uint32_t>(b * 4.0f) << 20 | 3u << 30;
+                std::memcpy(p, &packed, 4);
+            } else {
+                p[0] = static_cast<uint8_t>(r);
+                p[1] = static_cast<uint8_t>(g);
+                p[2] = static_cast<uint8_t>(b);
+                p[3] = 255;
+            }
+        }
+    }
+    return pixels;
+}
+
+// One pixel at a time, no SIMD: what BuildHistogram has to match
+static SceneChangeDetector::Histogram ReferenceHistogram(const std::vector<uint8_t>& pixels, uint32_t width,
+                                                         uint32_t height, SoftwareFormat format) {
+    SceneChangeDetector::Histogram histogram{};
+    for (uint32_t y = 0; y < height; y += SceneChangeDetector::kSampleStepY) {
+        for (uint32_t x = 0; x < width; x += SceneChangeDetector::kSampleStepX) {
+            const uint8_t* p = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+            uint32_t r = p[0];
+            uint32_t g = p[1];
+            uint32_t b = p[2];
+            if (format == SoftwareFormat::Rgb10A2) {
+                uint32_t packed;
+                std::memcpy(&packed, p, 4);
+                r = (packed >> 2) & 0xff;
+                g = (packed >> 12) & 0xff;
+                b = (packed >> 22) & 0xff;
+            }
+            histogram[((77 * r + 150 * g + 29 * b + 128) >> 8) >> 2]++;
+        }
+    }
+    return histogram;
+}
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 200;
+
+    const struct { uint32_t width, height; const char* name; } resolutions[] = {
+        {1920, 1080, "1080p"},
+        {3840, 2160, "4K"},
+    };
+    const struct { SoftwareFormat format; const char* name; } formats[] = {
+        {SoftwareFormat::Rgba8, "rgba8"},
+        {SoftwareFormat::Rgb10A2, "rgb10a2"},
+    };
+    const struct { Scene scene; bool cut; const char* name; } pairs[] = {
+        {{24, -14, 1.0f, false}, false, "pan"},
+        {{0, 0, 1.1f, false}, false, "+10% bright"},
+        {{0, 0, 1.0f, true}, true, "new palette"},
+        {{0, 0, 0.1f, false}, true, "fade to black"},
+    };
+
+    std::printf("%d iterations\n", iterations);
+    std::printf("%-6s %-8s %10s %10s\n", "res", "format", "ms/frame", "bins");
+    bool all_correct = true;
+    for (const auto& resolution : resolutions) {
+        for (const auto& format : formats) {
+            uint32_t width = resolution.width;
+            uint32_t height = resolution.height;
+            size_t pitch = static_cast<size_t>(width) * 4;
+            std::vector<uint8_t> frame0 = MakeFrame(width, height, format.format, Scene{});
+            std::vector<uint8_t> frame1 = MakeFrame(width, height, format.format, pairs[0].scene);
+
+            SceneChangeDetector detector(width, height, format.format);
+            detector.AddFrame(frame0.data(), pitch);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                detector.AddFrame(((i & 1) ? frame0 : frame1).data(), pitch);
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            double ms = std::chrono::duration<double, std::milli>(elapsed).count() / iterations;
+
+            SceneChangeDetector::Histogram histogram;
+            SceneChangeDetector::BuildHistogram(frame1.data(), pitch, width, height, format.format, &histogram);
+            bool bins_match = histogram == ReferenceHistogram(frame1, width, height, format.format);
+            all_correct &= bins_match;
+            std::printf("%-6s %-8s %10.4f %10s\n", resolution.name, format.name, ms, bins_match ? "exact" : "WRONG");
+        }
+    }
+
+    std::printf("\n%-14s %-8s %12s %6s\n", "1080p pair", "format", "of threshold", "cut");
+    for (const auto& pair : pairs) {
+        for (const auto& format : formats) {
+            uint32_t width = 1920;
+            uint32_t height = 1080;
+            size_t pitch = static_cast<size_t>(width) * 4;
+            std::vector<uint8_t> frame0 = MakeFrame(width, height, format.format, Scene{});
+            std::vector<uint8_t> frame1 = MakeFrame(width, height, format.format, pair.scene);
+
+            SceneChangeDetector detector(width, height, format.format);
+            detector.AddFrame(frame0.data(), pitch);
+            bool cut = detector.AddFrame(frame1.data(), pitch);
+            double share = static_cast<double>(detector.LastDistance()) /
+                           SceneChangeDetector::CutThreshold(width, height);
+            all_correct &= cut == pair.cut;
+            std::printf("%-14s %-8s %11.0f%% %6s%s\n", pair.name, format.name, 100.0 * share, cut ? "yes" : "no",
+                        cut == pair.cut ? "" : "  (WRONG)");
+        }
+    }
+    return all_correct ? 0 : 1;
+}
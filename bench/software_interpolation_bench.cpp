@@ -0,0 +1,160 @@
+// Software interpolation throughput at 720p and 1080p.
+//
+// Two procedural frames (multi-octave value noise) differ by an even pan, so
+// the true middle frame is the texture moved by half of it. For each format
+// and mode, single-threaded and on every hardware thread, reports the CPU
+// cost per application frame (AddFrame plus one Interpolate), the 2x output
+// rate that cost allows, and the share of interior pixels that exactly match
+// the true middle frame. Readback and upload copies are not included.
+//
+// Usage: software_interpolation_bench [iterations] [pan_x] [pan_y]
+
+#include "software_interpolation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static uint32_t Hash(int x, int y) {
+    uint32_t h = static_cast<uint32_t>(x) * 0x8da6b343u ^ static_cast<uint32_t>(y) * 0xd8163841u;
+    h ^= h >> 13;
+    h *= 0x85ebca6bu;
+    return h ^ (h >> 16);
+}
+
+// Bilinear value noise over a `cell`-pixel lattice
+static float ValueNoise(int x, int y, int cell) {
+    int cx = x >= 0 ? x / cell : (x - cell + 1) / cell;
+    int cy = y >= 0 ? y / cell : (y - cell + 1) / cell;
+    float fx = static_cast<float>(x - cx * cell) / cell;
+    float fy = static_cast<float>(y - cy * cell) / cell;
+    auto corner = [](int i, int j) { return static_cast<float>(Hash(i, j) & 0xff); };
+    float top = corner(cx, cy) + (corner(cx + 1, cy) - corner(cx, cy)) * fx;
+    float bottom = corner(cx, cy + 1) + (corner(cx + 1, cy + 1) - corner(cx, cy + 1)) * fx;
+    return top + (bottom - top) * fy;
+}
+
+// Frame of the texture moved by (pan_x, pan_y), 8 or 10 bits per channel
+static std::vector<uint8_t> MakeFrame(uint32_t width, uint32_t height, SoftwareFormat format, int pan_x, int pan_y) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            int u = static_cast<int>(x) - pan_x;
+            int v = static_cast<int>(y) - pan_y;
+            float value = 0.5f * ValueNoise(u, v, 32) + 0.3f * ValueNoise(u, v, 8) + 0.2f * ValueNoise(u, v, 2);
+            uint8_t* p = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+            if (format == SoftwareFormat::Rgb10A2) {
+                uint32_t r = static_cast<uint32_t>(value * 4.0f);
+                uint32_t g = static_cast<uint32_t>((255.0f - value) * 4.0f);
+                uint32_t b = static_cast<uint32_t>(value * 2.0f);
+                uint32_t packed = r | g << 10 | b << 20 | 3u << 30;
+                std::memcpy(p, &packed, 4);
+            } else {
+                p[0] = static_cast<uint8_t>(value);
+                p[1] = static_cast<uint8_t>(255.0f - value);
+                p[2] = static_cast<uint8_t>(value * 0.5f);
+                p[3] = 255;
+            }
+        }
+    }
+    return pixels;
+}
+
+struct RunResult {
+    double ms_per_frame = 0.0;
+    double exact_fraction = 0.0;
+};
+
+static RunResult Run(uint32_t width, uint32_t height, SoftwareFormat format, SoftwareInterpolationMode mode,
+                     uint32_t threads, const std::vector<uint8_t>& frame0, const std::vector<uint8_t>& frame1,
+                     const std::vector<uint8_t>& middle, int pan_x, int pan_y, int iterations) {
+    SoftwareInterpolatorOptions options;
+    options.mode = mode;
+    options.threads = threads;
+    std::unique_ptr<SoftwareInterpolator> interpolator = SoftwareInterpolator::Create(width, height, format, options);
+
+    RunResult result;
+    size_t pitch = static_cast<size_t>(width) * 4;
+    std::vector<uint8_t> output(frame0.size());
+    interpolator->AddFrame(frame0.data(), pitch);
+
+    // Alternate frames so every pair sees the pan (forwards, then back)
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        const std::vector<uint8_t>& previous = (i & 1) ? frame1 : frame0;
+        const std::vector<uint8_t>& current = (i & 1) ? frame0 : frame1;
+        interpolator->AddFrame(current.data(), pitch);
+        interpolator->Interpolate(previous.data(), current.data(), output.data(), pitch);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    result.ms_per_frame = std::chrono::duration<double, std::milli>(elapsed).count() / iterations;
+
+    // Score frame0 -> frame1 against the true middle; the edges see the border
+    interpolator->Reset();
+    interpolator->AddFrame(frame0.data(), pitch);
+    interpolator->AddFrame(frame1.data(), pitch);
+    interpolator->Interpolate(frame0.data(), frame1.data(), output.data(), pitch);
+
+    uint32_t margin = static_cast<uint32_t>(std::max(std::abs(pan_x), std::abs(pan_y))) + 16;
+    uint64_t exact = 0;
+    uint64_t scored = 0;
+    for (uint32_t y = margin; y + margin < height; y++) {
+        for (uint32_t x = margin; x + margin < width; x++) {
+            size_t offset = y * pitch + x * 4;
+            exact += std::memcmp(&output[offset], &middle[offset], 4) == 0;
+            scored++;
+        }
+    }
+    result.exact_fraction = scored ? static_cast<double>(exact) / scored : 0.0;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? std::max(1, std::atoi(argv[1])) : 20;
+    // Even, so the middle frame sits on whole pixels
+    int pan_x = ((argc > 2) ? std::atoi(argv[2]) : 24) & ~1;
+    int pan_y = ((argc > 3) ? std::atoi(argv[3]) : -14) & ~1;
+    uint32_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const struct { uint32_t width, height; const char* name; } resolutions[] = {
+        {1280, 720, "720p"},
+        {1920, 1080, "1080p"},
+    };
+    const struct { SoftwareFormat format; const char* name; } formats[] = {
+        {SoftwareFormat::Rgba8, "rgba8"},
+        {SoftwareFormat::Rgb10A2, "rgb10a2"},
+    };
+    const struct { SoftwareInterpolationMode mode; const char* name; } modes[] = {
+        {SoftwareInterpolationMode::Blend, "blend"},
+        {SoftwareInterpolationMode::Warp, "warp"},
+    };
+
+    std::printf("pan (%d, %d), %d iterations\n", pan_x, pan_y, iterations);
+    std::printf("%-6s %-8s %-6s %7s %10s %10s %11s\n", "res", "format", "mode", "threads", "ms/frame", "2x fps",
+                "mid exact");
+    for (const auto& resolution : resolutions) {
+        for (const auto& format : formats) {
+            std::vector<uint8_t> frame0 = MakeFrame(resolution.width, resolution.height, format.format, 0, 0);
+            std::vector<uint8_t> frame1 = MakeFrame(resolution.width, resolution.height, format.format, pan_x, pan_y);
+            std::vector<uint8_t> middle =
+                MakeFrame(resolution.width, resolution.height, format.format, pan_x / 2, pan_y / 2);
+
+            for (const auto& mode : modes) {
+                std::vector<uint32_t> thread_counts = {1};
+                if (hardware_threads > 1) thread_counts.push_back(hardware_threads);
+                for (uint32_t threads : thread_counts) {
+                    RunResult result = Run(resolution.width, resolution.height, format.format, mode.mode, threads,
+                                           frame0, frame1, middle, pan_x, pan_y, iterations);
+                    std::printf("%-6s %-8s %-6s %7u %10.2f %10.0f %10.1f%%\n", resolution.name, format.name,
+                                mode.name, threads, result.ms_per_frame, 2000.0 / result.ms_per_frame,
+                                100.0 * result.exact_fraction);
+                }
+            }
+        }
+    }
+    return 0;
+}
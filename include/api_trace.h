@@ -0,0 +1,239 @@
+#pragma once
+
+#include "spsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <x86intrin.h>
+#define API_TRACE_USE_TSC 1
+#endif
+
+// Timestamp in TSC ticks where available, steady_clock nanoseconds otherwise.
+// The file and block headers carry (ticks, ns) pairs so the decoder can
+// convert without knowing the TSC frequency.
+inline uint64_t TraceTimestamp() {
+#ifdef API_TRACE_USE_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+inline uint64_t TraceClockNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Fixed-size record, one per traced call. It is followed in the stream by
+// ceil(argCount / 3) TraceSlots holding the captured argument values.
+struct TraceRecord {
+    uint64_t timestamp;     // Call entry, TraceTimestamp() units
+    uint32_t duration;      // Call duration in the same units (saturated)
+    uint32_t threadId;
+    uint16_t function;      // Index into the file's schema
+    uint16_t argCount;
+    int32_t result;         // VkResult, or 0 for void functions
+};
+
+struct TraceSlot {
+    uint64_t values[3];
+};
+static_assert(sizeof(TraceRecord) == sizeof(TraceSlot), "TraceRecord layout is part of the file format");
+
+constexpr size_t kTraceArgsPerSlot = 3;
+constexpr size_t kMaxTraceArgs = 48;
+constexpr size_t kMaxTraceArgSlots = kMaxTraceArgs / kTraceArgsPerSlot;
+
+// Trace file layout (native endianness):
+//   TraceFileHeader
+//   schemaSize bytes of schema text: one line per function id,
+//     "<name> <arg label> <arg label> ...". A label may end in a format
+//     suffix: ":x" hex, ":i" signed, ":f" float, ":d" double (default unsigned).
+//   blocks of: TraceBlockHeader, then `count` slots (records and their args)
+constexpr uint32_t kTraceMagic = 0x52544B56; // "VKTR"
+constexpr uint32_t kTraceVersion = 2;
+
+struct TraceFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t timestamp;     // TraceTimestamp() when the trace was opened
+    uint64_t clockNs;       // steady_clock ns at the same moment
+    uint32_t schemaSize;
+    uint32_t reserved;
+};
+
+struct TraceBlockHeader {
+    uint32_t count;         // Slots in this block, argument slots included
+    uint32_t reserved;
+    uint64_t timestamp;     // TraceTimestamp() when the block was written
+    uint64_t clockNs;       // steady_clock ns at the same moment
+    uint64_t droppedTotal;  // Records lost to full rings so far
+};
+
+// Binary API trace. Every calling thread gets its own lock-free ring; a
+// drain thread empties all rings into the trace file every few ms. Nothing
+// on the calling thread formats, allocates (after its first record) or
+// touches the file.
+class ApiTrace {
+public:
+    static constexpr size_t kRingCapacity = 8192;
+    static constexpr std::chrono::milliseconds kDrainInterval{5};
+
+    // Opens `path`, writes `schema` and starts the drain thread. Returns
+    // nullptr on failure.
+    static std::unique_ptr<ApiTrace> Open(const std::string& path, const char* schema);
+    ~ApiTrace();
+
+    ApiTrace(const ApiTrace&) = delete;
+    ApiTrace& operator=(const ApiTrace&) = delete;
+
+    // A record and its argument slots go into the ring together or not at all
+    void Record(uint16_t function, uint64_t start, uint64_t end, int32_t result,
+                const uint64_t* args, size_t argCount) {
+        ThreadRing* ring = CurrentRing();
+
+        TraceRecord record;
+        record.timestamp = start;
+        uint64_t duration = end - start;
+        record.duration = duration > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(duration);
+        record.threadId = ring->threadId;
+        record.function = function;
+        record.argCount = static_cast<uint16_t>(argCount);
+        record.result = result;
+
+        TraceSlot slots[1 + kMaxTraceArgSlots];
+        std::memcpy(&slots[0], &record, sizeof(record));
+        size_t slot_count = 1 + (argCount + kTraceArgsPerSlot - 1) / kTraceArgsPerSlot;
+        if (argCount > 0) {
+            slots[slot_count - 1] = TraceSlot{};
+            std::memcpy(&slots[1], args, argCount * sizeof(uint64_t));
+        }
+
+        if (!ring->queue.TryPush(slots, slot_count)) {
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t Dropped() const;
+
+private:
+    struct ThreadRing {
+        SpscQueue<TraceSlot, kRingCapacity> queue;
+        std::atomic<uint64_t> dropped{0};
+        uint32_t threadId = 0;
+    };
+
+    ApiTrace() = default;
+
+    ThreadRing* CurrentRing() {
+        thread_local ThreadRing* ring = nullptr;
+        thread_local const ApiTrace* owner = nullptr;
+        if (ring == nullptr || owner != this) {
+            ring = RegisterThread();
+            owner = this;
+        }
+        return ring;
+    }
+
+    ThreadRing* RegisterThread();
+    void Run();
+    void Drain();
+    void WriteAll(const void* data, size_t size);
+
+    int fd_ = -1;
+    std::atomic<bool> stop_{false};
+
+    // Rings are only added, never removed, until the trace is closed
+    mutable std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<ThreadRing>> rings_;
+
+    std::vector<TraceSlot> batch_;
+    std::thread thread_;
+};
+
+// Converts an argument to its 64-bit trace value: pointers and handles by
+// address, floats by bit pattern, integers and enums by value.
+template <typename T>
+inline uint64_t TraceValue(T value) {
+    if constexpr (std::is_pointer<T>::value) {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+    } else if constexpr (std::is_same<T, float>::value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    } else if constexpr (std::is_same<T, double>::value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    } else if constexpr (std::is_enum<T>::value || std::is_signed<T>::value) {
+        return static_cast<uint64_t>(static_cast<int64_t>(value));
+    } else {
+        return static_cast<uint64_t>(value);
+    }
+}
+
+// Times one hooked call and records it, with any captured arguments, on
+// destruction. Does nothing when tracing is off (`trace` is null).
+class ApiTraceScope {
+public:
+    template <typename Function>
+    ApiTraceScope(ApiTrace* trace, Function function)
+        : trace_(trace), function_(static_cast<uint16_t>(function)),
+          start_(trace ? TraceTimestamp() : 0) {}
+
+    ~ApiTraceScope() {
+        if (trace_) {
+            trace_->Record(function_, start_, TraceTimestamp(), result_, args_, argCount_);
+        }
+    }
+
+    ApiTraceScope(const ApiTraceScope&) = delete;
+    ApiTraceScope& operator=(const ApiTraceScope&) = delete;
+
+    bool Active() const { return trace_ != nullptr; }
+
+    // Records the call's result and passes it through: `return scope.Result(r);`
+    template <typename T>
+    T Result(T result) {
+        result_ = static_cast<int32_t>(result);
+        return result;
+    }
+
+    template <typename T>
+    void Arg(T value) {
+        if (argCount_ < kMaxTraceArgs) args_[argCount_++] = TraceValue(value);
+    }
+
+    // Placeholders for values that are not available (null struct pointer)
+    void Skip(size_t count) {
+        for (size_t i = 0; i < count; i++) Arg(uint64_t(0));
+    }
+
+    // sType of the first `count` structures on a pNext chain, 0 past the end
+    void Chain(const void* next, size_t count) {
+        struct Header { int32_t sType; const Header* pNext; };
+        const Header* header = static_cast<const Header*>(next);
+        for (size_t i = 0; i < count; i++) {
+            Arg(header ? static_cast<uint32_t>(header->sType) : 0u);
+            header = header ? header->pNext : nullptr;
+        }
+    }
+
+private:
+    ApiTrace* trace_;
+    uint16_t function_;
+    uint64_t start_;
+    int32_t result_ = 0;
+    uint16_t argCount_ = 0;
+    uint64_t args_[kMaxTraceArgs];
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// 8x8 bitmap font for ASCII 32-126, shared by the text overlay and the frame
+// interpolation HUD. One byte per row, most significant bit on the left;
+// glyph i is character 32 + i.
+static constexpr uint32_t kBitmapFontGlyphs = 95;
+
+extern const uint8_t kBitmapFont[kBitmapFontGlyphs][8];
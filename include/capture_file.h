@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Raw frame capture file (native endianness), preallocated to its full
+// capacity and written through a shared mapping:
+//   CaptureFileHeader
+//   CaptureIndexEntry[frameCapacity]
+//   frames at framesOffset + i * frameStride, each height rows of
+//   width * 4 bytes, as the swapchain stored them
+// The file is trimmed to the frames written when it is closed. frameCount
+// is updated after each frame's pixels and index entry, so a file cut short
+// by a crash still reads back up to the last complete frame.
+// tools/capture_dump lists the index and extracts frames.
+constexpr uint32_t kCaptureMagic = 0x50434946; // "FICP"
+constexpr uint32_t kCaptureVersion = 1;
+
+// 32-bit texel layouts, named by their order from the lowest bits
+enum class CaptureLayout : uint32_t {
+    Rgba8 = 0,
+    Bgra8 = 1,
+    Rgb10A2 = 2,
+    Bgr10A2 = 3,
+};
+
+struct CaptureFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t layout;          // CaptureLayout
+    uint32_t vkFormat;        // The swapchain's VkFormat, for reference
+    uint32_t frameCapacity;
+    uint32_t frameCount;
+    uint64_t frameStride;     // Page-aligned
+    uint64_t framesOffset;    // Page-aligned
+};
+
+struct CaptureIndexEntry {
+    uint64_t presentNumber;   // Counts every present, so gaps are dropped frames
+    uint64_t timestampNs;     // steady_clock at the present call
+};
+
+class CaptureFile {
+public:
+    // Creates (truncating) and preallocates `path` for `capacity` frames.
+    // Returns nullptr, having logged why, if that fails.
+    static std::unique_ptr<CaptureFile> Create(const std::string& path, uint32_t width, uint32_t height,
+                                               CaptureLayout layout, uint32_t vk_format, uint32_t capacity);
+    ~CaptureFile();
+
+    CaptureFile(const CaptureFile&) = delete;
+    CaptureFile& operator=(const CaptureFile&) = delete;
+
+    // Drops the calling thread to the lowest CPU priority. For the thread
+    // that calls Write: copying a frame in takes a few milliseconds, which
+    // should come out of idle cores rather than the application's frame.
+    static void LowerWriterPriority();
+
+    // Appends one frame of tightly packed rows. Returns false once the file
+    // is full.
+    bool Write(uint64_t present_number, uint64_t timestamp_ns, const uint8_t* pixels);
+
+    bool Full() const { return count_ == capacity_; }
+    uint32_t Count() const { return count_; }
+    size_t FrameSize() const { return frame_size_; }
+    const std::string& Path() const { return path_; }
+
+private:
+    CaptureFile() = default;
+
+    std::string path_;
+    int fd_ = -1;
+    uint8_t* mapped_ = nullptr;
+    size_t mapped_size_ = 0;
+    size_t frame_size_ = 0;
+    uint64_t frame_stride_ = 0;
+    uint64_t frames_offset_ = 0;
+    uint32_t capacity_ = 0;
+    uint32_t count_ = 0;
+};
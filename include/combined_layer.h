@@ -0,0 +1,226 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_layer.h>
+#include "disk_cache.h"
+#include "dispatch_map.h"
+#include "layer_core.h"
+#include "proc_table.h"
+#include "render_pass_attachments.h"
+#include "api_trace.h"
+#include "frame_timing.h"
+#include "text_renderer.h"
+#include "tint_pass.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Layer identification
+#define LAYER_NAME "VK_LAYER_combined"
+#define LAYER_DESCRIPTION "Green tint, text overlay, logger and frame interpolation in one layer"
+
+// The effects of the four standalone layers, hosted as modules behind a
+// single dispatch hop. VK_COMBINED_MODULES=tint,overlay,interpolation,logger
+// picks a subset (default: all). Within a call, tint runs before overlay.
+enum CombinedModule : uint32_t {
+    MODULE_TINT = 1u << 0,
+    MODULE_OVERLAY = 1u << 1,
+    MODULE_INTERPOLATION = 1u << 2,
+    MODULE_LOGGER = 1u << 3,
+};
+
+constexpr uint32_t MODULE_ALL = MODULE_TINT | MODULE_OVERLAY | MODULE_INTERPOLATION | MODULE_LOGGER;
+
+// Device-level commands the layer hooks: X(vkName, dispatch member, modules
+// that need it, trace argument labels). vkGetDeviceProcAddr hands out the
+// hook only if one of those modules (or the logger) is enabled; otherwise
+// the application calls the next layer directly and the layer costs nothing.
+// Hooks no module needs (0) are there for the logger alone.
+#define COMBINED_DEVICE_HOOKS(X) \
+    X(vkCreateShaderModule, CreateShaderModule, 0, "device:x pCreateInfo->codeSize pShaderModule:x") \
+    X(vkCreateRenderPass, CreateRenderPass, 0, "device:x pCreateInfo->attachmentCount pRenderPass:x") \
+    X(vkDestroyRenderPass, DestroyRenderPass, 0, "device:x renderPass:x") \
+    X(vkCmdBeginRenderPass, CmdBeginRenderPass, 0, "commandBuffer:x pRenderPassBegin->clearValueCount contents colorClears") \
+    X(vkCmdEndRenderPass, CmdEndRenderPass, 0, "commandBuffer:x") \
+    X(vkCmdDraw, CmdDraw, 0, "commandBuffer:x vertexCount instanceCount firstVertex firstInstance") \
+    X(vkCmdDrawIndexed, CmdDrawIndexed, 0, "commandBuffer:x indexCount instanceCount firstIndex vertexOffset:i firstInstance") \
+    X(vkCmdSetViewport, CmdSetViewport, 0, "commandBuffer:x firstViewport viewportCount") \
+    X(vkCmdSetScissor, CmdSetScissor, 0, "commandBuffer:x firstScissor scissorCount") \
+    X(vkCreateSwapchainKHR, CreateSwapchainKHR, MODULE_TINT | MODULE_INTERPOLATION | MODULE_OVERLAY, "device:x pCreateInfo->minImageCount pCreateInfo->presentMode pSwapchain:x") \
+    X(vkDestroySwapchainKHR, DestroySwapchainKHR, MODULE_TINT | MODULE_INTERPOLATION | MODULE_OVERLAY, "device:x swapchain:x") \
+    X(vkAcquireNextImageKHR, AcquireNextImageKHR, MODULE_INTERPOLATION, "device:x swapchain:x timeout pImageIndex[0]") \
+    X(vkQueuePresentKHR, QueuePresentKHR, MODULE_TINT | MODULE_OVERLAY, "queue:x pPresentInfo->swapchainCount")
+
+#define COMBINED_DISPATCH_MEMBER(name, member, modules, labels) PFN_##name member;
+#define COMBINED_FUNCTION_ID(name, member, modules, labels) name,
+
+// Logger module function ids; the trace schema lists them in this order
+enum class CombinedFunction : uint16_t {
+    vkCreateInstance,
+    vkDestroyInstance,
+    vkCreateDevice,
+    vkDestroyDevice,
+    COMBINED_DEVICE_HOOKS(COMBINED_FUNCTION_ID)
+};
+
+// Layer dispatch table structures
+struct LayerInstanceDispatchTable {
+    PFN_vkGetInstanceProcAddr GetInstanceProcAddr;
+    PFN_vkDestroyInstance DestroyInstance;
+    PFN_vkEnumeratePhysicalDevices EnumeratePhysicalDevices;
+    PFN_vkEnumeratePhysicalDeviceGroups EnumeratePhysicalDeviceGroups;
+    PFN_vkEnumeratePhysicalDeviceGroupsKHR EnumeratePhysicalDeviceGroupsKHR;
+    PFN_vkCreateDevice CreateDevice;
+    PFN_vkEnumerateDeviceExtensionProperties EnumerateDeviceExtensionProperties;
+};
+
+struct LayerDeviceDispatchTable {
+    PFN_vkGetDeviceProcAddr GetDeviceProcAddr;
+    PFN_vkDestroyDevice DestroyDevice;
+    COMBINED_DEVICE_HOOKS(COMBINED_DISPATCH_MEMBER)
+};
+
+struct InstanceData {
+    LayerInstanceDispatchTable vtable;
+    VkInstance instance;
+    uint32_t modules;
+};
+
+struct DeviceData {
+    LayerDeviceDispatchTable vtable;
+    VkDevice device;
+    InstanceData* instance_data;
+    uint32_t modules;   // Snapshot of EnabledModules() at device creation
+
+    // Color attachments of each render pass created while the layer was
+    // hooking vkCreateRenderPass, for the logger's vkCmdBeginRenderPass
+    // details. Filled only when the logger module is on; keyed by
+    // RenderPassKey.
+    std::mutex render_pass_mutex;
+    std::unordered_map<uint64_t, RenderPassAttachments> render_passes;
+
+    // Pipelines the tint and overlay build; null when the disk cache is off
+    // or neither module is enabled
+    std::unique_ptr<PipelineDiskCache> pipeline_cache;
+
+    // Tint module; null if the pass couldn't be set up
+    std::unique_ptr<TintPass> tint_pass;
+    std::atomic<uint64_t> tint_present_count{0};
+
+    // Interpolation module. Entries are shared so an acquire on one thread
+    // keeps its swapchain's entry alive while another destroys it.
+    std::mutex swapchain_mutex;
+    std::unordered_map<VkSwapchainKHR, std::shared_ptr<SwapchainData>> swapchains;
+
+    // Overlay module; the renderer is null if it couldn't be set up. The
+    // lines are shared by every present queue.
+    std::unique_ptr<TextRenderer> text_renderer;
+    std::mutex text_mutex;
+    std::vector<std::string> text_lines;
+    uint64_t present_count = 0;
+    std::chrono::steady_clock::time_point last_present{};
+    double frame_time_ms = 0.0;
+};
+
+// Physical devices are recorded when enumerated so instance-level calls can
+// find their instance without a scan. Keyed by the handle itself.
+struct PhysicalDeviceData {
+    VkPhysicalDevice physical_device;
+    InstanceData* instance_data;
+};
+
+// Global data, keyed by dispatch key. Queues and command buffers share their
+// device's key, so they need no map of their own.
+extern DispatchMap<InstanceData> instance_map;
+extern DispatchMap<DeviceData> device_map;
+extern DispatchMap<PhysicalDeviceData> physical_device_map;
+
+// Utility functions
+InstanceData* GetInstanceData(VkInstance instance);
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice);
+DeviceData* GetDeviceData(VkDevice device);
+DeviceData* GetDeviceData(VkQueue queue);
+DeviceData* GetDeviceData(VkCommandBuffer commandBuffer);
+
+// Modules named in VK_COMBINED_MODULES, parsed once
+uint32_t EnabledModules();
+
+// Tint module (VK_LAYER_green_tint): a compute pass over the presented
+// image, run in place through a storage view. TintPresent points the present
+// at the tint's semaphore when it runs.
+void TintDeviceCreated(DeviceData* device_data, VkPhysicalDevice physical_device,
+                       const VkDeviceCreateInfo* pCreateInfo, PFN_vkGetInstanceProcAddr gipa);
+void TintPrepareSwapchain(DeviceData* device_data, VkSwapchainCreateInfoKHR* create_info);
+void TintSwapchainCreated(DeviceData* device_data, const VkSwapchainCreateInfoKHR* pCreateInfo,
+                          VkSwapchainKHR swapchain);
+void TintSwapchainDestroyed(DeviceData* device_data, VkSwapchainKHR swapchain);
+void TintPresent(DeviceData* device_data, VkQueue queue, VkPresentInfoKHR* present_info);
+
+// Overlay module (VK_LAYER_text_overlay): text drawn over each presented
+// image by TextRenderer. OverlayPresent points the present at the overlay's
+// semaphore when it draws.
+void OverlayDeviceCreated(DeviceData* device_data, VkPhysicalDevice physical_device,
+                          const VkDeviceCreateInfo* pCreateInfo, PFN_vkGetInstanceProcAddr gipa);
+void OverlaySwapchainCreated(DeviceData* device_data, const VkSwapchainCreateInfoKHR* pCreateInfo,
+                             VkSwapchainKHR swapchain);
+void OverlaySwapchainDestroyed(DeviceData* device_data, VkSwapchainKHR swapchain);
+void OverlayPresent(DeviceData* device_data, VkQueue queue, VkPresentInfoKHR* present_info);
+
+// Interpolation module (VK_LAYER_frame_interpolation): per-swapchain frame
+// timing, stats and telemetry
+void InterpolationSwapchainCreated(DeviceData* device_data, const VkSwapchainCreateInfoKHR* pCreateInfo,
+                                   VkSwapchainKHR swapchain);
+void InterpolationSwapchainDestroyed(DeviceData* device_data, VkSwapchainKHR swapchain);
+void InterpolationImageAcquired(DeviceData* device_data, VkSwapchainKHR swapchain, uint32_t imageIndex);
+
+// Logger module (VK_LAYER_logger, limited to the commands this layer hooks).
+// Binary trace when VK_LOGGER_TRACE=<path> is set, text lines otherwise.
+ApiTrace* GetCombinedTrace();
+
+inline ApiTrace* LoggerTrace(uint32_t modules) {
+    return (modules & MODULE_LOGGER) ? GetCombinedTrace() : nullptr;
+}
+
+// Text line for a hooked call, unless the logger is off or writing a trace
+inline void LogCombinedCall(const ApiTraceScope& trace, uint32_t modules, const char* function_name,
+                            const char* details = nullptr) {
+    if ((modules & MODULE_LOGGER) && !trace.Active()) {
+        LogLayerMessage("COMBINED_LAYER", function_name, details);
+    }
+}
+
+// Layer entry points
+extern "C" {
+    VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(
+        VkInstance instance,
+        const char* pName);
+
+    VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(
+        VkDevice device,
+        const char* pName);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(
+        uint32_t* pPropertyCount,
+        VkLayerProperties* pProperties);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(
+        const char* pLayerName,
+        uint32_t* pPropertyCount,
+        VkExtensionProperties* pProperties);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceLayerProperties(
+        VkPhysicalDevice physicalDevice,
+        uint32_t* pPropertyCount,
+        VkLayerProperties* pProperties);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(
+        VkPhysicalDevice physicalDevice,
+        const char* pLayerName,
+        uint32_t* pPropertyCount,
+        VkExtensionProperties* pProperties);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 128-bit content hash (MurmurHash3 x64/128), the key of everything the
+// disk cache holds
+struct ContentHash {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const ContentHash& other) const { return low == other.low && high == other.high; }
+};
+
+ContentHash HashBytes(const void* data, size_t size);
+
+struct ContentHashHasher {
+    size_t operator()(const ContentHash& hash) const { return static_cast<size_t>(hash.low); }
+};
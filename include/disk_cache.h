@@ -0,0 +1,155 @@
+#pragma once
+
+#include "content_hash.h"
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Cache kept across runs, so a warm start skips the work a cold one does:
+// the driver's compile of the layers' own pipelines.
+//
+// Directory layout (native endianness):
+//   <root>/v<kDiskCacheVersion>/
+//     index          DiskCacheIndexHeader, then DiskCacheIndexEntry sorted
+//                    by kind and key; memory-mapped for lookups
+//     <kind>-<key>   one file per entry
+//     lock           flock()ed while the index is rewritten
+// Files are written under a temporary name and renamed into place, so a
+// reader in another process sees the old file or the new one, never part
+// of one. Entries are checked against the size and content hash in the
+// index when read; a bad one is a miss. Bumping kDiskCacheVersion starts a
+// new directory.
+//
+// The root is $VK_LAYER_CACHE_DIR, else $XDG_CACHE_HOME/vulkan-layers, else
+// $HOME/.cache/vulkan-layers. VK_LAYER_CACHE_DIR=0 turns the cache off.
+constexpr uint32_t kDiskCacheMagic = 0x4944434c;   // "LCDI"
+constexpr uint32_t kDiskCacheVersion = 1;
+
+// Values are part of the entry file names; don't renumber
+enum class DiskCacheKind : uint32_t {
+    PipelineCache = 2,   // VkPipelineCache data by consumer, device and driver
+};
+
+struct DiskCacheIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t entryCount;
+};
+
+struct DiskCacheIndexEntry {
+    uint32_t kind;        // DiskCacheKind
+    uint32_t reserved;
+    uint64_t keyLow;
+    uint64_t keyHigh;
+    uint64_t size;        // Bytes in the entry's file
+    uint64_t contentLow;  // HashBytes of the file
+    uint64_t contentHigh;
+};
+
+class DiskCache {
+public:
+    // Opens `root`/v<kDiskCacheVersion>, creating it. Returns nullptr, having
+    // logged why, if it can't be created.
+    static std::unique_ptr<DiskCache> Open(const std::string& root);
+
+    // The process's cache under DefaultRoot(), opened on first use. nullptr
+    // when the cache is off or can't be opened.
+    static DiskCache* Shared();
+
+    // Empty when VK_LAYER_CACHE_DIR=0 or there is no home directory
+    static std::string DefaultRoot();
+
+    ~DiskCache();
+
+    DiskCache(const DiskCache&) = delete;
+    DiskCache& operator=(const DiskCache&) = delete;
+
+    // Reads the entry for `key` into `data`. False on a miss or a bad file.
+    bool Load(DiskCacheKind kind, const ContentHash& key, std::vector<uint8_t>* data);
+
+    // Writes an entry, replacing any for the same key. False if a write
+    // fails; the key then reads as its old entry or as a miss.
+    bool Store(DiskCacheKind kind, const ContentHash& key, const void* data, size_t size);
+
+    const std::string& directory() const { return directory_; }
+    size_t entry_count();
+
+private:
+    DiskCache() = default;
+
+    // Remaps the index if another process (or Store) has replaced it
+    void RefreshIndex();
+    void UnmapIndex();
+    const DiskCacheIndexEntry* FindEntry(DiskCacheKind kind, const ContentHash& key) const;
+    std::string EntryPath(DiskCacheKind kind, const ContentHash& key) const;
+
+    std::string directory_;
+    std::string index_path_;
+    int lock_fd_ = -1;
+
+    std::mutex mutex_;
+    const uint8_t* mapped_ = nullptr;
+    size_t mapped_size_ = 0;
+    ino_t mapped_inode_ = 0;
+    const DiskCacheIndexEntry* entries_ = nullptr;
+    size_t entry_count_ = 0;
+};
+
+// Entry points PipelineDiskCache calls on its device
+#define PIPELINE_DISK_CACHE_DEVICE_FUNCTIONS(X) \
+    X(CreatePipelineCache) \
+    X(GetPipelineCacheData) \
+    X(DestroyPipelineCache)
+
+#define PIPELINE_DISK_CACHE_DISPATCH_MEMBER(name) PFN_vk##name name;
+
+struct PipelineDiskCacheDispatch {
+    PIPELINE_DISK_CACHE_DEVICE_FUNCTIONS(PIPELINE_DISK_CACHE_DISPATCH_MEMBER)
+};
+
+// A VkPipelineCache for the pipelines a layer builds on one device, seeded
+// from the disk cache entry for the consumer, the device's
+// pipelineCacheUUID, vendor, device and driver version, and written back
+// when it is destroyed if the driver added to it. Hand handle() to every
+// vkCreate*Pipelines call.
+class PipelineDiskCache {
+public:
+    // `consumer` (the layer's name) keeps each layer's blob apart from the
+    // others', so layers stacked on one device don't overwrite each other.
+    // nullptr, leaving pipelines uncached, if `disk` is null or the cache
+    // can't be created.
+    static std::unique_ptr<PipelineDiskCache> Create(DiskCache* disk, const char* consumer, VkDevice device,
+                                                     const VkPhysicalDeviceProperties& properties,
+                                                     PFN_vkGetDeviceProcAddr gdpa);
+
+    // Call before the device is destroyed
+    ~PipelineDiskCache();
+
+    PipelineDiskCache(const PipelineDiskCache&) = delete;
+    PipelineDiskCache& operator=(const PipelineDiskCache&) = delete;
+
+    VkPipelineCache handle() const { return cache_; }
+
+    // Whether the cache was seeded from disk
+    bool warm() const { return warm_; }
+
+    // Writes the cache's data to disk if it has changed since it was
+    // loaded or last saved
+    void Save();
+
+private:
+    PipelineDiskCache() = default;
+
+    DiskCache* disk_ = nullptr;
+    VkDevice device_ = VK_NULL_HANDLE;
+    ContentHash key_;
+    PipelineDiskCacheDispatch vk_{};
+    VkPipelineCache cache_ = VK_NULL_HANDLE;
+    ContentHash saved_hash_;   // Of the data on disk
+    bool warm_ = false;
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Every dispatchable handle (VkInstance, VkPhysicalDevice, VkDevice, VkQueue,
+// VkCommandBuffer) starts with a pointer to the loader's dispatch table.
+// Child objects share the table of their parent, so the key identifies the
+// owning instance or device.
+template <typename DispatchableType>
+inline void* GetDispatchKey(DispatchableType handle) {
+    return handle ? *reinterpret_cast<void**>(handle) : nullptr;
+}
+
+// Read-mostly map from dispatch key to per-instance/per-device layer data.
+//
+// Lookups take no lock: they read an immutable open-addressed snapshot that is
+// published through an atomic pointer. Insert/Erase build a new snapshot under
+// a writer mutex, publish it, and free the old one after a grace period
+// (sleepable-RCU style: readers bump a per-thread shard counter for the
+// current epoch parity, writers flip the parity twice and wait for the old
+// shards to drain). Writers only run on create/destroy, so they may spin.
+template <typename T>
+class DispatchMap {
+public:
+    DispatchMap() : current_(new Snapshot(kMinCapacity)) {}
+
+    ~DispatchMap() {
+        delete current_.load();
+    }
+
+    DispatchMap(const DispatchMap&) = delete;
+    DispatchMap& operator=(const DispatchMap&) = delete;
+
+    T* Get(void* key) const {
+        ReadGuard guard(*this);
+        return guard.snapshot->Find(key);
+    }
+
+    // Returns the first value for which pred(value) is true, or nullptr.
+    template <typename Pred>
+    T* FindIf(Pred pred) const {
+        ReadGuard guard(*this);
+        const Snapshot* snapshot = guard.snapshot;
+        for (size_t i = 0; i <= snapshot->mask; i++) {
+            T* value = snapshot->slots[i].value;
+            if (value && pred(value)) {
+                return value;
+            }
+        }
+        return nullptr;
+    }
+
+    void Insert(void* key, T* value) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        const Snapshot* old_snapshot = current_.load();
+
+        Snapshot* snapshot = new Snapshot(CapacityFor(old_snapshot->count + 1));
+        old_snapshot->CopyTo(snapshot, key);
+        snapshot->Put(key, value);
+        Publish(snapshot);
+    }
+
+    // Inserts only if the key is not present yet. Returns false (and leaves
+    // `value` owned by the caller) when another entry already exists.
+    bool TryInsert(void* key, T* value) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        const Snapshot* old_snapshot = current_.load();
+        if (old_snapshot->Find(key)) {
+            return false;
+        }
+
+        Snapshot* snapshot = new Snapshot(CapacityFor(old_snapshot->count + 1));
+        old_snapshot->CopyTo(snapshot, key);
+        snapshot->Put(key, value);
+        Publish(snapshot);
+        return true;
+    }
+
+    // Removes the entry and returns its value so the caller can delete it.
+    T* Erase(void* key) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        const Snapshot* old_snapshot = current_.load();
+
+        T* value = old_snapshot->Find(key);
+        if (!value) {
+            return nullptr;
+        }
+
+        Snapshot* snapshot = new Snapshot(CapacityFor(old_snapshot->count - 1));
+        old_snapshot->CopyTo(snapshot, key);
+        Publish(snapshot);
+        return value;
+    }
+
+    // Removes every entry for which pred(value) is true and returns the
+    // removed values so the caller can delete them.
+    template <typename Pred>
+    std::vector<T*> EraseIf(Pred pred) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        const Snapshot* old_snapshot = current_.load();
+
+        std::vector<T*> removed;
+        std::vector<Entry> kept;
+        for (const Entry& entry : old_snapshot->slots) {
+            if (!entry.key) continue;
+            if (pred(entry.value)) {
+                removed.push_back(entry.value);
+            } else {
+                kept.push_back(entry);
+            }
+        }
+        if (removed.empty()) {
+            return removed;
+        }
+
+        Snapshot* snapshot = new Snapshot(CapacityFor(kept.size()));
+        for (const Entry& entry : kept) {
+            snapshot->Put(entry.key, entry.value);
+        }
+        Publish(snapshot);
+        return removed;
+    }
+
+    size_t Size() const {
+        ReadGuard guard(*this);
+        return guard.snapshot->count;
+    }
+
+private:
+    static constexpr size_t kMinCapacity = 8;
+    static constexpr size_t kReaderShards = 64;
+
+    struct Entry {
+        void* key = nullptr;
+        T* value = nullptr;
+    };
+
+    struct Snapshot {
+        size_t mask;
+        size_t count = 0;
+        std::vector<Entry> slots;
+
+        explicit Snapshot(size_t capacity) : mask(capacity - 1), slots(capacity) {}
+
+        static size_t Hash(void* key) {
+            uint64_t k = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key));
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccdULL;
+            k ^= k >> 33;
+            return static_cast<size_t>(k);
+        }
+
+        T* Find(void* key) const {
+            if (!key) return nullptr;
+            for (size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+                if (slots[i].key == key) return slots[i].value;
+                if (slots[i].key == nullptr) return nullptr;
+            }
+        }
+
+        void Put(void* key, T* value) {
+            for (size_t i = Hash(key) & mask;; i = (i + 1) & mask) {
+                if (slots[i].key == nullptr) {
+                    slots[i].key = key;
+                    slots[i].value = value;
+                    count++;
+                    return;
+                }
+            }
+        }
+
+        // Copies every entry except `skip_key` into `dst`.
+        void CopyTo(Snapshot* dst, void* skip_key) const {
+            for (const Entry& entry : slots) {
+                if (entry.key && entry.key != skip_key) {
+                    dst->Put(entry.key, entry.value);
+                }
+            }
+        }
+    };
+
+    struct alignas(64) ReaderShard {
+        std::atomic<uint32_t> active[2] = {{0}, {0}};
+    };
+
+    struct ReadGuard {
+        ReaderShard& shard;
+        uint32_t parity;
+        const Snapshot* snapshot;
+
+        explicit ReadGuard(const DispatchMap& map)
+            : shard(map.shards_[ThreadShardIndex()]),
+              parity(map.epoch_.load() & 1) {
+            shard.active[parity].fetch_add(1);
+            snapshot = map.current_.load();
+        }
+
+        ~ReadGuard() {
+            shard.active[parity].fetch_sub(1);
+        }
+    };
+
+    static size_t ThreadShardIndex() {
+        static std::atomic<size_t> next_index{0};
+        thread_local size_t index = next_index.fetch_add(1) % kReaderShards;
+        return index;
+    }
+
+    static size_t CapacityFor(size_t count) {
+        size_t capacity = kMinCapacity;
+        while (capacity < count * 2) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    // Called with write_mutex_ held.
+    void Publish(Snapshot* snapshot) {
+        const Snapshot* old_snapshot = current_.exchange(snapshot);
+        // Two flips: a reader may have sampled the parity just before the
+        // first flip and only registered after our wait on it finished.
+        for (int pass = 0; pass < 2; pass++) {
+            uint32_t old_parity = epoch_.fetch_add(1) & 1;
+            while (ReadersActive(old_parity)) {
+                std::this_thread::yield();
+            }
+        }
+        delete old_snapshot;
+    }
+
+    bool ReadersActive(uint32_t parity) const {
+        for (const ReaderShard& shard : shards_) {
+            if (shard.active[parity].load() != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::atomic<const Snapshot*> current_;
+    std::atomic<uint32_t> epoch_{0};
+    mutable ReaderShard shards_[kReaderShards];
+    std::mutex write_mutex_;
+};
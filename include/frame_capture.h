@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "capture_file.h"
+#include "frame_generation.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Swapchain capture (FRAME_INTERP_CAPTURE=1). Each presented application
+// image is copied into the next frame of a ring of host-visible staging
+// buffers by a submit placed ahead of the present, which now waits for that
+// submit instead of the application's semaphores. The submit signals a
+// timeline semaphore with the frame's capture sequence number; a writer
+// thread waits on that value, never the application's thread, and streams
+// the frame into a preallocated memory-mapped CaptureFile.
+//
+// Nothing at present ever waits: when all ring frames are still being
+// written the present goes out uncaptured and is counted as dropped, which
+// shows up as a gap in the file's present numbers. Capture stops once the
+// file holds FRAME_INTERP_CAPTURE_FRAMES frames (default 120).
+//
+// Needs timeline semaphores (Vulkan 1.2 or VK_KHR_timeline_semaphore),
+// which vkCreateDevice turns on when capture is requested, and a 32-bit
+// swapchain format. Only the application's images are captured, not the
+// generator's synthetic ones.
+class FrameCapture {
+public:
+    // Whether FRAME_INTERP_CAPTURE asks for capture
+    static bool Requested();
+
+    // Adds transfer source usage to a swapchain create info. Returns false,
+    // leaving it untouched, if capture is off or the swapchain does not
+    // qualify.
+    static bool PrepareSwapchain(const FrameGenerationDevice& device, VkSwapchainCreateInfoKHR* create_info);
+
+    // Opens the capture file and allocates the ring for a swapchain created
+    // from a prepared create info. Returns nullptr on failure.
+    static std::unique_ptr<FrameCapture> Create(const FrameGenerationDevice& device, VkSwapchainKHR swapchain,
+                                                const VkSwapchainCreateInfoKHR& create_info);
+
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Submits the copy of a single-swapchain present's image on `queue` and
+    // returns the present info to use in its place, which points into this
+    // object until the next call. Returns `present_info` itself for a frame
+    // that is not captured.
+    const VkPresentInfoKHR* Capture(VkQueue queue, uint32_t queue_family, std::mutex* queue_mutex,
+                                    const VkPresentInfoKHR* present_info);
+
+    // Frames written and dropped; drains the writer first
+    void PrintReport(std::ostream& out);
+
+private:
+    static constexpr uint32_t kRingSize = 4;
+
+    struct RingFrame {
+        VkCommandBuffer commands = VK_NULL_HANDLE;
+        VkSemaphore ready = VK_NULL_HANDLE;   // Copy done, the image may present
+        uint64_t present_number = 0;
+        uint64_t timestamp_ns = 0;
+    };
+
+    FrameCapture(const FrameGenerationDevice& device, std::unique_ptr<CaptureFile> file);
+
+    bool CreateRing(VkDeviceSize frame_size);
+    bool EnsureCommandBuffers(uint32_t queue_family);
+    void Record(const RingFrame& frame, VkDeviceSize offset, VkImage image);
+    void Drain();
+    void WriterThread();
+
+    const FrameGenerationDevice& device_;
+    std::unique_ptr<CaptureFile> file_;
+    VkExtent2D extent_{};
+    std::vector<VkImage> swapchain_images_;
+    uint32_t frame_limit_ = 0;
+
+    // kRingSize frames at frame * stride, mapped for the capture's lifetime
+    VkBuffer ring_buffer_ = VK_NULL_HANDLE;
+    VkDeviceMemory ring_memory_ = VK_NULL_HANDLE;
+    const uint8_t* ring_mapped_ = nullptr;
+    bool ring_coherent_ = false;
+    VkDeviceSize ring_stride_ = 0;
+
+    // Reaches the sequence number of each frame once its copy is done
+    VkSemaphore timeline_ = VK_NULL_HANDLE;
+
+    // Made on the first capture, for that queue's family
+    VkCommandPool command_pool_ = VK_NULL_HANDLE;
+    uint32_t queue_family_ = UINT32_MAX;
+    std::array<RingFrame, kRingSize> ring_;
+
+    // Frame `sequence` (from 1) uses ring_[(sequence - 1) % kRingSize]. The
+    // application's thread advances submitted_, the writer consumed_.
+    std::mutex mutex_;
+    std::condition_variable submitted_cv_;
+    std::condition_variable consumed_cv_;
+    uint64_t submitted_ = 0;
+    uint64_t consumed_ = 0;
+    bool stopping_ = false;
+    std::thread writer_thread_;
+
+    // Application's thread only
+    uint64_t present_count_ = 0;
+    uint64_t dropped_frames_ = 0;
+    VkPresentInfoKHR present_info_{};
+    VkSemaphore present_wait_ = VK_NULL_HANDLE;
+    std::vector<VkPipelineStageFlags> wait_stages_;
+};
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_layer.h>
+#include "frame_pacing.h"
+#include "frame_stats.h"
+#include "scene_change.h"
+#include "software_interpolation.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// Naive 2x frame generation (stage A1). Every presented swapchain image is
+// copied into a two-deep history pool; a compute pass blends the previous and
+// current frames into a third image, which is copied into an extra swapchain
+// image and presented just before the real one. Only MAILBOX and IMMEDIATE
+// swapchains are handled, since there an extra present never blocks.
+//
+// All work is recorded on the application's present queue and nothing waits
+// on the CPU: when the GPU still owns the next command slot, or no extra
+// image is free, that frame is presented without a synthetic one.
+//
+// Stage A2: the capture and blend are submitted on the application's
+// thread, but both presents are issued from the generator's own present
+// thread at the times FramePacer picks. vkQueuePresentKHR returns as soon as
+// the frame is queued, with the result of the previous present. Queue and
+// swapchain access from the two threads is serialized by the caller's queue
+// mutex and the generator's swapchain mutex.
+//
+// Software backend: on CPU devices (lavapipe, llvmpipe, SwiftShader) or
+// devices without a compute queue, the capture goes into a persistently
+// mapped readback ring instead of the history pool. The present thread waits
+// for it, makes the synthetic frame with SoftwareInterpolator and uploads
+// it from a second mapped ring into the extra swapchain image, so only
+// transfer commands ever reach the device.
+//
+// Scene cuts: each captured frame is histogrammed (two small compute passes
+// ahead of the blend, or SceneChangeDetector on the present thread for the
+// software backend). Across a cut the synthetic frame repeats the previous
+// frame and the software backend's motion history starts over. Cuts are
+// counted for the report and telemetry, a frame or two after they happen.
+//
+// FRAME_INTERP_GENERATE=0 turns generation off; FRAME_INTERP_SHOW_PREVIOUS=1
+// presents the previous frame instead of the blend. FRAME_INTERP_BACKEND=
+// compute|software overrides the backend choice; FRAME_INTERP_SOFTWARE_WARP=1
+// has the software backend follow motion rather than blend.
+
+// Device functions the generator calls, loaded once per device
+#define FRAME_GENERATION_DEVICE_FUNCTIONS(X) \
+    X(GetSwapchainImagesKHR) \
+    X(AcquireNextImageKHR) \
+    X(QueuePresentKHR) \
+    X(QueueSubmit) \
+    X(CreateImage) \
+    X(DestroyImage) \
+    X(GetImageMemoryRequirements) \
+    X(AllocateMemory) \
+    X(FreeMemory) \
+    X(BindImageMemory) \
+    X(CreateImageView) \
+    X(DestroyImageView) \
+    X(CreateShaderModule) \
+    X(DestroyShaderModule) \
+    X(CreateDescriptorSetLayout) \
+    X(DestroyDescriptorSetLayout) \
+    X(CreatePipelineLayout) \
+    X(DestroyPipelineLayout) \
+    X(CreateComputePipelines) \
+    X(DestroyPipeline) \
+    X(CreateDescriptorPool) \
+    X(DestroyDescriptorPool) \
+    X(AllocateDescriptorSets) \
+    X(UpdateDescriptorSets) \
+    X(CreateCommandPool) \
+    X(DestroyCommandPool) \
+    X(AllocateCommandBuffers) \
+    X(ResetCommandBuffer) \
+    X(BeginCommandBuffer) \
+    X(EndCommandBuffer) \
+    X(CmdPipelineBarrier) \
+    X(CmdCopyImage) \
+    X(CmdCopyImageToBuffer) \
+    X(CmdCopyBufferToImage) \
+    X(CreateBuffer) \
+    X(DestroyBuffer) \
+    X(GetBufferMemoryRequirements) \
+    X(BindBufferMemory) \
+    X(MapMemory) \
+    X(FlushMappedMemoryRanges) \
+    X(InvalidateMappedMemoryRanges) \
+    X(CmdBindPipeline) \
+    X(CmdBindDescriptorSets) \
+    X(CmdPushConstants) \
+    X(CmdDispatch) \
+    X(CreateQueryPool) \
+    X(DestroyQueryPool) \
+    X(GetQueryPoolResults) \
+    X(CmdResetQueryPool) \
+    X(CmdWriteTimestamp) \
+    X(CreateFence) \
+    X(DestroyFence) \
+    X(GetFenceStatus) \
+    X(ResetFences) \
+    X(WaitForFences) \
+    X(CreateSemaphore) \
+    X(DestroySemaphore) \
+    X(WaitSemaphores)
+
+#define FRAME_GENERATION_DISPATCH_MEMBER(name) PFN_vk##name name;
+
+struct FrameGenerationDispatch {
+    FRAME_GENERATION_DEVICE_FUNCTIONS(FRAME_GENERATION_DISPATCH_MEMBER)
+};
+
+enum class FrameGenerationBackend {
+    Compute,    // History pool and blend shader on the device
+    Software,   // Readback, SoftwareInterpolator, upload
+};
+
+// What the generator needs from the device, filled in at vkCreateDevice
+struct FrameGenerationDevice {
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    VkPhysicalDeviceType device_type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+    FrameGenerationDispatch vk{};
+    PFN_vkSetDeviceLoaderData set_device_loader_data = nullptr;
+    PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR get_surface_capabilities = nullptr;
+    VkPhysicalDeviceMemoryProperties memory_properties{};
+    std::vector<VkQueueFamilyProperties> queue_families;
+    float timestamp_period = 0.0f;      // Nanoseconds per tick, for the HUD
+    bool timeline_semaphores = false;   // Enabled at device creation, for capture
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;   // The layer's PipelineDiskCache, if any
+};
+
+// WaitSemaphores falls back to the VK_KHR_timeline_semaphore entry point
+void LoadFrameGenerationDispatch(FrameGenerationDispatch* dispatch, VkDevice device, PFN_vkGetDeviceProcAddr gdpa);
+
+// First memory type in `type_bits` with all of `flags`, or UINT32_MAX
+uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties& memory, uint32_t type_bits,
+                        VkMemoryPropertyFlags flags);
+
+class FrameGenerator {
+public:
+    // Adjusts a swapchain create info for generation (copy sources and
+    // destinations, one extra image). Returns false, leaving it untouched,
+    // if generation is off or the swapchain does not qualify.
+    static bool PrepareSwapchain(const FrameGenerationDevice& device, VkSwapchainCreateInfoKHR* create_info);
+
+    // Allocates the history pool and blend pipeline (or, for the software
+    // backend, the staging rings) for a swapchain created from a prepared
+    // create info. Returns nullptr on failure.
+    static std::unique_ptr<FrameGenerator> Create(const FrameGenerationDevice& device, VkSwapchainKHR swapchain,
+                                                  const VkSwapchainCreateInfoKHR& create_info);
+
+    ~FrameGenerator();
+
+    FrameGenerator(const FrameGenerator&) = delete;
+    FrameGenerator& operator=(const FrameGenerator&) = delete;
+
+    // Queues the application's image (a single-swapchain present on
+    // `queue`) for the present thread, preceded by a synthetic frame when one
+    // can be made. `queue_mutex` guards every use of `queue`.
+    VkResult Present(VkQueue queue, uint32_t queue_family, std::mutex* queue_mutex,
+                     const VkPresentInfoKHR* present_info);
+
+    // The application's vkAcquireNextImageKHR, serialized with the present
+    // thread's own acquires. Waits for queued presents before blocking.
+    VkResult AcquireNextImage(uint64_t timeout, VkSemaphore semaphore, VkFence fence, uint32_t* image_index);
+
+    // Blocks until every queued present has been issued
+    void WaitIdle();
+
+    // Scene cuts detected so far; any thread
+    uint64_t SceneChanges() const { return scene_changes_.load(std::memory_order_relaxed); }
+
+    // Present counts and the presented frame interval stats; drains the
+    // present thread first
+    void PrintReport(std::ostream& out);
+
+private:
+    static constexpr uint32_t kSlotCount = 3;
+
+    // Per-submission resources, reused round-robin once their fence signals
+    struct Slot {
+        VkCommandBuffer commands = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkSemaphore acquired = VK_NULL_HANDLE;         // Extra swapchain image is ready
+        VkSemaphore synthetic_ready = VK_NULL_HANDLE;  // Synthetic frame copied, may present
+        VkSemaphore real_ready = VK_NULL_HANDLE;       // Application image copied, may present
+        // Software backend: the present thread's upload of the synthetic frame
+        VkCommandBuffer upload_commands = VK_NULL_HANDLE;
+        VkFence upload_fence = VK_NULL_HANDLE;
+        // Compute backend: the scene change result for this slot's frame
+        // lands in the scene buffer when the fence signals
+        bool scene_pending = false;
+    };
+
+    // Host-visible buffer mapped for the generator's lifetime
+    struct MappedBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        uint8_t* mapped = nullptr;
+        bool coherent = false;
+    };
+
+    // One tightly packed frame per slot at slot * stride
+    struct StagingRing : MappedBuffer {
+        VkDeviceSize stride = 0;
+    };
+
+    struct PoolImage {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+    };
+
+    // One application frame for the present thread
+    struct PresentJob {
+        VkQueue queue = VK_NULL_HANDLE;
+        std::mutex* queue_mutex = nullptr;
+        uint32_t slot = 0;
+        uint32_t image_index = 0;
+        uint32_t synthetic_index = 0;
+        bool generate = false;
+        bool wait_acquired = false;  // slot.acquired carries the synthetic image's acquire
+        bool has_previous = false;   // The previous slot holds the frame before this one
+        PacingDecision timing;
+    };
+
+    FrameGenerator(const FrameGenerationDevice& device, FrameGenerationBackend backend);
+
+    bool CreatePoolImage(PoolImage* pool_image);
+    bool CreatePipeline();
+    bool CreateMappedBuffer(MappedBuffer* mapped_buffer, VkDeviceSize size, VkBufferUsageFlags usage,
+                            VkMemoryPropertyFlags preferred);
+    bool CreateStagingRing(StagingRing* ring, VkBufferUsageFlags usage, VkMemoryPropertyFlags preferred);
+    bool CreateSlots();
+    bool EnsureCommandBuffers(VkQueue queue, uint32_t queue_family);
+    void RecordFrame(const Slot& slot, uint32_t slot_index, VkImage app_image, VkImage synthetic_image,
+                     bool generate, bool has_previous);
+    void HarvestSceneChanges();
+    void RecordReadback(const Slot& slot, uint32_t slot_index, VkImage app_image);
+    VkResult UploadSynthetic(const PresentJob& job);
+    void RecoverFailedSubmit(const Slot& slot, VkQueue queue, std::mutex* queue_mutex, VkFence fence,
+                             bool generate, bool wait_acquired, uint32_t synthetic_index);
+    VkResult PresentDirect(VkQueue queue, std::mutex* queue_mutex, const VkPresentInfoKHR* present_info);
+    VkResult PresentImage(VkQueue queue, std::mutex* queue_mutex, VkSemaphore wait, uint32_t image_index);
+    void RecordPresented();
+    void PresentThread();
+
+    const FrameGenerationDevice& device_;
+    FrameGenerationBackend backend_;
+    VkSwapchainKHR swapchain_ = VK_NULL_HANDLE;
+    VkExtent2D extent_{};
+    std::vector<VkImage> swapchain_images_;
+    float blend_weight_ = 0.5f;
+    bool blue_first_ = false;   // Swapchain bytes are B, G, R, A
+
+    // history_[frame & 1] receives the current frame; the other holds the previous
+    std::array<PoolImage, 2> history_;
+    PoolImage output_;
+    bool pool_initialized_ = false;
+    bool history_valid_ = false;
+    uint64_t captured_frames_ = 0;
+
+    // Blend, histogram and compare pipelines share one layout and set
+    VkShaderModule shader_ = VK_NULL_HANDLE;
+    VkShaderModule histogram_shader_ = VK_NULL_HANDLE;
+    VkShaderModule compare_shader_ = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+    VkPipeline pipeline_ = VK_NULL_HANDLE;
+    VkPipeline histogram_pipeline_ = VK_NULL_HANDLE;
+    VkPipeline compare_pipeline_ = VK_NULL_HANDLE;
+    MappedBuffer scene_;   // Histograms, cut flag and per-slot results
+    VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+    std::array<VkDescriptorSet, 2> descriptor_sets_{};   // Indexed like history_
+
+    // Software backend; the interpolator is only used on the present thread
+    StagingRing readback_;
+    StagingRing upload_;
+    std::unique_ptr<SoftwareInterpolator> interpolator_;
+    std::unique_ptr<SceneChangeDetector> scene_detector_;
+
+    // Command buffers are made on the first present, for that queue's family
+    VkQueue queue_ = VK_NULL_HANDLE;
+    VkCommandPool command_pool_ = VK_NULL_HANDLE;
+    VkCommandPool upload_command_pool_ = VK_NULL_HANDLE;   // Recorded on the present thread
+    std::array<Slot, kSlotCount> slots_;
+    uint32_t next_slot_ = 0;
+    FramePacer pacer_;
+
+    // Guards the swapchain's acquire and present calls
+    std::mutex swapchain_mutex_;
+
+    // At most one job per slot; a slot is reused only after its job is done
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_ready_;
+    std::condition_variable jobs_done_;
+    std::array<PresentJob, kSlotCount> jobs_;
+    std::array<bool, kSlotCount> slot_queued_{};
+    // A synthetic image whose frame's submit failed (RecoverFailedSubmit).
+    // The next generated frame goes into it once spare_fence_ shows its
+    // acquire consumed, rather than acquiring another, so at most one image
+    // is ever held this way.
+    bool has_spare_image_ = false;
+    uint32_t spare_image_ = 0;
+    VkFence spare_fence_ = VK_NULL_HANDLE;
+    uint32_t job_head_ = 0;
+    uint32_t job_count_ = 0;
+    bool stopping_ = false;
+    std::thread present_thread_;
+    std::atomic<VkResult> last_present_result_{VK_SUCCESS};
+
+    // Intervals between presents as the display receives them
+    FrameStatsEngine presented_stats_;
+    std::chrono::steady_clock::time_point last_presented_{};
+
+    // Scratch for the capture submit; keeps its capacity between frames
+    std::vector<VkSemaphore> wait_semaphores_;
+    std::vector<VkPipelineStageFlags> wait_stages_;
+
+    std::atomic<uint64_t> real_presents_{0};
+    std::atomic<uint64_t> synthetic_presents_{0};
+    std::atomic<uint64_t> scene_changes_{0};
+    uint64_t skipped_frames_ = 0;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "frame_generation.h"
+#include "frame_timing.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// On-screen frame time HUD. At each present the top-right corner of the
+// application's image is copied into a small storage image, one compute
+// dispatch (shaders/frame_hud.comp) draws a panel with the HUDState frame
+// time graph, an FPS/frame time/present mode line and the HUD's own cost,
+// and the corner is copied back. The submit goes on the present queue
+// ahead of the present, which then waits for it.
+//
+// The shader reads everything from one persistently mapped buffer: the font,
+// written once, and a block per slot the host fills before submitting. The
+// descriptor set is written once at creation. GPU time comes from a pair of
+// timestamps per slot, read back without waiting when the slot comes round
+// again, so the HUD shows its cost a few frames late.
+//
+// Nothing at present ever waits: when the next slot is still in flight the
+// frame goes out without the HUD. FRAME_INTERP_HUD=0 turns it off.
+class FrameHud {
+public:
+    // Whether FRAME_INTERP_HUD leaves the HUD on (the default)
+    static bool Enabled();
+
+    // Adds transfer source and destination usage to a swapchain create
+    // info. Returns false, leaving it untouched, if the HUD is off or the
+    // swapchain does not qualify.
+    static bool PrepareSwapchain(const FrameGenerationDevice& device, VkSwapchainCreateInfoKHR* create_info);
+
+    // Allocates the HUD image, buffer and pipeline for a swapchain created
+    // from a prepared create info. Returns nullptr on failure.
+    static std::unique_ptr<FrameHud> Create(const FrameGenerationDevice& device, VkSwapchainKHR swapchain,
+                                            const VkSwapchainCreateInfoKHR& create_info);
+
+    ~FrameHud();
+
+    FrameHud(const FrameHud&) = delete;
+    FrameHud& operator=(const FrameHud&) = delete;
+
+    // Submits the HUD for a single-swapchain present's image on `queue` and
+    // returns the present info to use in its place, which points into this
+    // object until the next call. Returns `present_info` itself for a frame
+    // drawn without the HUD.
+    const VkPresentInfoKHR* Draw(VkQueue queue, uint32_t queue_family, std::mutex* queue_mutex,
+                                 const HUDState& hud, const VkPresentInfoKHR* present_info);
+
+    // Frames drawn and skipped, and the HUD's average cost
+    void PrintReport(std::ostream& out);
+
+private:
+    static constexpr uint32_t kSlotCount = 3;
+
+    // Per-submission resources, reused round-robin once their fence signals
+    struct Slot {
+        VkCommandBuffer commands = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkSemaphore ready = VK_NULL_HANDLE;   // HUD drawn, the image may present
+        bool timed = false;                   // Timestamps written, not yet read
+    };
+
+    explicit FrameHud(const FrameGenerationDevice& device);
+
+    bool CreateImage();
+    bool CreateBuffer();
+    bool CreatePipeline();
+    bool CreateSlots();
+    bool EnsureCommandBuffers(VkQueue queue, uint32_t queue_family);
+    void ReadTimestamps(uint32_t slot_index);
+    void WriteFrame(uint32_t slot_index, const HUDState& hud);
+    void Record(const Slot& slot, uint32_t slot_index, VkImage image);
+
+    const FrameGenerationDevice& device_;
+    std::vector<VkImage> swapchain_images_;
+    VkOffset3D origin_{};        // HUD corner in the swapchain image
+    VkExtent2D hud_extent_{};
+    uint32_t scale_ = 1;
+    bool blue_first_ = false;
+
+    // Copy of the swapchain corner the shader draws into
+    VkImage image_ = VK_NULL_HANDLE;
+    VkDeviceMemory image_memory_ = VK_NULL_HANDLE;
+    VkImageView image_view_ = VK_NULL_HANDLE;
+
+    // Font and per-slot frame blocks, mapped for the HUD's lifetime
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    VkDeviceMemory buffer_memory_ = VK_NULL_HANDLE;
+    uint8_t* buffer_mapped_ = nullptr;
+    bool buffer_coherent_ = false;
+
+    VkShaderModule shader_ = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+    VkPipeline pipeline_ = VK_NULL_HANDLE;
+    VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+    VkDescriptorSet descriptor_set_ = VK_NULL_HANDLE;
+
+    // Start and end timestamp per slot; none when the queue can't time
+    VkQueryPool query_pool_ = VK_NULL_HANDLE;
+    uint64_t timestamp_mask_ = 0;
+
+    // Command buffers are made on the first present, for that queue's family
+    VkQueue queue_ = VK_NULL_HANDLE;
+    VkCommandPool command_pool_ = VK_NULL_HANDLE;
+    std::array<Slot, kSlotCount> slots_;
+    uint32_t next_slot_ = 0;
+
+    // Application's thread only
+    VkPresentInfoKHR present_info_{};
+    VkSemaphore present_wait_ = VK_NULL_HANDLE;
+    std::vector<VkPipelineStageFlags> wait_stages_;
+
+    // Smoothed HUD cost, shown on its second line
+    double gpu_ms_ = 0.0;
+    double cpu_ms_ = 0.0;
+    uint64_t gpu_samples_ = 0;
+    uint64_t drawn_frames_ = 0;
+    uint64_t skipped_frames_ = 0;
+    double gpu_total_ms_ = 0.0;
+    double cpu_total_ms_ = 0.0;
+};
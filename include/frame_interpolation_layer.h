@@ -2,13 +2,21 @@
 
 #include <vulkan/vulkan.h>
 #include <vulkan/vk_layer.h>
+#include "disk_cache.h"
+#include "dispatch_map.h"
+#include "layer_core.h"
+#include "proc_table.h"
+#include "frame_timing.h"
+#include "frame_generation.h"
+#include "frame_capture.h"
+#include "frame_hud.h"
 #include <iostream>
 #include <unordered_map>
-#include <mutex>
 #include <chrono>
 #include <vector>
-#include <fstream>
+#include <array>
 #include <memory>
+#include <mutex>
 
 // Layer identification
 #define LAYER_NAME "VK_LAYER_frame_interpolation"
@@ -19,66 +27,42 @@ struct LayerInstanceDispatchTable {
     PFN_vkGetInstanceProcAddr GetInstanceProcAddr;
     PFN_vkDestroyInstance DestroyInstance;
     PFN_vkEnumeratePhysicalDevices EnumeratePhysicalDevices;
+    PFN_vkEnumeratePhysicalDeviceGroups EnumeratePhysicalDeviceGroups;
+    PFN_vkEnumeratePhysicalDeviceGroupsKHR EnumeratePhysicalDeviceGroupsKHR;
     PFN_vkGetPhysicalDeviceProperties GetPhysicalDeviceProperties;
+    PFN_vkGetPhysicalDeviceMemoryProperties GetPhysicalDeviceMemoryProperties;
+    PFN_vkGetPhysicalDeviceQueueFamilyProperties GetPhysicalDeviceQueueFamilyProperties;
+    PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR GetPhysicalDeviceSurfaceCapabilitiesKHR;
+    PFN_vkGetPhysicalDeviceFeatures2 GetPhysicalDeviceFeatures2;
+    PFN_vkEnumerateDeviceExtensionProperties EnumerateDeviceExtensionProperties;
     PFN_vkCreateDevice CreateDevice;
 };
 
 struct LayerDeviceDispatchTable {
     PFN_vkGetDeviceProcAddr GetDeviceProcAddr;
     PFN_vkDestroyDevice DestroyDevice;
+    PFN_vkGetDeviceQueue GetDeviceQueue;
+    PFN_vkGetDeviceQueue2 GetDeviceQueue2;
     PFN_vkCreateSwapchainKHR CreateSwapchainKHR;
     PFN_vkDestroySwapchainKHR DestroySwapchainKHR;
     PFN_vkAcquireNextImageKHR AcquireNextImageKHR;
     PFN_vkQueuePresentKHR QueuePresentKHR;
+    PFN_vkQueueSubmit QueueSubmit;
+    PFN_vkQueueSubmit2 QueueSubmit2;
+    PFN_vkQueueSubmit2KHR QueueSubmit2KHR;
+    PFN_vkQueueBindSparse QueueBindSparse;
+    PFN_vkQueueWaitIdle QueueWaitIdle;
+    PFN_vkDeviceWaitIdle DeviceWaitIdle;
 };
 
 // Forward declarations
 struct InstanceData;
 struct DeviceData;
-struct SwapchainData;
-
-// Frame timing data structure
-struct FrameTimingData {
-    std::chrono::high_resolution_clock::time_point timestamp;
-    uint32_t imageIndex;
-    VkPresentModeKHR presentMode;
-    double frametime_ms;
-    uint64_t frameNumber;
-};
-
-// HUD overlay state
-struct HUDState {
-    bool enabled = true;
-    std::vector<float> frametimes; // Rolling buffer of frame times
-    size_t maxSamples = 120; // Keep 2 seconds at 60fps
-    float currentFrametime = 0.0f;
-    VkPresentModeKHR currentPresentMode = VK_PRESENT_MODE_FIFO_KHR;
-};
-
-// Swapchain tracking data
-struct SwapchainData {
-    VkSwapchainKHR swapchain;
-    VkDevice device;
-    VkPresentModeKHR presentMode;
-    uint32_t imageCount;
-    VkExtent2D extent;
-    VkFormat format;
-    
-    // Frame timing tracking
-    std::chrono::high_resolution_clock::time_point lastFrameTime;
-    uint64_t frameNumber = 0;
-    std::vector<FrameTimingData> frameHistory;
-    
-    // CSV logging
-    std::unique_ptr<std::ofstream> csvFile;
-    
-    // HUD state
-    HUDState hud;
-};
 
 // Instance data structure
 struct InstanceData {
     VkInstance instance;
+    uint32_t api_version;   // The application's, from VkApplicationInfo
     LayerInstanceDispatchTable dispatch;
     std::unordered_map<VkDevice, DeviceData*> devices;
 };
@@ -88,21 +72,60 @@ struct DeviceData {
     VkDevice device;
     LayerDeviceDispatchTable dispatch;
     InstanceData* instance_data;
+    
+    // Guards the per-swapchain maps below. Acquire, present and wait-idle
+    // run on any thread while another creates or destroys a swapchain, so
+    // each takes it only to look an entry up and works on its own reference
+    // afterwards; a present never holds it.
+    std::mutex swapchain_mutex;
     std::unordered_map<VkSwapchainKHR, std::unique_ptr<SwapchainData>> swapchains;
+    
+    // Stage A1 frame generation, for swapchains that qualify
+    FrameGenerationDevice generation;
+    std::unordered_map<VkSwapchainKHR, std::shared_ptr<FrameGenerator>> generators;
+    
+    // FRAME_INTERP_CAPTURE, for swapchains that qualify
+    std::unordered_map<VkSwapchainKHR, std::shared_ptr<FrameCapture>> captures;
+    
+    // On-screen frame time HUD, for swapchains that qualify
+    std::unordered_map<VkSwapchainKHR, std::shared_ptr<FrameHud>> huds;
+
+    // Blend, scene change and HUD pipelines; null when the disk cache is off
+    std::unique_ptr<PipelineDiskCache> pipeline_cache;
 };
 
-// Global data
-extern std::unordered_map<void*, InstanceData*> instance_map;
-extern std::unordered_map<void*, DeviceData*> device_map;
-extern std::mutex global_mutex;
+// Physical devices are recorded when enumerated so instance-level calls can
+// find their instance without a scan. Keyed by the handle itself.
+struct PhysicalDeviceData {
+    VkPhysicalDevice physical_device;
+    InstanceData* instance_data;
+};
+
+// Queues are recorded at vkGetDeviceQueue/vkGetDeviceQueue2 so present and
+// submit can find their device without a scan. Keyed by the handle itself.
+struct QueueData {
+    VkQueue queue;
+    DeviceData* device_data;
+    uint32_t family_index;
+    uint32_t queue_index;
+    
+    // Frame generators present from their own thread, so every use of the
+    // queue goes through this
+    std::mutex mutex;
+};
+
+// Global data, keyed by dispatch key
+extern DispatchMap<InstanceData> instance_map;
+extern DispatchMap<DeviceData> device_map;
+extern DispatchMap<PhysicalDeviceData> physical_device_map;
+extern DispatchMap<QueueData> queue_map;
 
 // Utility functions
 InstanceData* GetInstanceData(VkInstance instance);
 DeviceData* GetDeviceData(VkDevice device);
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice);
+DeviceData* GetDeviceData(VkQueue queue);
 SwapchainData* GetSwapchainData(VkDevice device, VkSwapchainKHR swapchain);
-void LogFrameTiming(SwapchainData* swapchain_data, uint32_t imageIndex);
-void UpdateHUD(SwapchainData* swapchain_data, double frametime_ms);
-void WriteCSVHeader(std::ofstream& file);
 
 // Layer entry points
 VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance instance, const char* pName);
@@ -111,11 +134,22 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice device, co
 // Hooked Vulkan functions
 VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateInstance(const VkInstanceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkInstance* pInstance);
 VKAPI_ATTR void VKAPI_CALL layer_vkDestroyInstance(VkInstance instance, const VkAllocationCallbacks* pAllocator);
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkEnumeratePhysicalDevices(VkInstance instance, uint32_t* pPhysicalDeviceCount, VkPhysicalDevice* pPhysicalDevices);
 VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateDevice(VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDevice* pDevice);
 VKAPI_ATTR void VKAPI_CALL layer_vkDestroyDevice(VkDevice device, const VkAllocationCallbacks* pAllocator);
+VKAPI_ATTR void VKAPI_CALL layer_vkGetDeviceQueue(VkDevice device, uint32_t queueFamilyIndex, uint32_t queueIndex, VkQueue* pQueue);
+VKAPI_ATTR void VKAPI_CALL layer_vkGetDeviceQueue2(VkDevice device, const VkDeviceQueueInfo2* pQueueInfo, VkQueue* pQueue);
 
 // Swapchain interception functions (Stage 0 focus)
 VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateSwapchainKHR(VkDevice device, const VkSwapchainCreateInfoKHR* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkSwapchainKHR* pSwapchain);
 VKAPI_ATTR void VKAPI_CALL layer_vkDestroySwapchainKHR(VkDevice device, VkSwapchainKHR swapchain, const VkAllocationCallbacks* pAllocator);
 VKAPI_ATTR VkResult VKAPI_CALL layer_vkAcquireNextImageKHR(VkDevice device, VkSwapchainKHR swapchain, uint64_t timeout, VkSemaphore semaphore, VkFence fence, uint32_t* pImageIndex);
 VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* pPresentInfo);
+
+// Queue access, serialized with the frame generators' present threads
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence);
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueSubmit2(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2* pSubmits, VkFence fence);
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueSubmit2KHR(VkQueue queue, uint32_t submitCount, const VkSubmitInfo2* pSubmits, VkFence fence);
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueBindSparse(VkQueue queue, uint32_t bindInfoCount, const VkBindSparseInfo* pBindInfo, VkFence fence);
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueWaitIdle(VkQueue queue);
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkDeviceWaitIdle(VkDevice device);
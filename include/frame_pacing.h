@@ -0,0 +1,65 @@
+#pragma once
+
+#include "frame_ring_buffer.h"
+#include <chrono>
+#include <cstdint>
+
+// Stage A2 present scheduling. The application's frame N is held back by
+// about half a nominal interval so the synthetic frame between N-1 and N can
+// go out at the midpoint of the two real presents:
+//
+//   app:        N-1 ------------------- N
+//   presented:       syn ------- N-1 ------- syn ------- N
+//
+// The nominal interval is a moving average of application present
+// intervals. The synthetic frame can't go out before frame N arrives, so the
+// delay also covers the spread of recent intervals. Real presents follow the
+// nominal interval from the previous one and are only pulled gently
+// (kPhaseGain) toward that delay, so jitter in when the application presents
+// does not reach the display. An interval over kHitchFactor x nominal is a hitch: that frame
+// is presented at once with no synthetic frame, and pacing restarts from
+// it. A second consecutive hitch means the rate really changed, so the
+// average is rebuilt from there.
+struct PacingDecision {
+    bool generate = false;                               // Present a synthetic frame first
+    std::chrono::steady_clock::time_point synthetic_at;  // When to present it
+    std::chrono::steady_clock::time_point real_at;       // When to present the application's frame
+};
+
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr float kHitchFactor = 1.5f;
+    static constexpr size_t kWarmupFrames = 4;  // Intervals needed before pacing starts
+    static constexpr float kPhaseGain = 0.125f;
+
+    // Called when the application presents, with the present's arrival time
+    PacingDecision OnFrame(Clock::time_point now);
+
+    // The caller presented the last frame at `presented_at` instead of its
+    // real_at (e.g. without generation); the next midpoint is taken from there
+    void Resync(Clock::time_point presented_at) {
+        last_real_at_ = presented_at;
+        locked_ = false;
+    }
+
+    float NominalIntervalMs() const { return intervals_.Empty() ? 0.0f : intervals_.Stats().avg; }
+    uint64_t Hitches() const { return hitches_; }
+
+private:
+    FloatRing<16> intervals_;
+    Clock::time_point last_frame_{};
+    Clock::time_point last_real_at_{};
+    bool has_last_frame_ = false;
+    bool locked_ = false;   // last_real_at_ came from a paced frame
+    uint32_t consecutive_hitches_ = 0;
+    uint64_t hitches_ = 0;
+};
+
+// Sleeps until `deadline` with OS sleep for all but the last kSpinWindow,
+// then spins (yielding) through the rest, so wake-up lands within a few
+// microseconds instead of the scheduler's ~1 ms granularity.
+constexpr std::chrono::microseconds kSpinWindow{1500};
+
+void SleepUntilPrecise(std::chrono::steady_clock::time_point deadline);
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define FRAME_RING_USE_SSE 1
+#endif
+
+// Rolling summary of a window of frame times
+struct FrameTimeStats {
+    float min = 0.0f;
+    float max = 0.0f;
+    float avg = 0.0f;
+};
+
+// Min/max/average over `count` contiguous floats, four lanes at a time
+// where SSE is available.
+inline FrameTimeStats ComputeFrameTimeStats(const float* values, size_t count) {
+    FrameTimeStats stats;
+    if (count == 0) return stats;
+
+    float min_value = values[0];
+    float max_value = values[0];
+    float sum = 0.0f;
+    size_t i = 0;
+
+#ifdef FRAME_RING_USE_SSE
+    if (count >= 4) {
+        __m128 vmin = _mm_loadu_ps(values);
+        __m128 vmax = vmin;
+        __m128 vsum = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4) {
+            __m128 v = _mm_loadu_ps(values + i);
+            vmin = _mm_min_ps(vmin, v);
+            vmax = _mm_max_ps(vmax, v);
+            vsum = _mm_add_ps(vsum, v);
+        }
+
+        alignas(16) float lanes_min[4];
+        alignas(16) float lanes_max[4];
+        alignas(16) float lanes_sum[4];
+        _mm_store_ps(lanes_min, vmin);
+        _mm_store_ps(lanes_max, vmax);
+        _mm_store_ps(lanes_sum, vsum);
+        for (int lane = 0; lane < 4; lane++) {
+            if (lanes_min[lane] < min_value) min_value = lanes_min[lane];
+            if (lanes_max[lane] > max_value) max_value = lanes_max[lane];
+            sum += lanes_sum[lane];
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        if (values[i] < min_value) min_value = values[i];
+        if (values[i] > max_value) max_value = values[i];
+        sum += values[i];
+    }
+
+    stats.min = min_value;
+    stats.max = max_value;
+    stats.avg = sum / static_cast<float>(count);
+    return stats;
+}
+
+// Fixed-capacity ring of float samples. Storage is inline, so pushing never
+// allocates and the oldest sample is overwritten once full.
+template <size_t Capacity>
+class FloatRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "FloatRing capacity must be a power of two");
+
+public:
+    static constexpr size_t kCapacity = Capacity;
+
+    void Push(float value) {
+        values_[head_ & (Capacity - 1)] = value;
+        head_++;
+    }
+
+    size_t Size() const {
+        return head_ < Capacity ? static_cast<size_t>(head_) : Capacity;
+    }
+
+    bool Empty() const { return head_ == 0; }
+
+    // Oldest-first access, i < Size()
+    float operator[](size_t i) const {
+        return values_[(head_ - Size() + i) & (Capacity - 1)];
+    }
+
+    float Latest() const {
+        return values_[(head_ - 1) & (Capacity - 1)];
+    }
+
+    // The valid samples are always the first Size() slots, in ring order,
+    // so stats can run over them as one contiguous span.
+    FrameTimeStats Stats() const {
+        return ComputeFrameTimeStats(values_.data(), Size());
+    }
+
+    void Clear() { head_ = 0; }
+
+private:
+    alignas(16) std::array<float, Capacity> values_{};
+    uint64_t head_ = 0;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Summary of every frame a swapchain has presented so far
+struct FrameStatsReport {
+    uint64_t frames = 0;
+    double mean_ms = 0.0;
+    double stddev_ms = 0.0;
+    double min_ms = 0.0;
+    double max_ms = 0.0;
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double low1_fps = 0.0;      // Average FPS over the slowest 1% of frames
+    double low01_fps = 0.0;     // Average FPS over the slowest 0.1% of frames
+    uint64_t stutters = 0;      // Frames longer than kStutterFactor x moving average
+};
+
+// Constant-memory streaming frame time statistics.
+//
+// Frame times go into a log-bucketed histogram (HDR-histogram style: the
+// bucket is the float's exponent plus its top kSubBucketBits mantissa bits,
+// so every bucket is within ~0.8% of its value). Mean/variance use Welford's
+// update and stutters are counted against an exponential moving average.
+// Record() is O(1) with no allocation; Report() walks the buckets.
+class FrameStatsEngine {
+public:
+    static constexpr int kSubBucketBits = 7;
+    static constexpr int kMinExponent = -10;    // 2^-10 ms, ~1 us
+    static constexpr int kMaxExponent = 16;     // up to 2^17 ms, ~131 s
+    static constexpr size_t kBucketCount =
+        static_cast<size_t>(kMaxExponent - kMinExponent + 1) << kSubBucketBits;
+
+    static constexpr double kStutterFactor = 1.5;
+    static constexpr double kAverageWeight = 0.05;  // EMA over roughly 20 frames
+    static constexpr uint64_t kWarmupFrames = 20;
+
+    void Record(float frametime_ms);
+    FrameStatsReport Report() const;
+    void Reset();
+
+private:
+    static size_t BucketIndex(float frametime_ms);
+    static double BucketValue(size_t index);
+
+    double Percentile(double fraction) const;
+    double SlowestAverageFps(uint64_t frames) const;
+
+    std::array<uint32_t, kBucketCount> buckets_{};
+    uint64_t count_ = 0;
+    double mean_ = 0.0;
+    double m2_ = 0.0;
+    float min_ = 0.0f;
+    float max_ = 0.0f;
+    double movingAverage_ = 0.0;
+    uint64_t stutters_ = 0;
+};
+
+// Writes a one-line "[FRAME_INTERP] Stats (<label>): ..." summary
+void PrintFrameStatsReport(std::ostream& out, const FrameStatsReport& report, const char* label);
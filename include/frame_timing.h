@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "frame_ring_buffer.h"
+#include "frame_stats.h"
+#include "telemetry_writer.h"
+#include <array>
+#include <chrono>
+#include <memory>
+
+// Per-swapchain frame timing, HUD and telemetry state, shared by the frame
+// interpolation layer and the combined layer's interpolation module.
+
+// Frame timing data structure
+struct FrameTimingData {
+    std::chrono::high_resolution_clock::time_point timestamp;
+    uint32_t imageIndex;
+    VkPresentModeKHR presentMode;
+    double frametime_ms;
+    uint64_t frameNumber;
+};
+
+// Last kCapacity frames, stored as struct-of-arrays so frame times are one
+// contiguous float column. Lives inline in SwapchainData, so recording a
+// frame never allocates.
+struct FrameHistory {
+    static constexpr size_t kCapacity = 1024;
+    
+    alignas(16) std::array<float, kCapacity> frametimes_ms{};
+    std::array<std::chrono::high_resolution_clock::time_point, kCapacity> timestamps{};
+    std::array<uint64_t, kCapacity> frameNumbers{};
+    std::array<uint32_t, kCapacity> imageIndices{};
+    std::array<VkPresentModeKHR, kCapacity> presentModes{};
+    uint64_t head = 0;
+    
+    void Push(const FrameTimingData& timing_data) {
+        size_t slot = head & (kCapacity - 1);
+        frametimes_ms[slot] = static_cast<float>(timing_data.frametime_ms);
+        timestamps[slot] = timing_data.timestamp;
+        frameNumbers[slot] = timing_data.frameNumber;
+        imageIndices[slot] = timing_data.imageIndex;
+        presentModes[slot] = timing_data.presentMode;
+        head++;
+    }
+    
+    size_t Size() const {
+        return head < kCapacity ? static_cast<size_t>(head) : kCapacity;
+    }
+    
+    // Oldest-first access, i < Size()
+    FrameTimingData At(size_t i) const {
+        size_t slot = (head - Size() + i) & (kCapacity - 1);
+        FrameTimingData timing_data;
+        timing_data.timestamp = timestamps[slot];
+        timing_data.imageIndex = imageIndices[slot];
+        timing_data.presentMode = presentModes[slot];
+        timing_data.frametime_ms = frametimes_ms[slot];
+        timing_data.frameNumber = frameNumbers[slot];
+        return timing_data;
+    }
+    
+    FrameTimeStats Stats() const {
+        return ComputeFrameTimeStats(frametimes_ms.data(), Size());
+    }
+};
+
+// HUD overlay state
+struct HUDState {
+    bool enabled = true;
+    FloatRing<128> frametimes; // Rolling buffer of frame times, ~2 seconds at 60fps
+    float currentFrametime = 0.0f;
+    VkPresentModeKHR currentPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+};
+
+// Swapchain tracking data
+struct SwapchainData {
+    VkSwapchainKHR swapchain;
+    VkDevice device;
+    VkPresentModeKHR presentMode;
+    uint32_t imageCount;
+    VkExtent2D extent;
+    VkFormat format;
+    
+    // Frame timing tracking
+    std::chrono::high_resolution_clock::time_point lastFrameTime;
+    uint64_t frameNumber = 0;
+    FrameHistory frameHistory;
+    
+    // Streaming statistics over the swapchain's whole lifetime
+    FrameStatsEngine stats;
+    std::chrono::steady_clock::time_point lastStatsReport;
+    
+    // Binary telemetry, written off the acquire path
+    std::unique_ptr<TelemetryWriter> telemetry;
+    
+    // Scene cuts the frame generator has detected, and the count as of the
+    // last telemetry sample; a difference flags the next sample
+    uint64_t sceneChanges = 0;
+    uint64_t loggedSceneChanges = 0;
+    
+    // HUD state
+    HUDState hud;
+};
+
+// Records one acquire: frame time, history, HUD, stats and telemetry
+void LogFrameTiming(SwapchainData* swapchain_data, uint32_t imageIndex);
+void UpdateHUD(SwapchainData* swapchain_data, double frametime_ms);
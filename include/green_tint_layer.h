@@ -0,0 +1,174 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_layer.h>
+#include "disk_cache.h"
+#include "dispatch_map.h"
+#include "layer_core.h"
+#include "proc_table.h"
+#include "tint_pass.h"
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Layer name and description
+#define LAYER_NAME "VK_LAYER_green_tint"
+#define LAYER_DESCRIPTION "Vulkan layer that tints rendered output green"
+
+// Simple dispatch table structures
+struct LayerInstanceDispatchTable {
+    PFN_vkGetInstanceProcAddr GetInstanceProcAddr;
+    PFN_vkDestroyInstance DestroyInstance;
+    PFN_vkEnumeratePhysicalDevices EnumeratePhysicalDevices;
+    PFN_vkEnumeratePhysicalDeviceGroups EnumeratePhysicalDeviceGroups;
+    PFN_vkEnumeratePhysicalDeviceGroupsKHR EnumeratePhysicalDeviceGroupsKHR;
+    PFN_vkGetPhysicalDeviceProperties GetPhysicalDeviceProperties;
+    PFN_vkGetPhysicalDeviceMemoryProperties GetPhysicalDeviceMemoryProperties;
+    PFN_vkGetPhysicalDeviceQueueFamilyProperties GetPhysicalDeviceQueueFamilyProperties;
+    PFN_vkGetPhysicalDeviceFormatProperties GetPhysicalDeviceFormatProperties;
+    PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR GetPhysicalDeviceSurfaceCapabilitiesKHR;
+    PFN_vkCreateDevice CreateDevice;
+};
+
+struct LayerDeviceDispatchTable {
+    PFN_vkGetDeviceProcAddr GetDeviceProcAddr;
+    PFN_vkDestroyDevice DestroyDevice;
+    PFN_vkGetDeviceQueue GetDeviceQueue;
+    PFN_vkGetDeviceQueue2 GetDeviceQueue2;
+    PFN_vkCreateSwapchainKHR CreateSwapchainKHR;
+    PFN_vkDestroySwapchainKHR DestroySwapchainKHR;
+    PFN_vkQueuePresentKHR QueuePresentKHR;
+};
+
+struct InstanceData {
+    LayerInstanceDispatchTable vtable;
+    VkInstance instance;
+};
+
+struct DeviceData {
+    LayerDeviceDispatchTable vtable;
+    VkDevice device;
+    VkPhysicalDevice physical_device;
+
+    // Null if the pass couldn't be set up; presents then pass through
+    std::unique_ptr<TintPass> tint_pass;
+    std::unique_ptr<PipelineDiskCache> pipeline_cache;   // Null when the disk cache is off
+    std::atomic<uint64_t> present_count{0};
+};
+
+// Physical devices are recorded when enumerated so instance-level calls can
+// find their instance without a scan. Keyed by the handle itself.
+struct PhysicalDeviceData {
+    VkPhysicalDevice physical_device;
+    InstanceData* instance_data;
+};
+
+// Queues are recorded at vkGetDeviceQueue/vkGetDeviceQueue2 so present and
+// submit can find their device without a scan. Keyed by the handle itself.
+struct QueueData {
+    VkQueue queue;
+    DeviceData* device_data;
+    uint32_t family_index;
+    uint32_t queue_index;
+};
+
+// Global data, keyed by dispatch key
+extern DispatchMap<InstanceData> instance_map;
+extern DispatchMap<DeviceData> device_map;
+extern DispatchMap<PhysicalDeviceData> physical_device_map;
+extern DispatchMap<QueueData> queue_map;
+
+// Utility functions
+InstanceData* GetInstanceData(VkInstance instance);
+DeviceData* GetDeviceData(VkDevice device);
+DeviceData* GetDeviceData(VkCommandBuffer commandBuffer);
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice);
+DeviceData* GetDeviceData(VkQueue queue);
+void LogAPICall(const std::string& function_name, const std::string& details = "");
+
+// Layer entry points
+extern "C" {
+    VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
+        const VkInstanceCreateInfo* pCreateInfo,
+        const VkAllocationCallbacks* pAllocator,
+        VkInstance* pInstance);
+
+    VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(
+        VkInstance instance,
+        const VkAllocationCallbacks* pAllocator);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(
+        VkPhysicalDevice physicalDevice,
+        const VkDeviceCreateInfo* pCreateInfo,
+        const VkAllocationCallbacks* pAllocator,
+        VkDevice* pDevice);
+
+    VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(
+        VkDevice device,
+        const VkAllocationCallbacks* pAllocator);
+
+    VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue(
+        VkDevice device,
+        uint32_t queueFamilyIndex,
+        uint32_t queueIndex,
+        VkQueue* pQueue);
+
+    VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue2(
+        VkDevice device,
+        const VkDeviceQueueInfo2* pQueueInfo,
+        VkQueue* pQueue);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(
+        VkInstance instance,
+        uint32_t* pPhysicalDeviceCount,
+        VkPhysicalDevice* pPhysicalDevices);
+
+    VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(
+        VkPhysicalDevice physicalDevice,
+        VkPhysicalDeviceProperties* pProperties);
+
+    // The tint is applied to swapchain images at present
+    VKAPI_ATTR VkResult VKAPI_CALL vkCreateSwapchainKHR(
+        VkDevice device,
+        const VkSwapchainCreateInfoKHR* pCreateInfo,
+        const VkAllocationCallbacks* pAllocator,
+        VkSwapchainKHR* pSwapchain);
+
+    VKAPI_ATTR void VKAPI_CALL vkDestroySwapchainKHR(
+        VkDevice device,
+        VkSwapchainKHR swapchain,
+        const VkAllocationCallbacks* pAllocator);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkQueuePresentKHR(
+        VkQueue queue,
+        const VkPresentInfoKHR* pPresentInfo);
+
+    VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(
+        VkInstance instance,
+        const char* pName);
+
+    VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(
+        VkDevice device,
+        const char* pName);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(
+        uint32_t* pPropertyCount,
+        VkLayerProperties* pProperties);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(
+        const char* pLayerName,
+        uint32_t* pPropertyCount,
+        VkExtensionProperties* pProperties);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceLayerProperties(
+        VkPhysicalDevice physicalDevice,
+        uint32_t* pPropertyCount,
+        VkLayerProperties* pProperties);
+
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(
+        VkPhysicalDevice physicalDevice,
+        const char* pLayerName,
+        uint32_t* pPropertyCount,
+        VkExtensionProperties* pProperties);
+}
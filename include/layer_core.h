@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_layer.h>
+#include "dispatch_map.h"
+#include <cstdint>
+#include <string>
+
+// Plumbing shared by every layer in the repo, built once into the layer_core
+// static library.
+
+// The loader's link info on a create-info pNext chain, or nullptr
+VkLayerInstanceCreateInfo* FindInstanceLinkInfo(const VkInstanceCreateInfo* pCreateInfo);
+VkLayerDeviceCreateInfo* FindDeviceLinkInfo(const VkDeviceCreateInfo* pCreateInfo);
+
+// The loader's callback for initializing dispatchable objects a layer creates
+// itself (e.g. its own command buffers), or nullptr
+PFN_vkSetDeviceLoaderData FindDeviceLoaderDataCallback(const VkDeviceCreateInfo* pCreateInfo);
+
+// vkEnumerate{Instance,Device}LayerProperties for a layer reporting only itself
+VkResult EnumerateLayerProperties(const VkLayerProperties& layer_props, uint32_t* pPropertyCount,
+                                  VkLayerProperties* pProperties);
+
+// Local time as "HH:MM:SS.mmm" into `buffer` (at least 13 bytes)
+void FormatTimestamp(char* buffer, size_t size);
+
+// "[HH:MM:SS.mmm] <prefix>: <function> - <details>" on stdout, flushed.
+// The " - <details>" part is left out when details is null or empty. Lines
+// are built on the stack and cut at kMaxLogLineBytes, so logging from a
+// vkCmd* hook doesn't allocate.
+constexpr size_t kMaxLogLineBytes = 1024;
+void LogLayerMessage(const char* prefix, const char* function_name, const char* details);
+
+// Physical devices are recorded when enumerated so instance-level calls can
+// find their instance without a scan; queues likewise at vkGetDeviceQueue*.
+// Records are keyed by the handle itself and point back at their owner.
+template <typename Record, typename Owner>
+void TrackPhysicalDevices(DispatchMap<Record>& map, Owner* instance_data, uint32_t count,
+                          const VkPhysicalDevice* physical_devices) {
+    for (uint32_t i = 0; i < count; i++) {
+        Record* physical_device_data = new Record();
+        physical_device_data->physical_device = physical_devices[i];
+        physical_device_data->instance_data = instance_data;
+        // Applications enumerate more than once; keep the first record
+        if (!map.TryInsert(physical_devices[i], physical_device_data)) {
+            delete physical_device_data;
+        }
+    }
+}
+
+// Devices in a group are tracked like individually enumerated ones
+template <typename Record, typename Owner>
+void TrackPhysicalDeviceGroups(DispatchMap<Record>& map, Owner* instance_data, VkResult result, uint32_t count,
+                               const VkPhysicalDeviceGroupProperties* groups) {
+    if ((result == VK_SUCCESS || result == VK_INCOMPLETE) && groups) {
+        for (uint32_t i = 0; i < count; i++) {
+            TrackPhysicalDevices(map, instance_data, groups[i].physicalDeviceCount, groups[i].physicalDevices);
+        }
+    }
+}
+
+template <typename Record, typename Owner>
+void ReleasePhysicalDevices(DispatchMap<Record>& map, Owner* instance_data) {
+    for (Record* physical_device_data : map.EraseIf(
+             [instance_data](Record* data) { return data->instance_data == instance_data; })) {
+        delete physical_device_data;
+    }
+}
+
+template <typename Record, typename Owner>
+void TrackQueue(DispatchMap<Record>& map, Owner* device_data, VkQueue queue, uint32_t family_index,
+                uint32_t queue_index) {
+    if (queue == VK_NULL_HANDLE) return;
+
+    Record* queue_data = new Record();
+    queue_data->queue = queue;
+    queue_data->device_data = device_data;
+    queue_data->family_index = family_index;
+    queue_data->queue_index = queue_index;
+    if (!map.TryInsert(queue, queue_data)) {
+        delete queue_data;
+    }
+}
+
+template <typename Record, typename Owner>
+void ReleaseQueues(DispatchMap<Record>& map, Owner* device_data) {
+    for (Record* queue_data : map.EraseIf(
+             [device_data](Record* data) { return data->device_data == device_data; })) {
+        delete queue_data;
+    }
+}
@@ -2,32 +2,21 @@
 
 #include <vulkan/vulkan.h>
 #include <vulkan/vk_layer.h>
-#include <unordered_map>
-#include <mutex>
+#include "dispatch_map.h"
+#include "layer_core.h"
+#include "proc_table.h"
+#include "api_trace.h"
+#include "logger_hooks.h"
 #include <iostream>
 #include <fstream>
 #include <chrono>
-#include <iomanip>
 
 // Layer name and description
 #define LAYER_NAME "VK_LAYER_logger"
 #define LAYER_DESCRIPTION "Simple Vulkan API call logger"
 
-// Simple dispatch table structures
-struct LayerInstanceDispatchTable {
-    PFN_vkGetInstanceProcAddr GetInstanceProcAddr;
-    PFN_vkDestroyInstance DestroyInstance;
-    PFN_vkEnumeratePhysicalDevices EnumeratePhysicalDevices;
-    PFN_vkGetPhysicalDeviceProperties GetPhysicalDeviceProperties;
-    PFN_vkCreateDevice CreateDevice;
-};
-
-struct LayerDeviceDispatchTable {
-    PFN_vkGetDeviceProcAddr GetDeviceProcAddr;
-    PFN_vkDestroyDevice DestroyDevice;
-};
-
-// Function pointer types for dispatch tables
+// The dispatch tables, LoggerFunction and every hook not declared below are
+// generated from the Vulkan registry (tools/gen_logger_hooks.py)
 struct InstanceData {
     LayerInstanceDispatchTable vtable;
     VkInstance instance;
@@ -40,16 +29,29 @@ struct DeviceData {
     InstanceData* instance_data;
 };
 
-// Global data
-extern std::unordered_map<void*, InstanceData*> instance_map;
-extern std::unordered_map<void*, DeviceData*> device_map;
-extern std::mutex global_mutex;
+// Physical devices are recorded when enumerated so instance-level calls can
+// find their instance without a scan. Keyed by the handle itself.
+struct PhysicalDeviceData {
+    VkPhysicalDevice physical_device;
+    InstanceData* instance_data;
+};
+
+// Global data, keyed by dispatch key
+extern DispatchMap<InstanceData> instance_map;
+extern DispatchMap<DeviceData> device_map;
+extern DispatchMap<PhysicalDeviceData> physical_device_map;
 
 // Utility functions
 InstanceData* GetInstanceData(VkInstance instance);
 DeviceData* GetDeviceData(VkDevice device);
-void LogAPICall(const std::string& function_name, const std::string& details = "");
-std::string GetCurrentTimestamp();
+DeviceData* GetDeviceData(VkQueue queue);
+DeviceData* GetDeviceData(VkCommandBuffer commandBuffer);
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice);
+void LogAPICall(const char* function_name, const char* details = nullptr);
+
+// Binary trace mode, enabled by VK_LOGGER_TRACE=<path>. Returns null when
+// off; text logging is skipped while it is on.
+ApiTrace* GetApiTrace();
 
 // Layer entry points
 extern "C" {
@@ -77,9 +79,10 @@ extern "C" {
         uint32_t* pPhysicalDeviceCount,
         VkPhysicalDevice* pPhysicalDevices);
 
-    VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(
-        VkPhysicalDevice physicalDevice,
-        VkPhysicalDeviceProperties* pProperties);
+    VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(
+        VkInstance instance,
+        uint32_t* pPhysicalDeviceGroupCount,
+        VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties);
 
     VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(
         VkInstance instance,
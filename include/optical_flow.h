@@ -0,0 +1,120 @@
+#pragma once
+
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// CPU reference optical flow with the FidelityFX optical flow output layout:
+// one R16G16_SINT vector per 8x8 block of the frame, (W+7)/8 x (H+7)/8 of
+// them. For the block at (bx, by) in the current frame the vector (dx, dy),
+// in whole pixels, points at where its content was in the previous frame.
+//
+// Frames are reduced to 8-bit luma and a box-filtered pyramid of up to
+// kMaxLevels levels. The coarsest level gets an exhaustive +/-kSearchRadius
+// block search; every finer level starts from the doubled parent vector (or
+// a neighbouring parent's, whichever matches best) and refines it by
+// +/-kRefineRadius. Block rows are matched in parallel on a ThreadPool.
+//
+// It is a validation oracle for the GPU path and a software fallback; the
+// SAD kernels are exact, so every kernel variant produces identical vectors.
+
+// Block matching kernels, picked at runtime from what the CPU supports.
+// OPTICAL_FLOW_KERNELS=scalar|sse41|avx2 forces one (if supported).
+enum class SadKernelSet {
+    Scalar,
+    Sse41,
+    Avx2,
+};
+
+struct SadKernels {
+    // SAD of the 8x8 block at `current` against the one at `reference`
+    uint32_t (*sad8x8)(const uint8_t* current, ptrdiff_t current_stride,
+                       const uint8_t* reference, ptrdiff_t reference_stride);
+    // SADs against the 8 blocks at reference + 0..7 along x. Reads 15 bytes
+    // of each reference row.
+    void (*sad8x8_run8)(const uint8_t* current, ptrdiff_t current_stride,
+                        const uint8_t* reference, ptrdiff_t reference_stride, uint16_t sads[8]);
+    SadKernelSet set;
+    const char* name;
+};
+
+bool SadKernelsSupported(SadKernelSet set);
+SadKernels GetSadKernels(SadKernelSet set);
+SadKernels BestSadKernels();   // Honours OPTICAL_FLOW_KERNELS
+
+enum class PixelOrder {
+    RGBA,
+    BGRA,
+};
+
+struct OpticalFlowOptions {
+    uint32_t threads = 0;            // ThreadPool size; 0 = hardware threads
+    ThreadPool* pool = nullptr;      // Shared pool to run on instead; `threads` is then ignored
+    const SadKernels* kernels = nullptr;   // nullptr = BestSadKernels()
+};
+
+class OpticalFlowEngine {
+public:
+    static constexpr uint32_t kBlockSize = 8;
+    static constexpr uint32_t kMaxLevels = 7;
+    static constexpr int kSearchRadius = 12;   // ~24 px window at the coarsest level
+    static constexpr int kRefineRadius = 2;
+    static constexpr int kPadding = 32;        // Replicated border around every level
+
+    // Returns nullptr for frames too small to hold one block
+    static std::unique_ptr<OpticalFlowEngine> Create(uint32_t width, uint32_t height,
+                                                     const OpticalFlowOptions& options = {});
+
+    OpticalFlowEngine(const OpticalFlowEngine&) = delete;
+    OpticalFlowEngine& operator=(const OpticalFlowEngine&) = delete;
+
+    // Adds a 32-bit RGBA/BGRA frame and computes its flow against the previous
+    // one. Returns false (no vectors) for the first frame after Create/Reset.
+    bool Dispatch(const uint8_t* pixels, size_t row_pitch, PixelOrder order);
+
+    // Forget the previous frame, e.g. on a scene cut
+    void Reset() { has_previous_ = false; }
+
+    // Interleaved x, y vectors, GridWidth() x GridHeight(), row-major
+    const int16_t* Vectors() const { return levels_[0].vectors.data(); }
+    uint32_t GridWidth() const { return levels_[0].grid_width; }
+    uint32_t GridHeight() const { return levels_[0].grid_height; }
+
+    uint32_t LevelCount() const { return static_cast<uint32_t>(levels_.size()); }
+    uint32_t ThreadCount() const { return pool_->ThreadCount(); }
+    const SadKernels& Kernels() const { return kernels_; }
+
+private:
+    // Luma plane with kPadding replicated pixels on every side
+    struct Plane {
+        std::vector<uint8_t> storage;
+        ptrdiff_t stride = 0;
+        uint8_t* origin = nullptr;   // Pixel (0, 0)
+    };
+
+    struct Level {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t grid_width = 0;
+        uint32_t grid_height = 0;
+        Plane planes[2];             // Indexed by frame parity
+        std::vector<int16_t> vectors;
+    };
+
+    OpticalFlowEngine(ThreadPool* pool, uint32_t threads, const SadKernels& kernels);
+
+    void BuildPyramid(const uint8_t* pixels, size_t row_pitch, PixelOrder order);
+    static void PadRow(const Level& level, Plane& plane, uint32_t y);
+    static void PadTopBottom(const Level& level, Plane& plane);
+    void SearchBlockRow(uint32_t level_index, uint32_t by);
+    void RefineBlockRow(uint32_t level_index, uint32_t by);
+
+    std::unique_ptr<ThreadPool> owned_pool_;
+    ThreadPool* pool_;
+    SadKernels kernels_;
+    std::vector<Level> levels_;
+    uint32_t current_ = 0;           // Plane index of the newest frame
+    bool has_previous_ = false;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+// Perfect-hash lookup for the entry points a layer hands out from
+// vkGetInstanceProcAddr/vkGetDeviceProcAddr.
+//
+// Each layer lists its hooks once as an X-macro of X(vkName, function) and
+// declares a table with DECLARE_PROC_TABLE; generated code declares the same
+// arrays directly. The slot layout is found at compile time, so a lookup is
+// one hash of the name, two small table reads and one strcmp against the
+// only candidate.
+
+// FNV-1a, finished with the murmur3 mixer so every bit depends on the whole name
+constexpr uint64_t ProcNameHash(const char* name) {
+    uint64_t hash = 14695981039346656037ull;
+    for (; *name; name++) {
+        hash = (hash ^ static_cast<uint8_t>(*name)) * 1099511628211ull;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+constexpr size_t ProcHashPowerOfTwo(size_t at_least) {
+    size_t value = 1;
+    while (value < at_least) value <<= 1;
+    return value;
+}
+
+// Hash-and-displace perfect hash: the low bits of the hash pick a bucket
+// (about two names each), and each bucket stores the displacement that moves
+// all of its names into free slots of a half-empty slot array.
+template <size_t Count,
+          size_t Slots = ProcHashPowerOfTwo(Count * 2),
+          size_t Buckets = ProcHashPowerOfTwo((Count + 1) / 2)>
+class ProcHash {
+    static_assert(Count > 0 && Count < 0xFFFF, "ProcHash slots store 16-bit indices");
+
+public:
+    static constexpr uint16_t kEmpty = 0xFFFF;
+
+    constexpr explicit ProcHash(const char* const (&names)[Count])
+        : names_(), slots_(), displacements_() {
+        std::array<uint64_t, Count> hashes{};
+        std::array<size_t, Buckets> bucket_sizes{};
+        size_t largest = 0;
+        for (size_t i = 0; i < Count; i++) {
+            names_[i] = names[i];
+            hashes[i] = ProcNameHash(names[i]);
+            size_t size = ++bucket_sizes[hashes[i] & (Buckets - 1)];
+            largest = size > largest ? size : largest;
+        }
+        for (size_t s = 0; s < Slots; s++) {
+            slots_[s] = kEmpty;
+        }
+
+        // Place the most crowded buckets first, while the slots are emptiest
+        std::array<size_t, Count> members{};
+        for (size_t size = largest; size > 0; size--) {
+            for (size_t bucket = 0; bucket < Buckets; bucket++) {
+                if (bucket_sizes[bucket] != size) continue;
+
+                size_t count = 0;
+                for (size_t i = 0; i < Count; i++) {
+                    if ((hashes[i] & (Buckets - 1)) == bucket) members[count++] = i;
+                }
+                displacements_[bucket] = Place(hashes, members, count);
+            }
+        }
+    }
+
+    // Index of `name` in the original list, or -1
+    int Find(const char* name) const {
+        uint64_t hash = ProcNameHash(name);
+        uint16_t index = slots_[Slot(hash, displacements_[hash & (Buckets - 1)])];
+        if (index == kEmpty || std::strcmp(names_[index], name) != 0) {
+            return -1;
+        }
+        return index;
+    }
+
+private:
+    static constexpr size_t Slot(uint64_t hash, uint32_t displacement) {
+        uint32_t base = static_cast<uint32_t>(hash >> 32);
+        uint32_t step = static_cast<uint32_t>(hash >> 8) | 1u;
+        return (base + displacement * step) & (Slots - 1);
+    }
+
+    constexpr uint16_t Place(const std::array<uint64_t, Count>& hashes,
+                             const std::array<size_t, Count>& members, size_t count) {
+        for (uint32_t displacement = 0; displacement <= 0xFFFF; displacement++) {
+            bool fits = true;
+            for (size_t m = 0; m < count && fits; m++) {
+                size_t slot = Slot(hashes[members[m]], displacement);
+                fits = slots_[slot] == kEmpty;
+                for (size_t other = 0; other < m && fits; other++) {
+                    fits = Slot(hashes[members[other]], displacement) != slot;
+                }
+            }
+            if (!fits) continue;
+
+            for (size_t m = 0; m < count; m++) {
+                slots_[Slot(hashes[members[m]], displacement)] = static_cast<uint16_t>(members[m]);
+            }
+            return static_cast<uint16_t>(displacement);
+        }
+        // Only reachable with duplicate names; fails constant evaluation
+        throw "ProcHash: cannot place bucket (duplicate entry point?)";
+    }
+
+    std::array<const char*, Count> names_;
+    std::array<uint16_t, Slots> slots_;
+    std::array<uint16_t, Buckets> displacements_;
+};
+
+// A compile-time ProcHash plus the function pointers in the same order
+template <size_t Count>
+struct ProcTable {
+    const ProcHash<Count>& hash;
+    const PFN_vkVoidFunction (&functions)[Count];
+
+    // The layer's function for `name`, or nullptr if it does not hook it
+    PFN_vkVoidFunction Find(const char* name) const {
+        int index = hash.Find(name);
+        return index >= 0 ? functions[index] : nullptr;
+    }
+};
+
+#define PROC_TABLE_NAME(name, function) #name,
+#define PROC_TABLE_FUNCTION(name, function) reinterpret_cast<PFN_vkVoidFunction>(function),
+
+// Declares `table` (a ProcTable) from an X-macro list of X(vkName, function)
+#define DECLARE_PROC_TABLE(table, LIST) \
+    static constexpr const char* table##_names[] = {LIST(PROC_TABLE_NAME)}; \
+    static constexpr ProcHash<std::size(table##_names)> table##_hash(table##_names); \
+    static const PFN_vkVoidFunction table##_functions[] = {LIST(PROC_TABLE_FUNCTION)}; \
+    static const ProcTable<std::size(table##_names)> table = {table##_hash, table##_functions}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// Which attachments of a render pass are color attachments, worked out once
+// at vkCreateRenderPass so vkCmdBeginRenderPass can tell its color clears
+// from its depth/stencil ones without walking the create info again. Bit i
+// is attachment i; attachments from 64 on are never reported as color.
+struct RenderPassAttachments {
+    uint32_t attachment_count = 0;
+    uint64_t color_mask = 0;         // Used as a color or resolve attachment
+    uint64_t color_clear_mask = 0;   // ...and loaded with VK_ATTACHMENT_LOAD_OP_CLEAR
+
+    static RenderPassAttachments FromCreateInfo(const VkRenderPassCreateInfo& create_info);
+
+    bool IsColor(uint32_t attachment) const { return attachment < 64 && (color_mask >> attachment) & 1; }
+
+    // Color attachments among the first `clear_value_count` that clear, i.e.
+    // the entries of pClearValues a color clear rewrite would touch
+    uint32_t ColorClearCount(uint32_t clear_value_count) const;
+};
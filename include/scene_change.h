@@ -0,0 +1,61 @@
+#pragma once
+
+#include "software_interpolation.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Scene cut detection from luma histograms. Each frame is reduced to a
+// 64-bin histogram of BT.601 luma over a sparse grid (every 8th pixel of
+// every 16th row), and consecutive histograms are compared by their earth
+// mover's distance: the summed differences of the two cumulative
+// histograms, which is how far the samples moved in bins all told. A pan or
+// a small change of exposure moves little; past an average of kCutShift
+// bins the pair is a cut. Interpolating across a cut can only produce a mix
+// of two unrelated images, so the synthetic frame repeats the previous one
+// and motion history starts over. Cuts between shots with the same tonal
+// range leave the histogram alone and go unnoticed.
+//
+// shaders/luma_histogram.comp and scene_change.comp do the same on the GPU,
+// over the same grid and with the same integer threshold, so the compute
+// and software backends make the same call on the same frames.
+class SceneChangeDetector {
+public:
+    static constexpr uint32_t kBins = 64;
+    static constexpr uint32_t kSampleStepX = 8;
+    static constexpr uint32_t kSampleStepY = 16;
+    static constexpr uint32_t kCutShift = 8;   // Average bins moved, of 63 at most
+
+    using Histogram = std::array<uint32_t, kBins>;
+
+    SceneChangeDetector(uint32_t width, uint32_t height, SoftwareFormat format);
+
+    // Samples on the grid for a `width` x `height` frame
+    static uint32_t SampleCount(uint32_t width, uint32_t height);
+
+    // Cut when the distance exceeds this
+    static uint32_t CutThreshold(uint32_t width, uint32_t height);
+
+    // SIMD where available; every variant gives the same bins
+    static void BuildHistogram(const uint8_t* pixels, size_t row_pitch, uint32_t width, uint32_t height,
+                               SoftwareFormat format, Histogram* histogram);
+
+    // Histograms the frame and compares it with the previous one. Returns
+    // true on a cut; the first frame after construction or Reset never is.
+    bool AddFrame(const uint8_t* pixels, size_t row_pitch);
+
+    void Reset() { has_previous_ = false; }
+
+    // Distance between the last compared pair, 0 to 63 x SampleCount()
+    uint32_t LastDistance() const { return last_distance_; }
+
+private:
+    uint32_t width_;
+    uint32_t height_;
+    SoftwareFormat format_;
+    uint32_t threshold_;
+    std::array<Histogram, 2> histograms_{};
+    uint32_t current_ = 0;
+    bool has_previous_ = false;
+    uint32_t last_distance_ = 0;
+};
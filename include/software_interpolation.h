@@ -0,0 +1,93 @@
+#pragma once
+
+#include "optical_flow.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Software frame interpolation, for devices that are themselves CPU
+// rasterizers or have no compute to spare. The frame between two captured
+// frames is made on a work-stealing ThreadPool, one kTileSize square tile of
+// the swapchain image per task.
+//
+// Blend averages the two frames, as the GPU pass does. Warp moves every 8x8
+// block half way along its OpticalFlowEngine vector from both sides before
+// averaging, so moving edges land between their two positions rather than
+// showing twice. Either way the output is an average of pixel pairs, so one
+// kernel per format covers both: pavgb for 8-bit channels and a SWAR average
+// for the 10:10:10:2 packings.
+
+// 32-bit swapchain layouts, named by their order from the lowest bits
+enum class SoftwareFormat {
+    Rgba8,      // R8G8B8A8, A8B8G8R8_PACK32
+    Bgra8,      // B8G8R8A8
+    Rgb10A2,    // A2B10G10R10_PACK32
+    Bgr10A2,    // A2R10G10B10_PACK32
+};
+
+enum class SoftwareInterpolationMode {
+    Previous,   // Repeat the previous frame
+    Blend,
+    Warp,
+};
+
+struct SoftwareInterpolatorOptions {
+    SoftwareInterpolationMode mode = SoftwareInterpolationMode::Blend;
+    uint32_t threads = 0;            // ThreadPool size; 0 = hardware threads
+};
+
+class SoftwareInterpolator {
+public:
+    static constexpr uint32_t kTileSize = 64;   // Whole flow blocks per tile
+
+    static std::unique_ptr<SoftwareInterpolator> Create(uint32_t width, uint32_t height, SoftwareFormat format,
+                                                        const SoftwareInterpolatorOptions& options = {});
+
+    SoftwareInterpolator(const SoftwareInterpolator&) = delete;
+    SoftwareInterpolator& operator=(const SoftwareInterpolator&) = delete;
+
+    // Adds the newest captured frame; in Warp mode its motion against the
+    // previous one is estimated here, so every frame has to pass through
+    void AddFrame(const uint8_t* pixels, size_t row_pitch);
+
+    // Forget the previous frame; Warp falls back to Blend until the next pair
+    void Reset();
+
+    // Writes the frame between `previous` and `current`, the last two frames
+    // given to AddFrame. All three share `row_pitch`.
+    void Interpolate(const uint8_t* previous, const uint8_t* current, uint8_t* output, size_t row_pitch);
+
+    // Writes `previous` unchanged, as Previous mode does; for frame pairs
+    // that straddle a scene cut
+    void Repeat(const uint8_t* previous, uint8_t* output, size_t row_pitch);
+
+    SoftwareInterpolationMode Mode() const { return mode_; }
+    uint32_t ThreadCount() const { return pool_.ThreadCount(); }
+
+private:
+    // Rounded-up average of `count` pixel pairs
+    using AverageKernel = void (*)(const uint8_t* a, const uint8_t* b, uint8_t* out, uint32_t count);
+
+    SoftwareInterpolator(uint32_t width, uint32_t height, SoftwareFormat format,
+                         const SoftwareInterpolatorOptions& options);
+
+    void BlendTile(const uint8_t* previous, const uint8_t* current, uint8_t* output, size_t row_pitch,
+                   uint32_t tile);
+    void WarpTile(const uint8_t* previous, const uint8_t* current, uint8_t* output, size_t row_pitch,
+                  uint32_t tile);
+
+    uint32_t width_;
+    uint32_t height_;
+    SoftwareFormat format_;
+    SoftwareInterpolationMode mode_;
+    AverageKernel average_;
+    uint32_t tiles_x_;
+    uint32_t tiles_y_;
+
+    ThreadPool pool_;
+    std::unique_ptr<OpticalFlowEngine> flow_;   // Warp mode only; shares pool_
+    std::vector<uint8_t> flow_source_;          // 10-bit frames reduced to 8 bits for the flow
+    bool has_flow_ = false;
+};
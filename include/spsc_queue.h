@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer/single-consumer queue. TryPush and TryPop never
+// block or allocate; the producer and consumer indices live on separate
+// cache lines so the two threads only share the slots they hand over.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+public:
+    // Producer side. Returns false if the queue is full.
+    bool TryPush(const T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == Capacity) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == Capacity) {
+                return false;
+            }
+        }
+        slots_[tail & (Capacity - 1)] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer side. Pushes all `count` values or none; the consumer never
+    // sees part of the group.
+    bool TryPush(const T* values, size_t count) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (Capacity - (tail - cached_head_) < count) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (Capacity - (tail - cached_head_) < count) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            slots_[(tail + i) & (Capacity - 1)] = values[i];
+        }
+        tail_.store(tail + count, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the queue is empty.
+    bool TryPop(T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+        value = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Consumer-owned
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;
+
+    // Producer-owned
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;
+
+    alignas(64) std::array<T, Capacity> slots_{};
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "frame_ring_buffer.h"
+#include "frame_stats.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One frame as handed from the acquire path to the writer thread
+struct TelemetrySample {
+    uint64_t frameNumber;
+    float frametime_ms;
+    uint32_t imageIndex;
+    uint32_t presentMode;
+    uint32_t flags;             // kTelemetryFlag*
+    bool logToConsole;          // Print the periodic [FRAME_INTERP] line
+    FrameTimeStats hudStats;    // Rolling stats for that line
+};
+
+// Binary columnar telemetry file (native endianness):
+//   TelemetryFileHeader
+//   blocks of: TelemetryBlockHeader, then `count` values of each column in
+//   order frameNumber (u64), frametime_ms (f32), imageIndex (u32),
+//   presentMode (u32), flags (u32, from version 2)
+// tools/telemetry_to_csv turns it back into the frame_timing CSV.
+constexpr uint32_t kTelemetryMagic = 0x4C544946; // "FITL"
+constexpr uint32_t kTelemetryVersion = 2;
+
+// A scene cut was detected since the previous sample
+constexpr uint32_t kTelemetryFlagSceneChange = 1u << 0;
+
+struct TelemetryFileHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct TelemetryBlockHeader {
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t droppedTotal;  // Samples dropped before this block was written
+};
+
+// Per-swapchain background writer. The acquire path only pushes into a
+// bounded SPSC queue; the writer thread batches samples into blocks, writes
+// them, fsyncs periodically and prints the console line.
+class TelemetryWriter {
+public:
+    static constexpr size_t kQueueCapacity = 4096;   // ~8 s at 500 FPS
+    static constexpr size_t kBlockRecords = 256;
+    static constexpr std::chrono::milliseconds kPollInterval{10};
+    static constexpr std::chrono::milliseconds kSyncInterval{1000};
+
+    explicit TelemetryWriter(const std::string& path);
+    ~TelemetryWriter();
+
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+    bool IsOpen() const { return fd_ >= 0; }
+
+    // Producer side: never blocks and never touches the file. When the
+    // writer falls behind the sample is dropped and counted instead.
+    void Push(const TelemetrySample& sample);
+
+    // Producer side: queue a periodic stats report for the writer to print
+    void PushReport(const FrameStatsReport& report);
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    void Run();
+    void Drain();
+    void Append(const TelemetrySample& sample);
+    void FlushBlock();
+    void WriteAll(const void* data, size_t size);
+
+    std::string path_;
+    int fd_ = -1;
+
+    SpscQueue<TelemetrySample, kQueueCapacity> queue_;
+    SpscQueue<FrameStatsReport, 8> reports_;
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> stop_{false};
+
+    // Writer thread state
+    std::vector<uint64_t> frameNumbers_;
+    std::vector<float> frametimes_;
+    std::vector<uint32_t> imageIndices_;
+    std::vector<uint32_t> presentModes_;
+    std::vector<uint32_t> flags_;
+    uint64_t written_ = 0;
+    bool dirty_ = false;
+    std::chrono::steady_clock::time_point lastSync_;
+
+    std::thread thread_;
+};
@@ -2,11 +2,18 @@
 
 #include <vulkan/vulkan.h>
 #include <vulkan/vk_layer.h>
-#include <map>
-#include <mutex>
+#include "disk_cache.h"
+#include "dispatch_map.h"
+#include "layer_core.h"
+#include "proc_table.h"
+#include "text_renderer.h"
 #include <cstring>
 #include <iostream>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #define LAYER_NAME "VK_LAYER_text_overlay"
 
@@ -19,7 +26,11 @@ struct LayerInstanceDispatchTable {
     PFN_vkGetInstanceProcAddr GetInstanceProcAddr;
     PFN_vkDestroyInstance DestroyInstance;
     PFN_vkEnumeratePhysicalDevices EnumeratePhysicalDevices;
+    PFN_vkEnumeratePhysicalDeviceGroups EnumeratePhysicalDeviceGroups;
+    PFN_vkEnumeratePhysicalDeviceGroupsKHR EnumeratePhysicalDeviceGroupsKHR;
     PFN_vkGetPhysicalDeviceProperties GetPhysicalDeviceProperties;
+    PFN_vkGetPhysicalDeviceMemoryProperties GetPhysicalDeviceMemoryProperties;
+    PFN_vkGetPhysicalDeviceQueueFamilyProperties GetPhysicalDeviceQueueFamilyProperties;
     PFN_vkCreateDevice CreateDevice;
     PFN_vkEnumerateDeviceExtensionProperties EnumerateDeviceExtensionProperties;
 };
@@ -27,19 +38,22 @@ struct LayerInstanceDispatchTable {
 struct LayerDeviceDispatchTable {
     PFN_vkGetDeviceProcAddr GetDeviceProcAddr;
     PFN_vkDestroyDevice DestroyDevice;
-    PFN_vkCmdBeginRenderPass CmdBeginRenderPass;
-    PFN_vkCmdEndRenderPass CmdEndRenderPass;
-    PFN_vkCmdDraw CmdDraw;
-    PFN_vkCmdDrawIndexed CmdDrawIndexed;
-    PFN_vkCmdSetViewport CmdSetViewport;
-    PFN_vkCmdSetScissor CmdSetScissor;
+    PFN_vkGetDeviceQueue GetDeviceQueue;
+    PFN_vkGetDeviceQueue2 GetDeviceQueue2;
+    PFN_vkCreateSwapchainKHR CreateSwapchainKHR;
+    PFN_vkDestroySwapchainKHR DestroySwapchainKHR;
     PFN_vkQueuePresentKHR QueuePresentKHR;
 };
 
-// Global state
-extern std::map<VkInstance, InstanceData*> instance_map;
-extern std::map<VkDevice, DeviceData*> device_map;
-extern std::mutex global_mutex;
+// Forward declarations
+struct PhysicalDeviceData;
+struct QueueData;
+
+// Global state, keyed by dispatch key
+extern DispatchMap<InstanceData> instance_map;
+extern DispatchMap<DeviceData> device_map;
+extern DispatchMap<PhysicalDeviceData> physical_device_map;
+extern DispatchMap<QueueData> queue_map;
 
 // Instance data structure
 struct InstanceData {
@@ -55,20 +69,39 @@ struct DeviceData {
     VkPhysicalDevice physical_device;
     PFN_vkGetDeviceProcAddr GetDeviceProcAddr;
     
-    // Text overlay resources
-    VkBuffer text_buffer;
-    VkDeviceMemory text_buffer_memory;
-    VkDescriptorSetLayout descriptor_set_layout;
-    VkDescriptorPool descriptor_pool;
-    VkDescriptorSet descriptor_set;
-    VkPipelineLayout pipeline_layout;
-    VkPipeline text_pipeline;
-    bool text_overlay_initialized;
+    // Text overlay, drawn at present time; null if it couldn't be set up
+    std::unique_ptr<TextRenderer> text_renderer;
+    std::unique_ptr<PipelineDiskCache> pipeline_cache;   // Null when the disk cache is off
+
+    // Status line and Lorem Ipsum, shared by every present queue
+    std::mutex text_mutex;
+    std::vector<std::string> text_lines;
+    uint64_t present_count;
+    std::chrono::steady_clock::time_point last_present;
+    double frame_time_ms;
+};
+
+// Physical devices are recorded when enumerated so instance-level calls can
+// find their instance without a scan. Keyed by the handle itself.
+struct PhysicalDeviceData {
+    VkPhysicalDevice physical_device;
+    InstanceData* instance_data;
+};
+
+// Queues are recorded at vkGetDeviceQueue/vkGetDeviceQueue2 so present and
+// submit can find their device without a scan. Keyed by the handle itself.
+struct QueueData {
+    VkQueue queue;
+    DeviceData* device_data;
+    uint32_t family_index;
+    uint32_t queue_index;
 };
 
 // Helper functions
 InstanceData* GetInstanceData(VkInstance instance);
 DeviceData* GetDeviceData(VkDevice device);
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice);
+DeviceData* GetDeviceData(VkQueue queue);
 void LogAPICall(const char* function_name, const char* message = nullptr);
 
 // Vulkan Layer Functions
@@ -103,21 +136,28 @@ extern "C" {
         VkDevice device,
         const VkAllocationCallbacks* pAllocator);
 
-    // Command buffer functions for text overlay
-    VKAPI_ATTR void VKAPI_CALL vkCmdBeginRenderPass(
-        VkCommandBuffer commandBuffer,
-        const VkRenderPassBeginInfo* pRenderPassBegin,
-        VkSubpassContents contents);
-
-    VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderPass(
-        VkCommandBuffer commandBuffer);
-
-    VKAPI_ATTR void VKAPI_CALL vkCmdDraw(
-        VkCommandBuffer commandBuffer,
-        uint32_t vertexCount,
-        uint32_t instanceCount,
-        uint32_t firstVertex,
-        uint32_t firstInstance);
+    VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue(
+        VkDevice device,
+        uint32_t queueFamilyIndex,
+        uint32_t queueIndex,
+        VkQueue* pQueue);
+
+    VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue2(
+        VkDevice device,
+        const VkDeviceQueueInfo2* pQueueInfo,
+        VkQueue* pQueue);
+
+    // Swapchain functions for text overlay
+    VKAPI_ATTR VkResult VKAPI_CALL vkCreateSwapchainKHR(
+        VkDevice device,
+        const VkSwapchainCreateInfoKHR* pCreateInfo,
+        const VkAllocationCallbacks* pAllocator,
+        VkSwapchainKHR* pSwapchain);
+
+    VKAPI_ATTR void VKAPI_CALL vkDestroySwapchainKHR(
+        VkDevice device,
+        VkSwapchainKHR swapchain,
+        const VkAllocationCallbacks* pAllocator);
 
     VKAPI_ATTR VkResult VKAPI_CALL vkQueuePresentKHR(
         VkQueue queue,
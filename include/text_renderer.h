@@ -0,0 +1,221 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_layer.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GPU text overlay drawn at present time. The 8x8 font is uploaded once per
+// device into a 128x48 R8 atlas (16x6 glyph cells, plus a solid cell for
+// background panels). Each present, the caller's lines are laid out into
+// glyph instances in a persistently mapped ring and drawn over the swapchain
+// image with one instanced draw, in a render pass that loads and stores the
+// image in place. The application's own command buffers are never touched.
+//
+// Drawing is submitted on the application's present queue, waiting for what
+// its present waited for; the present then waits for the overlay instead.
+// Nothing waits on the CPU: when the GPU still owns the next slot, or the
+// present is one the renderer can't handle, that frame goes out without
+// the overlay.
+
+// Device functions the renderer calls, loaded once per device
+#define TEXT_RENDERER_DEVICE_FUNCTIONS(X) \
+    X(GetDeviceQueue) \
+    X(GetSwapchainImagesKHR) \
+    X(QueueSubmit) \
+    X(CreateImage) \
+    X(DestroyImage) \
+    X(GetImageMemoryRequirements) \
+    X(BindImageMemory) \
+    X(CreateImageView) \
+    X(DestroyImageView) \
+    X(CreateSampler) \
+    X(DestroySampler) \
+    X(CreateBuffer) \
+    X(DestroyBuffer) \
+    X(GetBufferMemoryRequirements) \
+    X(BindBufferMemory) \
+    X(AllocateMemory) \
+    X(FreeMemory) \
+    X(MapMemory) \
+    X(FlushMappedMemoryRanges) \
+    X(CreateShaderModule) \
+    X(DestroyShaderModule) \
+    X(CreateDescriptorSetLayout) \
+    X(DestroyDescriptorSetLayout) \
+    X(CreateDescriptorPool) \
+    X(DestroyDescriptorPool) \
+    X(AllocateDescriptorSets) \
+    X(UpdateDescriptorSets) \
+    X(CreatePipelineLayout) \
+    X(DestroyPipelineLayout) \
+    X(CreateRenderPass) \
+    X(DestroyRenderPass) \
+    X(CreateFramebuffer) \
+    X(DestroyFramebuffer) \
+    X(CreateGraphicsPipelines) \
+    X(DestroyPipeline) \
+    X(CreateCommandPool) \
+    X(DestroyCommandPool) \
+    X(AllocateCommandBuffers) \
+    X(BeginCommandBuffer) \
+    X(EndCommandBuffer) \
+    X(CmdPipelineBarrier) \
+    X(CmdCopyBufferToImage) \
+    X(CmdBeginRenderPass) \
+    X(CmdEndRenderPass) \
+    X(CmdBindPipeline) \
+    X(CmdBindDescriptorSets) \
+    X(CmdBindVertexBuffers) \
+    X(CmdPushConstants) \
+    X(CmdDraw) \
+    X(CreateFence) \
+    X(DestroyFence) \
+    X(GetFenceStatus) \
+    X(ResetFences) \
+    X(WaitForFences) \
+    X(CreateSemaphore) \
+    X(DestroySemaphore)
+
+#define TEXT_RENDERER_DISPATCH_MEMBER(name) PFN_vk##name name;
+
+struct TextRendererDispatch {
+    TEXT_RENDERER_DEVICE_FUNCTIONS(TEXT_RENDERER_DISPATCH_MEMBER)
+};
+
+// What the renderer needs from the device, filled in at vkCreateDevice
+struct TextRendererDevice {
+    VkDevice device = VK_NULL_HANDLE;
+    TextRendererDispatch vk{};
+    PFN_vkSetDeviceLoaderData set_device_loader_data = nullptr;
+    VkPhysicalDeviceMemoryProperties memory_properties{};
+    std::vector<VkQueueFamilyProperties> queue_families;
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;   // The layer's PipelineDiskCache, if any
+};
+
+void LoadTextRendererDispatch(TextRendererDispatch* dispatch, VkDevice device, PFN_vkGetDeviceProcAddr gdpa);
+
+// Splits `text` at spaces into lines of at most `columns` characters; longer
+// words are cut
+std::vector<std::string> WrapText(const std::string& text, size_t columns);
+
+class TextRenderer {
+public:
+    // Glyph instances per frame, background panels included
+    static constexpr uint32_t kMaxGlyphs = 4096;
+
+    // Swapchain images are drawn to as color attachments. Every surface
+    // supports that usage, so this never fails.
+    static void PrepareSwapchain(VkSwapchainCreateInfoKHR* create_info);
+
+    // Uploads the font atlas and builds the shared pipeline state for a
+    // device created from `create_info`, waiting once for the upload on one
+    // of its queues. Returns nullptr on failure.
+    static std::unique_ptr<TextRenderer> Create(const TextRendererDevice& device,
+                                                const VkDeviceCreateInfo& create_info);
+
+    ~TextRenderer();
+
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
+
+    // Per-swapchain render pass, pipeline, framebuffers and glyph ring for a
+    // swapchain created from a prepared create info. Returns false if the
+    // swapchain will present without the overlay.
+    bool AddSwapchain(VkSwapchainKHR swapchain, const VkSwapchainCreateInfoKHR& create_info);
+
+    // Waits for the swapchain's in-flight overlays and frees its resources
+    void RemoveSwapchain(VkSwapchainKHR swapchain);
+
+    // Draws `lines` in the top-left corner of the image a single-swapchain
+    // present on `queue` shows, and points *present_info at a semaphore the
+    // overlay signals. Returns false, leaving it untouched, if this frame
+    // goes out without the overlay.
+    bool Draw(VkQueue queue, const std::vector<std::string>& lines, VkPresentInfoKHR* present_info);
+
+private:
+    static constexpr uint32_t kSlotCount = 3;
+
+    // One glyph quad: position in pixels, glyph index and repeat count,
+    // and an RGBA8 color
+    struct GlyphInstance {
+        float x;
+        float y;
+        uint32_t glyph_columns;
+        uint32_t color;
+    };
+
+    // Per-submission resources, reused round-robin once their fence signals
+    struct Slot {
+        VkCommandBuffer commands = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkSemaphore rendered = VK_NULL_HANDLE;   // Overlay drawn, may present
+    };
+
+    // Host-visible buffer mapped for the renderer's lifetime
+    struct MappedBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        uint8_t* mapped = nullptr;
+        bool coherent = false;
+    };
+
+    struct Target {
+        VkExtent2D extent{};
+        float scale = 1.0f;
+        std::vector<VkImageView> views;
+        std::vector<VkFramebuffer> framebuffers;
+        VkRenderPass render_pass = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        MappedBuffer glyphs;   // kMaxGlyphs instances per slot
+
+        // Command buffers are made on the first present, for that queue's family
+        uint32_t queue_family = UINT32_MAX;
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+        std::array<Slot, kSlotCount> slots;
+        uint32_t next_slot = 0;
+
+        // Scratch for the overlay submit; keeps its capacity between frames
+        std::vector<VkPipelineStageFlags> wait_stages;
+    };
+
+    explicit TextRenderer(const TextRendererDevice& device);
+
+    bool CreateMappedBuffer(MappedBuffer* mapped_buffer, VkDeviceSize size, VkBufferUsageFlags usage);
+    void DestroyMappedBuffer(MappedBuffer* mapped_buffer);
+    bool CreateAtlas();
+    bool UploadAtlas(VkQueue queue, uint32_t queue_family);
+    bool CreatePipelineLayout();
+    bool CreateTargetPipeline(Target* target, VkFormat format);
+    bool EnsureCommandBuffers(Target* target, uint32_t queue_family);
+    uint32_t LayoutText(const Target& target, const std::vector<std::string>& lines, GlyphInstance* glyphs) const;
+    void DestroyTarget(Target* target);
+
+    TextRendererDevice device_;
+
+    // Every queue the application created, so presents can find their family
+    std::unordered_map<VkQueue, uint32_t> queue_families_;
+
+    // Font atlas, shared by every swapchain
+    VkImage atlas_ = VK_NULL_HANDLE;
+    VkDeviceMemory atlas_memory_ = VK_NULL_HANDLE;
+    VkImageView atlas_view_ = VK_NULL_HANDLE;
+    VkSampler sampler_ = VK_NULL_HANDLE;
+
+    VkShaderModule vertex_shader_ = VK_NULL_HANDLE;
+    VkShaderModule fragment_shader_ = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+    VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+    VkDescriptorSet descriptor_set_ = VK_NULL_HANDLE;
+
+    // Guards the map only; presents to one swapchain are externally
+    // synchronized by the application
+    std::mutex targets_mutex_;
+    std::unordered_map<VkSwapchainKHR, std::unique_ptr<Target>> targets_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops, with work stealing.
+// ParallelFor gives each thread one contiguous share of the indices, so
+// neighbouring rows or tiles stay on one core; a thread that runs out takes
+// half of what is left in another's share, so uneven work still balances.
+// The calling thread works alongside the pool rather than waiting. One loop
+// runs at a time; concurrent callers queue on a mutex.
+class ThreadPool {
+public:
+    // `threads` counts the caller; 0 means one per hardware thread
+    explicit ThreadPool(uint32_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Calls fn(i) for every i in [0, count) and returns once all are done
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& fn);
+
+    uint32_t ThreadCount() const { return static_cast<uint32_t>(workers_.size()) + 1; }
+
+private:
+    // A thread's share of the loop: [begin, end) packed as end << 32 | begin.
+    // The owner takes from the front, thieves split off the back.
+    struct alignas(64) Share {
+        std::atomic<uint64_t> range{0};
+    };
+
+    void Worker(uint32_t self);
+    void RunIndices(uint32_t self);
+    bool TakeIndex(uint32_t self, uint32_t* index);
+    bool Steal(uint32_t self);
+
+    std::vector<std::thread> workers_;
+    std::mutex caller_mutex_;
+
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    uint64_t generation_ = 0;
+    uint32_t busy_workers_ = 0;
+    bool stopping_ = false;
+
+    // The loop in progress
+    const std::function<void(uint32_t)>* fn_ = nullptr;
+    std::unique_ptr<Share[]> shares_;   // One per thread; the caller's is 0
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_layer.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Green tint applied to the swapchain image at present time. R8G8B8A8_UNORM
+// swapchains are created with storage usage so one compute dispatch
+// (shaders/green_tint.comp) tints the presented image in place: no copy, no
+// render pass, and a cost of one dispatch per frame however many render
+// passes the application records. The shader's storage image is rgba8, which
+// a B8G8R8A8_UNORM view can't be, so those swapchains get transfer usage
+// instead and the image is copied into an R8G8B8A8 staging image, tinted
+// there and copied back. The application's own command buffers and clear
+// values are never touched.
+//
+// The command buffers are recorded once per swapchain image, on the first
+// present, and resubmitted as they are. Each submit goes on the application's
+// present queue, waiting for what its present waited for; the present then
+// waits for the tint instead. Nothing waits on the CPU: an image whose last
+// tint is somehow still in flight goes out untinted.
+
+// Device functions the pass calls, loaded once per device
+#define TINT_PASS_DEVICE_FUNCTIONS(X) \
+    X(GetDeviceQueue) \
+    X(GetSwapchainImagesKHR) \
+    X(QueueSubmit) \
+    X(CreateImageView) \
+    X(DestroyImageView) \
+    X(CreateShaderModule) \
+    X(DestroyShaderModule) \
+    X(CreateDescriptorSetLayout) \
+    X(DestroyDescriptorSetLayout) \
+    X(CreateDescriptorPool) \
+    X(DestroyDescriptorPool) \
+    X(AllocateDescriptorSets) \
+    X(UpdateDescriptorSets) \
+    X(CreatePipelineLayout) \
+    X(DestroyPipelineLayout) \
+    X(CreateComputePipelines) \
+    X(DestroyPipeline) \
+    X(CreateCommandPool) \
+    X(DestroyCommandPool) \
+    X(AllocateCommandBuffers) \
+    X(BeginCommandBuffer) \
+    X(EndCommandBuffer) \
+    X(CmdPipelineBarrier) \
+    X(CmdBindPipeline) \
+    X(CmdBindDescriptorSets) \
+    X(CmdDispatch) \
+    X(CmdCopyImage) \
+    X(CreateImage) \
+    X(DestroyImage) \
+    X(GetImageMemoryRequirements) \
+    X(AllocateMemory) \
+    X(FreeMemory) \
+    X(BindImageMemory) \
+    X(CreateFence) \
+    X(DestroyFence) \
+    X(GetFenceStatus) \
+    X(ResetFences) \
+    X(WaitForFences) \
+    X(CreateSemaphore) \
+    X(DestroySemaphore)
+
+#define TINT_PASS_DISPATCH_MEMBER(name) PFN_vk##name name;
+
+struct TintPassDispatch {
+    TINT_PASS_DEVICE_FUNCTIONS(TINT_PASS_DISPATCH_MEMBER)
+};
+
+// What the pass needs from the device, filled in at vkCreateDevice
+struct TintPassDevice {
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    TintPassDispatch vk{};
+    PFN_vkSetDeviceLoaderData set_device_loader_data = nullptr;
+    PFN_vkGetPhysicalDeviceFormatProperties get_format_properties = nullptr;
+    PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR get_surface_capabilities = nullptr;
+    VkPhysicalDeviceMemoryProperties memory_properties{};
+    std::vector<VkQueueFamilyProperties> queue_families;
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;   // The layer's PipelineDiskCache, if any
+};
+
+void LoadTintPassDispatch(TintPassDispatch* dispatch, VkDevice device, PFN_vkGetDeviceProcAddr gdpa);
+
+class TintPass {
+public:
+    // Builds the compute pipeline for a device created from `create_info`.
+    // Returns nullptr on failure.
+    static std::unique_ptr<TintPass> Create(const TintPassDevice& device, const VkDeviceCreateInfo& create_info);
+
+    ~TintPass();
+
+    TintPass(const TintPass&) = delete;
+    TintPass& operator=(const TintPass&) = delete;
+
+    // Adds the usage the tint needs to a swapchain create info: storage for
+    // R8G8B8A8_UNORM, transfer source and destination for B8G8R8A8_UNORM.
+    // Returns false, leaving it untouched, for other formats or if the
+    // surface or device doesn't allow it.
+    bool PrepareSwapchain(VkSwapchainCreateInfoKHR* create_info) const;
+
+    // Whether a create info has the format and usage PrepareSwapchain gives
+    static bool IsPrepared(const VkSwapchainCreateInfoKHR& create_info);
+
+    // Per-image views (or the staging image), descriptor sets, fences and
+    // semaphores for a swapchain created from a prepared create info.
+    // Returns false if the swapchain will present untinted.
+    bool AddSwapchain(VkSwapchainKHR swapchain, const VkSwapchainCreateInfoKHR& create_info);
+
+    // Waits for the swapchain's in-flight tints and frees its resources
+    void RemoveSwapchain(VkSwapchainKHR swapchain);
+
+    // Tints the image a single-swapchain present on `queue` shows, and
+    // points *present_info at a semaphore the tint signals. Returns false,
+    // leaving it untouched, if this frame goes out untinted.
+    bool Draw(VkQueue queue, VkPresentInfoKHR* present_info);
+
+private:
+    // Per swapchain image; the command buffer is recorded once and only
+    // resubmitted after that
+    struct ImageTint {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;   // Null when tinted through the staging image
+        VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+        VkCommandBuffer commands = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        VkSemaphore tinted = VK_NULL_HANDLE;   // Tint done, the image may present
+    };
+
+    struct Target {
+        VkExtent2D extent{};
+        VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
+        std::vector<ImageTint> images;
+
+        // B8G8R8A8 swapchains only: the R8G8B8A8 image every present is
+        // tinted in. Submits on one queue are ordered by the recorded
+        // barriers; a present from another queue goes out untinted while the
+        // last tint is still in flight.
+        VkImage staging_image = VK_NULL_HANDLE;
+        VkDeviceMemory staging_memory = VK_NULL_HANDLE;
+        VkImageView staging_view = VK_NULL_HANDLE;
+        VkQueue last_queue = VK_NULL_HANDLE;
+        uint32_t last_image = 0;
+
+        // Command buffers are made and recorded on the first present, for
+        // that queue's family
+        uint32_t queue_family = UINT32_MAX;
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+
+        // Scratch for the tint submit; keeps its capacity between frames
+        std::vector<VkPipelineStageFlags> wait_stages;
+    };
+
+    explicit TintPass(const TintPassDevice& device);
+
+    bool CreatePipeline();
+    bool CreateStagingImage(Target* target);
+    bool EnsureCommandBuffers(Target* target, uint32_t queue_family);
+    void Record(const Target& target, const ImageTint& image_tint);
+    void RecordStaged(const Target& target, const ImageTint& image_tint);
+    void DestroyTarget(Target* target);
+
+    TintPassDevice device_;
+
+    // Every queue the application created, so presents can find their family
+    std::unordered_map<VkQueue, uint32_t> queue_families_;
+
+    VkShaderModule shader_ = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
+    VkPipeline pipeline_ = VK_NULL_HANDLE;
+
+    // Guards the map only; presents to one swapchain are externally
+    // synchronized by the application
+    std::mutex targets_mutex_;
+    std::unordered_map<VkSwapchainKHR, std::unique_ptr<Target>> targets_;
+};
@@ -0,0 +1,23 @@
+#version 450
+
+// Font coverage from the R8 atlas (16x6 cells of 8x8 texels), blended over
+// the swapchain image. Uncovered texels are discarded so glyph instances only
+// touch the pixels they draw.
+
+layout(set = 0, binding = 0) uniform sampler2D font_atlas;
+
+layout(location = 0) in vec2 cell_texel;
+layout(location = 1) flat in ivec2 cell_origin;
+layout(location = 2) in vec4 text_color;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    ivec2 texel = ivec2(cell_texel);
+    texel.x &= 7;
+    float coverage = texelFetch(font_atlas, cell_origin + texel, 0).r;
+    if (coverage == 0.0) {
+        discard;
+    }
+    out_color = vec4(text_color.rgb, text_color.a * coverage);
+}
@@ -0,0 +1,32 @@
+#version 450
+
+// One instance per glyph: a quad covering `columns` 8x8 cells of the font
+// atlas, scaled up by an integer factor. Columns beyond the first repeat the
+// glyph, which stretches the solid block into a line's background panel.
+// The quad is a four-vertex triangle strip with no vertex buffer of its own.
+
+layout(location = 0) in vec2 position;        // Top-left corner, pixels
+layout(location = 1) in uint glyph_columns;   // Glyph in bits 0-7, columns above
+layout(location = 2) in vec4 color;
+
+layout(push_constant) uniform TextParams {
+    vec2 pixel_to_ndc;   // 2 / extent
+    float scale;         // Screen pixels per font texel
+} params;
+
+layout(location = 0) out vec2 cell_texel;
+layout(location = 1) flat out ivec2 cell_origin;
+layout(location = 2) out vec4 text_color;
+
+void main() {
+    uint glyph = glyph_columns & 0xFFu;
+    float columns = float(glyph_columns >> 8);
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+
+    cell_texel = corner * vec2(8.0 * columns, 8.0);
+    cell_origin = ivec2(glyph % 16u, glyph / 16u) * 8;
+    text_color = color;
+
+    vec2 pixel = position + cell_texel * params.scale;
+    gl_Position = vec4(pixel * params.pixel_to_ndc - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,124 @@
+#include "api_trace.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+std::unique_ptr<ApiTrace> ApiTrace::Open(const std::string& path, const char* schema) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cout << "VULKAN_LAYER: Failed to open trace file " << path << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<ApiTrace> trace(new ApiTrace());
+    trace->fd_ = fd;
+    TraceFileHeader header = {};
+    header.magic = kTraceMagic;
+    header.version = kTraceVersion;
+    header.timestamp = TraceTimestamp();
+    header.clockNs = TraceClockNs();
+    header.schemaSize = static_cast<uint32_t>(std::strlen(schema));
+    trace->WriteAll(&header, sizeof(header));
+    trace->WriteAll(schema, header.schemaSize);
+    trace->batch_.reserve(kRingCapacity);
+    trace->thread_ = std::thread(&ApiTrace::Run, trace.get());
+    return trace;
+}
+
+ApiTrace::~ApiTrace() {
+    stop_.store(true, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    if (fd_ >= 0) {
+        ::fsync(fd_);
+        ::close(fd_);
+    }
+}
+
+uint64_t ApiTrace::Dropped() const {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    uint64_t dropped = 0;
+    for (const auto& ring : rings_) {
+        dropped += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+ApiTrace::ThreadRing* ApiTrace::RegisterThread() {
+    std::unique_ptr<ThreadRing> ring(new ThreadRing());
+    ring->threadId = static_cast<uint32_t>(::syscall(SYS_gettid));
+
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    rings_.push_back(std::move(ring));
+    return rings_.back().get();
+}
+
+void ApiTrace::Run() {
+    while (!stop_.load(std::memory_order_acquire)) {
+        Drain();
+        std::this_thread::sleep_for(kDrainInterval);
+    }
+
+    // Callers are gone by now; pick up whatever they left behind
+    Drain();
+}
+
+void ApiTrace::Drain() {
+    std::vector<ThreadRing*> rings;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings.reserve(rings_.size());
+        for (const auto& ring : rings_) {
+            rings.push_back(ring.get());
+        }
+    }
+
+    TraceSlot slot;
+    for (ThreadRing* ring : rings) {
+        // Records and their argument slots were pushed as one group, so
+        // once the record is visible its arguments are too
+        while (batch_.size() + 1 + kMaxTraceArgSlots <= kRingCapacity && ring->queue.TryPop(slot)) {
+            TraceRecord record;
+            std::memcpy(&record, &slot, sizeof(record));
+            batch_.push_back(slot);
+            for (size_t i = 0; i < (record.argCount + kTraceArgsPerSlot - 1) / kTraceArgsPerSlot; i++) {
+                ring->queue.TryPop(slot);
+                batch_.push_back(slot);
+            }
+        }
+        if (batch_.empty()) continue;
+
+        TraceBlockHeader header = {};
+        header.count = static_cast<uint32_t>(batch_.size());
+        header.timestamp = TraceTimestamp();
+        header.clockNs = TraceClockNs();
+        header.droppedTotal = Dropped();
+
+        WriteAll(&header, sizeof(header));
+        WriteAll(batch_.data(), batch_.size() * sizeof(TraceSlot));
+        batch_.clear();
+    }
+}
+
+void ApiTrace::WriteAll(const void* data, size_t size) {
+    if (fd_ < 0) return;
+
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::write(fd_, bytes, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "VULKAN_LAYER: Trace write failed, tracing stopped" << std::endl;
+            ::close(fd_);
+            fd_ = -1;
+            return;
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+}
@@ -0,0 +1,94 @@
+#include "capture_file.h"
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static uint64_t AlignToPage(uint64_t size) {
+    return (size + 4095) & ~static_cast<uint64_t>(4095);
+}
+
+std::unique_ptr<CaptureFile> CaptureFile::Create(const std::string& path, uint32_t width, uint32_t height,
+                                                 CaptureLayout layout, uint32_t vk_format, uint32_t capacity) {
+    if (width == 0 || height == 0 || capacity == 0) return nullptr;
+
+    std::unique_ptr<CaptureFile> file(new CaptureFile());
+    file->path_ = path;
+    file->capacity_ = capacity;
+    file->frame_size_ = static_cast<size_t>(width) * height * 4;
+    file->frame_stride_ = AlignToPage(file->frame_size_);
+    file->frames_offset_ = AlignToPage(sizeof(CaptureFileHeader) + capacity * sizeof(CaptureIndexEntry));
+    file->mapped_size_ = static_cast<size_t>(file->frames_offset_ + capacity * file->frame_stride_);
+
+    file->fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (file->fd_ < 0) {
+        std::cout << "[FRAME_INTERP] Failed to open capture file " << path << std::endl;
+        return nullptr;
+    }
+
+    // Real blocks up front: a full disk fails here rather than as SIGBUS
+    // on a store into the mapping
+    int error = ::posix_fallocate(file->fd_, 0, static_cast<off_t>(file->mapped_size_));
+    if (error != 0) {
+        std::cout << "[FRAME_INTERP] Cannot reserve " << (file->mapped_size_ >> 20) << " MB for capture file "
+                  << path << ": " << std::strerror(error) << std::endl;
+        return nullptr;
+    }
+
+    void* mapped = ::mmap(nullptr, file->mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd_, 0);
+    if (mapped == MAP_FAILED) {
+        std::cout << "[FRAME_INTERP] Failed to map capture file " << path << std::endl;
+        return nullptr;
+    }
+    file->mapped_ = static_cast<uint8_t*>(mapped);
+
+    CaptureFileHeader header = {};
+    header.magic = kCaptureMagic;
+    header.version = kCaptureVersion;
+    header.width = width;
+    header.height = height;
+    header.layout = static_cast<uint32_t>(layout);
+    header.vkFormat = vk_format;
+    header.frameCapacity = capacity;
+    header.frameStride = file->frame_stride_;
+    header.framesOffset = file->frames_offset_;
+    std::memcpy(file->mapped_, &header, sizeof(header));
+    return file;
+}
+
+CaptureFile::~CaptureFile() {
+    if (mapped_) {
+        // Only the frames written reach the disk; the reservation past
+        // them is given back
+        size_t used = static_cast<size_t>(frames_offset_ + count_ * frame_stride_);
+        ::msync(mapped_, used, MS_SYNC);
+        ::munmap(mapped_, mapped_size_);
+        if (::ftruncate(fd_, static_cast<off_t>(used)) != 0) {
+            std::cout << "[FRAME_INTERP] Failed to trim capture file " << path_ << std::endl;
+        }
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void CaptureFile::LowerWriterPriority() {
+    // Linux applies nice values per thread
+    ::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), 19);
+}
+
+bool CaptureFile::Write(uint64_t present_number, uint64_t timestamp_ns, const uint8_t* pixels) {
+    if (Full()) return false;
+
+    std::memcpy(mapped_ + frames_offset_ + count_ * frame_stride_, pixels, frame_size_);
+
+    CaptureIndexEntry entry = {present_number, timestamp_ns};
+    std::memcpy(mapped_ + sizeof(CaptureFileHeader) + count_ * sizeof(CaptureIndexEntry), &entry, sizeof(entry));
+
+    count_++;
+    std::memcpy(mapped_ + offsetof(CaptureFileHeader, frameCount), &count_, sizeof(count_));
+    return true;
+}
@@ -0,0 +1,741 @@
+#include "combined_layer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+// Global data
+DispatchMap<InstanceData> instance_map;
+DispatchMap<DeviceData> device_map;
+DispatchMap<PhysicalDeviceData> physical_device_map;
+
+// Layer properties
+static const VkLayerProperties layer_props = {
+    LAYER_NAME,
+    VK_MAKE_VERSION(1, 0, 0),
+    1,
+    LAYER_DESCRIPTION,
+};
+
+// Utility functions
+InstanceData* GetInstanceData(VkInstance instance) {
+    return instance_map.Get(GetDispatchKey(instance));
+}
+
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice) {
+    PhysicalDeviceData* physical_device_data = physical_device_map.Get(physicalDevice);
+    if (physical_device_data) return physical_device_data->instance_data;
+    // Not enumerated through this layer; a physical device shares its
+    // instance's dispatch key
+    return instance_map.Get(GetDispatchKey(physicalDevice));
+}
+
+DeviceData* GetDeviceData(VkDevice device) {
+    return device_map.Get(GetDispatchKey(device));
+}
+
+// Queues and command buffers share their device's dispatch key
+DeviceData* GetDeviceData(VkQueue queue) {
+    return device_map.Get(GetDispatchKey(queue));
+}
+
+DeviceData* GetDeviceData(VkCommandBuffer commandBuffer) {
+    return device_map.Get(GetDispatchKey(commandBuffer));
+}
+
+// A render pass handle's full value: a pointer on 64-bit builds, a
+// uint64_t on 32-bit ones, where a void* would truncate it
+static uint64_t RenderPassKey(VkRenderPass render_pass) {
+    return TraceValue(render_pass);
+}
+
+uint32_t EnabledModules() {
+    static const uint32_t modules = [] {
+        const char* value = std::getenv("VK_COMBINED_MODULES");
+        if (!value || !*value) return MODULE_ALL;
+
+        uint32_t enabled = 0;
+        std::stringstream list(value);
+        std::string name;
+        while (std::getline(list, name, ',')) {
+            if (name == "tint") enabled |= MODULE_TINT;
+            else if (name == "overlay") enabled |= MODULE_OVERLAY;
+            else if (name == "interpolation") enabled |= MODULE_INTERPOLATION;
+            else if (name == "logger") enabled |= MODULE_LOGGER;
+            else if (name == "all") enabled |= MODULE_ALL;
+            else if (!name.empty()) {
+                LogLayerMessage("COMBINED_LAYER", "VK_COMBINED_MODULES", ("Unknown module " + name).c_str());
+            }
+        }
+        return enabled;
+    }();
+    return modules;
+}
+
+static std::string ModuleNames(uint32_t modules) {
+    std::string names;
+    if (modules & MODULE_TINT) names += " tint";
+    if (modules & MODULE_OVERLAY) names += " overlay";
+    if (modules & MODULE_INTERPOLATION) names += " interpolation";
+    if (modules & MODULE_LOGGER) names += " logger";
+    return names.empty() ? "none" : names.substr(1);
+}
+
+// Instance and device lifetime
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateInstance(
+    const VkInstanceCreateInfo* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator,
+    VkInstance* pInstance) {
+
+    uint32_t modules = EnabledModules();
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCreateInstance);
+    LogCombinedCall(trace, modules, "vkCreateInstance", "Creating Vulkan instance");
+
+    VkLayerInstanceCreateInfo* chain_info = FindInstanceLinkInfo(pCreateInfo);
+    if (!chain_info) {
+        return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
+    }
+
+    PFN_vkGetInstanceProcAddr gpa = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
+    PFN_vkCreateInstance create_instance = (PFN_vkCreateInstance)gpa(VK_NULL_HANDLE, "vkCreateInstance");
+    if (!create_instance) {
+        return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
+    }
+
+    // Advance the link info for the next element on the chain
+    chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
+
+    VkResult result = create_instance(pCreateInfo, pAllocator, pInstance);
+    if (result != VK_SUCCESS) return trace.Result(result);
+
+    InstanceData* instance_data = new InstanceData();
+    instance_data->instance = *pInstance;
+    instance_data->modules = modules;
+    instance_data->vtable.GetInstanceProcAddr = gpa;
+    instance_data->vtable.DestroyInstance = (PFN_vkDestroyInstance)gpa(*pInstance, "vkDestroyInstance");
+    instance_data->vtable.EnumeratePhysicalDevices = (PFN_vkEnumeratePhysicalDevices)gpa(*pInstance, "vkEnumeratePhysicalDevices");
+    instance_data->vtable.EnumeratePhysicalDeviceGroups =
+        (PFN_vkEnumeratePhysicalDeviceGroups)gpa(*pInstance, "vkEnumeratePhysicalDeviceGroups");
+    instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR =
+        (PFN_vkEnumeratePhysicalDeviceGroupsKHR)gpa(*pInstance, "vkEnumeratePhysicalDeviceGroupsKHR");
+    instance_data->vtable.CreateDevice = (PFN_vkCreateDevice)gpa(*pInstance, "vkCreateDevice");
+    instance_data->vtable.EnumerateDeviceExtensionProperties =
+        (PFN_vkEnumerateDeviceExtensionProperties)gpa(*pInstance, "vkEnumerateDeviceExtensionProperties");
+
+    instance_map.Insert(GetDispatchKey(*pInstance), instance_data);
+
+    LogLayerMessage("COMBINED_LAYER", "vkCreateInstance", ("Modules: " + ModuleNames(modules)).c_str());
+    return trace.Result(result);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkDestroyInstance(
+    VkInstance instance,
+    const VkAllocationCallbacks* pAllocator) {
+
+    // The handle is gone once the call returns, so take the key first
+    void* key = GetDispatchKey(instance);
+    InstanceData* instance_data = instance_map.Get(key);
+    if (!instance_data) return;
+
+    ApiTraceScope trace(LoggerTrace(instance_data->modules), CombinedFunction::vkDestroyInstance);
+    LogCombinedCall(trace, instance_data->modules, "vkDestroyInstance", "Destroying Vulkan instance");
+
+    instance_data->vtable.DestroyInstance(instance, pAllocator);
+
+    instance_map.Erase(key);
+    ReleasePhysicalDevices(physical_device_map, instance_data);
+    delete instance_data;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkEnumeratePhysicalDevices(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceCount,
+    VkPhysicalDevice* pPhysicalDevices) {
+
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data) return VK_ERROR_INITIALIZATION_FAILED;
+
+    VkResult result = instance_data->vtable.EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
+    if ((result == VK_SUCCESS || result == VK_INCOMPLETE) && pPhysicalDevices) {
+        TrackPhysicalDevices(physical_device_map, instance_data, *pPhysicalDeviceCount, pPhysicalDevices);
+    }
+    return result;
+}
+
+// Devices in a group are tracked like individually enumerated ones
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkEnumeratePhysicalDeviceGroups(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->vtable.EnumeratePhysicalDeviceGroups) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkResult result = instance_data->vtable.EnumeratePhysicalDeviceGroups(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkEnumeratePhysicalDeviceGroupsKHR(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkResult result = instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    return result;
+}
+
+#define COMBINED_LOAD_DISPATCH(name, member, modules, labels) \
+    device_data->vtable.member = reinterpret_cast<PFN_##name>(gdpa(*pDevice, #name));
+
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateDevice(
+    VkPhysicalDevice physicalDevice,
+    const VkDeviceCreateInfo* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator,
+    VkDevice* pDevice) {
+
+    InstanceData* instance_data = GetInstanceData(physicalDevice);
+    uint32_t modules = instance_data ? instance_data->modules : EnabledModules();
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCreateDevice);
+    LogCombinedCall(trace, modules, "vkCreateDevice", "Creating logical device");
+
+    VkLayerDeviceCreateInfo* chain_info = FindDeviceLinkInfo(pCreateInfo);
+    if (!chain_info) {
+        return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
+    }
+
+    PFN_vkGetInstanceProcAddr gipa = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
+    PFN_vkGetDeviceProcAddr gdpa = chain_info->u.pLayerInfo->pfnNextGetDeviceProcAddr;
+    PFN_vkCreateDevice create_device = (PFN_vkCreateDevice)gipa(
+        instance_data ? instance_data->instance : VK_NULL_HANDLE, "vkCreateDevice");
+    if (!create_device) {
+        return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
+    }
+
+    // Advance the link info for the next element on the chain
+    chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
+
+    VkResult result = create_device(physicalDevice, pCreateInfo, pAllocator, pDevice);
+    if (result != VK_SUCCESS) return trace.Result(result);
+
+    DeviceData* device_data = new DeviceData();
+    device_data->device = *pDevice;
+    device_data->instance_data = instance_data;
+    device_data->modules = modules;
+    device_data->vtable.GetDeviceProcAddr = gdpa;
+    device_data->vtable.DestroyDevice = (PFN_vkDestroyDevice)gdpa(*pDevice, "vkDestroyDevice");
+    COMBINED_DEVICE_HOOKS(COMBINED_LOAD_DISPATCH)
+
+    device_map.Insert(GetDispatchKey(*pDevice), device_data);
+
+    auto get_properties = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties>(
+        gipa(instance_data ? instance_data->instance : VK_NULL_HANDLE, "vkGetPhysicalDeviceProperties"));
+    if ((modules & (MODULE_TINT | MODULE_OVERLAY)) && get_properties) {
+        VkPhysicalDeviceProperties properties;
+        get_properties(physicalDevice, &properties);
+        device_data->pipeline_cache = PipelineDiskCache::Create(DiskCache::Shared(), LAYER_NAME, *pDevice, properties, gdpa);
+    }
+
+    if (modules & MODULE_TINT) TintDeviceCreated(device_data, physicalDevice, pCreateInfo, gipa);
+    if (modules & MODULE_OVERLAY) OverlayDeviceCreated(device_data, physicalDevice, pCreateInfo, gipa);
+    return trace.Result(result);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkDestroyDevice(
+    VkDevice device,
+    const VkAllocationCallbacks* pAllocator) {
+
+    // The handle is gone once the call returns, so take the key first
+    void* key = GetDispatchKey(device);
+    DeviceData* device_data = device_map.Get(key);
+    if (!device_data) return;
+
+    ApiTraceScope trace(LoggerTrace(device_data->modules), CombinedFunction::vkDestroyDevice);
+    LogCombinedCall(trace, device_data->modules, "vkDestroyDevice", "Destroying logical device");
+
+    // Waits for in-flight tints and overlays
+    device_data->tint_pass.reset();
+    device_data->text_renderer.reset();
+    device_data->pipeline_cache.reset();
+    device_data->vtable.DestroyDevice(device, pAllocator);
+
+    device_map.Erase(key);
+    delete device_data;
+}
+
+// Hooked device commands. Each looks up its device once, runs the enabled
+// modules in order and makes one call to the next layer.
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateShaderModule(
+    VkDevice device,
+    const VkShaderModuleCreateInfo* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator,
+    VkShaderModule* pShaderModule) {
+
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data) return VK_ERROR_INITIALIZATION_FAILED;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCreateShaderModule);
+    if (trace.Active()) {
+        trace.Arg(device);
+        trace.Arg(pCreateInfo->codeSize);
+    }
+    LogCombinedCall(trace, modules, "vkCreateShaderModule");
+
+    VkResult result = device_data->vtable.CreateShaderModule(device, pCreateInfo, pAllocator, pShaderModule);
+    if (trace.Active()) trace.Arg(result == VK_SUCCESS ? *pShaderModule : VK_NULL_HANDLE);
+    return trace.Result(result);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateRenderPass(
+    VkDevice device,
+    const VkRenderPassCreateInfo* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator,
+    VkRenderPass* pRenderPass) {
+
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data) return VK_ERROR_INITIALIZATION_FAILED;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCreateRenderPass);
+    if (trace.Active()) {
+        trace.Arg(device);
+        trace.Arg(pCreateInfo->attachmentCount);
+    }
+    LogCombinedCall(trace, modules, "vkCreateRenderPass");
+
+    VkResult result = device_data->vtable.CreateRenderPass(device, pCreateInfo, pAllocator, pRenderPass);
+    if (result == VK_SUCCESS && (modules & MODULE_LOGGER)) {
+        RenderPassAttachments attachments = RenderPassAttachments::FromCreateInfo(*pCreateInfo);
+        std::lock_guard<std::mutex> lock(device_data->render_pass_mutex);
+        device_data->render_passes[RenderPassKey(*pRenderPass)] = attachments;
+    }
+    if (trace.Active()) trace.Arg(result == VK_SUCCESS ? *pRenderPass : VK_NULL_HANDLE);
+    return trace.Result(result);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkDestroyRenderPass(
+    VkDevice device,
+    VkRenderPass renderPass,
+    const VkAllocationCallbacks* pAllocator) {
+
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data) return;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkDestroyRenderPass);
+    if (trace.Active()) {
+        trace.Arg(device);
+        trace.Arg(renderPass);
+    }
+    LogCombinedCall(trace, modules, "vkDestroyRenderPass");
+
+    if (modules & MODULE_LOGGER) {
+        std::lock_guard<std::mutex> lock(device_data->render_pass_mutex);
+        device_data->render_passes.erase(RenderPassKey(renderPass));
+    }
+    device_data->vtable.DestroyRenderPass(device, renderPass, pAllocator);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkCmdBeginRenderPass(
+    VkCommandBuffer commandBuffer,
+    const VkRenderPassBeginInfo* pRenderPassBegin,
+    VkSubpassContents contents) {
+
+    DeviceData* device_data = GetDeviceData(commandBuffer);
+    if (!device_data) return;
+
+    // Only the logger reports color clears. Render passes made through
+    // vkCreateRenderPass2 aren't tracked.
+    uint32_t modules = device_data->modules;
+    uint32_t clear_value_count = pRenderPassBegin->pClearValues ? pRenderPassBegin->clearValueCount : 0;
+    bool tracked = false;
+    uint32_t color_clears = 0;
+    if (modules & MODULE_LOGGER) {
+        std::lock_guard<std::mutex> lock(device_data->render_pass_mutex);
+        auto it = device_data->render_passes.find(RenderPassKey(pRenderPassBegin->renderPass));
+        if (it != device_data->render_passes.end()) {
+            tracked = true;
+            color_clears = it->second.ColorClearCount(clear_value_count);
+        }
+    }
+
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCmdBeginRenderPass);
+    if (trace.Active()) {
+        trace.Arg(commandBuffer);
+        trace.Arg(pRenderPassBegin->clearValueCount);
+        trace.Arg(contents);
+        trace.Arg(color_clears);
+    } else if (modules & MODULE_LOGGER) {
+        char details[64];
+        if (tracked) {
+            std::snprintf(details, sizeof(details), "%u clear values, %u color", clear_value_count, color_clears);
+        } else {
+            std::snprintf(details, sizeof(details), "%u clear values", clear_value_count);
+        }
+        LogCombinedCall(trace, modules, "vkCmdBeginRenderPass", details);
+    }
+
+    device_data->vtable.CmdBeginRenderPass(commandBuffer, pRenderPassBegin, contents);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkCmdEndRenderPass(
+    VkCommandBuffer commandBuffer) {
+
+    DeviceData* device_data = GetDeviceData(commandBuffer);
+    if (!device_data) return;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCmdEndRenderPass);
+    if (trace.Active()) trace.Arg(commandBuffer);
+    LogCombinedCall(trace, modules, "vkCmdEndRenderPass");
+
+    device_data->vtable.CmdEndRenderPass(commandBuffer);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkCmdDraw(
+    VkCommandBuffer commandBuffer,
+    uint32_t vertexCount,
+    uint32_t instanceCount,
+    uint32_t firstVertex,
+    uint32_t firstInstance) {
+
+    DeviceData* device_data = GetDeviceData(commandBuffer);
+    if (!device_data) return;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCmdDraw);
+    if (trace.Active()) {
+        trace.Arg(commandBuffer);
+        trace.Arg(vertexCount);
+        trace.Arg(instanceCount);
+        trace.Arg(firstVertex);
+        trace.Arg(firstInstance);
+    }
+    LogCombinedCall(trace, modules, "vkCmdDraw");
+
+    device_data->vtable.CmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkCmdDrawIndexed(
+    VkCommandBuffer commandBuffer,
+    uint32_t indexCount,
+    uint32_t instanceCount,
+    uint32_t firstIndex,
+    int32_t vertexOffset,
+    uint32_t firstInstance) {
+
+    DeviceData* device_data = GetDeviceData(commandBuffer);
+    if (!device_data) return;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCmdDrawIndexed);
+    if (trace.Active()) {
+        trace.Arg(commandBuffer);
+        trace.Arg(indexCount);
+        trace.Arg(instanceCount);
+        trace.Arg(firstIndex);
+        trace.Arg(vertexOffset);
+        trace.Arg(firstInstance);
+    }
+    LogCombinedCall(trace, modules, "vkCmdDrawIndexed");
+
+    device_data->vtable.CmdDrawIndexed(commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkCmdSetViewport(
+    VkCommandBuffer commandBuffer,
+    uint32_t firstViewport,
+    uint32_t viewportCount,
+    const VkViewport* pViewports) {
+
+    DeviceData* device_data = GetDeviceData(commandBuffer);
+    if (!device_data) return;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCmdSetViewport);
+    if (trace.Active()) {
+        trace.Arg(commandBuffer);
+        trace.Arg(firstViewport);
+        trace.Arg(viewportCount);
+    }
+    LogCombinedCall(trace, modules, "vkCmdSetViewport");
+
+    device_data->vtable.CmdSetViewport(commandBuffer, firstViewport, viewportCount, pViewports);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkCmdSetScissor(
+    VkCommandBuffer commandBuffer,
+    uint32_t firstScissor,
+    uint32_t scissorCount,
+    const VkRect2D* pScissors) {
+
+    DeviceData* device_data = GetDeviceData(commandBuffer);
+    if (!device_data) return;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCmdSetScissor);
+    if (trace.Active()) {
+        trace.Arg(commandBuffer);
+        trace.Arg(firstScissor);
+        trace.Arg(scissorCount);
+    }
+    LogCombinedCall(trace, modules, "vkCmdSetScissor");
+
+    device_data->vtable.CmdSetScissor(commandBuffer, firstScissor, scissorCount, pScissors);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateSwapchainKHR(
+    VkDevice device,
+    const VkSwapchainCreateInfoKHR* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator,
+    VkSwapchainKHR* pSwapchain) {
+
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data) return VK_ERROR_INITIALIZATION_FAILED;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkCreateSwapchainKHR);
+    if (trace.Active()) {
+        trace.Arg(device);
+        trace.Arg(pCreateInfo->minImageCount);
+        trace.Arg(pCreateInfo->presentMode);
+    }
+    LogCombinedCall(trace, modules, "vkCreateSwapchainKHR");
+
+    // The tint writes the swapchain images as storage images, the overlay
+    // draws into them as color attachments
+    VkSwapchainCreateInfoKHR create_info = *pCreateInfo;
+    if (modules & MODULE_TINT) TintPrepareSwapchain(device_data, &create_info);
+    if (device_data->text_renderer) TextRenderer::PrepareSwapchain(&create_info);
+
+    VkResult result = device_data->vtable.CreateSwapchainKHR(device, &create_info, pAllocator, pSwapchain);
+    if (result == VK_SUCCESS && (modules & MODULE_TINT)) {
+        TintSwapchainCreated(device_data, &create_info, *pSwapchain);
+    }
+    if (result == VK_SUCCESS && (modules & MODULE_INTERPOLATION)) {
+        InterpolationSwapchainCreated(device_data, &create_info, *pSwapchain);
+    }
+    if (result == VK_SUCCESS && (modules & MODULE_OVERLAY)) {
+        OverlaySwapchainCreated(device_data, &create_info, *pSwapchain);
+    }
+    if (trace.Active()) trace.Arg(result == VK_SUCCESS ? *pSwapchain : VK_NULL_HANDLE);
+    return trace.Result(result);
+}
+
+static VKAPI_ATTR void VKAPI_CALL layer_vkDestroySwapchainKHR(
+    VkDevice device,
+    VkSwapchainKHR swapchain,
+    const VkAllocationCallbacks* pAllocator) {
+
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data) return;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkDestroySwapchainKHR);
+    if (trace.Active()) {
+        trace.Arg(device);
+        trace.Arg(swapchain);
+    }
+    LogCombinedCall(trace, modules, "vkDestroySwapchainKHR");
+
+    if (modules & MODULE_TINT) TintSwapchainDestroyed(device_data, swapchain);
+    if (modules & MODULE_INTERPOLATION) InterpolationSwapchainDestroyed(device_data, swapchain);
+    if (modules & MODULE_OVERLAY) OverlaySwapchainDestroyed(device_data, swapchain);
+
+    device_data->vtable.DestroySwapchainKHR(device, swapchain, pAllocator);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkAcquireNextImageKHR(
+    VkDevice device,
+    VkSwapchainKHR swapchain,
+    uint64_t timeout,
+    VkSemaphore semaphore,
+    VkFence fence,
+    uint32_t* pImageIndex) {
+
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data) return VK_ERROR_INITIALIZATION_FAILED;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkAcquireNextImageKHR);
+    if (trace.Active()) {
+        trace.Arg(device);
+        trace.Arg(swapchain);
+        trace.Arg(timeout);
+    }
+    LogCombinedCall(trace, modules, "vkAcquireNextImageKHR");
+
+    VkResult result = device_data->vtable.AcquireNextImageKHR(device, swapchain, timeout, semaphore, fence, pImageIndex);
+    if (result == VK_SUCCESS && (modules & MODULE_INTERPOLATION)) {
+        // Record timing data on acquire (start of frame)
+        InterpolationImageAcquired(device_data, swapchain, *pImageIndex);
+    }
+    if (trace.Active()) trace.Arg(result >= VK_SUCCESS ? *pImageIndex : 0u);
+    return trace.Result(result);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueuePresentKHR(
+    VkQueue queue,
+    const VkPresentInfoKHR* pPresentInfo) {
+
+    DeviceData* device_data = GetDeviceData(queue);
+    if (!device_data) return VK_ERROR_INITIALIZATION_FAILED;
+
+    uint32_t modules = device_data->modules;
+    ApiTraceScope trace(LoggerTrace(modules), CombinedFunction::vkQueuePresentKHR);
+    if (trace.Active()) {
+        trace.Arg(queue);
+        trace.Arg(pPresentInfo->swapchainCount);
+    }
+    LogCombinedCall(trace, modules, "vkQueuePresentKHR");
+
+    // The tint and then the overlay may swap the present's wait semaphores
+    // for their own
+    VkPresentInfoKHR present_info = *pPresentInfo;
+    if (modules & MODULE_TINT) TintPresent(device_data, queue, &present_info);
+    if (modules & MODULE_OVERLAY) OverlayPresent(device_data, queue, &present_info);
+
+    return trace.Result(device_data->vtable.QueuePresentKHR(queue, &present_info));
+}
+
+// Hooks, looked up by name, with the modules each one serves
+#define COMBINED_HOOK_NAME(name, member, modules, labels) #name,
+#define COMBINED_HOOK_FUNCTION(name, member, modules, labels) reinterpret_cast<PFN_vkVoidFunction>(layer_##name),
+#define COMBINED_HOOK_MODULES(name, member, modules, labels) static_cast<uint32_t>(modules),
+
+static constexpr const char* hook_names[] = {COMBINED_DEVICE_HOOKS(COMBINED_HOOK_NAME)};
+static constexpr ProcHash<std::size(hook_names)> hook_hash(hook_names);
+static const PFN_vkVoidFunction hook_functions[] = {COMBINED_DEVICE_HOOKS(COMBINED_HOOK_FUNCTION)};
+static const uint32_t hook_modules[] = {COMBINED_DEVICE_HOOKS(COMBINED_HOOK_MODULES)};
+
+// The hook for `pName` if an enabled module needs it. The logger needs
+// every hook.
+static PFN_vkVoidFunction FindDeviceHook(const char* pName, uint32_t modules) {
+    int index = hook_hash.Find(pName);
+    if (index < 0 || !(modules & (hook_modules[index] | MODULE_LOGGER))) {
+        return nullptr;
+    }
+    return hook_functions[index];
+}
+
+// Entry points this layer always intercepts
+#define COMBINED_INSTANCE_PROCS(X) \
+    X(vkGetInstanceProcAddr, vkGetInstanceProcAddr) \
+    X(vkGetDeviceProcAddr, vkGetDeviceProcAddr) \
+    X(vkCreateInstance, layer_vkCreateInstance) \
+    X(vkDestroyInstance, layer_vkDestroyInstance) \
+    X(vkEnumeratePhysicalDevices, layer_vkEnumeratePhysicalDevices) \
+    X(vkEnumeratePhysicalDeviceGroups, layer_vkEnumeratePhysicalDeviceGroups) \
+    X(vkEnumeratePhysicalDeviceGroupsKHR, layer_vkEnumeratePhysicalDeviceGroupsKHR) \
+    X(vkCreateDevice, layer_vkCreateDevice) \
+    X(vkDestroyDevice, layer_vkDestroyDevice) \
+    X(vkEnumerateInstanceLayerProperties, vkEnumerateInstanceLayerProperties) \
+    X(vkEnumerateInstanceExtensionProperties, vkEnumerateInstanceExtensionProperties) \
+    X(vkEnumerateDeviceLayerProperties, vkEnumerateDeviceLayerProperties) \
+    X(vkEnumerateDeviceExtensionProperties, vkEnumerateDeviceExtensionProperties)
+
+#define COMBINED_DEVICE_PROCS(X) \
+    X(vkGetDeviceProcAddr, vkGetDeviceProcAddr) \
+    X(vkDestroyDevice, layer_vkDestroyDevice)
+
+DECLARE_PROC_TABLE(instance_procs, COMBINED_INSTANCE_PROCS);
+DECLARE_PROC_TABLE(device_procs, COMBINED_DEVICE_PROCS);
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(
+    VkInstance instance,
+    const char* pName) {
+
+    // Return our layer's functions
+    if (PFN_vkVoidFunction function = instance_procs.Find(pName)) return function;
+
+    if (!instance) return nullptr;
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data) return nullptr;
+
+    // Device-level commands may be resolved through the instance as well
+    PFN_vkVoidFunction next = instance_data->vtable.GetInstanceProcAddr(instance, pName);
+    if (next) {
+        if (PFN_vkVoidFunction hook = FindDeviceHook(pName, instance_data->modules)) return hook;
+    }
+    return next;
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(
+    VkDevice device,
+    const char* pName) {
+
+    // Return our layer's functions
+    if (PFN_vkVoidFunction function = device_procs.Find(pName)) return function;
+
+    if (!device) return nullptr;
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data) return nullptr;
+
+    // Commands no enabled module needs go straight to the next layer
+    PFN_vkVoidFunction next = device_data->vtable.GetDeviceProcAddr(device, pName);
+    if (next) {
+        if (PFN_vkVoidFunction hook = FindDeviceHook(pName, device_data->modules)) return hook;
+    }
+    return next;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(
+    uint32_t* pPropertyCount,
+    VkLayerProperties* pProperties) {
+
+    return EnumerateLayerProperties(layer_props, pPropertyCount, pProperties);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(
+    const char* pLayerName,
+    uint32_t* pPropertyCount,
+    VkExtensionProperties* pProperties) {
+
+    if (pLayerName && strcmp(pLayerName, LAYER_NAME) == 0) {
+        *pPropertyCount = 0;
+        return VK_SUCCESS;
+    }
+
+    return VK_ERROR_LAYER_NOT_PRESENT;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceLayerProperties(
+    VkPhysicalDevice physicalDevice,
+    uint32_t* pPropertyCount,
+    VkLayerProperties* pProperties) {
+
+    return EnumerateLayerProperties(layer_props, pPropertyCount, pProperties);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(
+    VkPhysicalDevice physicalDevice,
+    const char* pLayerName,
+    uint32_t* pPropertyCount,
+    VkExtensionProperties* pProperties) {
+
+    // Don't handle layer-specific queries for our layer
+    if (pLayerName && strcmp(pLayerName, LAYER_NAME) == 0) {
+        *pPropertyCount = 0;
+        return VK_SUCCESS;
+    }
+
+    // Forward to next layer/driver for extension enumeration
+    InstanceData* instance_data = GetInstanceData(physicalDevice);
+    if (instance_data && instance_data->vtable.EnumerateDeviceExtensionProperties) {
+        return instance_data->vtable.EnumerateDeviceExtensionProperties(physicalDevice, pLayerName, pPropertyCount, pProperties);
+    }
+
+    return VK_ERROR_LAYER_NOT_PRESENT;
+}
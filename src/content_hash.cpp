@@ -0,0 +1,78 @@
+#include "content_hash.h"
+#include <cstring>
+
+static inline uint64_t RotateLeft(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t FinalMix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+ContentHash HashBytes(const void* bytes, size_t size) {
+    const uint8_t* data = static_cast<const uint8_t*>(bytes);
+    const size_t length = size;
+    const size_t blocks = length / 16;
+    constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+    constexpr uint64_t c2 = 0x4cf5ad432745937full;
+
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    for (size_t i = 0; i < blocks; i++) {
+        uint64_t k1;
+        uint64_t k2;
+        std::memcpy(&k1, data + i * 16, sizeof(k1));
+        std::memcpy(&k2, data + i * 16 + 8, sizeof(k2));
+
+        k1 *= c1;
+        k1 = RotateLeft(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+        h1 = RotateLeft(h1, 27);
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2;
+        k2 = RotateLeft(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+        h2 = RotateLeft(h2, 31);
+        h2 += h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    // Little-endian loads, as the reference reads its tail bytes
+    const uint8_t* tail = data + blocks * 16;
+    size_t tail_length = length & 15;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    if (tail_length > 8) {
+        std::memcpy(&k2, tail + 8, tail_length - 8);
+        k2 *= c2;
+        k2 = RotateLeft(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+    }
+    if (tail_length > 0) {
+        std::memcpy(&k1, tail, tail_length < 8 ? tail_length : 8);
+        k1 *= c1;
+        k1 = RotateLeft(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+    }
+
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = FinalMix(h1);
+    h2 = FinalMix(h2);
+    h1 += h2;
+    h2 += h1;
+    return {h1, h2};
+}
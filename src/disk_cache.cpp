@@ -0,0 +1,356 @@
+#include "disk_cache.h"
+#include "layer_core.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void LogDiskCache(const char* function_name, const std::string& details) {
+    LogLayerMessage("DISK_CACHE", function_name, details.c_str());
+}
+
+// mkdir -p
+static bool MakeDirectories(const std::string& path) {
+    for (size_t slash = path.find('/', 1);; slash = path.find('/', slash + 1)) {
+        std::string prefix = path.substr(0, slash);
+        if (::mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (slash == std::string::npos) break;
+    }
+    struct stat status;
+    return ::stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+}
+
+static bool WriteAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Writes a temporary file next to `path` and renames it over `path`. There
+// is no fsync: a power cut can leave a short file behind the rename, which
+// the size and content checks on read turn into a miss.
+static bool WriteFileAtomically(const std::string& path, const void* data, size_t size) {
+    static std::atomic<uint32_t> temp_counter{0};
+    std::string temp_path = path + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(temp_counter++);
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    bool written = WriteAll(fd, static_cast<const uint8_t*>(data), size);
+    written = ::close(fd) == 0 && written;
+    if (written && ::rename(temp_path.c_str(), path.c_str()) == 0) return true;
+    ::unlink(temp_path.c_str());
+    return false;
+}
+
+static bool ReadFile(const std::string& path, uint64_t expected_size, std::vector<uint8_t>* data) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat status;
+    bool ok = ::fstat(fd, &status) == 0 && static_cast<uint64_t>(status.st_size) == expected_size;
+    if (ok) {
+        data->resize(static_cast<size_t>(expected_size));
+        size_t done = 0;
+        while (done < data->size()) {
+            ssize_t count = ::read(fd, data->data() + done, data->size() - done);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) {
+                ok = false;
+                break;
+            }
+            done += static_cast<size_t>(count);
+        }
+    }
+    ::close(fd);
+    if (!ok) data->clear();
+    return ok;
+}
+
+static bool EntryLess(const DiskCacheIndexEntry& a, const DiskCacheIndexEntry& b) {
+    if (a.kind != b.kind) return a.kind < b.kind;
+    if (a.keyHigh != b.keyHigh) return a.keyHigh < b.keyHigh;
+    return a.keyLow < b.keyLow;
+}
+
+static DiskCacheIndexEntry MakeEntry(DiskCacheKind kind, const ContentHash& key) {
+    DiskCacheIndexEntry entry{};
+    entry.kind = static_cast<uint32_t>(kind);
+    entry.keyLow = key.low;
+    entry.keyHigh = key.high;
+    return entry;
+}
+
+std::unique_ptr<DiskCache> DiskCache::Open(const std::string& root) {
+    if (root.empty()) return nullptr;
+
+    std::unique_ptr<DiskCache> cache(new DiskCache());
+    cache->directory_ = root + "/v" + std::to_string(kDiskCacheVersion);
+    if (!MakeDirectories(cache->directory_)) {
+        LogDiskCache("Open", "Cache off: cannot create " + cache->directory_ + ": " + std::strerror(errno));
+        return nullptr;
+    }
+    cache->index_path_ = cache->directory_ + "/index";
+
+    std::string lock_path = cache->directory_ + "/lock";
+    cache->lock_fd_ = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (cache->lock_fd_ < 0) {
+        LogDiskCache("Open", "Cache off: cannot open " + lock_path + ": " + std::strerror(errno));
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(cache->mutex_);
+    cache->RefreshIndex();
+    return cache;
+}
+
+DiskCache* DiskCache::Shared() {
+    static std::unique_ptr<DiskCache> shared = Open(DefaultRoot());
+    return shared.get();
+}
+
+std::string DiskCache::DefaultRoot() {
+    const char* value = std::getenv("VK_LAYER_CACHE_DIR");
+    if (value && *value) {
+        return std::strcmp(value, "0") == 0 ? std::string() : std::string(value);
+    }
+    const char* cache_home = std::getenv("XDG_CACHE_HOME");
+    if (cache_home && *cache_home) return std::string(cache_home) + "/vulkan-layers";
+    const char* home = std::getenv("HOME");
+    if (home && *home) return std::string(home) + "/.cache/vulkan-layers";
+    return std::string();
+}
+
+DiskCache::~DiskCache() {
+    UnmapIndex();
+    if (lock_fd_ >= 0) {
+        ::close(lock_fd_);
+    }
+}
+
+void DiskCache::UnmapIndex() {
+    if (mapped_) {
+        ::munmap(const_cast<uint8_t*>(mapped_), mapped_size_);
+    }
+    mapped_ = nullptr;
+    mapped_size_ = 0;
+    mapped_inode_ = 0;
+    entries_ = nullptr;
+    entry_count_ = 0;
+}
+
+void DiskCache::RefreshIndex() {
+    // One stat per lookup. While the old index stays mapped its inode can't
+    // be reused, so a changed inode always means a replaced index.
+    struct stat status;
+    if (::stat(index_path_.c_str(), &status) != 0) {
+        UnmapIndex();
+        return;
+    }
+    if (mapped_ && status.st_ino == mapped_inode_ && static_cast<size_t>(status.st_size) == mapped_size_) return;
+
+    UnmapIndex();
+    int fd = ::open(index_path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(DiskCacheIndexHeader)) {
+        ::close(fd);
+        return;
+    }
+    size_t size = static_cast<size_t>(status.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) return;
+
+    // A short or foreign index reads as empty and is replaced by the next Store
+    const auto* header = static_cast<const DiskCacheIndexHeader*>(mapped);
+    size_t capacity = (size - sizeof(DiskCacheIndexHeader)) / sizeof(DiskCacheIndexEntry);
+    if (header->magic != kDiskCacheMagic || header->version != kDiskCacheVersion ||
+        header->entryCount != capacity ||
+        sizeof(DiskCacheIndexHeader) + capacity * sizeof(DiskCacheIndexEntry) != size) {
+        ::munmap(mapped, size);
+        return;
+    }
+
+    mapped_ = static_cast<const uint8_t*>(mapped);
+    mapped_size_ = size;
+    mapped_inode_ = status.st_ino;
+    entries_ = reinterpret_cast<const DiskCacheIndexEntry*>(mapped_ + sizeof(DiskCacheIndexHeader));
+    entry_count_ = capacity;
+}
+
+const DiskCacheIndexEntry* DiskCache::FindEntry(DiskCacheKind kind, const ContentHash& key) const {
+    DiskCacheIndexEntry probe = MakeEntry(kind, key);
+    const DiskCacheIndexEntry* end = entries_ + entry_count_;
+    const DiskCacheIndexEntry* found = std::lower_bound(entries_, end, probe, EntryLess);
+    return (found != end && !EntryLess(probe, *found)) ? found : nullptr;
+}
+
+std::string DiskCache::EntryPath(DiskCacheKind kind, const ContentHash& key) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%u-%016llx%016llx", static_cast<unsigned>(kind),
+                  static_cast<unsigned long long>(key.high), static_cast<unsigned long long>(key.low));
+    return directory_ + name;
+}
+
+bool DiskCache::Load(DiskCacheKind kind, const ContentHash& key, std::vector<uint8_t>* data) {
+    DiskCacheIndexEntry entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        RefreshIndex();
+        const DiskCacheIndexEntry* found = FindEntry(kind, key);
+        if (!found) return false;
+        entry = *found;
+    }
+
+    // A file replaced since the index was read fails the content check and
+    // is a miss
+    if (!ReadFile(EntryPath(kind, key), entry.size, data)) return false;
+    ContentHash content = HashBytes(data->data(), data->size());
+    if (content.low != entry.contentLow || content.high != entry.contentHigh) {
+        data->clear();
+        return false;
+    }
+    return true;
+}
+
+bool DiskCache::Store(DiskCacheKind kind, const ContentHash& key, const void* data, size_t size) {
+    ContentHash content = HashBytes(data, size);
+    std::string path = EntryPath(kind, key);
+    if (!WriteFileAtomically(path, data, size)) {
+        LogDiskCache("Store", "Cannot write " + path + ": " + std::strerror(errno));
+        return false;
+    }
+
+    DiskCacheIndexEntry entry = MakeEntry(kind, key);
+    entry.size = size;
+    entry.contentLow = content.low;
+    entry.contentHigh = content.high;
+
+    // Other processes rewrite the index too: read, merge and replace it
+    // under the lock file so no entry is lost between them
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (::flock(lock_fd_, LOCK_EX) != 0) return false;
+    RefreshIndex();
+
+    std::vector<DiskCacheIndexEntry> entries(entries_, entries_ + entry_count_);
+    auto position = std::lower_bound(entries.begin(), entries.end(), entry, EntryLess);
+    if (position != entries.end() && !EntryLess(entry, *position)) {
+        *position = entry;
+    } else {
+        entries.insert(position, entry);
+    }
+
+    DiskCacheIndexHeader header = {};
+    header.magic = kDiskCacheMagic;
+    header.version = kDiskCacheVersion;
+    header.entryCount = entries.size();
+    std::vector<uint8_t> index(sizeof(header) + entries.size() * sizeof(DiskCacheIndexEntry));
+    std::memcpy(index.data(), &header, sizeof(header));
+    std::memcpy(index.data() + sizeof(header), entries.data(), entries.size() * sizeof(DiskCacheIndexEntry));
+
+    bool written = WriteFileAtomically(index_path_, index.data(), index.size());
+    int write_error = errno;
+    RefreshIndex();
+    ::flock(lock_fd_, LOCK_UN);
+    if (!written) {
+        LogDiskCache("Store", "Cannot write " + index_path_ + ": " + std::strerror(write_error));
+    }
+    return written;
+}
+
+size_t DiskCache::entry_count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RefreshIndex();
+    return entry_count_;
+}
+
+std::unique_ptr<PipelineDiskCache> PipelineDiskCache::Create(DiskCache* disk, const char* consumer, VkDevice device,
+                                                             const VkPhysicalDeviceProperties& properties,
+                                                             PFN_vkGetDeviceProcAddr gdpa) {
+    if (!disk || !consumer || !gdpa) return nullptr;
+
+    std::unique_ptr<PipelineDiskCache> cache(new PipelineDiskCache());
+    cache->disk_ = disk;
+    cache->device_ = device;
+#define PIPELINE_DISK_CACHE_LOAD(name) cache->vk_.name = reinterpret_cast<PFN_vk##name>(gdpa(device, "vk" #name));
+    PIPELINE_DISK_CACHE_DEVICE_FUNCTIONS(PIPELINE_DISK_CACHE_LOAD)
+#undef PIPELINE_DISK_CACHE_LOAD
+    if (!cache->vk_.CreatePipelineCache || !cache->vk_.GetPipelineCacheData || !cache->vk_.DestroyPipelineCache) {
+        return nullptr;
+    }
+
+    // Drivers check the data's own header and drop what they can't use; the
+    // key keeps one entry per consumer, device and driver so they never have
+    // to, and so one layer's blob never replaces another's
+    struct {
+        uint8_t uuid[VK_UUID_SIZE];
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+    } identity{};
+    std::memcpy(identity.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    identity.vendor_id = properties.vendorID;
+    identity.device_id = properties.deviceID;
+    identity.driver_version = properties.driverVersion;
+    std::vector<uint8_t> key_bytes(sizeof(identity) + std::strlen(consumer));
+    std::memcpy(key_bytes.data(), &identity, sizeof(identity));
+    std::memcpy(key_bytes.data() + sizeof(identity), consumer, key_bytes.size() - sizeof(identity));
+    cache->key_ = HashBytes(key_bytes.data(), key_bytes.size());
+
+    std::vector<uint8_t> data;
+    cache->warm_ = disk->Load(DiskCacheKind::PipelineCache, cache->key_, &data);
+
+    VkPipelineCacheCreateInfo create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    create_info.initialDataSize = data.size();
+    create_info.pInitialData = data.empty() ? nullptr : data.data();
+    VkResult result = cache->vk_.CreatePipelineCache(device, &create_info, nullptr, &cache->cache_);
+    if (result != VK_SUCCESS && cache->warm_) {
+        cache->warm_ = false;
+        create_info.initialDataSize = 0;
+        create_info.pInitialData = nullptr;
+        result = cache->vk_.CreatePipelineCache(device, &create_info, nullptr, &cache->cache_);
+    }
+    if (result != VK_SUCCESS) {
+        cache->cache_ = VK_NULL_HANDLE;
+        return nullptr;
+    }
+    if (cache->warm_) cache->saved_hash_ = HashBytes(data.data(), data.size());
+    return cache;
+}
+
+PipelineDiskCache::~PipelineDiskCache() {
+    if (cache_ != VK_NULL_HANDLE) {
+        Save();
+        vk_.DestroyPipelineCache(device_, cache_, nullptr);
+    }
+}
+
+void PipelineDiskCache::Save() {
+    size_t size = 0;
+    if (vk_.GetPipelineCacheData(device_, cache_, &size, nullptr) != VK_SUCCESS || size == 0) return;
+    std::vector<uint8_t> data(size);
+    // VK_INCOMPLETE if another thread grew the cache in between; the next
+    // Save gets it
+    if (vk_.GetPipelineCacheData(device_, cache_, &size, data.data()) != VK_SUCCESS) return;
+    data.resize(size);
+
+    ContentHash hash = HashBytes(data.data(), data.size());
+    if (hash == saved_hash_) return;
+    if (disk_->Store(DiskCacheKind::PipelineCache, key_, data.data(), data.size())) {
+        saved_hash_ = hash;
+    }
+}
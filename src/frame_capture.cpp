@@ -0,0 +1,400 @@
+#include "frame_capture.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static bool CaptureLayoutFor(VkFormat format, CaptureLayout* layout) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+    case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+        *layout = CaptureLayout::Rgba8;
+        return true;
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        *layout = CaptureLayout::Bgra8;
+        return true;
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        *layout = CaptureLayout::Rgb10A2;
+        return true;
+    case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+        *layout = CaptureLayout::Bgr10A2;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Frames kept per swapchain, from FRAME_INTERP_CAPTURE_FRAMES
+static uint32_t CaptureFrameLimit() {
+    static const uint32_t limit = []() {
+        const char* value = std::getenv("FRAME_INTERP_CAPTURE_FRAMES");
+        long frames = value ? std::atol(value) : 0;
+        return frames > 0 ? static_cast<uint32_t>(frames) : 120u;
+    }();
+    return limit;
+}
+
+bool FrameCapture::Requested() {
+    static const bool requested = []() {
+        const char* value = std::getenv("FRAME_INTERP_CAPTURE");
+        return value && *value && std::strcmp(value, "0") != 0;
+    }();
+    return requested;
+}
+
+bool FrameCapture::PrepareSwapchain(const FrameGenerationDevice& device, VkSwapchainCreateInfoKHR* create_info) {
+    if (!Requested()) return false;
+
+    if (!device.timeline_semaphores || !device.vk.WaitSemaphores) {
+        std::cout << "[FRAME_INTERP] Capture off: device has no timeline semaphores" << std::endl;
+        return false;
+    }
+
+    CaptureLayout layout;
+    if (!CaptureLayoutFor(create_info->imageFormat, &layout) || create_info->imageArrayLayers != 1) {
+        std::cout << "[FRAME_INTERP] Capture off: unsupported swapchain format " << create_info->imageFormat
+                  << std::endl;
+        return false;
+    }
+
+    if (!device.get_surface_capabilities || !device.set_device_loader_data) return false;
+
+    VkSurfaceCapabilitiesKHR capabilities{};
+    if (device.get_surface_capabilities(device.physical_device, create_info->surface, &capabilities) != VK_SUCCESS) {
+        return false;
+    }
+    if (!(capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+        std::cout << "[FRAME_INTERP] Capture off: surface lacks transfer usage" << std::endl;
+        return false;
+    }
+
+    create_info->imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    return true;
+}
+
+FrameCapture::FrameCapture(const FrameGenerationDevice& device, std::unique_ptr<CaptureFile> file)
+    : device_(device), file_(std::move(file)) {}
+
+std::unique_ptr<FrameCapture> FrameCapture::Create(const FrameGenerationDevice& device, VkSwapchainKHR swapchain,
+                                                   const VkSwapchainCreateInfoKHR& create_info) {
+    CaptureLayout layout = CaptureLayout::Rgba8;
+    CaptureLayoutFor(create_info.imageFormat, &layout);
+    std::string path = "frame_capture_" + std::to_string(reinterpret_cast<uintptr_t>(swapchain)) + ".cap";
+    std::unique_ptr<CaptureFile> file =
+        CaptureFile::Create(path, create_info.imageExtent.width, create_info.imageExtent.height, layout,
+                            static_cast<uint32_t>(create_info.imageFormat), CaptureFrameLimit());
+    if (!file) return nullptr;
+
+    std::unique_ptr<FrameCapture> capture(new FrameCapture(device, std::move(file)));
+    capture->extent_ = create_info.imageExtent;
+    capture->frame_limit_ = CaptureFrameLimit();
+
+    uint32_t image_count = 0;
+    if (device.vk.GetSwapchainImagesKHR(device.device, swapchain, &image_count, nullptr) != VK_SUCCESS) {
+        return nullptr;
+    }
+    capture->swapchain_images_.resize(image_count);
+    if (device.vk.GetSwapchainImagesKHR(device.device, swapchain, &image_count,
+                                        capture->swapchain_images_.data()) != VK_SUCCESS) {
+        return nullptr;
+    }
+
+    if (!capture->CreateRing(capture->file_->FrameSize())) return nullptr;
+
+    capture->writer_thread_ = std::thread(&FrameCapture::WriterThread, capture.get());
+    std::cout << "[FRAME_INTERP] Capturing up to " << capture->frame_limit_ << " frames to " << path << std::endl;
+    return capture;
+}
+
+FrameCapture::~FrameCapture() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    // The writer finishes every submitted frame before it exits, so no copy
+    // is in flight past this point
+    if (writer_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        submitted_cv_.notify_all();
+        writer_thread_.join();
+    }
+
+    for (RingFrame& frame : ring_) {
+        vk.DestroySemaphore(device, frame.ready, nullptr);
+    }
+    vk.DestroySemaphore(device, timeline_, nullptr);
+    vk.DestroyCommandPool(device, command_pool_, nullptr);
+    vk.DestroyBuffer(device, ring_buffer_, nullptr);
+    vk.FreeMemory(device, ring_memory_, nullptr);
+}
+
+bool FrameCapture::CreateRing(VkDeviceSize frame_size) {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    ring_stride_ = (frame_size + 4095) & ~static_cast<VkDeviceSize>(4095);
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = ring_stride_ * kRingSize;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vk.CreateBuffer(device, &buffer_info, nullptr, &ring_buffer_) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vk.GetBufferMemoryRequirements(device, ring_buffer_, &requirements);
+
+    // The writer reads every byte back; uncached reads are many times slower
+    const VkPhysicalDeviceMemoryProperties& memory = device_.memory_properties;
+    uint32_t memory_type = FindMemoryType(memory, requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    if (memory_type == UINT32_MAX) {
+        memory_type = FindMemoryType(memory, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    }
+    if (memory_type == UINT32_MAX) return false;
+    ring_coherent_ = (memory.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    if (vk.AllocateMemory(device, &allocate_info, nullptr, &ring_memory_) != VK_SUCCESS) return false;
+    if (vk.BindBufferMemory(device, ring_buffer_, ring_memory_, 0) != VK_SUCCESS) return false;
+
+    void* mapped = nullptr;
+    if (vk.MapMemory(device, ring_memory_, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) return false;
+    ring_mapped_ = static_cast<const uint8_t*>(mapped);
+
+    VkSemaphoreTypeCreateInfo type_info{};
+    type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_info.initialValue = 0;
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = &type_info;
+    if (vk.CreateSemaphore(device, &semaphore_info, nullptr, &timeline_) != VK_SUCCESS) return false;
+
+    semaphore_info.pNext = nullptr;
+    for (RingFrame& frame : ring_) {
+        if (vk.CreateSemaphore(device, &semaphore_info, nullptr, &frame.ready) != VK_SUCCESS) return false;
+    }
+    return true;
+}
+
+bool FrameCapture::EnsureCommandBuffers(uint32_t queue_family) {
+    if (command_pool_ != VK_NULL_HANDLE) {
+        // Presents from another family go uncaptured
+        return queue_family == queue_family_;
+    }
+
+    if (queue_family >= device_.queue_families.size() ||
+        !(device_.queue_families[queue_family].queueFlags &
+          (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT))) {
+        return false;
+    }
+
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+    if (vk.CreateCommandPool(device, &pool_info, nullptr, &command_pool_) != VK_SUCCESS) return false;
+    queue_family_ = queue_family;
+
+    std::array<VkCommandBuffer, kRingSize> command_buffers{};
+    VkCommandBufferAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.commandPool = command_pool_;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = kRingSize;
+    if (vk.AllocateCommandBuffers(device, &allocate_info, command_buffers.data()) != VK_SUCCESS) return false;
+
+    for (uint32_t i = 0; i < kRingSize; i++) {
+        // Command buffers made below the loader need its dispatch pointer
+        if (device_.set_device_loader_data(device, command_buffers[i]) != VK_SUCCESS) return false;
+        ring_[i].commands = command_buffers[i];
+    }
+    return true;
+}
+
+void FrameCapture::Record(const RingFrame& frame, VkDeviceSize offset, VkImage image) {
+    const FrameGenerationDispatch& vk = device_.vk;
+    VkCommandBuffer commands = frame.commands;
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vk.BeginCommandBuffer(commands, &begin_info);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = offset;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {extent_.width, extent_.height, 1};
+    vk.CmdCopyImageToBuffer(commands, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ring_buffer_, 1, &region);
+
+    // Hand the image back for its present; the timeline signal makes the
+    // copy available, and the host barrier visible, to the writer
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    VkBufferMemoryBarrier buffer_barrier{};
+    buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    buffer_barrier.buffer = ring_buffer_;
+    buffer_barrier.offset = offset;
+    buffer_barrier.size = ring_stride_;
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                          0, 0, nullptr, 1, &buffer_barrier, 1, &barrier);
+
+    vk.EndCommandBuffer(commands);
+}
+
+const VkPresentInfoKHR* FrameCapture::Capture(VkQueue queue, uint32_t queue_family, std::mutex* queue_mutex,
+                                              const VkPresentInfoKHR* present_info) {
+    uint64_t timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    uint64_t present_number = ++present_count_;
+
+    // submitted_ only changes on this thread
+    if (submitted_ >= frame_limit_) return present_info;
+
+    uint32_t image_index = present_info->pImageIndices[0];
+    bool ring_full;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring_full = submitted_ - consumed_ == kRingSize;
+    }
+    if (ring_full || image_index >= swapchain_images_.size() || !EnsureCommandBuffers(queue_family)) {
+        dropped_frames_++;
+        return present_info;
+    }
+
+    uint64_t sequence = submitted_ + 1;
+    uint32_t ring_index = static_cast<uint32_t>((sequence - 1) % kRingSize);
+    RingFrame& frame = ring_[ring_index];
+    frame.present_number = present_number;
+    frame.timestamp_ns = timestamp_ns;
+    Record(frame, ring_index * ring_stride_, swapchain_images_[image_index]);
+
+    // Wait for whatever the application's present waited for; the present
+    // waits for the copy instead
+    wait_stages_.assign(present_info->waitSemaphoreCount, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    std::array<VkSemaphore, 2> signal_semaphores = {timeline_, frame.ready};
+    std::array<uint64_t, 2> signal_values = {sequence, 0};
+
+    VkTimelineSemaphoreSubmitInfo timeline_info{};
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timeline_info.signalSemaphoreValueCount = static_cast<uint32_t>(signal_values.size());
+    timeline_info.pSignalSemaphoreValues = signal_values.data();
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = &timeline_info;
+    submit_info.waitSemaphoreCount = present_info->waitSemaphoreCount;
+    submit_info.pWaitSemaphores = present_info->pWaitSemaphores;
+    submit_info.pWaitDstStageMask = wait_stages_.data();
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &frame.commands;
+    submit_info.signalSemaphoreCount = static_cast<uint32_t>(signal_semaphores.size());
+    submit_info.pSignalSemaphores = signal_semaphores.data();
+
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> lock(*queue_mutex);
+        result = device_.vk.QueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE);
+    }
+    if (result != VK_SUCCESS) {
+        dropped_frames_++;
+        return present_info;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        submitted_ = sequence;
+    }
+    submitted_cv_.notify_one();
+
+    present_wait_ = frame.ready;
+    present_info_ = *present_info;
+    present_info_.waitSemaphoreCount = 1;
+    present_info_.pWaitSemaphores = &present_wait_;
+    return &present_info_;
+}
+
+// Writer thread only. Takes frames in submission order, each once the
+// timeline reaches its sequence number.
+void FrameCapture::WriterThread() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+    CaptureFile::LowerWriterPriority();
+
+    for (;;) {
+        uint64_t sequence;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            submitted_cv_.wait(lock, [this] { return stopping_ || submitted_ > consumed_; });
+            if (submitted_ == consumed_) return;
+            sequence = consumed_ + 1;
+        }
+
+        VkSemaphoreWaitInfo wait_info{};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &timeline_;
+        wait_info.pValues = &sequence;
+        uint32_t ring_index = static_cast<uint32_t>((sequence - 1) % kRingSize);
+        const RingFrame& frame = ring_[ring_index];
+        if (vk.WaitSemaphores(device, &wait_info, UINT64_MAX) == VK_SUCCESS) {
+            VkDeviceSize offset = ring_index * ring_stride_;
+            if (!ring_coherent_) {
+                VkMappedMemoryRange range{};
+                range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+                range.memory = ring_memory_;
+                range.offset = offset;
+                range.size = ring_stride_;
+                vk.InvalidateMappedMemoryRanges(device, 1, &range);
+            }
+            file_->Write(frame.present_number, frame.timestamp_ns, ring_mapped_ + offset);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            consumed_ = sequence;
+        }
+        consumed_cv_.notify_all();
+    }
+}
+
+void FrameCapture::Drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    consumed_cv_.wait(lock, [this] { return consumed_ == submitted_; });
+}
+
+void FrameCapture::PrintReport(std::ostream& out) {
+    Drain();
+    out << "[FRAME_INTERP] Capture: " << file_->Count() << " frames written to " << file_->Path() << ", "
+        << dropped_frames_ << " dropped" << std::endl;
+}
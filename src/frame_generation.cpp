@@ -0,0 +1,1164 @@
+#include "frame_generation.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Compiled from shaders/*.comp at build time
+static const uint32_t kFrameBlendSpirv[] = {
+#include "frame_blend.comp.spv.inc"
+};
+static const uint32_t kLumaHistogramSpirv[] = {
+#include "luma_histogram.comp.spv.inc"
+};
+static const uint32_t kSceneChangeSpirv[] = {
+#include "scene_change.comp.spv.inc"
+};
+
+// The SceneChange block of the three shaders: two 64-bin histograms, the
+// cut flag for the blend, then one result per slot for the host
+static constexpr VkDeviceSize kSceneCutOffset = 2 * SceneChangeDetector::kBins * sizeof(uint32_t);
+static constexpr VkDeviceSize kSceneResultsOffset = kSceneCutOffset + sizeof(uint32_t);
+static constexpr uint32_t kSceneCutBit = 1u << 31;
+
+// Push constants shared by the blend, histogram and compare passes
+struct PassConstants {
+    float blend_weight;
+    uint32_t current;      // Histogram the frame is counted into
+    uint32_t slot;         // Where its result goes
+    uint32_t threshold;    // UINT32_MAX: no previous frame to compare with
+    uint32_t blue_first;
+};
+
+// History images use one storage-capable format. Swapchain formats with the
+// same 32-bit texel copy into it byte for byte; the blend is per channel, so
+// the channel order never matters.
+static constexpr VkFormat kPoolFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+static bool IsPoolCompatibleFormat(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+    case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// The software backend copies texels as they are, so it takes any 32-bit
+// layout it has an average kernel for
+static bool SoftwareFormatFor(VkFormat format, SoftwareFormat* software_format) {
+    switch (format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+    case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+        *software_format = SoftwareFormat::Rgba8;
+        return true;
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        *software_format = SoftwareFormat::Bgra8;
+        return true;
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+        *software_format = SoftwareFormat::Rgb10A2;
+        return true;
+    case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+        *software_format = SoftwareFormat::Bgr10A2;
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool IsBlueFirst(VkFormat format) {
+    return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB ||
+           format == VK_FORMAT_A2R10G10B10_UNORM_PACK32;
+}
+
+static bool EnvFlag(const char* name, bool default_value) {
+    const char* value = std::getenv(name);
+    if (!value || !*value) return default_value;
+    return std::strcmp(value, "0") != 0;
+}
+
+static bool GenerationEnabled() {
+    static const bool enabled = EnvFlag("FRAME_INTERP_GENERATE", true);
+    return enabled;
+}
+
+static bool ShowPreviousFrame() {
+    static const bool show_previous = EnvFlag("FRAME_INTERP_SHOW_PREVIOUS", false);
+    return show_previous;
+}
+
+static bool SoftwareWarp() {
+    static const bool warp = EnvFlag("FRAME_INTERP_SOFTWARE_WARP", false);
+    return warp;
+}
+
+// A CPU device would run the blend shader on the same cores, without the
+// tiling; a device with no compute queue can't run it at all
+static FrameGenerationBackend SelectBackend(const FrameGenerationDevice& device) {
+    const char* forced = std::getenv("FRAME_INTERP_BACKEND");
+    if (forced && std::strcmp(forced, "compute") == 0) return FrameGenerationBackend::Compute;
+    if (forced && std::strcmp(forced, "software") == 0) return FrameGenerationBackend::Software;
+
+    if (device.device_type == VK_PHYSICAL_DEVICE_TYPE_CPU) return FrameGenerationBackend::Software;
+    for (const VkQueueFamilyProperties& family : device.queue_families) {
+        if (family.queueFlags & VK_QUEUE_COMPUTE_BIT) return FrameGenerationBackend::Compute;
+    }
+    return FrameGenerationBackend::Software;
+}
+
+uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties& memory, uint32_t type_bits,
+                        VkMemoryPropertyFlags flags) {
+    for (uint32_t i = 0; i < memory.memoryTypeCount; i++) {
+        if ((type_bits & (1u << i)) && (memory.memoryTypes[i].propertyFlags & flags) == flags) return i;
+    }
+    return UINT32_MAX;
+}
+
+static const VkImageSubresourceRange kColorRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+static VkImageMemoryBarrier ImageBarrier(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+                                         VkAccessFlags src_access, VkAccessFlags dst_access) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = kColorRange;
+    return barrier;
+}
+
+static VkBufferMemoryBarrier BufferBarrier(VkBuffer buffer, VkAccessFlags src_access, VkAccessFlags dst_access,
+                                           VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+    return barrier;
+}
+
+void LoadFrameGenerationDispatch(FrameGenerationDispatch* dispatch, VkDevice device, PFN_vkGetDeviceProcAddr gdpa) {
+#define FRAME_GENERATION_LOAD(name) dispatch->name = reinterpret_cast<PFN_vk##name>(gdpa(device, "vk" #name));
+    FRAME_GENERATION_DEVICE_FUNCTIONS(FRAME_GENERATION_LOAD)
+#undef FRAME_GENERATION_LOAD
+    if (!dispatch->WaitSemaphores) {
+        dispatch->WaitSemaphores = reinterpret_cast<PFN_vkWaitSemaphores>(gdpa(device, "vkWaitSemaphoresKHR"));
+    }
+}
+
+bool FrameGenerator::PrepareSwapchain(const FrameGenerationDevice& device, VkSwapchainCreateInfoKHR* create_info) {
+    if (!GenerationEnabled()) return false;
+
+    if (create_info->presentMode != VK_PRESENT_MODE_MAILBOX_KHR &&
+        create_info->presentMode != VK_PRESENT_MODE_IMMEDIATE_KHR) {
+        return false;
+    }
+
+    SoftwareFormat software_format;
+    bool format_supported = SelectBackend(device) == FrameGenerationBackend::Compute
+        ? IsPoolCompatibleFormat(create_info->imageFormat)
+        : SoftwareFormatFor(create_info->imageFormat, &software_format);
+    if (!format_supported || create_info->imageArrayLayers != 1) {
+        std::cout << "[FRAME_INTERP] Frame generation off: unsupported swapchain format "
+                  << create_info->imageFormat << std::endl;
+        return false;
+    }
+
+    if (!device.get_surface_capabilities || !device.set_device_loader_data) return false;
+
+    VkSurfaceCapabilitiesKHR capabilities{};
+    if (device.get_surface_capabilities(device.physical_device, create_info->surface, &capabilities) != VK_SUCCESS) {
+        return false;
+    }
+
+    const VkImageUsageFlags needed_usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if ((capabilities.supportedUsageFlags & needed_usage) != needed_usage) {
+        std::cout << "[FRAME_INTERP] Frame generation off: surface lacks transfer usage" << std::endl;
+        return false;
+    }
+
+    // One image beyond what the application asked for, so the synthetic
+    // frame's acquire never competes with the application's
+    uint32_t image_count = create_info->minImageCount + 1;
+    if (capabilities.maxImageCount != 0 && image_count > capabilities.maxImageCount) {
+        std::cout << "[FRAME_INTERP] Frame generation off: no room for an extra swapchain image" << std::endl;
+        return false;
+    }
+
+    create_info->minImageCount = image_count;
+    create_info->imageUsage |= needed_usage;
+    return true;
+}
+
+FrameGenerator::FrameGenerator(const FrameGenerationDevice& device, FrameGenerationBackend backend)
+    : device_(device), backend_(backend) {}
+
+std::unique_ptr<FrameGenerator> FrameGenerator::Create(const FrameGenerationDevice& device, VkSwapchainKHR swapchain,
+                                                       const VkSwapchainCreateInfoKHR& create_info) {
+    FrameGenerationBackend backend = SelectBackend(device);
+    std::unique_ptr<FrameGenerator> generator(new FrameGenerator(device, backend));
+    generator->swapchain_ = swapchain;
+    generator->extent_ = create_info.imageExtent;
+    generator->blend_weight_ = ShowPreviousFrame() ? 0.0f : 0.5f;
+    generator->blue_first_ = IsBlueFirst(create_info.imageFormat);
+
+    uint32_t image_count = 0;
+    if (device.vk.GetSwapchainImagesKHR(device.device, swapchain, &image_count, nullptr) != VK_SUCCESS) {
+        return nullptr;
+    }
+    generator->swapchain_images_.resize(image_count);
+    if (device.vk.GetSwapchainImagesKHR(device.device, swapchain, &image_count,
+                                        generator->swapchain_images_.data()) != VK_SUCCESS) {
+        return nullptr;
+    }
+
+    // Everything is allocated up front; presenting never allocates
+    if (backend == FrameGenerationBackend::Compute) {
+        for (PoolImage& history : generator->history_) {
+            if (!generator->CreatePoolImage(&history)) return nullptr;
+        }
+        if (!generator->CreatePoolImage(&generator->output_)) return nullptr;
+        // Small and read back every frame; both histograms start out empty
+        if (!generator->CreateMappedBuffer(&generator->scene_, kSceneResultsOffset + kSlotCount * sizeof(uint32_t),
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                           VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            return nullptr;
+        }
+        std::memset(generator->scene_.mapped, 0, static_cast<size_t>(kSceneResultsOffset));
+        if (!generator->scene_.coherent) {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = generator->scene_.memory;
+            range.size = VK_WHOLE_SIZE;
+            device.vk.FlushMappedMemoryRanges(device.device, 1, &range);
+        }
+        if (!generator->CreatePipeline()) return nullptr;
+    } else {
+        // Reads back through cached memory where there is any; uncached
+        // reads are many times slower on most hosts
+        if (!generator->CreateStagingRing(&generator->readback_, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                          VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ||
+            !generator->CreateStagingRing(&generator->upload_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            return nullptr;
+        }
+
+        SoftwareFormat format = SoftwareFormat::Rgba8;
+        SoftwareFormatFor(create_info.imageFormat, &format);
+        SoftwareInterpolatorOptions options;
+        options.mode = ShowPreviousFrame() ? SoftwareInterpolationMode::Previous
+                     : SoftwareWarp()      ? SoftwareInterpolationMode::Warp
+                                           : SoftwareInterpolationMode::Blend;
+        generator->interpolator_ = SoftwareInterpolator::Create(generator->extent_.width, generator->extent_.height,
+                                                                format, options);
+        if (!generator->interpolator_) return nullptr;
+        generator->scene_detector_.reset(
+            new SceneChangeDetector(generator->extent_.width, generator->extent_.height, format));
+    }
+    if (!generator->CreateSlots()) return nullptr;
+
+    FrameGenerator* present_target = generator.get();
+    generator->present_thread_ = std::thread([present_target] { present_target->PresentThread(); });
+
+    std::cout << "[FRAME_INTERP] Frame generation on: " << image_count << " swapchain images, ";
+    if (backend == FrameGenerationBackend::Compute) {
+        std::cout << (generator->blend_weight_ == 0.0f ? "showing previous frame" : "50% blend") << std::endl;
+    } else {
+        SoftwareInterpolationMode mode = generator->interpolator_->Mode();
+        uint32_t threads = generator->interpolator_->ThreadCount();
+        std::cout << (mode == SoftwareInterpolationMode::Previous ? "showing previous frame"
+                      : mode == SoftwareInterpolationMode::Warp   ? "motion-compensated blend"
+                                                                  : "50% blend")
+                  << ", software backend on " << threads << (threads == 1 ? " thread" : " threads") << std::endl;
+    }
+    return generator;
+}
+
+FrameGenerator::~FrameGenerator() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    // Issue whatever is still queued, without waiting for its time
+    if (present_thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex_);
+            stopping_ = true;
+        }
+        jobs_ready_.notify_all();
+        present_thread_.join();
+    }
+
+    // Let in-flight copies and blends finish before their images go away
+    std::array<VkFence, 2 * kSlotCount> fences;
+    uint32_t fence_count = 0;
+    for (const Slot& slot : slots_) {
+        if (slot.fence != VK_NULL_HANDLE) fences[fence_count++] = slot.fence;
+        if (slot.upload_fence != VK_NULL_HANDLE) fences[fence_count++] = slot.upload_fence;
+    }
+    if (fence_count > 0) {
+        vk.WaitForFences(device, fence_count, fences.data(), VK_TRUE, UINT64_MAX);
+    }
+
+    for (Slot& slot : slots_) {
+        vk.DestroyFence(device, slot.fence, nullptr);
+        vk.DestroySemaphore(device, slot.acquired, nullptr);
+        vk.DestroySemaphore(device, slot.synthetic_ready, nullptr);
+        vk.DestroySemaphore(device, slot.real_ready, nullptr);
+        vk.DestroyFence(device, slot.upload_fence, nullptr);
+    }
+    vk.DestroyCommandPool(device, command_pool_, nullptr);
+    vk.DestroyCommandPool(device, upload_command_pool_, nullptr);
+
+    // Freeing the memory unmaps it
+    for (MappedBuffer* mapped_buffer : {static_cast<MappedBuffer*>(&readback_), static_cast<MappedBuffer*>(&upload_),
+                                        &scene_}) {
+        vk.DestroyBuffer(device, mapped_buffer->buffer, nullptr);
+        vk.FreeMemory(device, mapped_buffer->memory, nullptr);
+    }
+
+    vk.DestroyDescriptorPool(device, descriptor_pool_, nullptr);
+    for (VkPipeline pipeline : {pipeline_, histogram_pipeline_, compare_pipeline_}) {
+        vk.DestroyPipeline(device, pipeline, nullptr);
+    }
+    vk.DestroyPipelineLayout(device, pipeline_layout_, nullptr);
+    vk.DestroyDescriptorSetLayout(device, set_layout_, nullptr);
+    for (VkShaderModule shader : {shader_, histogram_shader_, compare_shader_}) {
+        vk.DestroyShaderModule(device, shader, nullptr);
+    }
+
+    for (PoolImage* pool_image : {&history_[0], &history_[1], &output_}) {
+        vk.DestroyImageView(device, pool_image->view, nullptr);
+        vk.DestroyImage(device, pool_image->image, nullptr);
+        vk.FreeMemory(device, pool_image->memory, nullptr);
+    }
+}
+
+bool FrameGenerator::CreatePoolImage(PoolImage* pool_image) {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = kPoolFormat;
+    image_info.extent = {extent_.width, extent_.height, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vk.CreateImage(device, &image_info, nullptr, &pool_image->image) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vk.GetImageMemoryRequirements(device, pool_image->image, &requirements);
+
+    uint32_t memory_type = FindMemoryType(device_.memory_properties, requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (memory_type == UINT32_MAX) return false;
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    if (vk.AllocateMemory(device, &allocate_info, nullptr, &pool_image->memory) != VK_SUCCESS) return false;
+    if (vk.BindImageMemory(device, pool_image->image, pool_image->memory, 0) != VK_SUCCESS) return false;
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = pool_image->image;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = kPoolFormat;
+    view_info.subresourceRange = kColorRange;
+    return vk.CreateImageView(device, &view_info, nullptr, &pool_image->view) == VK_SUCCESS;
+}
+
+bool FrameGenerator::CreatePipeline() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    // previous, current, blended, scene buffer
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i < 3 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo set_layout_info{};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    set_layout_info.pBindings = bindings.data();
+    if (vk.CreateDescriptorSetLayout(device, &set_layout_info, nullptr, &set_layout_) != VK_SUCCESS) return false;
+
+    VkPushConstantRange push_range = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PassConstants)};
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &set_layout_;
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_range;
+    if (vk.CreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS) return false;
+
+    auto create_pipeline = [&](const uint32_t* code, size_t code_size, VkShaderModule* shader, VkPipeline* pipeline) {
+        VkShaderModuleCreateInfo shader_info{};
+        shader_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        shader_info.codeSize = code_size;
+        shader_info.pCode = code;
+        if (vk.CreateShaderModule(device, &shader_info, nullptr, shader) != VK_SUCCESS) return false;
+
+        VkComputePipelineCreateInfo pipeline_info{};
+        pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_info.stage.module = *shader;
+        pipeline_info.stage.pName = "main";
+        pipeline_info.layout = pipeline_layout_;
+        return vk.CreateComputePipelines(device, device_.pipeline_cache, 1, &pipeline_info, nullptr, pipeline) == VK_SUCCESS;
+    };
+    if (!create_pipeline(kFrameBlendSpirv, sizeof(kFrameBlendSpirv), &shader_, &pipeline_) ||
+        !create_pipeline(kLumaHistogramSpirv, sizeof(kLumaHistogramSpirv), &histogram_shader_, &histogram_pipeline_) ||
+        !create_pipeline(kSceneChangeSpirv, sizeof(kSceneChangeSpirv), &compare_shader_, &compare_pipeline_)) {
+        return false;
+    }
+
+    std::array<VkDescriptorPoolSize, 2> pool_sizes = {{
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 3 * 2},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 * 2},
+    }};
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = 2;
+    pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+    pool_info.pPoolSizes = pool_sizes.data();
+    if (vk.CreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool_) != VK_SUCCESS) return false;
+
+    std::array<VkDescriptorSetLayout, 2> set_layouts = {set_layout_, set_layout_};
+    VkDescriptorSetAllocateInfo set_info{};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = descriptor_pool_;
+    set_info.descriptorSetCount = 2;
+    set_info.pSetLayouts = set_layouts.data();
+    if (vk.AllocateDescriptorSets(device, &set_info, descriptor_sets_.data()) != VK_SUCCESS) return false;
+
+    // Set i blends into output_ with history_[i] as the current frame, so
+    // the sets never change after this
+    VkDescriptorBufferInfo scene_info = {scene_.buffer, 0, VK_WHOLE_SIZE};
+    for (uint32_t current = 0; current < 2; current++) {
+        std::array<VkDescriptorImageInfo, 3> image_infos = {{
+            {VK_NULL_HANDLE, history_[current ^ 1].view, VK_IMAGE_LAYOUT_GENERAL},
+            {VK_NULL_HANDLE, history_[current].view, VK_IMAGE_LAYOUT_GENERAL},
+            {VK_NULL_HANDLE, output_.view, VK_IMAGE_LAYOUT_GENERAL},
+        }};
+        std::array<VkWriteDescriptorSet, 4> writes{};
+        for (uint32_t i = 0; i < writes.size(); i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = descriptor_sets_[current];
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = bindings[i].descriptorType;
+            if (i < 3) {
+                writes[i].pImageInfo = &image_infos[i];
+            } else {
+                writes[i].pBufferInfo = &scene_info;
+            }
+        }
+        vk.UpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+    return true;
+}
+
+bool FrameGenerator::CreateMappedBuffer(MappedBuffer* mapped_buffer, VkDeviceSize size, VkBufferUsageFlags usage,
+                                        VkMemoryPropertyFlags preferred) {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = size;
+    buffer_info.usage = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vk.CreateBuffer(device, &buffer_info, nullptr, &mapped_buffer->buffer) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vk.GetBufferMemoryRequirements(device, mapped_buffer->buffer, &requirements);
+
+    const VkPhysicalDeviceMemoryProperties& memory = device_.memory_properties;
+    uint32_t memory_type = FindMemoryType(memory, requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | preferred);
+    if (memory_type == UINT32_MAX) {
+        memory_type = FindMemoryType(memory, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    }
+    if (memory_type == UINT32_MAX) return false;
+    mapped_buffer->coherent =
+        (memory.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    if (vk.AllocateMemory(device, &allocate_info, nullptr, &mapped_buffer->memory) != VK_SUCCESS) return false;
+    if (vk.BindBufferMemory(device, mapped_buffer->buffer, mapped_buffer->memory, 0) != VK_SUCCESS) return false;
+
+    void* mapped = nullptr;
+    if (vk.MapMemory(device, mapped_buffer->memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) return false;
+    mapped_buffer->mapped = static_cast<uint8_t*>(mapped);
+    return true;
+}
+
+bool FrameGenerator::CreateStagingRing(StagingRing* ring, VkBufferUsageFlags usage, VkMemoryPropertyFlags preferred) {
+    // Tightly packed 32-bit texels; page-aligned frames
+    VkDeviceSize frame_size = static_cast<VkDeviceSize>(extent_.width) * extent_.height * 4;
+    ring->stride = (frame_size + 4095) & ~static_cast<VkDeviceSize>(4095);
+    return CreateMappedBuffer(ring, ring->stride * kSlotCount, usage, preferred);
+}
+
+bool FrameGenerator::CreateSlots() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    VkFenceCreateInfo fence_info{};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (Slot& slot : slots_) {
+        if (vk.CreateFence(device, &fence_info, nullptr, &slot.fence) != VK_SUCCESS ||
+            vk.CreateSemaphore(device, &semaphore_info, nullptr, &slot.acquired) != VK_SUCCESS ||
+            vk.CreateSemaphore(device, &semaphore_info, nullptr, &slot.synthetic_ready) != VK_SUCCESS ||
+            vk.CreateSemaphore(device, &semaphore_info, nullptr, &slot.real_ready) != VK_SUCCESS) {
+            return false;
+        }
+        if (backend_ == FrameGenerationBackend::Software &&
+            vk.CreateFence(device, &fence_info, nullptr, &slot.upload_fence) != VK_SUCCESS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FrameGenerator::EnsureCommandBuffers(VkQueue queue, uint32_t queue_family) {
+    if (command_pool_ != VK_NULL_HANDLE) {
+        // The history pool's barriers only order work on one queue
+        return queue == queue_;
+    }
+
+    // The software backend only copies, which any graphics or compute
+    // queue can do as well
+    VkQueueFlags needed = backend_ == FrameGenerationBackend::Compute
+        ? VK_QUEUE_COMPUTE_BIT
+        : VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+    if (queue_family >= device_.queue_families.size() ||
+        !(device_.queue_families[queue_family].queueFlags & needed)) {
+        return false;
+    }
+
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    // One buffer per slot from `pool`; uploads get a pool of their own, as
+    // the two threads record at the same time
+    auto create_buffers = [&](VkCommandPool* pool, VkCommandBuffer Slot::*member) {
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        pool_info.queueFamilyIndex = queue_family;
+        if (vk.CreateCommandPool(device, &pool_info, nullptr, pool) != VK_SUCCESS) return false;
+
+        std::array<VkCommandBuffer, kSlotCount> command_buffers{};
+        VkCommandBufferAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = *pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocate_info.commandBufferCount = kSlotCount;
+        if (vk.AllocateCommandBuffers(device, &allocate_info, command_buffers.data()) != VK_SUCCESS) return false;
+
+        for (uint32_t i = 0; i < kSlotCount; i++) {
+            // Command buffers made below the loader need its dispatch pointer
+            if (device_.set_device_loader_data(device, command_buffers[i]) != VK_SUCCESS) return false;
+            slots_[i].*member = command_buffers[i];
+        }
+        return true;
+    };
+
+    if (!create_buffers(&command_pool_, &Slot::commands)) return false;
+    if (backend_ == FrameGenerationBackend::Software &&
+        !create_buffers(&upload_command_pool_, &Slot::upload_commands)) {
+        return false;
+    }
+
+    queue_ = queue;
+    return true;
+}
+
+void FrameGenerator::RecordFrame(const Slot& slot, uint32_t slot_index, VkImage app_image, VkImage synthetic_image,
+                                 bool generate, bool has_previous) {
+    const FrameGenerationDispatch& vk = device_.vk;
+    VkCommandBuffer commands = slot.commands;
+
+    uint32_t current = static_cast<uint32_t>(captured_frames_ & 1);
+    VkImageLayout pool_layout = pool_initialized_ ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vk.BeginCommandBuffer(commands, &begin_info);
+
+    // Capture: application image -> history_[current]. The history slot was
+    // last read by the blend two frames ago.
+    std::array<VkImageMemoryBarrier, 3> barriers = {
+        ImageBarrier(app_image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     0, VK_ACCESS_TRANSFER_READ_BIT),
+        ImageBarrier(history_[current].image, pool_layout, VK_IMAGE_LAYOUT_GENERAL,
+                     0, VK_ACCESS_TRANSFER_WRITE_BIT),
+        ImageBarrier(history_[current ^ 1].image, pool_layout, VK_IMAGE_LAYOUT_GENERAL, 0, 0),
+    };
+    // The other history image only needs its first layout transition
+    uint32_t barrier_count = pool_initialized_ ? 2 : 3;
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, barrier_count, barriers.data());
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.extent = {extent_.width, extent_.height, 1};
+    vk.CmdCopyImage(commands, app_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    history_[current].image, VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+    // Hand the application image back for its present; make the capture
+    // visible to the blend, which overwrites output_ after its last copy-out
+    barriers = {
+        ImageBarrier(app_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                     VK_ACCESS_TRANSFER_READ_BIT, 0),
+        ImageBarrier(history_[current].image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                     VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT),
+        ImageBarrier(output_.image, pool_layout, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT),
+    };
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+    pool_initialized_ = true;
+
+    // Scene change: histogram the capture, then compare it with the previous
+    // frame's. Every captured frame goes through both, so the histogram the
+    // compare clears is always the one the next frame counts into. The
+    // last frame's compare and blend used the scene buffer before this.
+    PassConstants constants = {blend_weight_, current, slot_index, UINT32_MAX, blue_first_ ? 1u : 0u};
+    if (has_previous) {
+        constants.threshold = SceneChangeDetector::CutThreshold(extent_.width, extent_.height);
+    }
+    vk.CmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1,
+                             &descriptor_sets_[current], 0, nullptr);
+    vk.CmdPushConstants(commands, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+
+    const VkAccessFlags shader_access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    VkBufferMemoryBarrier scene_barrier = BufferBarrier(scene_.buffer, shader_access, shader_access);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          0, 0, nullptr, 1, &scene_barrier, 0, nullptr);
+    vk.CmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, histogram_pipeline_);
+    uint32_t samples_x = (extent_.width + SceneChangeDetector::kSampleStepX - 1) / SceneChangeDetector::kSampleStepX;
+    uint32_t samples_y = (extent_.height + SceneChangeDetector::kSampleStepY - 1) / SceneChangeDetector::kSampleStepY;
+    vk.CmdDispatch(commands, (samples_x + 15) / 16, (samples_y + 15) / 16, 1);
+
+    scene_barrier = BufferBarrier(scene_.buffer, VK_ACCESS_SHADER_WRITE_BIT, shader_access);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          0, 0, nullptr, 1, &scene_barrier, 0, nullptr);
+    vk.CmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, compare_pipeline_);
+    vk.CmdDispatch(commands, 1, 1, 1);
+
+    // The cut flag for the blend; the result for the host after the fence
+    scene_barrier = BufferBarrier(scene_.buffer, VK_ACCESS_SHADER_WRITE_BIT,
+                                  VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                          0, 0, nullptr, 1, &scene_barrier, 0, nullptr);
+
+    if (generate) {
+        vk.CmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+        vk.CmdDispatch(commands, (extent_.width + 7) / 8, (extent_.height + 7) / 8, 1);
+
+        // Blend result -> the extra swapchain image (contents discarded)
+        barriers = {
+            ImageBarrier(output_.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                         VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT),
+            ImageBarrier(synthetic_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         0, VK_ACCESS_TRANSFER_WRITE_BIT),
+        };
+        vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                              VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers.data());
+
+        vk.CmdCopyImage(commands, output_.image, VK_IMAGE_LAYOUT_GENERAL,
+                        synthetic_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        barriers[0] = ImageBarrier(synthetic_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                   VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+        vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                              0, 0, nullptr, 0, nullptr, 1, barriers.data());
+    }
+
+    vk.EndCommandBuffer(commands);
+}
+
+void FrameGenerator::RecordReadback(const Slot& slot, uint32_t slot_index, VkImage app_image) {
+    const FrameGenerationDispatch& vk = device_.vk;
+    VkCommandBuffer commands = slot.commands;
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vk.BeginCommandBuffer(commands, &begin_info);
+
+    // Application image -> this slot's frame of the readback ring, which the
+    // present thread finished reading before the slot could be reused
+    VkImageMemoryBarrier barrier = ImageBarrier(app_image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0, VK_ACCESS_TRANSFER_READ_BIT);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = slot_index * readback_.stride;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {extent_.width, extent_.height, 1};
+    vk.CmdCopyImageToBuffer(commands, app_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback_.buffer, 1, &region);
+
+    // Hand the application image back for its present; make the copy
+    // visible to the host once the fence signals
+    barrier = ImageBarrier(app_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                           VK_ACCESS_TRANSFER_READ_BIT, 0);
+    VkBufferMemoryBarrier buffer_barrier = BufferBarrier(readback_.buffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                                         VK_ACCESS_HOST_READ_BIT, region.bufferOffset,
+                                                         readback_.stride);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                          0, 0, nullptr, 1, &buffer_barrier, 1, &barrier);
+
+    vk.EndCommandBuffer(commands);
+}
+
+// Present thread only. Waits for the job's readback and feeds it to the
+// scene change detector and the interpolator; for a generated frame, fills
+// and submits the upload into the extra swapchain image, which signals the
+// slot's synthetic_ready. Across a cut the previous frame is uploaded as is.
+VkResult FrameGenerator::UploadSynthetic(const PresentJob& job) {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+    const Slot& slot = slots_[job.slot];
+
+    VkResult result = vk.WaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+    if (result != VK_SUCCESS) return result;
+
+    // Whole-ring flushes and invalidates: the ranges need no atom
+    // alignment, and the other frames' bytes are unchanged by either
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.size = VK_WHOLE_SIZE;
+    if (!readback_.coherent) {
+        range.memory = readback_.memory;
+        vk.InvalidateMappedMemoryRanges(device, 1, &range);
+    }
+
+    size_t row_pitch = static_cast<size_t>(extent_.width) * 4;
+    const uint8_t* current = readback_.mapped + job.slot * readback_.stride;
+    if (!job.has_previous) {
+        interpolator_->Reset();
+        scene_detector_->Reset();
+    }
+    bool cut = scene_detector_->AddFrame(current, row_pitch);
+    if (cut) {
+        scene_changes_++;
+        interpolator_->Reset();
+    }
+    interpolator_->AddFrame(current, row_pitch);
+    if (!job.generate) return VK_SUCCESS;
+
+    // The upload from this slot's last use has to be done with its frame
+    result = vk.WaitForFences(device, 1, &slot.upload_fence, VK_TRUE, UINT64_MAX);
+    if (result != VK_SUCCESS) return result;
+
+    const uint8_t* previous = readback_.mapped + ((job.slot + kSlotCount - 1) % kSlotCount) * readback_.stride;
+    uint8_t* output = upload_.mapped + job.slot * upload_.stride;
+    if (cut) {
+        interpolator_->Repeat(previous, output, row_pitch);
+    } else {
+        interpolator_->Interpolate(previous, current, output, row_pitch);
+    }
+    if (!upload_.coherent) {
+        range.memory = upload_.memory;
+        vk.FlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    VkCommandBuffer commands = slot.upload_commands;
+    VkImage synthetic_image = swapchain_images_[job.synthetic_index];
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vk.BeginCommandBuffer(commands, &begin_info);
+
+    // Host writes before the submit are visible to it; contents discarded
+    VkImageMemoryBarrier barrier = ImageBarrier(synthetic_image, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = job.slot * upload_.stride;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {extent_.width, extent_.height, 1};
+    vk.CmdCopyBufferToImage(commands, upload_.buffer, synthetic_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            1, &region);
+
+    barrier = ImageBarrier(synthetic_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                           VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vk.EndCommandBuffer(commands);
+
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = job.wait_acquired ? 1 : 0;
+    submit_info.pWaitSemaphores = &slot.acquired;
+    submit_info.pWaitDstStageMask = &wait_stage;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &commands;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &slot.synthetic_ready;
+
+    vk.ResetFences(device, 1, &slot.upload_fence);
+    {
+        std::lock_guard<std::mutex> lock(*job.queue_mutex);
+        result = vk.QueueSubmit(job.queue, 1, &submit_info, slot.upload_fence);
+    }
+    if (result != VK_SUCCESS) {
+        RecoverFailedSubmit(slot, job.queue, job.queue_mutex, slot.upload_fence, true, job.wait_acquired,
+                            job.synthetic_index);
+    }
+    return result;
+}
+
+// After a submit that was to signal `fence` failed. The fence was reset for
+// it and would never signal, leaving the slot unusable and the teardown
+// wait hung, so an empty submit signals it. The same submit consumes the
+// synthetic image's acquire if nothing has waited on it yet, and the image
+// is kept as the spare instead of being lost to the swapchain. If this
+// submit fails too the device is lost, and waits on it return.
+void FrameGenerator::RecoverFailedSubmit(const Slot& slot, VkQueue queue, std::mutex* queue_mutex, VkFence fence,
+                                         bool generate, bool wait_acquired, uint32_t synthetic_index) {
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = wait_acquired ? 1 : 0;
+    submit_info.pWaitSemaphores = &slot.acquired;
+    submit_info.pWaitDstStageMask = &wait_stage;
+    {
+        std::lock_guard<std::mutex> lock(*queue_mutex);
+        device_.vk.QueueSubmit(queue, 1, &submit_info, fence);
+    }
+    if (generate) {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        has_spare_image_ = true;
+        spare_image_ = synthetic_index;
+        spare_fence_ = fence;
+    }
+}
+
+VkResult FrameGenerator::Present(VkQueue queue, uint32_t queue_family, std::mutex* queue_mutex,
+                                 const VkPresentInfoKHR* present_info) {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    PacingDecision timing = pacer_.OnFrame(now);
+
+    uint32_t image_index = present_info->pImageIndices[0];
+    uint32_t slot_index = next_slot_;
+    Slot& slot = slots_[slot_index];
+    bool software = backend_ == FrameGenerationBackend::Software;
+    if (!software) HarvestSceneChanges();
+    bool slot_queued = false;
+    {
+        // The software backend's next slot still reads this slot's readback
+        // as its previous frame until its job is done
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        slot_queued = slot_queued_[slot_index] || (software && slot_queued_[(slot_index + 1) % kSlotCount]);
+    }
+
+    // Never wait on the GPU here: if the slot is still busy (or this is not
+    // a queue the pool can use), present the application's frame alone and
+    // start the history over. Extension structs can't outlive this call, so
+    // presents that carry any go out directly too.
+    if (present_info->pNext != nullptr || image_index >= swapchain_images_.size() ||
+        !EnsureCommandBuffers(queue, queue_family) || slot_queued ||
+        vk.GetFenceStatus(device, slot.fence) != VK_SUCCESS) {
+        skipped_frames_++;
+        history_valid_ = false;
+        pacer_.Resync(now);
+        return PresentDirect(queue, queue_mutex, present_info);
+    }
+
+    // The extra image the synthetic frame goes into; timeout 0 so a full
+    // swapchain costs a skipped synthetic frame rather than a stall. Hitches
+    // skip generation and present the application's frame at once. A spare
+    // left by a failed submit is used first, once its acquire is consumed.
+    bool generate = history_valid_ && timing.generate;
+    uint32_t synthetic_index = 0;
+    bool acquired_pending = false;   // slot.acquired carries synthetic_index's acquire
+    bool has_spare = false;
+    bool spare_ready = false;
+    if (generate) {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        has_spare = has_spare_image_;
+        spare_ready = has_spare && vk.GetFenceStatus(device, spare_fence_) == VK_SUCCESS;
+        if (spare_ready) {
+            synthetic_index = spare_image_;
+            has_spare_image_ = false;
+        }
+    }
+    if (generate && has_spare && !spare_ready) {
+        generate = false;
+        skipped_frames_++;
+    } else if (generate && !spare_ready) {
+        VkResult acquired;
+        {
+            std::lock_guard<std::mutex> lock(swapchain_mutex_);
+            acquired = vk.AcquireNextImageKHR(device, swapchain_, 0, slot.acquired, VK_NULL_HANDLE, &synthetic_index);
+        }
+        if (acquired != VK_SUCCESS && acquired != VK_SUBOPTIMAL_KHR) {
+            generate = false;
+            skipped_frames_++;
+        } else {
+            acquired_pending = true;
+        }
+    }
+
+    // The software backend only reads back here; its synthetic frame is
+    // made and uploaded on the present thread
+    bool synthetic_in_submit = generate && !software;
+    if (software) {
+        RecordReadback(slot, slot_index, swapchain_images_[image_index]);
+    } else {
+        RecordFrame(slot, slot_index, swapchain_images_[image_index],
+                    generate ? swapchain_images_[synthetic_index] : VK_NULL_HANDLE, generate, history_valid_);
+    }
+
+    // Wait for whatever the application's present waited for
+    wait_semaphores_.assign(present_info->pWaitSemaphores,
+                            present_info->pWaitSemaphores + present_info->waitSemaphoreCount);
+    if (synthetic_in_submit && acquired_pending) wait_semaphores_.push_back(slot.acquired);
+    wait_stages_.assign(wait_semaphores_.size(), VK_PIPELINE_STAGE_TRANSFER_BIT);
+    std::array<VkSemaphore, 2> signal_semaphores = {slot.real_ready, slot.synthetic_ready};
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores_.size());
+    submit_info.pWaitSemaphores = wait_semaphores_.data();
+    submit_info.pWaitDstStageMask = wait_stages_.data();
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &slot.commands;
+    submit_info.signalSemaphoreCount = synthetic_in_submit ? 2 : 1;
+    submit_info.pSignalSemaphores = signal_semaphores.data();
+
+    vk.ResetFences(device, 1, &slot.fence);
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> lock(*queue_mutex);
+        result = vk.QueueSubmit(queue, 1, &submit_info, slot.fence);
+    }
+    if (result != VK_SUCCESS) {
+        // The application's frame still goes out, without the layer's work
+        RecoverFailedSubmit(slot, queue, queue_mutex, slot.fence, generate, acquired_pending, synthetic_index);
+        skipped_frames_++;
+        history_valid_ = false;
+        pacer_.Resync(now);
+        return PresentDirect(queue, queue_mutex, present_info);
+    }
+
+    next_slot_ = (next_slot_ + 1) % kSlotCount;
+    slot.scene_pending = !software && history_valid_;
+    captured_frames_++;
+    bool has_previous = history_valid_;
+    history_valid_ = true;
+
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex_);
+        PresentJob& job = jobs_[(job_head_ + job_count_) % kSlotCount];
+        job.queue = queue;
+        job.queue_mutex = queue_mutex;
+        job.slot = slot_index;
+        job.image_index = image_index;
+        job.synthetic_index = synthetic_index;
+        job.generate = generate;
+        job.wait_acquired = acquired_pending;
+        job.has_previous = has_previous;
+        job.timing = timing;
+        slot_queued_[slot_index] = true;
+        job_count_++;
+    }
+    jobs_ready_.notify_one();
+
+    // This frame's present hasn't happened yet; report the last one's
+    result = last_present_result_.exchange(VK_SUCCESS);
+    if (present_info->pResults) present_info->pResults[0] = result;
+    return result;
+}
+
+VkResult FrameGenerator::PresentDirect(VkQueue queue, std::mutex* queue_mutex, const VkPresentInfoKHR* present_info) {
+    // Keep presents in order behind anything already queued
+    WaitIdle();
+
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> queue_lock(*queue_mutex);
+        std::lock_guard<std::mutex> swapchain_lock(swapchain_mutex_);
+        result = device_.vk.QueuePresentKHR(queue, present_info);
+    }
+    real_presents_++;
+    RecordPresented();
+
+    VkResult previous = last_present_result_.exchange(VK_SUCCESS);
+    return result != VK_SUCCESS ? result : previous;
+}
+
+VkResult FrameGenerator::PresentImage(VkQueue queue, std::mutex* queue_mutex, VkSemaphore wait, uint32_t image_index) {
+    VkPresentInfoKHR present_info{};
+    present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    present_info.waitSemaphoreCount = 1;
+    present_info.pWaitSemaphores = &wait;
+    present_info.swapchainCount = 1;
+    present_info.pSwapchains = &swapchain_;
+    present_info.pImageIndices = &image_index;
+
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> queue_lock(*queue_mutex);
+        std::lock_guard<std::mutex> swapchain_lock(swapchain_mutex_);
+        result = device_.vk.QueuePresentKHR(queue, &present_info);
+    }
+    RecordPresented();
+    return result;
+}
+
+void FrameGenerator::RecordPresented() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (last_presented_ != std::chrono::steady_clock::time_point{}) {
+        presented_stats_.Record(std::chrono::duration<float, std::milli>(now - last_presented_).count());
+    }
+    last_presented_ = now;
+}
+
+void FrameGenerator::PresentThread() {
+    std::unique_lock<std::mutex> lock(jobs_mutex_);
+    while (true) {
+        jobs_ready_.wait(lock, [this] { return stopping_ || job_count_ > 0; });
+        if (job_count_ == 0) return;
+        PresentJob job = jobs_[job_head_];
+        bool on_time = !stopping_;
+        lock.unlock();
+
+        const Slot& slot = slots_[job.slot];
+        if (backend_ == FrameGenerationBackend::Software) {
+            VkResult result = UploadSynthetic(job);
+            if (result != VK_SUCCESS) {
+                job.generate = false;
+                last_present_result_ = result;
+            }
+        }
+
+        if (job.generate) {
+            if (on_time) SleepUntilPrecise(job.timing.synthetic_at);
+            VkResult result = PresentImage(job.queue, job.queue_mutex, slot.synthetic_ready, job.synthetic_index);
+            if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+                synthetic_presents_++;
+            } else if (result != VK_ERROR_OUT_OF_DATE_KHR) {
+                last_present_result_ = result;
+            }
+        }
+
+        if (on_time) SleepUntilPrecise(job.timing.real_at);
+        VkResult result = PresentImage(job.queue, job.queue_mutex, slot.real_ready, job.image_index);
+        real_presents_++;
+        if (result != VK_SUCCESS) last_present_result_ = result;
+
+        lock.lock();
+        slot_queued_[job.slot] = false;
+        job_head_ = (job_head_ + 1) % kSlotCount;
+        job_count_--;
+        jobs_done_.notify_all();
+    }
+}
+
+void FrameGenerator::WaitIdle() {
+    std::unique_lock<std::mutex> lock(jobs_mutex_);
+    jobs_done_.wait(lock, [this] { return job_count_ == 0; });
+}
+
+VkResult FrameGenerator::AcquireNextImage(uint64_t timeout, VkSemaphore semaphore, VkFence fence,
+                                          uint32_t* image_index) {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    {
+        std::lock_guard<std::mutex> lock(swapchain_mutex_);
+        VkResult result = vk.AcquireNextImageKHR(device, swapchain_, 0, semaphore, fence, image_index);
+        if (timeout == 0 || (result != VK_NOT_READY && result != VK_TIMEOUT)) return result;
+    }
+
+    // Every free image may be sitting in the present queue; blocking with
+    // the lock held would stall the thread that releases them
+    WaitIdle();
+    std::lock_guard<std::mutex> lock(swapchain_mutex_);
+    return vk.AcquireNextImageKHR(device, swapchain_, timeout, semaphore, fence, image_index);
+}
+
+// Application thread, compute backend. Picks up the results of frames whose
+// fence has signalled since the last call.
+void FrameGenerator::HarvestSceneChanges() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    bool invalidated = scene_.coherent;
+    for (uint32_t i = 0; i < kSlotCount; i++) {
+        Slot& slot = slots_[i];
+        if (!slot.scene_pending || vk.GetFenceStatus(device, slot.fence) != VK_SUCCESS) continue;
+        if (!invalidated) {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = scene_.memory;
+            range.size = VK_WHOLE_SIZE;
+            vk.InvalidateMappedMemoryRanges(device, 1, &range);
+            invalidated = true;
+        }
+
+        uint32_t result;
+        std::memcpy(&result, scene_.mapped + kSceneResultsOffset + i * sizeof(uint32_t), sizeof(result));
+        if (result & kSceneCutBit) scene_changes_++;
+        slot.scene_pending = false;
+    }
+}
+
+void FrameGenerator::PrintReport(std::ostream& out) {
+    WaitIdle();
+    if (backend_ == FrameGenerationBackend::Compute) HarvestSceneChanges();
+    out << "[FRAME_INTERP] Presents: " << real_presents_ << " application, " << synthetic_presents_
+        << " synthetic, " << skipped_frames_ << " frames without a synthetic frame, "
+        << pacer_.Hitches() << " hitches, " << SceneChanges() << " scene cuts" << std::endl;
+    PrintFrameStatsReport(out, presented_stats_.Report(), "presented");
+}
@@ -0,0 +1,641 @@
+#include "frame_hud.h"
+#include "bitmap_font.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Compiled from shaders/frame_hud.comp at build time
+static const uint32_t kFrameHudSpirv[] = {
+#include "frame_hud.comp.spv.inc"
+};
+
+// HUD size in HUD pixels, as laid out by the shader, and its distance from
+// the image's top-right corner
+static constexpr uint32_t kHudWidth = 272;
+static constexpr uint32_t kHudHeight = 104;
+static constexpr uint32_t kHudMargin = 8;
+
+static constexpr uint32_t kHudLines = 2;
+static constexpr uint32_t kHudColumns = 32;
+static constexpr size_t kGraphSamples = decltype(HUDState::frametimes)::kCapacity;
+
+// The HudData block of the shader: the font, then one frame per slot
+struct HudFrameData {
+    float frametimes_ms[kGraphSamples];
+    uint32_t count;
+    float graph_ms;
+    float average_ms;
+    uint32_t text[kHudLines][kHudColumns / 4];
+};
+
+struct HudBufferData {
+    uint32_t font[192];
+    HudFrameData frames[3];
+};
+
+static_assert(kGraphSamples == 128, "frame_hud.comp draws 128 bars");
+static_assert(kBitmapFontGlyphs * 2 <= 192, "font block holds two words per glyph");
+static_assert(sizeof(HudFrameData) == 4 * (128 + 3 + 16), "HudFrameData must match frame_hud.comp");
+
+struct HudParams {
+    uint32_t slot;
+    uint32_t scale;
+    uint32_t blue_first;
+};
+
+// The image is copied as it is stored, so any 8-bit four-channel format
+// whose texels match the HUD image's size will do
+static constexpr VkFormat kHudFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+static bool IsHudCompatibleFormat(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+    case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static const char* PresentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+    case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+    default: return "OTHER";
+    }
+}
+
+static VkImageMemoryBarrier ImageBarrier(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+                                         VkAccessFlags src_access, VkAccessFlags dst_access) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    return barrier;
+}
+
+bool FrameHud::Enabled() {
+    static const bool enabled = []() {
+        const char* value = std::getenv("FRAME_INTERP_HUD");
+        return !value || !*value || std::strcmp(value, "0") != 0;
+    }();
+    return enabled;
+}
+
+bool FrameHud::PrepareSwapchain(const FrameGenerationDevice& device, VkSwapchainCreateInfoKHR* create_info) {
+    if (!Enabled()) return false;
+
+    if (!IsHudCompatibleFormat(create_info->imageFormat) || create_info->imageArrayLayers != 1) {
+        std::cout << "[FRAME_INTERP] HUD off: unsupported swapchain format " << create_info->imageFormat
+                  << std::endl;
+        return false;
+    }
+    if (create_info->imageExtent.width < kHudWidth + kHudMargin ||
+        create_info->imageExtent.height < kHudHeight + kHudMargin) {
+        std::cout << "[FRAME_INTERP] HUD off: swapchain too small" << std::endl;
+        return false;
+    }
+
+    if (!device.get_surface_capabilities || !device.set_device_loader_data) return false;
+
+    VkSurfaceCapabilitiesKHR capabilities{};
+    if (device.get_surface_capabilities(device.physical_device, create_info->surface, &capabilities) != VK_SUCCESS) {
+        return false;
+    }
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if ((capabilities.supportedUsageFlags & usage) != usage) {
+        std::cout << "[FRAME_INTERP] HUD off: surface lacks transfer usage" << std::endl;
+        return false;
+    }
+
+    create_info->imageUsage |= usage;
+    return true;
+}
+
+FrameHud::FrameHud(const FrameGenerationDevice& device) : device_(device) {}
+
+std::unique_ptr<FrameHud> FrameHud::Create(const FrameGenerationDevice& device, VkSwapchainKHR swapchain,
+                                           const VkSwapchainCreateInfoKHR& create_info) {
+    std::unique_ptr<FrameHud> hud(new FrameHud(device));
+    const VkExtent2D& extent = create_info.imageExtent;
+    hud->scale_ = extent.height >= 1440 && extent.width >= 2 * (kHudWidth + kHudMargin) ? 2 : 1;
+    hud->hud_extent_ = {kHudWidth * hud->scale_, kHudHeight * hud->scale_};
+    hud->origin_ = {static_cast<int32_t>(extent.width - hud->hud_extent_.width - kHudMargin * hud->scale_),
+                    static_cast<int32_t>(kHudMargin * hud->scale_), 0};
+    hud->blue_first_ = create_info.imageFormat == VK_FORMAT_B8G8R8A8_UNORM ||
+                       create_info.imageFormat == VK_FORMAT_B8G8R8A8_SRGB;
+
+    uint32_t image_count = 0;
+    if (device.vk.GetSwapchainImagesKHR(device.device, swapchain, &image_count, nullptr) != VK_SUCCESS) {
+        return nullptr;
+    }
+    hud->swapchain_images_.resize(image_count);
+    if (device.vk.GetSwapchainImagesKHR(device.device, swapchain, &image_count,
+                                        hud->swapchain_images_.data()) != VK_SUCCESS) {
+        return nullptr;
+    }
+
+    if (!hud->CreateImage() || !hud->CreateBuffer() || !hud->CreatePipeline() || !hud->CreateSlots()) {
+        return nullptr;
+    }
+    return hud;
+}
+
+FrameHud::~FrameHud() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    std::array<VkFence, kSlotCount> fences{};
+    uint32_t fence_count = 0;
+    for (const Slot& slot : slots_) {
+        if (slot.fence != VK_NULL_HANDLE) fences[fence_count++] = slot.fence;
+    }
+    if (fence_count > 0) vk.WaitForFences(device, fence_count, fences.data(), VK_TRUE, UINT64_MAX);
+
+    for (Slot& slot : slots_) {
+        vk.DestroyFence(device, slot.fence, nullptr);
+        vk.DestroySemaphore(device, slot.ready, nullptr);
+    }
+    vk.DestroyCommandPool(device, command_pool_, nullptr);
+    vk.DestroyQueryPool(device, query_pool_, nullptr);
+    vk.DestroyPipeline(device, pipeline_, nullptr);
+    vk.DestroyShaderModule(device, shader_, nullptr);
+    vk.DestroyDescriptorPool(device, descriptor_pool_, nullptr);
+    vk.DestroyPipelineLayout(device, pipeline_layout_, nullptr);
+    vk.DestroyDescriptorSetLayout(device, set_layout_, nullptr);
+    vk.DestroyBuffer(device, buffer_, nullptr);
+    vk.FreeMemory(device, buffer_memory_, nullptr);
+    vk.DestroyImageView(device, image_view_, nullptr);
+    vk.DestroyImage(device, image_, nullptr);
+    vk.FreeMemory(device, image_memory_, nullptr);
+}
+
+bool FrameHud::CreateImage() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = kHudFormat;
+    image_info.extent = {hud_extent_.width, hud_extent_.height, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vk.CreateImage(device, &image_info, nullptr, &image_) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vk.GetImageMemoryRequirements(device, image_, &requirements);
+
+    uint32_t memory_type = FindMemoryType(device_.memory_properties, requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (memory_type == UINT32_MAX) return false;
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    if (vk.AllocateMemory(device, &allocate_info, nullptr, &image_memory_) != VK_SUCCESS) return false;
+    if (vk.BindImageMemory(device, image_, image_memory_, 0) != VK_SUCCESS) return false;
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = image_;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = kHudFormat;
+    view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    return vk.CreateImageView(device, &view_info, nullptr, &image_view_) == VK_SUCCESS;
+}
+
+bool FrameHud::CreateBuffer() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = sizeof(HudBufferData);
+    buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vk.CreateBuffer(device, &buffer_info, nullptr, &buffer_) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vk.GetBufferMemoryRequirements(device, buffer_, &requirements);
+
+    // Written every frame and read once by the GPU; device-local host
+    // memory keeps the shader's reads off the bus where there is any
+    const VkPhysicalDeviceMemoryProperties& memory = device_.memory_properties;
+    uint32_t memory_type = FindMemoryType(memory, requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (memory_type == UINT32_MAX) {
+        memory_type = FindMemoryType(memory, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    }
+    if (memory_type == UINT32_MAX) return false;
+    buffer_coherent_ = (memory.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    if (vk.AllocateMemory(device, &allocate_info, nullptr, &buffer_memory_) != VK_SUCCESS) return false;
+    if (vk.BindBufferMemory(device, buffer_, buffer_memory_, 0) != VK_SUCCESS) return false;
+
+    void* mapped = nullptr;
+    if (vk.MapMemory(device, buffer_memory_, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) return false;
+    buffer_mapped_ = static_cast<uint8_t*>(mapped);
+
+    // Four font rows to a word, lowest byte first; frames are filled per present
+    HudBufferData* data = reinterpret_cast<HudBufferData*>(buffer_mapped_);
+    std::memset(data, 0, sizeof(HudBufferData));
+    for (uint32_t glyph = 0; glyph < kBitmapFontGlyphs; glyph++) {
+        for (uint32_t row = 0; row < 8; row++) {
+            data->font[glyph * 2 + row / 4] |= static_cast<uint32_t>(kBitmapFont[glyph][row]) << ((row % 4) * 8);
+        }
+    }
+    if (!buffer_coherent_) {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = buffer_memory_;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+        vk.FlushMappedMemoryRanges(device, 1, &range);
+    }
+    return true;
+}
+
+bool FrameHud::CreatePipeline() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    // HUD image, HUD buffer
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo set_layout_info{};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+    set_layout_info.pBindings = bindings.data();
+    if (vk.CreateDescriptorSetLayout(device, &set_layout_info, nullptr, &set_layout_) != VK_SUCCESS) return false;
+
+    VkPushConstantRange push_range = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HudParams)};
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &set_layout_;
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_range;
+    if (vk.CreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS) return false;
+
+    VkShaderModuleCreateInfo shader_info{};
+    shader_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_info.codeSize = sizeof(kFrameHudSpirv);
+    shader_info.pCode = kFrameHudSpirv;
+    if (vk.CreateShaderModule(device, &shader_info, nullptr, &shader_) != VK_SUCCESS) return false;
+
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = shader_;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = pipeline_layout_;
+    if (vk.CreateComputePipelines(device, device_.pipeline_cache, 1, &pipeline_info, nullptr, &pipeline_) != VK_SUCCESS) {
+        return false;
+    }
+
+    std::array<VkDescriptorPoolSize, 2> pool_sizes = {{
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+    }};
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+    pool_info.pPoolSizes = pool_sizes.data();
+    if (vk.CreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool_) != VK_SUCCESS) return false;
+
+    VkDescriptorSetAllocateInfo set_info{};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = descriptor_pool_;
+    set_info.descriptorSetCount = 1;
+    set_info.pSetLayouts = &set_layout_;
+    if (vk.AllocateDescriptorSets(device, &set_info, &descriptor_set_) != VK_SUCCESS) return false;
+
+    // Every slot draws through this set; the slot is a push constant
+    VkDescriptorImageInfo image_info = {VK_NULL_HANDLE, image_view_, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorBufferInfo buffer_info = {buffer_, 0, VK_WHOLE_SIZE};
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = descriptor_set_;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = bindings[i].descriptorType;
+    }
+    writes[0].pImageInfo = &image_info;
+    writes[1].pBufferInfo = &buffer_info;
+    vk.UpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    return true;
+}
+
+bool FrameHud::CreateSlots() {
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    VkFenceCreateInfo fence_info{};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    for (Slot& slot : slots_) {
+        if (vk.CreateFence(device, &fence_info, nullptr, &slot.fence) != VK_SUCCESS ||
+            vk.CreateSemaphore(device, &semaphore_info, nullptr, &slot.ready) != VK_SUCCESS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FrameHud::EnsureCommandBuffers(VkQueue queue, uint32_t queue_family) {
+    if (command_pool_ != VK_NULL_HANDLE) {
+        // The HUD image's barriers only order work on one queue
+        return queue == queue_;
+    }
+
+    if (queue_family >= device_.queue_families.size() ||
+        !(device_.queue_families[queue_family].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+        return false;
+    }
+
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+    if (vk.CreateCommandPool(device, &pool_info, nullptr, &command_pool_) != VK_SUCCESS) return false;
+
+    std::array<VkCommandBuffer, kSlotCount> command_buffers{};
+    VkCommandBufferAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.commandPool = command_pool_;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = kSlotCount;
+    if (vk.AllocateCommandBuffers(device, &allocate_info, command_buffers.data()) != VK_SUCCESS) return false;
+
+    for (uint32_t i = 0; i < kSlotCount; i++) {
+        // Command buffers made below the loader need its dispatch pointer
+        if (device_.set_device_loader_data(device, command_buffers[i]) != VK_SUCCESS) return false;
+        slots_[i].commands = command_buffers[i];
+    }
+
+    // Without timestamps the HUD still draws, and shows only its CPU cost
+    uint32_t valid_bits = device_.queue_families[queue_family].timestampValidBits;
+    if (valid_bits > 0 && device_.timestamp_period > 0.0f) {
+        VkQueryPoolCreateInfo query_info{};
+        query_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        query_info.queryCount = 2 * kSlotCount;
+        if (vk.CreateQueryPool(device, &query_info, nullptr, &query_pool_) == VK_SUCCESS) {
+            timestamp_mask_ = valid_bits >= 64 ? UINT64_MAX : (uint64_t(1) << valid_bits) - 1;
+        } else {
+            query_pool_ = VK_NULL_HANDLE;
+        }
+    }
+
+    queue_ = queue;
+    return true;
+}
+
+// The slot's fence has signalled, so its timestamps are ready if the device
+// wrote them at all
+void FrameHud::ReadTimestamps(uint32_t slot_index) {
+    Slot& slot = slots_[slot_index];
+    if (!slot.timed) return;
+    slot.timed = false;
+
+    std::array<uint64_t, 2> ticks{};
+    if (device_.vk.GetQueryPoolResults(device_.device, query_pool_, slot_index * 2, 2, sizeof(ticks), ticks.data(),
+                                       sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return;
+    }
+    uint64_t elapsed = (ticks[1] - ticks[0]) & timestamp_mask_;
+    double gpu_ms = static_cast<double>(elapsed) * device_.timestamp_period * 1e-6;
+    gpu_ms_ = gpu_samples_ == 0 ? gpu_ms : gpu_ms_ * 0.9 + gpu_ms * 0.1;
+    gpu_total_ms_ += gpu_ms;
+    gpu_samples_++;
+}
+
+void FrameHud::WriteFrame(uint32_t slot_index, const HUDState& hud) {
+    HudFrameData& frame = reinterpret_cast<HudBufferData*>(buffer_mapped_)->frames[slot_index];
+
+    size_t count = hud.frametimes.Size();
+    for (size_t i = 0; i < count; i++) {
+        frame.frametimes_ms[i] = hud.frametimes[i];
+    }
+    FrameTimeStats stats = hud.frametimes.Stats();
+    frame.count = static_cast<uint32_t>(count);
+    frame.average_ms = stats.avg;
+    frame.graph_ms = std::max(std::max(stats.max, 2.0f * stats.avg), 1.0f);
+
+    char lines[kHudLines][kHudColumns + 1];
+    double fps = stats.avg > 0.0f ? 1000.0 / stats.avg : 0.0;
+    snprintf(lines[0], sizeof(lines[0]), "%5.1f FPS %6.2f ms %s", fps, hud.currentFrametime,
+             PresentModeName(hud.currentPresentMode));
+    if (query_pool_ != VK_NULL_HANDLE) {
+        snprintf(lines[1], sizeof(lines[1]), "HUD gpu %.3f ms cpu %.3f ms", gpu_ms_, cpu_ms_);
+    } else {
+        snprintf(lines[1], sizeof(lines[1]), "HUD cpu %.3f ms", cpu_ms_);
+    }
+
+    std::memset(frame.text, 0, sizeof(frame.text));
+    for (uint32_t line = 0; line < kHudLines; line++) {
+        for (uint32_t column = 0; column < kHudColumns && lines[line][column]; column++) {
+            frame.text[line][column / 4] |=
+                static_cast<uint32_t>(static_cast<uint8_t>(lines[line][column])) << ((column % 4) * 8);
+        }
+    }
+
+    if (!buffer_coherent_) {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = buffer_memory_;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+        device_.vk.FlushMappedMemoryRanges(device_.device, 1, &range);
+    }
+}
+
+void FrameHud::Record(const Slot& slot, uint32_t slot_index, VkImage image) {
+    const FrameGenerationDispatch& vk = device_.vk;
+    VkCommandBuffer commands = slot.commands;
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vk.BeginCommandBuffer(commands, &begin_info);
+
+    if (query_pool_ != VK_NULL_HANDLE) {
+        vk.CmdResetQueryPool(commands, query_pool_, slot_index * 2, 2);
+        vk.CmdWriteTimestamp(commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool_, slot_index * 2);
+    }
+
+    // The HUD image is overwritten whole each frame, so its contents never
+    // need keeping; the previous frame's copy out only has to finish first
+    std::array<VkImageMemoryBarrier, 2> barriers = {
+        ImageBarrier(image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     0, VK_ACCESS_TRANSFER_READ_BIT),
+        ImageBarrier(image_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT),
+    };
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.srcOffset = origin_;
+    region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.extent = {hud_extent_.width, hud_extent_.height, 1};
+    vk.CmdCopyImage(commands, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image_, VK_IMAGE_LAYOUT_GENERAL,
+                    1, &region);
+
+    barriers[0] = ImageBarrier(image_, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                               VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, barriers.data());
+
+    HudParams params = {slot_index, scale_, blue_first_ ? 1u : 0u};
+    vk.CmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+    vk.CmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1,
+                             &descriptor_set_, 0, nullptr);
+    vk.CmdPushConstants(commands, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+    vk.CmdDispatch(commands, (hud_extent_.width + 7) / 8, (hud_extent_.height + 7) / 8, 1);
+
+    barriers = {
+        ImageBarrier(image_, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                     VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT),
+        ImageBarrier(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     0, VK_ACCESS_TRANSFER_WRITE_BIT),
+    };
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+                          static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    region.srcOffset = {0, 0, 0};
+    region.dstOffset = origin_;
+    vk.CmdCopyImage(commands, image_, VK_IMAGE_LAYOUT_GENERAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    1, &region);
+
+    barriers[0] = ImageBarrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                               VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          0, 0, nullptr, 0, nullptr, 1, barriers.data());
+
+    if (query_pool_ != VK_NULL_HANDLE) {
+        vk.CmdWriteTimestamp(commands, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool_, slot_index * 2 + 1);
+    }
+
+    vk.EndCommandBuffer(commands);
+}
+
+const VkPresentInfoKHR* FrameHud::Draw(VkQueue queue, uint32_t queue_family, std::mutex* queue_mutex,
+                                       const HUDState& hud, const VkPresentInfoKHR* present_info) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    VkDevice device = device_.device;
+    const FrameGenerationDispatch& vk = device_.vk;
+
+    uint32_t image_index = present_info->pImageIndices[0];
+    uint32_t slot_index = next_slot_;
+    Slot& slot = slots_[slot_index];
+    if (image_index >= swapchain_images_.size() || !EnsureCommandBuffers(queue, queue_family) ||
+        vk.GetFenceStatus(device, slot.fence) != VK_SUCCESS) {
+        skipped_frames_++;
+        return present_info;
+    }
+    ReadTimestamps(slot_index);
+
+    WriteFrame(slot_index, hud);
+    vk.ResetCommandBuffer(slot.commands, 0);
+    Record(slot, slot_index, swapchain_images_[image_index]);
+
+    // Wait for whatever the application's present waited for; the present
+    // waits for the HUD instead
+    wait_stages_.assign(present_info->waitSemaphoreCount, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = present_info->waitSemaphoreCount;
+    submit_info.pWaitSemaphores = present_info->pWaitSemaphores;
+    submit_info.pWaitDstStageMask = wait_stages_.data();
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &slot.commands;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &slot.ready;
+
+    vk.ResetFences(device, 1, &slot.fence);
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> lock(*queue_mutex);
+        result = vk.QueueSubmit(queue, 1, &submit_info, slot.fence);
+    }
+    if (result != VK_SUCCESS) {
+        // The fence was reset for a submit that didn't happen; an empty one
+        // signals it so the slot comes back and teardown doesn't wait forever
+        VkSubmitInfo empty_submit{};
+        empty_submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        {
+            std::lock_guard<std::mutex> lock(*queue_mutex);
+            vk.QueueSubmit(queue, 1, &empty_submit, slot.fence);
+        }
+        skipped_frames_++;
+        return present_info;
+    }
+    slot.timed = query_pool_ != VK_NULL_HANDLE;
+    next_slot_ = (next_slot_ + 1) % kSlotCount;
+    drawn_frames_++;
+
+    present_wait_ = slot.ready;
+    present_info_ = *present_info;
+    present_info_.waitSemaphoreCount = 1;
+    present_info_.pWaitSemaphores = &present_wait_;
+
+    double cpu_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    cpu_ms_ = drawn_frames_ == 1 ? cpu_ms : cpu_ms_ * 0.9 + cpu_ms * 0.1;
+    cpu_total_ms_ += cpu_ms;
+    return &present_info_;
+}
+
+void FrameHud::PrintReport(std::ostream& out) {
+    // Costs are a few microseconds; the stream's precision would round them away
+    char cost[64] = "";
+    if (drawn_frames_ > 0 && gpu_samples_ > 0) {
+        snprintf(cost, sizeof(cost), ", cpu %.4f ms/frame, gpu %.4f ms/frame", cpu_total_ms_ / drawn_frames_,
+                 gpu_total_ms_ / gpu_samples_);
+    } else if (drawn_frames_ > 0) {
+        snprintf(cost, sizeof(cost), ", cpu %.4f ms/frame", cpu_total_ms_ / drawn_frames_);
+    }
+    out << "[FRAME_INTERP] HUD: " << drawn_frames_ << " frames drawn, " << skipped_frames_ << " skipped" << cost
+        << std::endl;
+}
@@ -1,12 +1,12 @@
 #include "frame_interpolation_layer.h"
 #include <cstring>
 #include <sstream>
-#include <iomanip>
 
 // Global data
-std::unordered_map<void*, InstanceData*> instance_map;
-std::unordered_map<void*, DeviceData*> device_map;
-std::mutex global_mutex;
+DispatchMap<InstanceData> instance_map;
+DispatchMap<DeviceData> device_map;
+DispatchMap<PhysicalDeviceData> physical_device_map;
+DispatchMap<QueueData> queue_map;
 
 // Layer properties
 static const VkLayerProperties layer_props = {
@@ -18,85 +18,57 @@ static const VkLayerProperties layer_props = {
 
 // Utility functions
 InstanceData* GetInstanceData(VkInstance instance) {
-    std::lock_guard<std::mutex> lock(global_mutex);
-    auto it = instance_map.find(instance);
-    return (it != instance_map.end()) ? it->second : nullptr;
+    return instance_map.Get(GetDispatchKey(instance));
 }
 
 DeviceData* GetDeviceData(VkDevice device) {
-    std::lock_guard<std::mutex> lock(global_mutex);
-    auto it = device_map.find(device);
-    return (it != device_map.end()) ? it->second : nullptr;
+    return device_map.Get(GetDispatchKey(device));
+}
+
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice) {
+    PhysicalDeviceData* physical_device_data = physical_device_map.Get(physicalDevice);
+    if (physical_device_data) return physical_device_data->instance_data;
+    // Not enumerated through this layer; a physical device shares its
+    // instance's dispatch key
+    return instance_map.Get(GetDispatchKey(physicalDevice));
+}
+
+DeviceData* GetDeviceData(VkQueue queue) {
+    QueueData* queue_data = queue_map.Get(queue);
+    return queue_data ? queue_data->device_data : nullptr;
 }
 
 SwapchainData* GetSwapchainData(VkDevice device, VkSwapchainKHR swapchain) {
     DeviceData* device_data = GetDeviceData(device);
     if (!device_data) return nullptr;
     
+    std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
     auto it = device_data->swapchains.find(swapchain);
     return (it != device_data->swapchains.end()) ? it->second.get() : nullptr;
 }
 
-void LogFrameTiming(SwapchainData* swapchain_data, uint32_t imageIndex) {
-    auto now = std::chrono::high_resolution_clock::now();
-    
-    if (swapchain_data->frameNumber > 0) {
-        auto frametime = std::chrono::duration<double, std::milli>(
-            now - swapchain_data->lastFrameTime).count();
-        
-        FrameTimingData timing_data;
-        timing_data.timestamp = now;
-        timing_data.imageIndex = imageIndex;
-        timing_data.presentMode = swapchain_data->presentMode;
-        timing_data.frametime_ms = frametime;
-        timing_data.frameNumber = swapchain_data->frameNumber;
-        
-        swapchain_data->frameHistory.push_back(timing_data);
-        
-        // Keep only last 1000 frames
-        if (swapchain_data->frameHistory.size() > 1000) {
-            swapchain_data->frameHistory.erase(swapchain_data->frameHistory.begin());
-        }
-        
-        // Update HUD
-        UpdateHUD(swapchain_data, frametime);
-        
-        // Log to CSV
-        if (swapchain_data->csvFile && swapchain_data->csvFile->is_open()) {
-            *swapchain_data->csvFile << timing_data.frameNumber << ","
-                                    << timing_data.frametime_ms << ","
-                                    << timing_data.imageIndex << ","
-                                    << timing_data.presentMode << std::endl;
-        }
-        
-        // Console logging every 60 frames
-        if (swapchain_data->frameNumber % 60 == 0) {
-            std::cout << "[FRAME_INTERP] Frame " << swapchain_data->frameNumber 
-                     << ": " << std::fixed << std::setprecision(2) << frametime << "ms"
-                     << " (FPS: " << (1000.0 / frametime) << ")"
-                     << " Present Mode: " << swapchain_data->presentMode
-                     << " Image Index: " << imageIndex << std::endl;
-        }
-    }
-    
-    swapchain_data->lastFrameTime = now;
-    swapchain_data->frameNumber++;
-}
-
-void UpdateHUD(SwapchainData* swapchain_data, double frametime_ms) {
-    if (!swapchain_data->hud.enabled) return;
-    
-    swapchain_data->hud.currentFrametime = frametime_ms;
-    swapchain_data->hud.frametimes.push_back(frametime_ms);
-    
-    // Keep rolling buffer of frame times
-    if (swapchain_data->hud.frametimes.size() > swapchain_data->hud.maxSamples) {
-        swapchain_data->hud.frametimes.erase(swapchain_data->hud.frametimes.begin());
-    }
+// A swapchain's entry in one of the device's per-swapchain maps, or null
+template <typename T>
+static std::shared_ptr<T> FindSwapchainEntry(DeviceData* device_data,
+                                             const std::unordered_map<VkSwapchainKHR, std::shared_ptr<T>>& map,
+                                             VkSwapchainKHR swapchain) {
+    std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+    auto it = map.find(swapchain);
+    return (it != map.end()) ? it->second : nullptr;
 }
 
-void WriteCSVHeader(std::ofstream& file) {
-    file << "FrameNumber,FrametimeMs,ImageIndex,PresentMode" << std::endl;
+// Removes a swapchain's entry and hands it back; the caller's reference is
+// then the last one unless a present on another thread still holds it
+template <typename T>
+static std::shared_ptr<T> TakeSwapchainEntry(DeviceData* device_data,
+                                             std::unordered_map<VkSwapchainKHR, std::shared_ptr<T>>& map,
+                                             VkSwapchainKHR swapchain) {
+    std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+    auto it = map.find(swapchain);
+    if (it == map.end()) return nullptr;
+    std::shared_ptr<T> entry = std::move(it->second);
+    map.erase(it);
+    return entry;
 }
 
 // Hooked Vulkan functions
@@ -105,16 +77,7 @@ VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateInstance(
     const VkAllocationCallbacks* pAllocator,
     VkInstance* pInstance) {
     
-    VkLayerInstanceCreateInfo* chain_info = 
-        const_cast<VkLayerInstanceCreateInfo*>(
-            reinterpret_cast<const VkLayerInstanceCreateInfo*>(pCreateInfo->pNext));
-    
-    while (chain_info && 
-           (chain_info->sType != VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO ||
-            chain_info->function != VK_LAYER_LINK_INFO)) {
-        chain_info = const_cast<VkLayerInstanceCreateInfo*>(
-            reinterpret_cast<const VkLayerInstanceCreateInfo*>(chain_info->pNext));
-    }
+    VkLayerInstanceCreateInfo* chain_info = FindInstanceLinkInfo(pCreateInfo);
     
     if (chain_info == nullptr) {
         return VK_ERROR_INITIALIZATION_FAILED;
@@ -135,20 +98,37 @@ VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateInstance(
     
     InstanceData* instance_data = new InstanceData();
     instance_data->instance = *pInstance;
+    instance_data->api_version = (pCreateInfo->pApplicationInfo && pCreateInfo->pApplicationInfo->apiVersion)
+        ? pCreateInfo->pApplicationInfo->apiVersion : VK_API_VERSION_1_0;
     instance_data->dispatch.GetInstanceProcAddr = fpGetInstanceProcAddr;
     instance_data->dispatch.DestroyInstance = 
         reinterpret_cast<PFN_vkDestroyInstance>(fpGetInstanceProcAddr(*pInstance, "vkDestroyInstance"));
     instance_data->dispatch.EnumeratePhysicalDevices = 
         reinterpret_cast<PFN_vkEnumeratePhysicalDevices>(fpGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDevices"));
+    instance_data->dispatch.EnumeratePhysicalDeviceGroups = 
+        reinterpret_cast<PFN_vkEnumeratePhysicalDeviceGroups>(fpGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDeviceGroups"));
+    instance_data->dispatch.EnumeratePhysicalDeviceGroupsKHR = 
+        reinterpret_cast<PFN_vkEnumeratePhysicalDeviceGroupsKHR>(fpGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDeviceGroupsKHR"));
     instance_data->dispatch.GetPhysicalDeviceProperties = 
         reinterpret_cast<PFN_vkGetPhysicalDeviceProperties>(fpGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceProperties"));
+    instance_data->dispatch.GetPhysicalDeviceMemoryProperties = 
+        reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties>(fpGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceMemoryProperties"));
+    instance_data->dispatch.GetPhysicalDeviceQueueFamilyProperties = 
+        reinterpret_cast<PFN_vkGetPhysicalDeviceQueueFamilyProperties>(fpGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceQueueFamilyProperties"));
+    instance_data->dispatch.GetPhysicalDeviceSurfaceCapabilitiesKHR = 
+        reinterpret_cast<PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR>(fpGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceSurfaceCapabilitiesKHR"));
+    instance_data->dispatch.GetPhysicalDeviceFeatures2 = 
+        reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(fpGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceFeatures2"));
+    if (!instance_data->dispatch.GetPhysicalDeviceFeatures2) {
+        instance_data->dispatch.GetPhysicalDeviceFeatures2 = 
+            reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(fpGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceFeatures2KHR"));
+    }
+    instance_data->dispatch.EnumerateDeviceExtensionProperties = 
+        reinterpret_cast<PFN_vkEnumerateDeviceExtensionProperties>(fpGetInstanceProcAddr(*pInstance, "vkEnumerateDeviceExtensionProperties"));
     instance_data->dispatch.CreateDevice = 
         reinterpret_cast<PFN_vkCreateDevice>(fpGetInstanceProcAddr(*pInstance, "vkCreateDevice"));
     
-    {
-        std::lock_guard<std::mutex> lock(global_mutex);
-        instance_map[*pInstance] = instance_data;
-    }
+    instance_map.Insert(GetDispatchKey(*pInstance), instance_data);
     
     std::cout << "[FRAME_INTERP] Layer initialized for instance " << *pInstance << std::endl;
     return result;
@@ -158,35 +138,142 @@ VKAPI_ATTR void VKAPI_CALL layer_vkDestroyInstance(
     VkInstance instance,
     const VkAllocationCallbacks* pAllocator) {
     
-    InstanceData* instance_data = GetInstanceData(instance);
+    void* key = GetDispatchKey(instance);
+    InstanceData* instance_data = instance_map.Get(key);
     if (instance_data) {
         instance_data->dispatch.DestroyInstance(instance, pAllocator);
         
-        {
-            std::lock_guard<std::mutex> lock(global_mutex);
-            instance_map.erase(instance);
-        }
+        instance_map.Erase(key);
+        ReleasePhysicalDevices(physical_device_map, instance_data);
         delete instance_data;
         std::cout << "[FRAME_INTERP] Instance destroyed" << std::endl;
     }
 }
 
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkEnumeratePhysicalDevices(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceCount,
+    VkPhysicalDevice* pPhysicalDevices) {
+    
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data) return VK_ERROR_INITIALIZATION_FAILED;
+    
+    VkResult result = instance_data->dispatch.EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
+    if ((result == VK_SUCCESS || result == VK_INCOMPLETE) && pPhysicalDevices) {
+        TrackPhysicalDevices(physical_device_map, instance_data, *pPhysicalDeviceCount, pPhysicalDevices);
+    }
+    return result;
+}
+
+// Devices in a group are tracked like individually enumerated ones
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkEnumeratePhysicalDeviceGroups(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->dispatch.EnumeratePhysicalDeviceGroups) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    
+    VkResult result = instance_data->dispatch.EnumeratePhysicalDeviceGroups(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL layer_vkEnumeratePhysicalDeviceGroupsKHR(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->dispatch.EnumeratePhysicalDeviceGroupsKHR) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    
+    VkResult result = instance_data->dispatch.EnumeratePhysicalDeviceGroupsKHR(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    return result;
+}
+
+// Capture signals a timeline semaphore per frame. Turns the feature on in
+// `create_info` (core from Vulkan 1.2, else VK_KHR_timeline_semaphore) when
+// the device has it; `extensions` and `features` back the modified info.
+// Returns false if it can't be enabled, or the application chained a
+// features struct that explicitly leaves it off.
+static bool EnableTimelineSemaphores(InstanceData* instance_data, VkPhysicalDevice physical_device,
+                                     VkDeviceCreateInfo* create_info, std::vector<const char*>* extensions,
+                                     VkPhysicalDeviceTimelineSemaphoreFeatures* features) {
+    if (!instance_data || !instance_data->dispatch.GetPhysicalDeviceFeatures2) return false;
+    
+    VkPhysicalDeviceProperties properties{};
+    instance_data->dispatch.GetPhysicalDeviceProperties(physical_device, &properties);
+    bool core = properties.apiVersion >= VK_API_VERSION_1_2 && instance_data->api_version >= VK_API_VERSION_1_2;
+    
+    bool extension_enabled = false;
+    for (uint32_t i = 0; i < create_info->enabledExtensionCount; ++i) {
+        if (std::strcmp(create_info->ppEnabledExtensionNames[i], VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0) {
+            extension_enabled = true;
+        }
+    }
+    if (!core && !extension_enabled) {
+        uint32_t count = 0;
+        instance_data->dispatch.EnumerateDeviceExtensionProperties(physical_device, nullptr, &count, nullptr);
+        std::vector<VkExtensionProperties> available(count);
+        instance_data->dispatch.EnumerateDeviceExtensionProperties(physical_device, nullptr, &count, available.data());
+        bool found = false;
+        for (const VkExtensionProperties& extension : available) {
+            found |= std::strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0;
+        }
+        if (!found) return false;
+    }
+    
+    VkPhysicalDeviceTimelineSemaphoreFeatures supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &supported;
+    instance_data->dispatch.GetPhysicalDeviceFeatures2(physical_device, &features2);
+    if (!supported.timelineSemaphore) return false;
+    
+    // The application's own structs can't be changed, and may not appear twice
+    bool requested = false;
+    for (const VkBaseInStructure* next = static_cast<const VkBaseInStructure*>(create_info->pNext); next; next = next->pNext) {
+        if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES) {
+            if (!reinterpret_cast<const VkPhysicalDeviceTimelineSemaphoreFeatures*>(next)->timelineSemaphore) return false;
+            requested = true;
+        } else if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES) {
+            if (!reinterpret_cast<const VkPhysicalDeviceVulkan12Features*>(next)->timelineSemaphore) return false;
+            requested = true;
+        }
+    }
+    if (!requested) {
+        *features = {};
+        features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        features->pNext = const_cast<void*>(create_info->pNext);
+        features->timelineSemaphore = VK_TRUE;
+        create_info->pNext = features;
+    }
+    if (!core && !extension_enabled) {
+        extensions->assign(create_info->ppEnabledExtensionNames,
+                           create_info->ppEnabledExtensionNames + create_info->enabledExtensionCount);
+        extensions->push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        create_info->enabledExtensionCount = static_cast<uint32_t>(extensions->size());
+        create_info->ppEnabledExtensionNames = extensions->data();
+    }
+    return true;
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateDevice(
     VkPhysicalDevice physicalDevice,
     const VkDeviceCreateInfo* pCreateInfo,
     const VkAllocationCallbacks* pAllocator,
     VkDevice* pDevice) {
     
-    VkLayerDeviceCreateInfo* chain_info = 
-        const_cast<VkLayerDeviceCreateInfo*>(
-            reinterpret_cast<const VkLayerDeviceCreateInfo*>(pCreateInfo->pNext));
-    
-    while (chain_info && 
-           (chain_info->sType != VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO ||
-            chain_info->function != VK_LAYER_LINK_INFO)) {
-        chain_info = const_cast<VkLayerDeviceCreateInfo*>(
-            reinterpret_cast<const VkLayerDeviceCreateInfo*>(chain_info->pNext));
-    }
+    VkLayerDeviceCreateInfo* chain_info = FindDeviceLinkInfo(pCreateInfo);
+    PFN_vkSetDeviceLoaderData fpSetDeviceLoaderData = FindDeviceLoaderDataCallback(pCreateInfo);
     
     if (chain_info == nullptr) {
         return VK_ERROR_INITIALIZATION_FAILED;
@@ -203,14 +290,25 @@ VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateDevice(
     
     chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
     
-    VkResult result = fpCreateDevice(physicalDevice, pCreateInfo, pAllocator, pDevice);
+    VkDeviceCreateInfo create_info = *pCreateInfo;
+    std::vector<const char*> extensions;
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features{};
+    bool timeline_semaphores = FrameCapture::Requested() &&
+        EnableTimelineSemaphores(GetInstanceData(physicalDevice), physicalDevice, &create_info, &extensions, &timeline_features);
+    
+    VkResult result = fpCreateDevice(physicalDevice, &create_info, pAllocator, pDevice);
     if (result != VK_SUCCESS) return result;
     
     DeviceData* device_data = new DeviceData();
     device_data->device = *pDevice;
+    device_data->instance_data = GetInstanceData(physicalDevice);
     device_data->dispatch.GetDeviceProcAddr = fpGetDeviceProcAddr;
     device_data->dispatch.DestroyDevice = 
         reinterpret_cast<PFN_vkDestroyDevice>(fpGetDeviceProcAddr(*pDevice, "vkDestroyDevice"));
+    device_data->dispatch.GetDeviceQueue = 
+        reinterpret_cast<PFN_vkGetDeviceQueue>(fpGetDeviceProcAddr(*pDevice, "vkGetDeviceQueue"));
+    device_data->dispatch.GetDeviceQueue2 = 
+        reinterpret_cast<PFN_vkGetDeviceQueue2>(fpGetDeviceProcAddr(*pDevice, "vkGetDeviceQueue2"));
     device_data->dispatch.CreateSwapchainKHR = 
         reinterpret_cast<PFN_vkCreateSwapchainKHR>(fpGetDeviceProcAddr(*pDevice, "vkCreateSwapchainKHR"));
     device_data->dispatch.DestroySwapchainKHR = 
@@ -219,12 +317,44 @@ VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateDevice(
         reinterpret_cast<PFN_vkAcquireNextImageKHR>(fpGetDeviceProcAddr(*pDevice, "vkAcquireNextImageKHR"));
     device_data->dispatch.QueuePresentKHR = 
         reinterpret_cast<PFN_vkQueuePresentKHR>(fpGetDeviceProcAddr(*pDevice, "vkQueuePresentKHR"));
-    
-    {
-        std::lock_guard<std::mutex> lock(global_mutex);
-        device_map[*pDevice] = device_data;
+    device_data->dispatch.QueueSubmit = 
+        reinterpret_cast<PFN_vkQueueSubmit>(fpGetDeviceProcAddr(*pDevice, "vkQueueSubmit"));
+    device_data->dispatch.QueueSubmit2 = 
+        reinterpret_cast<PFN_vkQueueSubmit2>(fpGetDeviceProcAddr(*pDevice, "vkQueueSubmit2"));
+    device_data->dispatch.QueueSubmit2KHR = 
+        reinterpret_cast<PFN_vkQueueSubmit2KHR>(fpGetDeviceProcAddr(*pDevice, "vkQueueSubmit2KHR"));
+    device_data->dispatch.QueueBindSparse = 
+        reinterpret_cast<PFN_vkQueueBindSparse>(fpGetDeviceProcAddr(*pDevice, "vkQueueBindSparse"));
+    device_data->dispatch.QueueWaitIdle = 
+        reinterpret_cast<PFN_vkQueueWaitIdle>(fpGetDeviceProcAddr(*pDevice, "vkQueueWaitIdle"));
+    device_data->dispatch.DeviceWaitIdle = 
+        reinterpret_cast<PFN_vkDeviceWaitIdle>(fpGetDeviceProcAddr(*pDevice, "vkDeviceWaitIdle"));
+    
+    FrameGenerationDevice& generation = device_data->generation;
+    generation.device = *pDevice;
+    generation.physical_device = physicalDevice;
+    generation.set_device_loader_data = fpSetDeviceLoaderData;
+    generation.timeline_semaphores = timeline_semaphores;
+    LoadFrameGenerationDispatch(&generation.vk, *pDevice, fpGetDeviceProcAddr);
+    if (InstanceData* instance_data = device_data->instance_data) {
+        generation.get_surface_capabilities = instance_data->dispatch.GetPhysicalDeviceSurfaceCapabilitiesKHR;
+        VkPhysicalDeviceProperties properties{};
+        instance_data->dispatch.GetPhysicalDeviceProperties(physicalDevice, &properties);
+        generation.device_type = properties.deviceType;
+        generation.timestamp_period = properties.limits.timestampPeriod;
+        instance_data->dispatch.GetPhysicalDeviceMemoryProperties(physicalDevice, &generation.memory_properties);
+        uint32_t family_count = 0;
+        instance_data->dispatch.GetPhysicalDeviceQueueFamilyProperties(physicalDevice, &family_count, nullptr);
+        generation.queue_families.resize(family_count);
+        instance_data->dispatch.GetPhysicalDeviceQueueFamilyProperties(physicalDevice, &family_count, generation.queue_families.data());
+
+        device_data->pipeline_cache =
+            PipelineDiskCache::Create(DiskCache::Shared(), LAYER_NAME, *pDevice, properties, fpGetDeviceProcAddr);
+        if (device_data->pipeline_cache) generation.pipeline_cache = device_data->pipeline_cache->handle();
     }
     
+    device_map.Insert(GetDispatchKey(*pDevice), device_data);
+    
     std::cout << "[FRAME_INTERP] Device created" << std::endl;
     return result;
 }
@@ -233,19 +363,49 @@ VKAPI_ATTR void VKAPI_CALL layer_vkDestroyDevice(
     VkDevice device,
     const VkAllocationCallbacks* pAllocator) {
     
-    DeviceData* device_data = GetDeviceData(device);
+    void* key = GetDispatchKey(device);
+    DeviceData* device_data = device_map.Get(key);
     if (device_data) {
+        // Generator resources belong to the device; release any the
+        // application's swapchain teardown left behind
+        device_data->generators.clear();
+        device_data->captures.clear();
+        device_data->huds.clear();
+        device_data->pipeline_cache.reset();
         device_data->dispatch.DestroyDevice(device, pAllocator);
         
-        {
-            std::lock_guard<std::mutex> lock(global_mutex);
-            device_map.erase(device);
-        }
+        device_map.Erase(key);
+        ReleaseQueues(queue_map, device_data);
         delete device_data;
         std::cout << "[FRAME_INTERP] Device destroyed" << std::endl;
     }
 }
 
+VKAPI_ATTR void VKAPI_CALL layer_vkGetDeviceQueue(
+    VkDevice device,
+    uint32_t queueFamilyIndex,
+    uint32_t queueIndex,
+    VkQueue* pQueue) {
+    
+    DeviceData* device_data = GetDeviceData(device);
+    if (device_data && device_data->dispatch.GetDeviceQueue) {
+        device_data->dispatch.GetDeviceQueue(device, queueFamilyIndex, queueIndex, pQueue);
+        TrackQueue(queue_map, device_data, *pQueue, queueFamilyIndex, queueIndex);
+    }
+}
+
+VKAPI_ATTR void VKAPI_CALL layer_vkGetDeviceQueue2(
+    VkDevice device,
+    const VkDeviceQueueInfo2* pQueueInfo,
+    VkQueue* pQueue) {
+    
+    DeviceData* device_data = GetDeviceData(device);
+    if (device_data && device_data->dispatch.GetDeviceQueue2) {
+        device_data->dispatch.GetDeviceQueue2(device, pQueueInfo, pQueue);
+        TrackQueue(queue_map, device_data, *pQueue, pQueueInfo->queueFamilyIndex, pQueueInfo->queueIndex);
+    }
+}
+
 // Stage 0 swapchain interception functions
 VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateSwapchainKHR(
     VkDevice device,
@@ -256,7 +416,71 @@ VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateSwapchainKHR(
     DeviceData* device_data = GetDeviceData(device);
     if (!device_data) return VK_ERROR_INITIALIZATION_FAILED;
     
-    VkResult result = device_data->dispatch.CreateSwapchainKHR(device, pCreateInfo, pAllocator, pSwapchain);
+    // Presents still queued for a retired swapchain go out first
+    if (std::shared_ptr<FrameGenerator> old_generator =
+            FindSwapchainEntry(device_data, device_data->generators, pCreateInfo->oldSwapchain)) {
+        old_generator->WaitIdle();
+    }
+    
+    // Frame generation needs the images as copy sources/destinations and one
+    // spare, capture as copy sources, the HUD as both; fall back to the
+    // application's own settings if that fails
+    VkSwapchainCreateInfoKHR create_info = *pCreateInfo;
+    bool hud = FrameHud::PrepareSwapchain(device_data->generation, &create_info);
+    bool capture = FrameCapture::PrepareSwapchain(device_data->generation, &create_info);
+    VkSwapchainCreateInfoKHR generation_create_info = create_info;
+    bool generate = FrameGenerator::PrepareSwapchain(device_data->generation, &generation_create_info);
+
+    // A failed create still retires oldSwapchain, so the attempts after it
+    // must not name it again
+    VkSwapchainKHR old_swapchain = pCreateInfo->oldSwapchain;
+    auto create_swapchain = [&](VkSwapchainCreateInfoKHR attempt_info) {
+        attempt_info.oldSwapchain = old_swapchain;
+        VkResult created = device_data->dispatch.CreateSwapchainKHR(device, &attempt_info, pAllocator, pSwapchain);
+        if (created != VK_SUCCESS) old_swapchain = VK_NULL_HANDLE;
+        return created;
+    };
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+    if (generate) {
+        result = create_swapchain(generation_create_info);
+        if (result == VK_SUCCESS) {
+            std::unique_ptr<FrameGenerator> generator =
+                FrameGenerator::Create(device_data->generation, *pSwapchain, generation_create_info);
+            if (generator) {
+                std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+                device_data->generators[*pSwapchain] = std::move(generator);
+            } else {
+                std::cout << "[FRAME_INTERP] Frame generation setup failed; presenting application frames only" << std::endl;
+            }
+        }
+    }
+    if ((capture || hud) && (!generate || result != VK_SUCCESS)) {
+        generation_create_info = create_info;
+        result = create_swapchain(create_info);
+    }
+    if (capture && result == VK_SUCCESS) {
+        std::unique_ptr<FrameCapture> frame_capture =
+            FrameCapture::Create(device_data->generation, *pSwapchain, generation_create_info);
+        if (frame_capture) {
+            std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+            device_data->captures[*pSwapchain] = std::move(frame_capture);
+        } else {
+            std::cout << "[FRAME_INTERP] Capture setup failed; presenting without capture" << std::endl;
+        }
+    }
+    if (hud && result == VK_SUCCESS) {
+        std::unique_ptr<FrameHud> frame_hud =
+            FrameHud::Create(device_data->generation, *pSwapchain, generation_create_info);
+        if (frame_hud) {
+            std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+            device_data->huds[*pSwapchain] = std::move(frame_hud);
+        } else {
+            std::cout << "[FRAME_INTERP] HUD setup failed; presenting without HUD" << std::endl;
+        }
+    }
+    if ((!generate && !capture && !hud) || result != VK_SUCCESS) {
+        result = create_swapchain(*pCreateInfo);
+    }
     if (result == VK_SUCCESS) {
         auto swapchain_data = std::make_unique<SwapchainData>();
         swapchain_data->swapchain = *pSwapchain;
@@ -266,15 +490,18 @@ VKAPI_ATTR VkResult VKAPI_CALL layer_vkCreateSwapchainKHR(
         swapchain_data->extent = pCreateInfo->imageExtent;
         swapchain_data->format = pCreateInfo->imageFormat;
         swapchain_data->lastFrameTime = std::chrono::high_resolution_clock::now();
+        swapchain_data->lastStatsReport = std::chrono::steady_clock::now();
+        swapchain_data->hud.enabled = FrameHud::Enabled();
+        swapchain_data->hud.currentPresentMode = pCreateInfo->presentMode;
         
-        // Initialize CSV logging
-        std::string filename = "frame_timing_" + std::to_string(reinterpret_cast<uintptr_t>(*pSwapchain)) + ".csv";
-        swapchain_data->csvFile = std::make_unique<std::ofstream>(filename);
-        if (swapchain_data->csvFile->is_open()) {
-            WriteCSVHeader(*swapchain_data->csvFile);
-        }
+        // Initialize telemetry logging (convert with tools/telemetry_to_csv)
+        std::string filename = "frame_timing_" + std::to_string(reinterpret_cast<uintptr_t>(*pSwapchain)) + ".bin";
+        swapchain_data->telemetry = std::make_unique<TelemetryWriter>(filename);
         
-        device_data->swapchains[*pSwapchain] = std::move(swapchain_data);
+        {
+            std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+            device_data->swapchains[*pSwapchain] = std::move(swapchain_data);
+        }
         
         std::cout << "[FRAME_INTERP] Swapchain created: " << pCreateInfo->imageExtent.width 
                  << "x" << pCreateInfo->imageExtent.height
@@ -293,11 +520,42 @@ VKAPI_ATTR void VKAPI_CALL layer_vkDestroySwapchainKHR(
     DeviceData* device_data = GetDeviceData(device);
     if (device_data) {
         SwapchainData* swapchain_data = GetSwapchainData(device, swapchain);
-        if (swapchain_data && swapchain_data->csvFile) {
-            swapchain_data->csvFile->close();
+        if (swapchain_data) {
+            PrintFrameStatsReport(std::cout, swapchain_data->stats.Report(), "final");
+        }
+        
+        if (std::shared_ptr<FrameGenerator> generator =
+                TakeSwapchainEntry(device_data, device_data->generators, swapchain)) {
+            generator->PrintReport(std::cout);
+            // Waits for the generator's in-flight work before freeing its pool
+            generator.reset();
+        }
+        
+        if (std::shared_ptr<FrameCapture> frame_capture =
+                TakeSwapchainEntry(device_data, device_data->captures, swapchain)) {
+            frame_capture->PrintReport(std::cout);
+            // Waits for every submitted copy and writes it out
+            frame_capture.reset();
+        }
+        
+        if (std::shared_ptr<FrameHud> frame_hud = TakeSwapchainEntry(device_data, device_data->huds, swapchain)) {
+            frame_hud->PrintReport(std::cout);
+            // Waits for the HUD's in-flight draws
+            frame_hud.reset();
         }
         
-        device_data->swapchains.erase(swapchain);
+        // Releasing joins the telemetry writer, which flushes and syncs the
+        // file; that happens outside the lock
+        std::unique_ptr<SwapchainData> retired;
+        {
+            std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+            auto it = device_data->swapchains.find(swapchain);
+            if (it != device_data->swapchains.end()) {
+                retired = std::move(it->second);
+                device_data->swapchains.erase(it);
+            }
+        }
+        retired.reset();
         device_data->dispatch.DestroySwapchainKHR(device, swapchain, pAllocator);
         
         std::cout << "[FRAME_INTERP] Swapchain destroyed" << std::endl;
@@ -315,11 +573,20 @@ VKAPI_ATTR VkResult VKAPI_CALL layer_vkAcquireNextImageKHR(
     DeviceData* device_data = GetDeviceData(device);
     if (!device_data) return VK_ERROR_INITIALIZATION_FAILED;
     
-    VkResult result = device_data->dispatch.AcquireNextImageKHR(device, swapchain, timeout, semaphore, fence, pImageIndex);
+    VkResult result;
+    std::shared_ptr<FrameGenerator> generator = FindSwapchainEntry(device_data, device_data->generators, swapchain);
+    if (generator) {
+        result = generator->AcquireNextImage(timeout, semaphore, fence, pImageIndex);
+    } else {
+        result = device_data->dispatch.AcquireNextImageKHR(device, swapchain, timeout, semaphore, fence, pImageIndex);
+    }
     
     if (result == VK_SUCCESS) {
         SwapchainData* swapchain_data = GetSwapchainData(device, swapchain);
         if (swapchain_data) {
+            if (generator) {
+                swapchain_data->sceneChanges = generator->SceneChanges();
+            }
             // Record timing data on acquire (start of frame)
             LogFrameTiming(swapchain_data, *pImageIndex);
         }
@@ -332,19 +599,44 @@ VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueuePresentKHR(
     VkQueue queue,
     const VkPresentInfoKHR* pPresentInfo) {
     
-    // Find device associated with this queue (simplified approach)
-    DeviceData* device_data = nullptr;
-    {
-        std::lock_guard<std::mutex> lock(global_mutex);
-        for (auto& pair : device_map) {
-            device_data = pair.second;
-            break; // For simplicity, assume single device
+    QueueData* queue_data = queue_map.Get(queue);
+    if (!queue_data) return VK_ERROR_INITIALIZATION_FAILED;
+    DeviceData* device_data = queue_data->device_data;
+    
+    // Capture copies the image ahead of the present, which then waits on
+    // the copy; the HUD is drawn after it, so captured frames stay clean.
+    // Single-swapchain presents only.
+    if (pPresentInfo->swapchainCount == 1) {
+        VkSwapchainKHR swapchain = pPresentInfo->pSwapchains[0];
+        if (std::shared_ptr<FrameCapture> frame_capture =
+                FindSwapchainEntry(device_data, device_data->captures, swapchain)) {
+            pPresentInfo = frame_capture->Capture(queue, queue_data->family_index, &queue_data->mutex, pPresentInfo);
+        }
+        std::shared_ptr<FrameHud> frame_hud = FindSwapchainEntry(device_data, device_data->huds, swapchain);
+        SwapchainData* swapchain_data = GetSwapchainData(device_data->device, swapchain);
+        if (frame_hud && swapchain_data) {
+            pPresentInfo = frame_hud->Draw(queue, queue_data->family_index, &queue_data->mutex,
+                                                   swapchain_data->hud, pPresentInfo);
         }
     }
     
-    if (!device_data) return VK_ERROR_INITIALIZATION_FAILED;
+    // Frame generation handles single-swapchain presents; a present that
+    // also names other swapchains goes after the generator's queued ones
+    for (uint32_t i = 0; i < pPresentInfo->swapchainCount; ++i) {
+        std::shared_ptr<FrameGenerator> generator =
+            FindSwapchainEntry(device_data, device_data->generators, pPresentInfo->pSwapchains[i]);
+        if (!generator) continue;
+        if (pPresentInfo->swapchainCount == 1) {
+            return generator->Present(queue, queue_data->family_index, &queue_data->mutex, pPresentInfo);
+        }
+        generator->WaitIdle();
+    }
     
-    VkResult result = device_data->dispatch.QueuePresentKHR(queue, pPresentInfo);
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> lock(queue_data->mutex);
+        result = device_data->dispatch.QueuePresentKHR(queue, pPresentInfo);
+    }
     
     // Log present completion
     if (result == VK_SUCCESS && pPresentInfo->swapchainCount > 0) {
@@ -359,20 +651,118 @@ VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueuePresentKHR(
     return result;
 }
 
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueSubmit(
+    VkQueue queue,
+    uint32_t submitCount,
+    const VkSubmitInfo* pSubmits,
+    VkFence fence) {
+    
+    QueueData* queue_data = queue_map.Get(queue);
+    if (!queue_data) return VK_ERROR_INITIALIZATION_FAILED;
+    
+    std::lock_guard<std::mutex> lock(queue_data->mutex);
+    return queue_data->device_data->dispatch.QueueSubmit(queue, submitCount, pSubmits, fence);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueSubmit2(
+    VkQueue queue,
+    uint32_t submitCount,
+    const VkSubmitInfo2* pSubmits,
+    VkFence fence) {
+    
+    QueueData* queue_data = queue_map.Get(queue);
+    if (!queue_data || !queue_data->device_data->dispatch.QueueSubmit2) return VK_ERROR_INITIALIZATION_FAILED;
+    
+    std::lock_guard<std::mutex> lock(queue_data->mutex);
+    return queue_data->device_data->dispatch.QueueSubmit2(queue, submitCount, pSubmits, fence);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueSubmit2KHR(
+    VkQueue queue,
+    uint32_t submitCount,
+    const VkSubmitInfo2* pSubmits,
+    VkFence fence) {
+    
+    QueueData* queue_data = queue_map.Get(queue);
+    if (!queue_data || !queue_data->device_data->dispatch.QueueSubmit2KHR) return VK_ERROR_INITIALIZATION_FAILED;
+    
+    std::lock_guard<std::mutex> lock(queue_data->mutex);
+    return queue_data->device_data->dispatch.QueueSubmit2KHR(queue, submitCount, pSubmits, fence);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueBindSparse(
+    VkQueue queue,
+    uint32_t bindInfoCount,
+    const VkBindSparseInfo* pBindInfo,
+    VkFence fence) {
+    
+    QueueData* queue_data = queue_map.Get(queue);
+    if (!queue_data) return VK_ERROR_INITIALIZATION_FAILED;
+    
+    std::lock_guard<std::mutex> lock(queue_data->mutex);
+    return queue_data->device_data->dispatch.QueueBindSparse(queue, bindInfoCount, pBindInfo, fence);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkQueueWaitIdle(VkQueue queue) {
+    QueueData* queue_data = queue_map.Get(queue);
+    if (!queue_data) return VK_ERROR_INITIALIZATION_FAILED;
+    
+    std::lock_guard<std::mutex> lock(queue_data->mutex);
+    return queue_data->device_data->dispatch.QueueWaitIdle(queue);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL layer_vkDeviceWaitIdle(VkDevice device) {
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data) return VK_ERROR_INITIALIZATION_FAILED;
+    
+    // Idle includes presents the generators have not issued yet
+    std::vector<std::shared_ptr<FrameGenerator>> generators;
+    {
+        std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+        for (auto& generator : device_data->generators) {
+            generators.push_back(generator.second);
+        }
+    }
+    for (auto& generator : generators) {
+        generator->WaitIdle();
+    }
+    return device_data->dispatch.DeviceWaitIdle(device);
+}
+
+// Entry points this layer intercepts
+#define FRAME_INTERP_INSTANCE_PROCS(X) \
+    X(vkGetInstanceProcAddr, vkGetInstanceProcAddr) \
+    X(vkCreateInstance, layer_vkCreateInstance) \
+    X(vkDestroyInstance, layer_vkDestroyInstance) \
+    X(vkEnumeratePhysicalDevices, layer_vkEnumeratePhysicalDevices) \
+    X(vkEnumeratePhysicalDeviceGroups, layer_vkEnumeratePhysicalDeviceGroups) \
+    X(vkEnumeratePhysicalDeviceGroupsKHR, layer_vkEnumeratePhysicalDeviceGroupsKHR) \
+    X(vkCreateDevice, layer_vkCreateDevice)
+
+#define FRAME_INTERP_DEVICE_PROCS(X) \
+    X(vkGetDeviceProcAddr, vkGetDeviceProcAddr) \
+    X(vkDestroyDevice, layer_vkDestroyDevice) \
+    X(vkGetDeviceQueue, layer_vkGetDeviceQueue) \
+    X(vkGetDeviceQueue2, layer_vkGetDeviceQueue2) \
+    X(vkCreateSwapchainKHR, layer_vkCreateSwapchainKHR) \
+    X(vkDestroySwapchainKHR, layer_vkDestroySwapchainKHR) \
+    X(vkAcquireNextImageKHR, layer_vkAcquireNextImageKHR) \
+    X(vkQueuePresentKHR, layer_vkQueuePresentKHR) \
+    X(vkQueueSubmit, layer_vkQueueSubmit) \
+    X(vkQueueSubmit2, layer_vkQueueSubmit2) \
+    X(vkQueueSubmit2KHR, layer_vkQueueSubmit2KHR) \
+    X(vkQueueBindSparse, layer_vkQueueBindSparse) \
+    X(vkQueueWaitIdle, layer_vkQueueWaitIdle) \
+    X(vkDeviceWaitIdle, layer_vkDeviceWaitIdle)
+
+DECLARE_PROC_TABLE(instance_procs, FRAME_INTERP_INSTANCE_PROCS);
+DECLARE_PROC_TABLE(device_procs, FRAME_INTERP_DEVICE_PROCS);
+
 // Layer entry points
 VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance instance, const char* pName) {
     // Handle global functions
-    if (strcmp(pName, "vkGetInstanceProcAddr") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(vkGetInstanceProcAddr);
-    }
-    if (strcmp(pName, "vkCreateInstance") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(layer_vkCreateInstance);
-    }
-    if (strcmp(pName, "vkDestroyInstance") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(layer_vkDestroyInstance);
-    }
-    if (strcmp(pName, "vkCreateDevice") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(layer_vkCreateDevice);
+    if (PFN_vkVoidFunction function = instance_procs.Find(pName)) {
+        return function;
     }
     
     // Pass through to next layer
@@ -387,23 +777,8 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance instan
 
 VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice device, const char* pName) {
     // Handle device functions
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(vkGetDeviceProcAddr);
-    }
-    if (strcmp(pName, "vkDestroyDevice") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(layer_vkDestroyDevice);
-    }
-    if (strcmp(pName, "vkCreateSwapchainKHR") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(layer_vkCreateSwapchainKHR);
-    }
-    if (strcmp(pName, "vkDestroySwapchainKHR") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(layer_vkDestroySwapchainKHR);
-    }
-    if (strcmp(pName, "vkAcquireNextImageKHR") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(layer_vkAcquireNextImageKHR);
-    }
-    if (strcmp(pName, "vkQueuePresentKHR") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(layer_vkQueuePresentKHR);
+    if (PFN_vkVoidFunction function = device_procs.Find(pName)) {
+        return function;
     }
     
     // Pass through to next layer
@@ -419,18 +794,7 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(VkDevice device, co
 // Required layer entry points
 extern "C" {
     VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(uint32_t* pCount, VkLayerProperties* pProperties) {
-        if (pProperties == nullptr) {
-            *pCount = 1;
-            return VK_SUCCESS;
-        }
-        
-        if (*pCount < 1) {
-            return VK_INCOMPLETE;
-        }
-        
-        memcpy(pProperties, &layer_props, sizeof(layer_props));
-        *pCount = 1;
-        return VK_SUCCESS;
+        return EnumerateLayerProperties(layer_props, pCount, pProperties);
     }
     
     VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceLayerProperties(VkPhysicalDevice physicalDevice, uint32_t* pCount, VkLayerProperties* pProperties) {
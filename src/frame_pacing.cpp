@@ -0,0 +1,77 @@
+#include "frame_pacing.h"
+#include <algorithm>
+#include <thread>
+
+static FramePacer::Clock::duration ToDuration(float ms) {
+    return std::chrono::duration_cast<FramePacer::Clock::duration>(std::chrono::duration<float, std::milli>(ms));
+}
+
+PacingDecision FramePacer::OnFrame(Clock::time_point now) {
+    PacingDecision decision;
+    decision.synthetic_at = now;
+    decision.real_at = now;
+
+    if (!has_last_frame_) {
+        has_last_frame_ = true;
+        last_frame_ = now;
+        last_real_at_ = now;
+        return decision;
+    }
+
+    float interval_ms = std::chrono::duration<float, std::milli>(now - last_frame_).count();
+    last_frame_ = now;
+
+    if (intervals_.Size() >= kWarmupFrames && interval_ms > kHitchFactor * intervals_.Stats().avg) {
+        hitches_++;
+        // Keep the hitch out of the average unless the rate has moved
+        if (++consecutive_hitches_ >= 2) {
+            intervals_.Clear();
+            intervals_.Push(interval_ms);
+        }
+        Resync(now);
+        return decision;
+    }
+    consecutive_hitches_ = 0;
+    intervals_.Push(interval_ms);
+
+    if (intervals_.Size() < kWarmupFrames) {
+        Resync(now);
+        return decision;
+    }
+
+    FrameTimeStats stats = intervals_.Stats();
+    float nominal_ms = stats.avg;
+    float margin_ms = std::min((stats.max - stats.min) * 0.5f, nominal_ms * 0.5f);
+    Clock::time_point target = now + ToDuration(nominal_ms * 0.5f + margin_ms);
+
+    if (locked_) {
+        Clock::time_point predicted = last_real_at_ + ToDuration(nominal_ms);
+        float error_ms = std::chrono::duration<float, std::milli>(target - predicted).count();
+        decision.real_at = predicted + ToDuration(error_ms * kPhaseGain);
+    } else {
+        decision.real_at = target;
+        locked_ = true;
+    }
+
+    // Never earlier than now, never more than a full interval late
+    if (decision.real_at < now) decision.real_at = now;
+    if (decision.real_at > now + ToDuration(nominal_ms)) decision.real_at = now + ToDuration(nominal_ms);
+
+    decision.generate = true;
+    decision.synthetic_at = last_real_at_ + (decision.real_at - last_real_at_) / 2;
+    if (decision.synthetic_at < now) decision.synthetic_at = now;
+    last_real_at_ = decision.real_at;
+    return decision;
+}
+
+void SleepUntilPrecise(std::chrono::steady_clock::time_point deadline) {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point now = Clock::now();
+    if (deadline - now > kSpinWindow) {
+        std::this_thread::sleep_until(deadline - kSpinWindow);
+    }
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,118 @@
+#include "frame_stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
+size_t FrameStatsEngine::BucketIndex(float frametime_ms) {
+    const float lowest = std::ldexp(1.0f, kMinExponent);
+    const float highest = std::nextafter(std::ldexp(1.0f, kMaxExponent + 1), 0.0f);
+    float value = std::min(std::max(frametime_ms, lowest), highest);
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127;
+    uint32_t sub_bucket = (bits >> (23 - kSubBucketBits)) & ((1u << kSubBucketBits) - 1);
+
+    return (static_cast<size_t>(exponent - kMinExponent) << kSubBucketBits) | sub_bucket;
+}
+
+double FrameStatsEngine::BucketValue(size_t index) {
+    int exponent = static_cast<int>(index >> kSubBucketBits) + kMinExponent;
+    double sub_bucket = static_cast<double>(index & ((1u << kSubBucketBits) - 1));
+    double scale = static_cast<double>(1u << kSubBucketBits);
+    // Midpoint of [1 + s/scale, 1 + (s+1)/scale) * 2^exponent
+    return std::ldexp(1.0 + (sub_bucket + 0.5) / scale, exponent);
+}
+
+void FrameStatsEngine::Record(float frametime_ms) {
+    if (!(frametime_ms > 0.0f)) return;
+
+    buckets_[BucketIndex(frametime_ms)]++;
+
+    if (count_ == 0) {
+        min_ = frametime_ms;
+        max_ = frametime_ms;
+        movingAverage_ = frametime_ms;
+    } else {
+        min_ = std::min(min_, frametime_ms);
+        max_ = std::max(max_, frametime_ms);
+    }
+
+    // Welford's running mean/variance
+    count_++;
+    double delta = frametime_ms - mean_;
+    mean_ += delta / static_cast<double>(count_);
+    m2_ += delta * (frametime_ms - mean_);
+
+    // Compare against the average of the frames before this one
+    if (count_ > kWarmupFrames && frametime_ms > kStutterFactor * movingAverage_) {
+        stutters_++;
+    }
+    movingAverage_ += kAverageWeight * (frametime_ms - movingAverage_);
+}
+
+double FrameStatsEngine::Percentile(double fraction) const {
+    uint64_t target = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count_)));
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        seen += buckets_[i];
+        if (seen >= target) {
+            return std::min(std::max(BucketValue(i), static_cast<double>(min_)), static_cast<double>(max_));
+        }
+    }
+    return max_;
+}
+
+double FrameStatsEngine::SlowestAverageFps(uint64_t frames) const {
+    frames = std::max<uint64_t>(frames, 1);
+
+    uint64_t remaining = frames;
+    double total_ms = 0.0;
+    for (size_t i = kBucketCount; i-- > 0 && remaining > 0;) {
+        uint64_t take = std::min<uint64_t>(buckets_[i], remaining);
+        double value = std::min(BucketValue(i), static_cast<double>(max_));
+        total_ms += value * static_cast<double>(take);
+        remaining -= take;
+    }
+
+    uint64_t counted = frames - remaining;
+    return (counted > 0 && total_ms > 0.0) ? 1000.0 * static_cast<double>(counted) / total_ms : 0.0;
+}
+
+FrameStatsReport FrameStatsEngine::Report() const {
+    FrameStatsReport report;
+    report.frames = count_;
+    if (count_ == 0) return report;
+
+    report.mean_ms = mean_;
+    report.stddev_ms = (count_ > 1) ? std::sqrt(m2_ / static_cast<double>(count_ - 1)) : 0.0;
+    report.min_ms = min_;
+    report.max_ms = max_;
+    report.p50_ms = Percentile(0.50);
+    report.p95_ms = Percentile(0.95);
+    report.p99_ms = Percentile(0.99);
+    report.low1_fps = SlowestAverageFps(count_ / 100);
+    report.low01_fps = SlowestAverageFps(count_ / 1000);
+    report.stutters = stutters_;
+    return report;
+}
+
+void FrameStatsEngine::Reset() {
+    *this = FrameStatsEngine();
+}
+
+void PrintFrameStatsReport(std::ostream& out, const FrameStatsReport& report, const char* label) {
+    out << "[FRAME_INTERP] Stats (" << label << "): " << report.frames << " frames"
+        << std::fixed << std::setprecision(2)
+        << " avg " << report.mean_ms << "ms"
+        << " (FPS: " << (report.mean_ms > 0.0 ? 1000.0 / report.mean_ms : 0.0) << ")"
+        << " stddev " << report.stddev_ms << "ms"
+        << " min/max " << report.min_ms << "/" << report.max_ms << "ms"
+        << " p50/p95/p99 " << report.p50_ms << "/" << report.p95_ms << "/" << report.p99_ms << "ms"
+        << " 1% low " << report.low1_fps << " FPS"
+        << " 0.1% low " << report.low01_fps << " FPS"
+        << " stutters " << report.stutters << std::endl;
+}
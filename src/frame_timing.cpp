@@ -0,0 +1,79 @@
+#include "frame_timing.h"
+#include <cstdlib>
+
+// Frame timing and HUD bookkeeping. Runs on the application's thread at
+// every acquire; the history buffers are fixed-size and never allocate, and
+// file/console output is left to the swapchain's TelemetryWriter thread.
+
+// Seconds between periodic stats reports, from FRAME_INTERP_STATS_INTERVAL.
+// Zero (the default) reports only when the swapchain is destroyed.
+static std::chrono::steady_clock::duration StatsReportInterval() {
+    static const std::chrono::steady_clock::duration interval = []() {
+        const char* value = std::getenv("FRAME_INTERP_STATS_INTERVAL");
+        double seconds = value ? std::atof(value) : 0.0;
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(seconds > 0.0 ? seconds : 0.0));
+    }();
+    return interval;
+}
+
+void LogFrameTiming(SwapchainData* swapchain_data, uint32_t imageIndex) {
+    auto now = std::chrono::high_resolution_clock::now();
+    
+    if (swapchain_data->frameNumber > 0) {
+        auto frametime = std::chrono::duration<double, std::milli>(
+            now - swapchain_data->lastFrameTime).count();
+        
+        FrameTimingData timing_data;
+        timing_data.timestamp = now;
+        timing_data.imageIndex = imageIndex;
+        timing_data.presentMode = swapchain_data->presentMode;
+        timing_data.frametime_ms = frametime;
+        timing_data.frameNumber = swapchain_data->frameNumber;
+        
+        // Ring buffer keeps the last FrameHistory::kCapacity frames
+        swapchain_data->frameHistory.Push(timing_data);
+        
+        // Update HUD
+        UpdateHUD(swapchain_data, frametime);
+        
+        swapchain_data->stats.Record(static_cast<float>(frametime));
+        
+        // Hand off to the writer thread; console line every 60 frames
+        if (swapchain_data->telemetry) {
+            TelemetrySample sample = {};
+            sample.frameNumber = timing_data.frameNumber;
+            sample.frametime_ms = static_cast<float>(frametime);
+            sample.imageIndex = imageIndex;
+            sample.presentMode = static_cast<uint32_t>(timing_data.presentMode);
+            if (swapchain_data->sceneChanges != swapchain_data->loggedSceneChanges) {
+                sample.flags |= kTelemetryFlagSceneChange;
+                swapchain_data->loggedSceneChanges = swapchain_data->sceneChanges;
+            }
+            sample.logToConsole = (swapchain_data->frameNumber % 60 == 0);
+            if (sample.logToConsole) {
+                sample.hudStats = swapchain_data->hud.frametimes.Stats();
+            }
+            swapchain_data->telemetry->Push(sample);
+            
+            auto interval = StatsReportInterval();
+            if (interval.count() > 0) {
+                auto steady_now = std::chrono::steady_clock::now();
+                if (steady_now - swapchain_data->lastStatsReport >= interval) {
+                    swapchain_data->telemetry->PushReport(swapchain_data->stats.Report());
+                    swapchain_data->lastStatsReport = steady_now;
+                }
+            }
+        }
+    }
+    
+    swapchain_data->lastFrameTime = now;
+    swapchain_data->frameNumber++;
+}
+
+void UpdateHUD(SwapchainData* swapchain_data, double frametime_ms) {
+    if (!swapchain_data->hud.enabled) return;
+    
+    swapchain_data->hud.currentFrametime = frametime_ms;
+    swapchain_data->hud.frametimes.Push(static_cast<float>(frametime_ms));
+}
@@ -4,9 +4,10 @@
 #include <algorithm>
 
 // Global data
-std::unordered_map<void*, InstanceData*> instance_map;
-std::unordered_map<void*, DeviceData*> device_map;
-std::mutex global_mutex;
+DispatchMap<InstanceData> instance_map;
+DispatchMap<DeviceData> device_map;
+DispatchMap<PhysicalDeviceData> physical_device_map;
+DispatchMap<QueueData> queue_map;
 
 // Layer properties
 static const VkLayerProperties layer_props = {
@@ -18,76 +19,72 @@ static const VkLayerProperties layer_props = {
 
 // Utility functions
 InstanceData* GetInstanceData(VkInstance instance) {
-    std::lock_guard<std::mutex> lock(global_mutex);
-    auto it = instance_map.find(instance);
-    return (it != instance_map.end()) ? it->second : nullptr;
+    return instance_map.Get(GetDispatchKey(instance));
 }
 
 DeviceData* GetDeviceData(VkDevice device) {
-    std::lock_guard<std::mutex> lock(global_mutex);
-    auto it = device_map.find(device);
-    return (it != device_map.end()) ? it->second : nullptr;
+    return device_map.Get(GetDispatchKey(device));
 }
 
-std::string GetCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
+// Command buffers share their device's dispatch key
+DeviceData* GetDeviceData(VkCommandBuffer commandBuffer) {
+    return device_map.Get(GetDispatchKey(commandBuffer));
+}
+
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice) {
+    PhysicalDeviceData* physical_device_data = physical_device_map.Get(physicalDevice);
+    if (physical_device_data) return physical_device_data->instance_data;
+    // Not enumerated through this layer; a physical device shares its
+    // instance's dispatch key
+    return instance_map.Get(GetDispatchKey(physicalDevice));
+}
+
+DeviceData* GetDeviceData(VkQueue queue) {
+    QueueData* queue_data = queue_map.Get(queue);
+    return queue_data ? queue_data->device_data : nullptr;
 }
 
 void LogAPICall(const std::string& function_name, const std::string& details) {
-    std::string timestamp = GetCurrentTimestamp();
-    std::cout << "[" << timestamp << "] GREEN_TINT_LAYER: " << function_name;
-    if (!details.empty()) {
-        std::cout << " - " << details;
-    }
-    std::cout << std::endl;
-    std::cout.flush();
+    LogLayerMessage("GREEN_TINT_LAYER", function_name.c_str(), details.c_str());
 }
 
-// SPIR-V shader modification functions
-bool IsFragmentShader(const uint32_t* spirv_code, size_t spirv_size) {
-    if (spirv_size < 20) return false; // Too small to be valid SPIR-V
-    
-    // SPIR-V magic number check
-    if (spirv_code[0] != 0x07230203) return false;
-    
-    // Look for OpExecutionMode with Fragment execution model
-    for (size_t i = 5; i < spirv_size / 4; i++) {
-        uint32_t instruction = spirv_code[i];
-        uint16_t opcode = instruction & 0xFFFF;
-        uint16_t length = instruction >> 16;
-        
-        // OpExecutionMode = 16
-        if (opcode == 16 && length >= 3) {
-            // Check if execution model is Fragment (4)
-            if (i + 2 < spirv_size / 4 && spirv_code[i + 2] == 4) {
-                return true;
-            }
-        }
-        
-        i += length - 1; // Skip to next instruction
+// Builds the tint pass from the physical device's queue families. Without
+// one, presents pass through untinted.
+static void InitializeTintPass(DeviceData* device_data, const VkDeviceCreateInfo* pCreateInfo) {
+    InstanceData* instance_data = GetInstanceData(device_data->physical_device);
+    PFN_vkSetDeviceLoaderData set_device_loader_data = FindDeviceLoaderDataCallback(pCreateInfo);
+    if (!instance_data || !set_device_loader_data || !instance_data->vtable.GetPhysicalDeviceQueueFamilyProperties ||
+        !instance_data->vtable.GetPhysicalDeviceMemoryProperties) {
+        LogAPICall("InitializeTintPass", "Tint off: no instance, loader callback or physical device queries");
+        return;
     }
-    
-    return false;
-}
 
-std::vector<uint32_t> ModifyFragmentShader(const uint32_t* original_spirv, size_t spirv_size) {
-    // For now, we'll implement a simple approach:
-    // Just pass through the original shader and add green tint via push constants
-    // In a full implementation, we would parse and modify the SPIR-V bytecode
-    
-    std::vector<uint32_t> modified_spirv(original_spirv, original_spirv + spirv_size / 4);
-    
-    LogAPICall("ModifyFragmentShader", "Applied green tint modification");
-    
-    return modified_spirv;
+    TintPassDevice pass_device;
+    pass_device.device = device_data->device;
+    pass_device.physical_device = device_data->physical_device;
+    pass_device.set_device_loader_data = set_device_loader_data;
+    pass_device.get_format_properties = instance_data->vtable.GetPhysicalDeviceFormatProperties;
+    pass_device.get_surface_capabilities = instance_data->vtable.GetPhysicalDeviceSurfaceCapabilitiesKHR;
+    LoadTintPassDispatch(&pass_device.vk, device_data->device, device_data->vtable.GetDeviceProcAddr);
+    instance_data->vtable.GetPhysicalDeviceMemoryProperties(device_data->physical_device, &pass_device.memory_properties);
+    uint32_t family_count = 0;
+    instance_data->vtable.GetPhysicalDeviceQueueFamilyProperties(device_data->physical_device, &family_count, nullptr);
+    pass_device.queue_families.resize(family_count);
+    instance_data->vtable.GetPhysicalDeviceQueueFamilyProperties(device_data->physical_device, &family_count,
+                                                                 pass_device.queue_families.data());
+
+    if (instance_data->vtable.GetPhysicalDeviceProperties) {
+        VkPhysicalDeviceProperties properties;
+        instance_data->vtable.GetPhysicalDeviceProperties(device_data->physical_device, &properties);
+        device_data->pipeline_cache = PipelineDiskCache::Create(DiskCache::Shared(), LAYER_NAME, device_data->device,
+                                                                properties, device_data->vtable.GetDeviceProcAddr);
+        if (device_data->pipeline_cache) pass_device.pipeline_cache = device_data->pipeline_cache->handle();
+    }
+
+    device_data->tint_pass = TintPass::Create(pass_device, *pCreateInfo);
+    LogAPICall("InitializeTintPass", device_data->tint_pass
+                   ? "Tint pipeline built, swapchain images tinted at present"
+                   : "Tint off: pipeline setup failed");
 }
 
 // Vulkan API implementations
@@ -99,14 +96,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
     LogAPICall("vkCreateInstance", "Creating Vulkan instance with green tint layer");
     
     // Get the layer's instance proc addr
-    VkLayerInstanceCreateInfo* chain_info = 
-        (VkLayerInstanceCreateInfo*)pCreateInfo->pNext;
-    
-    while (chain_info && 
-           !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO &&
-             chain_info->function == VK_LAYER_LINK_INFO)) {
-        chain_info = (VkLayerInstanceCreateInfo*)chain_info->pNext;
-    }
+    VkLayerInstanceCreateInfo* chain_info = FindInstanceLinkInfo(pCreateInfo);
     
     if (!chain_info) {
         LogAPICall("vkCreateInstance", "No chain info - calling next layer directly");
@@ -122,11 +112,16 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
             instance_data->vtable.GetInstanceProcAddr = vkGetInstanceProcAddr;
             instance_data->vtable.DestroyInstance = (PFN_vkDestroyInstance)vkGetInstanceProcAddr(*pInstance, "vkDestroyInstance");
             instance_data->vtable.EnumeratePhysicalDevices = (PFN_vkEnumeratePhysicalDevices)vkGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDevices");
+            instance_data->vtable.EnumeratePhysicalDeviceGroups = (PFN_vkEnumeratePhysicalDeviceGroups)vkGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDeviceGroups");
+            instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR = (PFN_vkEnumeratePhysicalDeviceGroupsKHR)vkGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDeviceGroupsKHR");
             instance_data->vtable.GetPhysicalDeviceProperties = (PFN_vkGetPhysicalDeviceProperties)vkGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceProperties");
+            instance_data->vtable.GetPhysicalDeviceMemoryProperties = (PFN_vkGetPhysicalDeviceMemoryProperties)vkGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceMemoryProperties");
+            instance_data->vtable.GetPhysicalDeviceQueueFamilyProperties = (PFN_vkGetPhysicalDeviceQueueFamilyProperties)vkGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceQueueFamilyProperties");
+            instance_data->vtable.GetPhysicalDeviceFormatProperties = (PFN_vkGetPhysicalDeviceFormatProperties)vkGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceFormatProperties");
+            instance_data->vtable.GetPhysicalDeviceSurfaceCapabilitiesKHR = (PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR)vkGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceSurfaceCapabilitiesKHR");
             instance_data->vtable.CreateDevice = (PFN_vkCreateDevice)vkGetInstanceProcAddr(*pInstance, "vkCreateDevice");
             
-            std::lock_guard<std::mutex> lock(global_mutex);
-            instance_map[*pInstance] = instance_data;
+            instance_map.Insert(GetDispatchKey(*pInstance), instance_data);
             LogAPICall("vkCreateInstance", "Instance created successfully");
         }
         return result;
@@ -154,12 +149,15 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
         pTable->DestroyInstance = (PFN_vkDestroyInstance)gpa(*pInstance, "vkDestroyInstance");
         pTable->CreateDevice = (PFN_vkCreateDevice)gpa(*pInstance, "vkCreateDevice");
         pTable->EnumeratePhysicalDevices = (PFN_vkEnumeratePhysicalDevices)gpa(*pInstance, "vkEnumeratePhysicalDevices");
+        pTable->EnumeratePhysicalDeviceGroups = (PFN_vkEnumeratePhysicalDeviceGroups)gpa(*pInstance, "vkEnumeratePhysicalDeviceGroups");
+        pTable->EnumeratePhysicalDeviceGroupsKHR = (PFN_vkEnumeratePhysicalDeviceGroupsKHR)gpa(*pInstance, "vkEnumeratePhysicalDeviceGroupsKHR");
         pTable->GetPhysicalDeviceProperties = (PFN_vkGetPhysicalDeviceProperties)gpa(*pInstance, "vkGetPhysicalDeviceProperties");
+        pTable->GetPhysicalDeviceMemoryProperties = (PFN_vkGetPhysicalDeviceMemoryProperties)gpa(*pInstance, "vkGetPhysicalDeviceMemoryProperties");
+        pTable->GetPhysicalDeviceQueueFamilyProperties = (PFN_vkGetPhysicalDeviceQueueFamilyProperties)gpa(*pInstance, "vkGetPhysicalDeviceQueueFamilyProperties");
+        pTable->GetPhysicalDeviceFormatProperties = (PFN_vkGetPhysicalDeviceFormatProperties)gpa(*pInstance, "vkGetPhysicalDeviceFormatProperties");
+        pTable->GetPhysicalDeviceSurfaceCapabilitiesKHR = (PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR)gpa(*pInstance, "vkGetPhysicalDeviceSurfaceCapabilitiesKHR");
         
-        {
-            std::lock_guard<std::mutex> lock(global_mutex);
-            instance_map[*pInstance] = instance_data;
-        }
+        instance_map.Insert(GetDispatchKey(*pInstance), instance_data);
         
         LogAPICall("vkCreateInstance", "Instance created successfully");
     }
@@ -173,7 +171,8 @@ VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(
     
     LogAPICall("vkDestroyInstance", "Destroying Vulkan instance");
     
-    InstanceData* instance_data = GetInstanceData(instance);
+    void* key = GetDispatchKey(instance);
+    InstanceData* instance_data = instance_map.Get(key);
     if (instance_data && instance_data->vtable.DestroyInstance) {
         instance_data->vtable.DestroyInstance(instance, pAllocator);
     } else {
@@ -184,8 +183,8 @@ VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(
     }
     
     if (instance_data) {
-        std::lock_guard<std::mutex> lock(global_mutex);
-        instance_map.erase(instance);
+        instance_map.Erase(key);
+        ReleasePhysicalDevices(physical_device_map, instance_data);
         delete instance_data;
         LogAPICall("vkDestroyInstance", "Instance destroyed successfully");
     }
@@ -199,14 +198,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(
     
     LogAPICall("vkCreateDevice", "Creating logical device");
     
-    VkLayerDeviceCreateInfo* chain_info = 
-        (VkLayerDeviceCreateInfo*)pCreateInfo->pNext;
-    
-    while (chain_info && 
-           !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO &&
-             chain_info->function == VK_LAYER_LINK_INFO)) {
-        chain_info = (VkLayerDeviceCreateInfo*)chain_info->pNext;
-    }
+    VkLayerDeviceCreateInfo* chain_info = FindDeviceLinkInfo(pCreateInfo);
     
     if (!chain_info) {
         LogAPICall("vkCreateDevice", "No chain info found");
@@ -229,25 +221,20 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(
     if (result == VK_SUCCESS) {
         DeviceData* device_data = new DeviceData();
         device_data->device = *pDevice;
+        device_data->physical_device = physicalDevice;
         
         // Initialize dispatch table
         LayerDeviceDispatchTable* pTable = &device_data->vtable;
         pTable->GetDeviceProcAddr = gdpa;
         pTable->DestroyDevice = (PFN_vkDestroyDevice)gdpa(*pDevice, "vkDestroyDevice");
-        pTable->CreateShaderModule = (PFN_vkCreateShaderModule)gdpa(*pDevice, "vkCreateShaderModule");
-        pTable->DestroyShaderModule = (PFN_vkDestroyShaderModule)gdpa(*pDevice, "vkDestroyShaderModule");
-        pTable->CreateRenderPass = (PFN_vkCreateRenderPass)gdpa(*pDevice, "vkCreateRenderPass");
-        pTable->DestroyRenderPass = (PFN_vkDestroyRenderPass)gdpa(*pDevice, "vkDestroyRenderPass");
-        pTable->CmdBeginRenderPass = (PFN_vkCmdBeginRenderPass)gdpa(*pDevice, "vkCmdBeginRenderPass");
-        pTable->CmdEndRenderPass = (PFN_vkCmdEndRenderPass)gdpa(*pDevice, "vkCmdEndRenderPass");
-        pTable->CmdDraw = (PFN_vkCmdDraw)gdpa(*pDevice, "vkCmdDraw");
-        pTable->CmdDrawIndexed = (PFN_vkCmdDrawIndexed)gdpa(*pDevice, "vkCmdDrawIndexed");
+        pTable->GetDeviceQueue = (PFN_vkGetDeviceQueue)gdpa(*pDevice, "vkGetDeviceQueue");
+        pTable->GetDeviceQueue2 = (PFN_vkGetDeviceQueue2)gdpa(*pDevice, "vkGetDeviceQueue2");
+        pTable->CreateSwapchainKHR = (PFN_vkCreateSwapchainKHR)gdpa(*pDevice, "vkCreateSwapchainKHR");
+        pTable->DestroySwapchainKHR = (PFN_vkDestroySwapchainKHR)gdpa(*pDevice, "vkDestroySwapchainKHR");
         pTable->QueuePresentKHR = (PFN_vkQueuePresentKHR)gdpa(*pDevice, "vkQueuePresentKHR");
         
-        {
-            std::lock_guard<std::mutex> lock(global_mutex);
-            device_map[*pDevice] = device_data;
-        }
+        device_map.Insert(GetDispatchKey(*pDevice), device_data);
+        InitializeTintPass(device_data, pCreateInfo);
         
         LogAPICall("vkCreateDevice", "Device created successfully");
     }
@@ -261,196 +248,86 @@ VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(
     
     LogAPICall("vkDestroyDevice", "Destroying logical device");
     
-    DeviceData* device_data = GetDeviceData(device);
+    void* key = GetDispatchKey(device);
+    DeviceData* device_data = device_map.Get(key);
     if (device_data && device_data->vtable.DestroyDevice) {
+        // Waits for in-flight tints
+        device_data->tint_pass.reset();
+        device_data->pipeline_cache.reset();
         device_data->vtable.DestroyDevice(device, pAllocator);
     }
     
     if (device_data) {
-        std::lock_guard<std::mutex> lock(global_mutex);
-        device_map.erase(device);
+        device_map.Erase(key);
+        ReleaseQueues(queue_map, device_data);
         delete device_data;
         LogAPICall("vkDestroyDevice", "Device destroyed successfully");
     }
 }
 
-VKAPI_ATTR VkResult VKAPI_CALL vkCreateShaderModule(
+VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue(
     VkDevice device,
-    const VkShaderModuleCreateInfo* pCreateInfo,
-    const VkAllocationCallbacks* pAllocator,
-    VkShaderModule* pShaderModule) {
-    
-    LogAPICall("vkCreateShaderModule", "Intercepting shader creation");
+    uint32_t queueFamilyIndex,
+    uint32_t queueIndex,
+    VkQueue* pQueue) {
     
     DeviceData* device_data = GetDeviceData(device);
-    if (!device_data || !device_data->vtable.CreateShaderModule) {
-        LogAPICall("vkCreateShaderModule", "ERROR: No device data or function");
-        return VK_ERROR_INITIALIZATION_FAILED;
-    }
-    
-    // Check if this is a fragment shader and modify it
-    if (IsFragmentShader((const uint32_t*)pCreateInfo->pCode, pCreateInfo->codeSize)) {
-        LogAPICall("vkCreateShaderModule", "Found fragment shader - applying green tint");
-        
-        // For demonstration, we'll modify the clear color approach
-        // In a full implementation, we'd parse and modify the SPIR-V bytecode
-        auto modified_spirv = ModifyFragmentShader((const uint32_t*)pCreateInfo->pCode, pCreateInfo->codeSize);
-        
-        VkShaderModuleCreateInfo modified_create_info = *pCreateInfo;
-        modified_create_info.codeSize = modified_spirv.size() * sizeof(uint32_t);
-        modified_create_info.pCode = modified_spirv.data();
-        
-        VkResult result = device_data->vtable.CreateShaderModule(device, &modified_create_info, pAllocator, pShaderModule);
-        if (result == VK_SUCCESS) {
-            LogAPICall("vkCreateShaderModule", "Fragment shader with green tint created");
-        }
-        return result;
-    } else {
-        LogAPICall("vkCreateShaderModule", "Non-fragment shader - passing through");
-        return device_data->vtable.CreateShaderModule(device, pCreateInfo, pAllocator, pShaderModule);
+    if (device_data && device_data->vtable.GetDeviceQueue) {
+        device_data->vtable.GetDeviceQueue(device, queueFamilyIndex, queueIndex, pQueue);
+        TrackQueue(queue_map, device_data, *pQueue, queueFamilyIndex, queueIndex);
     }
 }
 
-VKAPI_ATTR void VKAPI_CALL vkDestroyShaderModule(
+VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue2(
     VkDevice device,
-    VkShaderModule shaderModule,
-    const VkAllocationCallbacks* pAllocator) {
+    const VkDeviceQueueInfo2* pQueueInfo,
+    VkQueue* pQueue) {
     
     DeviceData* device_data = GetDeviceData(device);
-    if (device_data && device_data->vtable.DestroyShaderModule) {
-        device_data->vtable.DestroyShaderModule(device, shaderModule, pAllocator);
+    if (device_data && device_data->vtable.GetDeviceQueue2) {
+        device_data->vtable.GetDeviceQueue2(device, pQueueInfo, pQueue);
+        TrackQueue(queue_map, device_data, *pQueue, pQueueInfo->queueFamilyIndex, pQueueInfo->queueIndex);
     }
 }
 
-VKAPI_ATTR VkResult VKAPI_CALL vkCreateRenderPass(
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateSwapchainKHR(
     VkDevice device,
-    const VkRenderPassCreateInfo* pCreateInfo,
+    const VkSwapchainCreateInfoKHR* pCreateInfo,
     const VkAllocationCallbacks* pAllocator,
-    VkRenderPass* pRenderPass) {
-    
-    LogAPICall("vkCreateRenderPass", "Intercepting render pass creation for green tinting");
+    VkSwapchainKHR* pSwapchain) {
     
     DeviceData* device_data = GetDeviceData(device);
-    if (!device_data || !device_data->vtable.CreateRenderPass) {
+    if (!device_data || !device_data->vtable.CreateSwapchainKHR) {
         return VK_ERROR_INITIALIZATION_FAILED;
     }
     
-    return device_data->vtable.CreateRenderPass(device, pCreateInfo, pAllocator, pRenderPass);
-}
-
-VKAPI_ATTR void VKAPI_CALL vkDestroyRenderPass(
-    VkDevice device,
-    VkRenderPass renderPass,
-    const VkAllocationCallbacks* pAllocator) {
-    
-    DeviceData* device_data = GetDeviceData(device);
-    if (device_data && device_data->vtable.DestroyRenderPass) {
-        device_data->vtable.DestroyRenderPass(device, renderPass, pAllocator);
-    }
-}
-
-VKAPI_ATTR void VKAPI_CALL vkCmdBeginRenderPass(
-    VkCommandBuffer commandBuffer,
-    const VkRenderPassBeginInfo* pRenderPassBegin,
-    VkSubpassContents contents) {
-    
-    LogAPICall("vkCmdBeginRenderPass", "Intercepting render pass - applying green tint to clear values");
+    // The tint needs storage or transfer usage on the images, by format
+    VkSwapchainCreateInfoKHR create_info = *pCreateInfo;
+    bool prepared = device_data->tint_pass && device_data->tint_pass->PrepareSwapchain(&create_info);
     
-    // Make a copy of the render pass begin info and modify clear values
-    VkRenderPassBeginInfo modified_begin_info = *pRenderPassBegin;
-    std::vector<VkClearValue> modified_clear_values;
+    VkResult result = device_data->vtable.CreateSwapchainKHR(device, &create_info, pAllocator, pSwapchain);
+    if (result != VK_SUCCESS || !device_data->tint_pass) return result;
     
-    if (pRenderPassBegin->clearValueCount > 0 && pRenderPassBegin->pClearValues) {
-        modified_clear_values.assign(
-            pRenderPassBegin->pClearValues,
-            pRenderPassBegin->pClearValues + pRenderPassBegin->clearValueCount
-        );
-        
-        // Apply strong green tint to ALL clear values
-        for (uint32_t i = 0; i < pRenderPassBegin->clearValueCount; i++) {
-            // Make background clearly green
-            modified_clear_values[i].color.float32[0] = 0.0f; // Zero red
-            modified_clear_values[i].color.float32[1] = 0.8f; // Strong green
-            modified_clear_values[i].color.float32[2] = 0.0f; // Zero blue
-            modified_clear_values[i].color.float32[3] = 1.0f; // Full alpha
-        }
-        
-        modified_begin_info.pClearValues = modified_clear_values.data();
-        LogAPICall("vkCmdBeginRenderPass", "Forced green background on " + std::to_string(pRenderPassBegin->clearValueCount) + " clear values");
-    }
-    
-    // Find the device for this command buffer
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdBeginRenderPass) {
-            device_data->vtable.CmdBeginRenderPass(commandBuffer, &modified_begin_info, contents);
-            return;
-        }
-    }
-}
-
-VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderPass(VkCommandBuffer commandBuffer) {
-    // Find the device for this command buffer
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdEndRenderPass) {
-            device_data->vtable.CmdEndRenderPass(commandBuffer);
-            return;
-        }
-    }
-}
-
-// Draw command interceptions for green tint effect
-VKAPI_ATTR void VKAPI_CALL vkCmdDraw(
-    VkCommandBuffer commandBuffer,
-    uint32_t vertexCount,
-    uint32_t instanceCount,
-    uint32_t firstVertex,
-    uint32_t firstInstance) {
-    
-    static int draw_count = 0;
-    draw_count++;
-    
-    if (draw_count % 100 == 0) { // Log every 100 draws to reduce spam
-        LogAPICall("vkCmdDraw", "Draw call " + std::to_string(draw_count) + " - green tint active");
-    }
-    
-    // Find the device for this command buffer
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdDraw) {
-            device_data->vtable.CmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
-            return;
-        }
+    if (!prepared) {
+        LogAPICall("vkCreateSwapchainKHR", "Swapchain presents untinted: format " +
+                   std::to_string(pCreateInfo->imageFormat) + " can't be tinted on this surface");
+    } else if (!device_data->tint_pass->AddSwapchain(*pSwapchain, create_info)) {
+        LogAPICall("vkCreateSwapchainKHR", "Swapchain presents untinted: tint setup failed");
     }
+    return result;
 }
 
-VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndexed(
-    VkCommandBuffer commandBuffer,
-    uint32_t indexCount,
-    uint32_t instanceCount,
-    uint32_t firstIndex,
-    int32_t vertexOffset,
-    uint32_t firstInstance) {
-    
-    static int indexed_draw_count = 0;
-    indexed_draw_count++;
-    
-    if (indexed_draw_count % 100 == 0) { // Log every 100 draws to reduce spam
-        LogAPICall("vkCmdDrawIndexed", "Indexed draw call " + std::to_string(indexed_draw_count) + " - green tint active");
-    }
+VKAPI_ATTR void VKAPI_CALL vkDestroySwapchainKHR(
+    VkDevice device,
+    VkSwapchainKHR swapchain,
+    const VkAllocationCallbacks* pAllocator) {
     
-    // Find the device for this command buffer
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdDrawIndexed) {
-            device_data->vtable.CmdDrawIndexed(commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
-            return;
+    DeviceData* device_data = GetDeviceData(device);
+    if (device_data && device_data->vtable.DestroySwapchainKHR) {
+        if (device_data->tint_pass) {
+            device_data->tint_pass->RemoveSwapchain(swapchain);
         }
+        device_data->vtable.DestroySwapchainKHR(device, swapchain, pAllocator);
     }
 }
 
@@ -458,32 +335,24 @@ VKAPI_ATTR VkResult VKAPI_CALL vkQueuePresentKHR(
     VkQueue queue,
     const VkPresentInfoKHR* pPresentInfo) {
     
-    // For a simple demonstration, we could intercept and modify the swapchain images
-    // However, this requires significant Vulkan API knowledge and proper synchronization
-    
-    // A more practical approach for testing would be to implement the tint via:
-    // 1. Intercepting render passes and modifying clear colors
-    // 2. Injecting a post-processing pass
-    // 3. Modifying the presentation semaphore chain
-    
-    static int frame_count = 0;
-    frame_count++;
-    
-    // Log every 60 frames to reduce spam but show it's working
-    if (frame_count % 60 == 0) {
-        LogAPICall("vkQueuePresentKHR", "Green tint layer active (frame " + std::to_string(frame_count) + ")");
+    DeviceData* device_data = GetDeviceData(queue);
+    if (!device_data || !device_data->vtable.QueuePresentKHR) {
+        return VK_ERROR_INITIALIZATION_FAILED;
     }
     
-    // For now, pass through unchanged - real tinting would require complex image manipulation
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.QueuePresentKHR) {
-            return device_data->vtable.QueuePresentKHR(queue, pPresentInfo);
+    // The tint may swap the present's wait semaphores for its own
+    VkPresentInfoKHR present_info = *pPresentInfo;
+    if (device_data->tint_pass) {
+        bool tinted = device_data->tint_pass->Draw(queue, &present_info);
+        
+        uint64_t frame_count = ++device_data->present_count;
+        if (frame_count % 60 == 0) {
+            LogAPICall("vkQueuePresentKHR", "Frame " + std::to_string(frame_count) +
+                       (tinted ? " tinted" : " presented untinted"));
         }
     }
     
-    return VK_ERROR_INITIALIZATION_FAILED;
+    return device_data->vtable.QueuePresentKHR(queue, &present_info);
 }
 
 // Implementation of remaining functions (similar to logger layer)
@@ -494,7 +363,11 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(
     
     InstanceData* instance_data = GetInstanceData(instance);
     if (instance_data && instance_data->vtable.EnumeratePhysicalDevices) {
-        return instance_data->vtable.EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
+        VkResult result = instance_data->vtable.EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
+        if ((result == VK_SUCCESS || result == VK_INCOMPLETE) && pPhysicalDevices) {
+            TrackPhysicalDevices(physical_device_map, instance_data, *pPhysicalDeviceCount, pPhysicalDevices);
+        }
+        return result;
     }
     
     PFN_vkEnumeratePhysicalDevices fpEnumerate = (PFN_vkEnumeratePhysicalDevices)vkGetInstanceProcAddr(instance, "vkEnumeratePhysicalDevices");
@@ -505,36 +378,89 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(
     return VK_ERROR_INITIALIZATION_FAILED;
 }
 
+// Devices in a group are tracked like individually enumerated ones
+static VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    
+    LogAPICall("vkEnumeratePhysicalDeviceGroups", "Enumerating physical device groups");
+    
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->vtable.EnumeratePhysicalDeviceGroups) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    
+    VkResult result = instance_data->vtable.EnumeratePhysicalDeviceGroups(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroupsKHR(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    
+    LogAPICall("vkEnumeratePhysicalDeviceGroupsKHR", "Enumerating physical device groups");
+    
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    
+    VkResult result = instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    return result;
+}
+
 VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(
     VkPhysicalDevice physicalDevice,
     VkPhysicalDeviceProperties* pProperties) {
     
-    std::lock_guard<std::mutex> lock(global_mutex);
-    if (!instance_map.empty()) {
-        InstanceData* instance_data = instance_map.begin()->second;
-        if (instance_data && instance_data->vtable.GetPhysicalDeviceProperties) {
-            instance_data->vtable.GetPhysicalDeviceProperties(physicalDevice, pProperties);
-            return;
-        }
+    InstanceData* instance_data = GetInstanceData(physicalDevice);
+    if (instance_data && instance_data->vtable.GetPhysicalDeviceProperties) {
+        instance_data->vtable.GetPhysicalDeviceProperties(physicalDevice, pProperties);
     }
 }
 
+// Entry points this layer intercepts
+#define GREEN_TINT_INSTANCE_PROCS(X) \
+    X(vkCreateInstance, vkCreateInstance) \
+    X(vkDestroyInstance, vkDestroyInstance) \
+    X(vkEnumeratePhysicalDevices, vkEnumeratePhysicalDevices) \
+    X(vkEnumeratePhysicalDeviceGroups, vkEnumeratePhysicalDeviceGroups) \
+    X(vkEnumeratePhysicalDeviceGroupsKHR, vkEnumeratePhysicalDeviceGroupsKHR) \
+    X(vkGetPhysicalDeviceProperties, vkGetPhysicalDeviceProperties) \
+    X(vkCreateDevice, vkCreateDevice) \
+    X(vkGetInstanceProcAddr, vkGetInstanceProcAddr) \
+    X(vkGetDeviceProcAddr, vkGetDeviceProcAddr) \
+    X(vkEnumerateInstanceLayerProperties, vkEnumerateInstanceLayerProperties) \
+    X(vkEnumerateInstanceExtensionProperties, vkEnumerateInstanceExtensionProperties) \
+    X(vkEnumerateDeviceLayerProperties, vkEnumerateDeviceLayerProperties) \
+    X(vkEnumerateDeviceExtensionProperties, vkEnumerateDeviceExtensionProperties)
+
+#define GREEN_TINT_DEVICE_PROCS(X) \
+    X(vkDestroyDevice, vkDestroyDevice) \
+    X(vkGetDeviceQueue, vkGetDeviceQueue) \
+    X(vkGetDeviceQueue2, vkGetDeviceQueue2) \
+    X(vkCreateSwapchainKHR, vkCreateSwapchainKHR) \
+    X(vkDestroySwapchainKHR, vkDestroySwapchainKHR) \
+    X(vkQueuePresentKHR, vkQueuePresentKHR) \
+    X(vkGetDeviceProcAddr, vkGetDeviceProcAddr)
+
+DECLARE_PROC_TABLE(instance_procs, GREEN_TINT_INSTANCE_PROCS);
+DECLARE_PROC_TABLE(device_procs, GREEN_TINT_DEVICE_PROCS);
+
 VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(
     VkInstance instance,
     const char* pName) {
     
     // Return our layer's functions
-    if (strcmp(pName, "vkCreateInstance") == 0) return (PFN_vkVoidFunction)vkCreateInstance;
-    if (strcmp(pName, "vkDestroyInstance") == 0) return (PFN_vkVoidFunction)vkDestroyInstance;
-    if (strcmp(pName, "vkEnumeratePhysicalDevices") == 0) return (PFN_vkVoidFunction)vkEnumeratePhysicalDevices;
-    if (strcmp(pName, "vkGetPhysicalDeviceProperties") == 0) return (PFN_vkVoidFunction)vkGetPhysicalDeviceProperties;
-    if (strcmp(pName, "vkCreateDevice") == 0) return (PFN_vkVoidFunction)vkCreateDevice;
-    if (strcmp(pName, "vkGetInstanceProcAddr") == 0) return (PFN_vkVoidFunction)vkGetInstanceProcAddr;
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) return (PFN_vkVoidFunction)vkGetDeviceProcAddr;
-    if (strcmp(pName, "vkEnumerateInstanceLayerProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateInstanceLayerProperties;
-    if (strcmp(pName, "vkEnumerateInstanceExtensionProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateInstanceExtensionProperties;
-    if (strcmp(pName, "vkEnumerateDeviceLayerProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateDeviceLayerProperties;
-    if (strcmp(pName, "vkEnumerateDeviceExtensionProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateDeviceExtensionProperties;
+    if (PFN_vkVoidFunction function = instance_procs.Find(pName)) return function;
     
     if (instance) {
         InstanceData* instance_data = GetInstanceData(instance);
@@ -551,17 +477,7 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(
     const char* pName) {
     
     // Return our layer's functions
-    if (strcmp(pName, "vkDestroyDevice") == 0) return (PFN_vkVoidFunction)vkDestroyDevice;
-    if (strcmp(pName, "vkCreateShaderModule") == 0) return (PFN_vkVoidFunction)vkCreateShaderModule;
-    if (strcmp(pName, "vkDestroyShaderModule") == 0) return (PFN_vkVoidFunction)vkDestroyShaderModule;
-    if (strcmp(pName, "vkCreateRenderPass") == 0) return (PFN_vkVoidFunction)vkCreateRenderPass;
-    if (strcmp(pName, "vkDestroyRenderPass") == 0) return (PFN_vkVoidFunction)vkDestroyRenderPass;
-    if (strcmp(pName, "vkCmdBeginRenderPass") == 0) return (PFN_vkVoidFunction)vkCmdBeginRenderPass;
-    if (strcmp(pName, "vkCmdEndRenderPass") == 0) return (PFN_vkVoidFunction)vkCmdEndRenderPass;
-    if (strcmp(pName, "vkCmdDraw") == 0) return (PFN_vkVoidFunction)vkCmdDraw;
-    if (strcmp(pName, "vkCmdDrawIndexed") == 0) return (PFN_vkVoidFunction)vkCmdDrawIndexed;
-    if (strcmp(pName, "vkQueuePresentKHR") == 0) return (PFN_vkVoidFunction)vkQueuePresentKHR;
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) return (PFN_vkVoidFunction)vkGetDeviceProcAddr;
+    if (PFN_vkVoidFunction function = device_procs.Find(pName)) return function;
     
     if (device) {
         DeviceData* device_data = GetDeviceData(device);
@@ -577,18 +493,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(
     uint32_t* pPropertyCount,
     VkLayerProperties* pProperties) {
     
-    if (pProperties == nullptr) {
-        *pPropertyCount = 1;
-        return VK_SUCCESS;
-    }
-    
-    if (*pPropertyCount >= 1) {
-        memcpy(pProperties, &layer_props, sizeof(VkLayerProperties));
-        *pPropertyCount = 1;
-        return VK_SUCCESS;
-    }
-    
-    return VK_INCOMPLETE;
+    return EnumerateLayerProperties(layer_props, pPropertyCount, pProperties);
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(
@@ -625,16 +530,13 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(
     }
     
     // Forward to next layer/driver for extension enumeration
-    std::lock_guard<std::mutex> lock(global_mutex);
-    if (!instance_map.empty()) {
-        InstanceData* instance_data = instance_map.begin()->second;
-        if (instance_data && instance_data->vtable.GetInstanceProcAddr) {
-            PFN_vkEnumerateDeviceExtensionProperties fpEnumerate = 
-                (PFN_vkEnumerateDeviceExtensionProperties)instance_data->vtable.GetInstanceProcAddr(
-                    instance_data->instance, "vkEnumerateDeviceExtensionProperties");
-            if (fpEnumerate) {
-                return fpEnumerate(physicalDevice, pLayerName, pPropertyCount, pProperties);
-            }
+    InstanceData* instance_data = GetInstanceData(physicalDevice);
+    if (instance_data && instance_data->vtable.GetInstanceProcAddr) {
+        PFN_vkEnumerateDeviceExtensionProperties fpEnumerate = 
+            (PFN_vkEnumerateDeviceExtensionProperties)instance_data->vtable.GetInstanceProcAddr(
+                instance_data->instance, "vkEnumerateDeviceExtensionProperties");
+        if (fpEnumerate) {
+            return fpEnumerate(physicalDevice, pLayerName, pPropertyCount, pProperties);
         }
     }
     
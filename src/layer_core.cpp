@@ -0,0 +1,80 @@
+#include "layer_core.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+VkLayerInstanceCreateInfo* FindInstanceLinkInfo(const VkInstanceCreateInfo* pCreateInfo) {
+    VkLayerInstanceCreateInfo* chain_info = (VkLayerInstanceCreateInfo*)pCreateInfo->pNext;
+    while (chain_info &&
+           !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO &&
+             chain_info->function == VK_LAYER_LINK_INFO)) {
+        chain_info = (VkLayerInstanceCreateInfo*)chain_info->pNext;
+    }
+    return chain_info;
+}
+
+VkLayerDeviceCreateInfo* FindDeviceLinkInfo(const VkDeviceCreateInfo* pCreateInfo) {
+    VkLayerDeviceCreateInfo* chain_info = (VkLayerDeviceCreateInfo*)pCreateInfo->pNext;
+    while (chain_info &&
+           !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO &&
+             chain_info->function == VK_LAYER_LINK_INFO)) {
+        chain_info = (VkLayerDeviceCreateInfo*)chain_info->pNext;
+    }
+    return chain_info;
+}
+
+PFN_vkSetDeviceLoaderData FindDeviceLoaderDataCallback(const VkDeviceCreateInfo* pCreateInfo) {
+    VkLayerDeviceCreateInfo* chain_info = (VkLayerDeviceCreateInfo*)pCreateInfo->pNext;
+    while (chain_info &&
+           !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO &&
+             chain_info->function == VK_LOADER_DATA_CALLBACK)) {
+        chain_info = (VkLayerDeviceCreateInfo*)chain_info->pNext;
+    }
+    return chain_info ? chain_info->u.pfnSetDeviceLoaderData : nullptr;
+}
+
+VkResult EnumerateLayerProperties(const VkLayerProperties& layer_props, uint32_t* pPropertyCount,
+                                  VkLayerProperties* pProperties) {
+    if (pProperties == nullptr) {
+        *pPropertyCount = 1;
+        return VK_SUCCESS;
+    }
+
+    if (*pPropertyCount < 1) {
+        return VK_INCOMPLETE;
+    }
+
+    memcpy(pProperties, &layer_props, sizeof(VkLayerProperties));
+    *pPropertyCount = 1;
+    return VK_SUCCESS;
+}
+
+void FormatTimestamp(char* buffer, size_t size) {
+    auto now = std::chrono::system_clock::now();
+    std::time_t seconds = std::chrono::system_clock::to_time_t(now);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now.time_since_epoch()) % 1000;
+
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    size_t length = std::strftime(buffer, size, "%H:%M:%S", &local);
+    std::snprintf(buffer + length, size - length, ".%03d", static_cast<int>(ms.count()));
+}
+
+void LogLayerMessage(const char* prefix, const char* function_name, const char* details) {
+    char timestamp[16];
+    FormatTimestamp(timestamp, sizeof(timestamp));
+
+    bool has_details = details && *details;
+    char line[kMaxLogLineBytes];
+    int length = std::snprintf(line, sizeof(line), "[%s] %s: %s%s%s\n", timestamp, prefix, function_name,
+                               has_details ? " - " : "", has_details ? details : "");
+    if (length < 0) return;
+    if (static_cast<size_t>(length) >= sizeof(line)) {
+        length = sizeof(line) - 1;
+        line[length - 1] = '\n';
+    }
+    std::cout.write(line, length).flush();
+}
@@ -1,11 +1,11 @@
 #include "logger_layer.h"
+#include <cstdlib>
 #include <cstring>
-#include <sstream>
 
 // Global data
-std::unordered_map<void*, InstanceData*> instance_map;
-std::unordered_map<void*, DeviceData*> device_map;
-std::mutex global_mutex;
+DispatchMap<InstanceData> instance_map;
+DispatchMap<DeviceData> device_map;
+DispatchMap<PhysicalDeviceData> physical_device_map;
 
 // Layer properties
 static const VkLayerProperties layer_props = {
@@ -17,37 +17,43 @@ static const VkLayerProperties layer_props = {
 
 // Utility functions
 InstanceData* GetInstanceData(VkInstance instance) {
-    std::lock_guard<std::mutex> lock(global_mutex);
-    auto it = instance_map.find(instance);
-    return (it != instance_map.end()) ? it->second : nullptr;
+    return instance_map.Get(GetDispatchKey(instance));
 }
 
 DeviceData* GetDeviceData(VkDevice device) {
-    std::lock_guard<std::mutex> lock(global_mutex);
-    auto it = device_map.find(device);
-    return (it != device_map.end()) ? it->second : nullptr;
+    return device_map.Get(GetDispatchKey(device));
 }
 
-std::string GetCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%H:%M:%S");
-    ss << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
+// Queues and command buffers share their device's dispatch key
+DeviceData* GetDeviceData(VkQueue queue) {
+    return device_map.Get(GetDispatchKey(queue));
 }
 
-void LogAPICall(const std::string& function_name, const std::string& details) {
-    std::string timestamp = GetCurrentTimestamp();
-    std::cout << "[" << timestamp << "] VULKAN_LAYER: " << function_name;
-    if (!details.empty()) {
-        std::cout << " - " << details;
-    }
-    std::cout << std::endl;
-    std::cout.flush(); // Force immediate output
+DeviceData* GetDeviceData(VkCommandBuffer commandBuffer) {
+    return device_map.Get(GetDispatchKey(commandBuffer));
+}
+
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice) {
+    PhysicalDeviceData* physical_device_data = physical_device_map.Get(physicalDevice);
+    if (physical_device_data) return physical_device_data->instance_data;
+    // Not enumerated through this layer; a physical device shares its
+    // instance's dispatch key
+    return instance_map.Get(GetDispatchKey(physicalDevice));
+}
+
+ApiTrace* GetApiTrace() {
+    // Opened on first use; closed (and flushed) when the layer is unloaded
+    static std::unique_ptr<ApiTrace> trace = [] {
+        const char* path = std::getenv("VK_LOGGER_TRACE");
+        return (path && *path) ? ApiTrace::Open(path, kLoggerTraceSchema) : nullptr;
+    }();
+    return trace.get();
+}
+
+void LogAPICall(const char* function_name, const char* details) {
+    if (GetApiTrace()) return;
+
+    LogLayerMessage("VULKAN_LAYER", function_name, details);
 }
 
 // Vulkan API implementations
@@ -56,17 +62,12 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
     const VkAllocationCallbacks* pAllocator,
     VkInstance* pInstance) {
     
+    ApiTraceScope trace(GetApiTrace(), LoggerFunction::vkCreateInstance);
     LogAPICall("vkCreateInstance", "Creating Vulkan instance");
+    if (trace.Active()) CaptureInputs_vkCreateInstance(trace, pCreateInfo, pAllocator, pInstance);
     
     // Get the layer's instance proc addr
-    VkLayerInstanceCreateInfo* chain_info = 
-        (VkLayerInstanceCreateInfo*)pCreateInfo->pNext;
-    
-    while (chain_info && 
-           !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO &&
-             chain_info->function == VK_LAYER_LINK_INFO)) {
-        chain_info = (VkLayerInstanceCreateInfo*)chain_info->pNext;
-    }
+    VkLayerInstanceCreateInfo* chain_info = FindInstanceLinkInfo(pCreateInfo);
     
     if (!chain_info) {
         LogAPICall("vkCreateInstance", "No chain info - calling next layer directly");
@@ -74,7 +75,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
         PFN_vkCreateInstance fpCreateInstance = (PFN_vkCreateInstance)vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkCreateInstance");
         if (!fpCreateInstance) {
             LogAPICall("vkCreateInstance", "ERROR: Cannot get vkCreateInstance");
-            return VK_ERROR_INITIALIZATION_FAILED;
+            return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
         }
         VkResult result = fpCreateInstance(pCreateInfo, pAllocator, pInstance);
         if (result == VK_SUCCESS) {
@@ -85,14 +86,12 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
             instance_data->vtable.GetInstanceProcAddr = vkGetInstanceProcAddr;
             instance_data->vtable.DestroyInstance = (PFN_vkDestroyInstance)vkGetInstanceProcAddr(*pInstance, "vkDestroyInstance");
             instance_data->vtable.EnumeratePhysicalDevices = (PFN_vkEnumeratePhysicalDevices)vkGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDevices");
-            instance_data->vtable.GetPhysicalDeviceProperties = (PFN_vkGetPhysicalDeviceProperties)vkGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceProperties");
             instance_data->vtable.CreateDevice = (PFN_vkCreateDevice)vkGetInstanceProcAddr(*pInstance, "vkCreateDevice");
             
-            std::lock_guard<std::mutex> lock(global_mutex);
-            instance_map[*pInstance] = instance_data;
+            instance_map.Insert(GetDispatchKey(*pInstance), instance_data);
             LogAPICall("vkCreateInstance", "Instance created successfully");
         }
-        return result;
+        return trace.Result(result);
     }
     
     PFN_vkGetInstanceProcAddr gpa = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
@@ -101,7 +100,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
     
     if (!create_instance) {
         LogAPICall("vkCreateInstance", "ERROR: Failed to get next vkCreateInstance");
-        return VK_ERROR_INITIALIZATION_FAILED;
+        return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
     }
     
     // Advance the link info for the next element on the chain
@@ -114,37 +113,33 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
         InstanceData* instance_data = new InstanceData();
         instance_data->instance = *pInstance;
         
-        // Initialize dispatch table
-        LayerInstanceDispatchTable* pTable = &instance_data->vtable;
-        
-        // Get function pointers
-        pTable->GetInstanceProcAddr = gpa;
-        pTable->DestroyInstance = (PFN_vkDestroyInstance)gpa(*pInstance, "vkDestroyInstance");
-        pTable->CreateDevice = (PFN_vkCreateDevice)gpa(*pInstance, "vkCreateDevice");
-        pTable->EnumeratePhysicalDevices = (PFN_vkEnumeratePhysicalDevices)gpa(*pInstance, "vkEnumeratePhysicalDevices");
-        pTable->GetPhysicalDeviceProperties = (PFN_vkGetPhysicalDeviceProperties)gpa(*pInstance, "vkGetPhysicalDeviceProperties");
+        // Every instance-level command the next layer exposes
+        LoadInstanceDispatchTable(&instance_data->vtable, gpa, *pInstance);
+        instance_data->vtable.GetInstanceProcAddr = gpa;
         
         // Store instance data
-        {
-            std::lock_guard<std::mutex> lock(global_mutex);
-            instance_map[*pInstance] = instance_data;
-        }
+        instance_map.Insert(GetDispatchKey(*pInstance), instance_data);
         
+        if (trace.Active()) CaptureOutputs_vkCreateInstance(trace, pCreateInfo, pAllocator, pInstance);
         LogAPICall("vkCreateInstance", "Instance created successfully");
     } else {
         LogAPICall("vkCreateInstance", "ERROR: Instance creation failed");
     }
     
-    return result;
+    return trace.Result(result);
 }
 
 VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(
     VkInstance instance,
     const VkAllocationCallbacks* pAllocator) {
     
+    ApiTraceScope trace(GetApiTrace(), LoggerFunction::vkDestroyInstance);
     LogAPICall("vkDestroyInstance", "Destroying Vulkan instance");
+    if (trace.Active()) CaptureInputs_vkDestroyInstance(trace, instance, pAllocator);
     
-    InstanceData* instance_data = GetInstanceData(instance);
+    // The handle is gone once the call returns, so take the key first
+    void* key = GetDispatchKey(instance);
+    InstanceData* instance_data = instance_map.Get(key);
     if (instance_data && instance_data->vtable.DestroyInstance) {
         instance_data->vtable.DestroyInstance(instance, pAllocator);
     } else {
@@ -156,8 +151,8 @@ VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(
     }
     
     if (instance_data) {
-        std::lock_guard<std::mutex> lock(global_mutex);
-        instance_map.erase(instance);
+        instance_map.Erase(key);
+        ReleasePhysicalDevices(physical_device_map, instance_data);
         delete instance_data;
         LogAPICall("vkDestroyInstance", "Instance destroyed successfully");
     }
@@ -168,13 +163,21 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(
     uint32_t* pPhysicalDeviceCount,
     VkPhysicalDevice* pPhysicalDevices) {
     
+    ApiTraceScope trace(GetApiTrace(), LoggerFunction::vkEnumeratePhysicalDevices);
     LogAPICall("vkEnumeratePhysicalDevices", "Enumerating physical devices");
+    if (trace.Active()) CaptureInputs_vkEnumeratePhysicalDevices(trace, instance, pPhysicalDeviceCount, pPhysicalDevices);
     
     InstanceData* instance_data = GetInstanceData(instance);
     if (instance_data && instance_data->vtable.EnumeratePhysicalDevices) {
         VkResult result = instance_data->vtable.EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
+        if ((result == VK_SUCCESS || result == VK_INCOMPLETE) && pPhysicalDevices) {
+            TrackPhysicalDevices(physical_device_map, instance_data, *pPhysicalDeviceCount, pPhysicalDevices);
+        }
+        if (trace.Active() && result >= VK_SUCCESS) {
+            CaptureOutputs_vkEnumeratePhysicalDevices(trace, instance, pPhysicalDeviceCount, pPhysicalDevices);
+        }
         LogAPICall("vkEnumeratePhysicalDevices", "Enumeration completed");
-        return result;
+        return trace.Result(result);
     }
     
     // Fallback to driver call
@@ -182,90 +185,182 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(
     if (fpEnumerate) {
         VkResult result = fpEnumerate(instance, pPhysicalDeviceCount, pPhysicalDevices);
         LogAPICall("vkEnumeratePhysicalDevices", "Enumeration completed (fallback)");
-        return result;
+        return trace.Result(result);
     }
     
-    return VK_ERROR_INITIALIZATION_FAILED;
+    return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
 }
 
-VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(
-    VkPhysicalDevice physicalDevice,
-    VkPhysicalDeviceProperties* pProperties) {
-    
-    LogAPICall("vkGetPhysicalDeviceProperties", "Getting physical device properties");
-    
-    // For global functions like this, we need to find the instance
-    std::lock_guard<std::mutex> lock(global_mutex);
-    if (!instance_map.empty()) {
-        InstanceData* instance_data = instance_map.begin()->second;
-        if (instance_data && instance_data->vtable.GetPhysicalDeviceProperties) {
-            instance_data->vtable.GetPhysicalDeviceProperties(physicalDevice, pProperties);
-            LogAPICall("vkGetPhysicalDeviceProperties", "Properties retrieved");
-            return;
-        }
+VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    
+    ApiTraceScope trace(GetApiTrace(), LoggerFunction::vkEnumeratePhysicalDeviceGroups);
+    LogAPICall("vkEnumeratePhysicalDeviceGroups", "Enumerating physical device groups");
+    if (trace.Active()) {
+        CaptureInputs_vkEnumeratePhysicalDeviceGroups(trace, instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
     }
     
-    // Fallback - this is more complex for global functions
-    LogAPICall("vkGetPhysicalDeviceProperties", "Using fallback method");
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->vtable.EnumeratePhysicalDeviceGroups) {
+        return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
+    }
+    
+    VkResult result = instance_data->vtable.EnumeratePhysicalDeviceGroups(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    if (trace.Active() && result >= VK_SUCCESS) {
+        CaptureOutputs_vkEnumeratePhysicalDeviceGroups(trace, instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    }
+    return trace.Result(result);
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroupsKHR(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    
+    ApiTraceScope trace(GetApiTrace(), LoggerFunction::vkEnumeratePhysicalDeviceGroupsKHR);
+    LogAPICall("vkEnumeratePhysicalDeviceGroupsKHR", "Enumerating physical device groups");
+    if (trace.Active()) {
+        CaptureInputs_vkEnumeratePhysicalDeviceGroupsKHR(trace, instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    }
+    
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR) {
+        return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
+    }
+    
+    VkResult result = instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    if (trace.Active() && result >= VK_SUCCESS) {
+        CaptureOutputs_vkEnumeratePhysicalDeviceGroupsKHR(trace, instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    }
+    return trace.Result(result);
 }
 
+// Entry points written by hand; everything else is generated
+#define LOGGER_INSTANCE_PROCS(X) \
+    X(vkCreateInstance, vkCreateInstance) \
+    X(vkDestroyInstance, vkDestroyInstance) \
+    X(vkEnumeratePhysicalDevices, vkEnumeratePhysicalDevices) \
+    X(vkEnumeratePhysicalDeviceGroups, vkEnumeratePhysicalDeviceGroups) \
+    X(vkEnumeratePhysicalDeviceGroupsKHR, vkEnumeratePhysicalDeviceGroupsKHR) \
+    X(vkCreateDevice, vkCreateDevice) \
+    X(vkDestroyDevice, vkDestroyDevice) \
+    X(vkGetInstanceProcAddr, vkGetInstanceProcAddr) \
+    X(vkGetDeviceProcAddr, vkGetDeviceProcAddr) \
+    X(vkEnumerateInstanceLayerProperties, vkEnumerateInstanceLayerProperties) \
+    X(vkEnumerateInstanceExtensionProperties, vkEnumerateInstanceExtensionProperties) \
+    X(vkEnumerateDeviceLayerProperties, vkEnumerateDeviceLayerProperties) \
+    X(vkEnumerateDeviceExtensionProperties, vkEnumerateDeviceExtensionProperties)
+
+#define LOGGER_DEVICE_PROCS(X) \
+    X(vkDestroyDevice, vkDestroyDevice) \
+    X(vkGetDeviceProcAddr, vkGetDeviceProcAddr)
+
+DECLARE_PROC_TABLE(instance_procs, LOGGER_INSTANCE_PROCS);
+DECLARE_PROC_TABLE(device_procs, LOGGER_DEVICE_PROCS);
+
 VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(
     VkInstance instance,
     const char* pName) {
     
     // Return our layer's functions
-    if (strcmp(pName, "vkCreateInstance") == 0) return (PFN_vkVoidFunction)vkCreateInstance;
-    if (strcmp(pName, "vkDestroyInstance") == 0) return (PFN_vkVoidFunction)vkDestroyInstance;
-    if (strcmp(pName, "vkEnumeratePhysicalDevices") == 0) return (PFN_vkVoidFunction)vkEnumeratePhysicalDevices;
-    if (strcmp(pName, "vkGetPhysicalDeviceProperties") == 0) return (PFN_vkVoidFunction)vkGetPhysicalDeviceProperties;
-    if (strcmp(pName, "vkCreateDevice") == 0) return (PFN_vkVoidFunction)vkCreateDevice;
-    if (strcmp(pName, "vkGetInstanceProcAddr") == 0) return (PFN_vkVoidFunction)vkGetInstanceProcAddr;
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) return (PFN_vkVoidFunction)vkGetDeviceProcAddr;
-    if (strcmp(pName, "vkEnumerateInstanceLayerProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateInstanceLayerProperties;
-    if (strcmp(pName, "vkEnumerateInstanceExtensionProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateInstanceExtensionProperties;
-    if (strcmp(pName, "vkEnumerateDeviceLayerProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateDeviceLayerProperties;
-    if (strcmp(pName, "vkEnumerateDeviceExtensionProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateDeviceExtensionProperties;
-    
-    // For other functions, get from next layer
-    if (instance) {
-        InstanceData* instance_data = GetInstanceData(instance);
-        if (instance_data && instance_data->vtable.GetInstanceProcAddr) {
-            return instance_data->vtable.GetInstanceProcAddr(instance, pName);
-        }
-    }
+    if (PFN_vkVoidFunction function = instance_procs.Find(pName)) return function;
+    
+    if (!instance) return nullptr;
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->vtable.GetInstanceProcAddr) return nullptr;
     
-    return nullptr;
+    // Generated hooks, for the commands the next layer implements
+    if (PFN_vkVoidFunction hook = FindInstanceHook(pName, &instance_data->vtable)) return hook;
+    
+    // Device-level commands may be resolved through the instance as well
+    PFN_vkVoidFunction next = instance_data->vtable.GetInstanceProcAddr(instance, pName);
+    if (next) {
+        if (PFN_vkVoidFunction hook = FindDeviceHook(pName, nullptr)) return hook;
+    }
+    return next;
 }
 
-// Minimal implementations for other required functions
 VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(
     VkPhysicalDevice physicalDevice,
     const VkDeviceCreateInfo* pCreateInfo,
     const VkAllocationCallbacks* pAllocator,
     VkDevice* pDevice) {
     
+    ApiTraceScope trace(GetApiTrace(), LoggerFunction::vkCreateDevice);
     LogAPICall("vkCreateDevice", "Creating logical device");
+    if (trace.Active()) CaptureInputs_vkCreateDevice(trace, physicalDevice, pCreateInfo, pAllocator, pDevice);
     
-    // Simple passthrough for now
-    std::lock_guard<std::mutex> lock(global_mutex);
-    if (!instance_map.empty()) {
-        InstanceData* instance_data = instance_map.begin()->second;
-        if (instance_data && instance_data->vtable.CreateDevice) {
-            VkResult result = instance_data->vtable.CreateDevice(physicalDevice, pCreateInfo, pAllocator, pDevice);
-            LogAPICall("vkCreateDevice", result == VK_SUCCESS ? "Device created successfully" : "Device creation failed");
-            return result;
-        }
+    VkLayerDeviceCreateInfo* chain_info = FindDeviceLinkInfo(pCreateInfo);
+    
+    if (!chain_info) {
+        LogAPICall("vkCreateDevice", "No chain info found");
+        return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
     }
     
-    return VK_ERROR_INITIALIZATION_FAILED;
+    InstanceData* instance_data = GetInstanceData(physicalDevice);
+    PFN_vkGetInstanceProcAddr gipa = chain_info->u.pLayerInfo->pfnNextGetInstanceProcAddr;
+    PFN_vkGetDeviceProcAddr gdpa = chain_info->u.pLayerInfo->pfnNextGetDeviceProcAddr;
+    PFN_vkCreateDevice create_device = (PFN_vkCreateDevice)gipa(
+        instance_data ? instance_data->instance : VK_NULL_HANDLE, "vkCreateDevice");
+    
+    if (!create_device) {
+        LogAPICall("vkCreateDevice", "ERROR: Failed to get next vkCreateDevice");
+        return trace.Result(VK_ERROR_INITIALIZATION_FAILED);
+    }
+    
+    // Advance the link info for the next element on the chain
+    chain_info->u.pLayerInfo = chain_info->u.pLayerInfo->pNext;
+    
+    VkResult result = create_device(physicalDevice, pCreateInfo, pAllocator, pDevice);
+    
+    if (result == VK_SUCCESS) {
+        DeviceData* device_data = new DeviceData();
+        device_data->device = *pDevice;
+        device_data->instance_data = instance_data;
+        
+        // Every device-level command the next layer exposes
+        LoadDeviceDispatchTable(&device_data->vtable, gdpa, *pDevice);
+        device_data->vtable.GetDeviceProcAddr = gdpa;
+        
+        device_map.Insert(GetDispatchKey(*pDevice), device_data);
+        
+        if (trace.Active()) CaptureOutputs_vkCreateDevice(trace, physicalDevice, pCreateInfo, pAllocator, pDevice);
+        LogAPICall("vkCreateDevice", "Device created successfully");
+    } else {
+        LogAPICall("vkCreateDevice", "Device creation failed");
+    }
+    
+    return trace.Result(result);
 }
 
 VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(
     VkDevice device,
     const VkAllocationCallbacks* pAllocator) {
     
+    ApiTraceScope trace(GetApiTrace(), LoggerFunction::vkDestroyDevice);
     LogAPICall("vkDestroyDevice", "Destroying logical device");
-    // For now, just log - device destruction is typically handled by the driver
+    if (trace.Active()) CaptureInputs_vkDestroyDevice(trace, device, pAllocator);
+    
+    // The handle is gone once the call returns, so take the key first
+    void* key = GetDispatchKey(device);
+    DeviceData* device_data = device_map.Get(key);
+    if (device_data && device_data->vtable.DestroyDevice) {
+        device_data->vtable.DestroyDevice(device, pAllocator);
+    }
+    
+    if (device_data) {
+        device_map.Erase(key);
+        delete device_data;
+        LogAPICall("vkDestroyDevice", "Device destroyed successfully");
+    }
 }
 
 VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(
@@ -273,28 +368,24 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(
     const char* pName) {
     
     // Return our layer's functions
-    if (strcmp(pName, "vkDestroyDevice") == 0) return (PFN_vkVoidFunction)vkDestroyDevice;
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) return (PFN_vkVoidFunction)vkGetDeviceProcAddr;
+    if (PFN_vkVoidFunction function = device_procs.Find(pName)) return function;
+    
+    if (!device) return nullptr;
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data || !device_data->vtable.GetDeviceProcAddr) return nullptr;
+    
+    // Generated hooks, for the commands the next layer implements
+    if (PFN_vkVoidFunction hook = FindDeviceHook(pName, &device_data->vtable)) return hook;
     
-    return nullptr;
+    // Anything else (newer than the registry the layer was built from) passes through
+    return device_data->vtable.GetDeviceProcAddr(device, pName);
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(
     uint32_t* pPropertyCount,
     VkLayerProperties* pProperties) {
     
-    if (pProperties == nullptr) {
-        *pPropertyCount = 1;
-        return VK_SUCCESS;
-    }
-    
-    if (*pPropertyCount >= 1) {
-        memcpy(pProperties, &layer_props, sizeof(VkLayerProperties));
-        *pPropertyCount = 1;
-        return VK_SUCCESS;
-    }
-    
-    return VK_INCOMPLETE;
+    return EnumerateLayerProperties(layer_props, pPropertyCount, pProperties);
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(
@@ -324,25 +415,24 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(
     uint32_t* pPropertyCount,
     VkExtensionProperties* pProperties) {
     
+    ApiTraceScope trace(GetApiTrace(), LoggerFunction::vkEnumerateDeviceExtensionProperties);
+
     // Don't handle layer-specific queries for our layer
     if (pLayerName && strcmp(pLayerName, LAYER_NAME) == 0) {
         *pPropertyCount = 0;
-        return VK_SUCCESS;
+        return trace.Result(VK_SUCCESS);
     }
     
     // Forward to next layer/driver for extension enumeration
-    std::lock_guard<std::mutex> lock(global_mutex);
-    if (!instance_map.empty()) {
-        InstanceData* instance_data = instance_map.begin()->second;
-        if (instance_data && instance_data->vtable.GetInstanceProcAddr) {
-            PFN_vkEnumerateDeviceExtensionProperties fpEnumerate = 
-                (PFN_vkEnumerateDeviceExtensionProperties)instance_data->vtable.GetInstanceProcAddr(
-                    instance_data->instance, "vkEnumerateDeviceExtensionProperties");
-            if (fpEnumerate) {
-                return fpEnumerate(physicalDevice, pLayerName, pPropertyCount, pProperties);
-            }
+    InstanceData* instance_data = GetInstanceData(physicalDevice);
+    if (instance_data && instance_data->vtable.GetInstanceProcAddr) {
+        PFN_vkEnumerateDeviceExtensionProperties fpEnumerate = 
+            (PFN_vkEnumerateDeviceExtensionProperties)instance_data->vtable.GetInstanceProcAddr(
+                instance_data->instance, "vkEnumerateDeviceExtensionProperties");
+        if (fpEnumerate) {
+            return trace.Result(fpEnumerate(physicalDevice, pLayerName, pPropertyCount, pProperties));
         }
     }
     
-    return VK_ERROR_LAYER_NOT_PRESENT;
+    return trace.Result(VK_ERROR_LAYER_NOT_PRESENT);
 }
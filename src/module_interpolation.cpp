@@ -0,0 +1,65 @@
+#include "combined_layer.h"
+#include <iostream>
+#include <string>
+
+// Frame interpolation module: the VK_LAYER_frame_interpolation swapchain
+// monitoring, run from the combined layer's hooks.
+
+static std::shared_ptr<SwapchainData> FindSwapchain(DeviceData* device_data, VkSwapchainKHR swapchain) {
+    std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+    auto it = device_data->swapchains.find(swapchain);
+    return (it != device_data->swapchains.end()) ? it->second : nullptr;
+}
+
+void InterpolationSwapchainCreated(DeviceData* device_data, const VkSwapchainCreateInfoKHR* pCreateInfo,
+                                   VkSwapchainKHR swapchain) {
+    auto swapchain_data = std::make_shared<SwapchainData>();
+    swapchain_data->swapchain = swapchain;
+    swapchain_data->device = device_data->device;
+    swapchain_data->presentMode = pCreateInfo->presentMode;
+    swapchain_data->imageCount = pCreateInfo->minImageCount;
+    swapchain_data->extent = pCreateInfo->imageExtent;
+    swapchain_data->format = pCreateInfo->imageFormat;
+    swapchain_data->lastFrameTime = std::chrono::high_resolution_clock::now();
+    swapchain_data->lastStatsReport = std::chrono::steady_clock::now();
+
+    // Initialize telemetry logging (convert with tools/telemetry_to_csv)
+    std::string filename = "frame_timing_" + std::to_string(reinterpret_cast<uintptr_t>(swapchain)) + ".bin";
+    swapchain_data->telemetry = std::make_unique<TelemetryWriter>(filename);
+
+    {
+        std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+        device_data->swapchains[swapchain] = std::move(swapchain_data);
+    }
+
+    std::cout << "[FRAME_INTERP] Swapchain created: " << pCreateInfo->imageExtent.width
+              << "x" << pCreateInfo->imageExtent.height
+              << " Present Mode: " << pCreateInfo->presentMode
+              << " Format: " << pCreateInfo->imageFormat << std::endl;
+}
+
+void InterpolationSwapchainDestroyed(DeviceData* device_data, VkSwapchainKHR swapchain) {
+    std::shared_ptr<SwapchainData> swapchain_data;
+    {
+        std::lock_guard<std::mutex> lock(device_data->swapchain_mutex);
+        auto it = device_data->swapchains.find(swapchain);
+        if (it == device_data->swapchains.end()) return;
+        swapchain_data = std::move(it->second);
+        device_data->swapchains.erase(it);
+    }
+
+    PrintFrameStatsReport(std::cout, swapchain_data->stats.Report(), "final");
+
+    // Releasing the last reference joins the telemetry writer, which
+    // flushes and syncs the file; outside the lock, as that can take a while
+    swapchain_data.reset();
+
+    std::cout << "[FRAME_INTERP] Swapchain destroyed" << std::endl;
+}
+
+void InterpolationImageAcquired(DeviceData* device_data, VkSwapchainKHR swapchain, uint32_t imageIndex) {
+    std::shared_ptr<SwapchainData> swapchain_data = FindSwapchain(device_data, swapchain);
+    if (swapchain_data) {
+        LogFrameTiming(swapchain_data.get(), imageIndex);
+    }
+}
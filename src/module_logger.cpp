@@ -0,0 +1,23 @@
+#include "combined_layer.h"
+#include <cstdlib>
+
+// Logger module: text lines go through LogCombinedCall; this file owns the
+// binary trace. The schema lists "<function> <labels>" per line in
+// CombinedFunction order, the format tools/trace_decode reads.
+#define COMBINED_TRACE_SCHEMA_LINE(name, member, modules, labels) #name " " labels "\n"
+
+static const char kCombinedTraceSchema[] =
+    "vkCreateInstance\n"
+    "vkDestroyInstance\n"
+    "vkCreateDevice\n"
+    "vkDestroyDevice\n"
+    COMBINED_DEVICE_HOOKS(COMBINED_TRACE_SCHEMA_LINE);
+
+ApiTrace* GetCombinedTrace() {
+    // Opened on first use; closed (and flushed) when the layer is unloaded
+    static std::unique_ptr<ApiTrace> trace = [] {
+        const char* path = std::getenv("VK_LOGGER_TRACE");
+        return (path && *path) ? ApiTrace::Open(path, kCombinedTraceSchema) : nullptr;
+    }();
+    return trace.get();
+}
@@ -0,0 +1,90 @@
+#include "combined_layer.h"
+#include <cstdio>
+#include <string>
+
+// Text overlay module: the VK_LAYER_text_overlay effects, run from the
+// combined layer's hooks.
+
+// Lorem Ipsum text to overlay, wrapped to this many columns below a status
+// line
+static const char* lorem_ipsum =
+    "Lorem ipsum dolor sit amet, consectetur adipiscing elit. "
+    "Sed do eiusmod tempor incididunt ut labore et dolore magna aliqua.";
+static constexpr size_t kTextColumns = 64;
+
+static void LogOverlay(const char* function_name, const std::string& details) {
+    LogLayerMessage("TEXT_OVERLAY_MODULE", function_name, details.c_str());
+}
+
+void OverlayDeviceCreated(DeviceData* device_data, VkPhysicalDevice physical_device,
+                          const VkDeviceCreateInfo* pCreateInfo, PFN_vkGetInstanceProcAddr gipa) {
+    device_data->text_lines = WrapText(lorem_ipsum, kTextColumns);
+    device_data->text_lines.insert(device_data->text_lines.begin(), std::string());
+
+    PFN_vkSetDeviceLoaderData set_device_loader_data = FindDeviceLoaderDataCallback(pCreateInfo);
+    VkInstance instance = device_data->instance_data ? device_data->instance_data->instance : VK_NULL_HANDLE;
+    auto get_memory_properties = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties>(
+        gipa(instance, "vkGetPhysicalDeviceMemoryProperties"));
+    auto get_queue_families = reinterpret_cast<PFN_vkGetPhysicalDeviceQueueFamilyProperties>(
+        gipa(instance, "vkGetPhysicalDeviceQueueFamilyProperties"));
+    if (!set_device_loader_data || !get_memory_properties || !get_queue_families) {
+        LogOverlay("vkCreateDevice", "Text overlay off: no loader callback or physical device queries");
+        return;
+    }
+
+    TextRendererDevice renderer_device;
+    renderer_device.device = device_data->device;
+    renderer_device.set_device_loader_data = set_device_loader_data;
+    LoadTextRendererDispatch(&renderer_device.vk, device_data->device, device_data->vtable.GetDeviceProcAddr);
+    get_memory_properties(physical_device, &renderer_device.memory_properties);
+    uint32_t family_count = 0;
+    get_queue_families(physical_device, &family_count, nullptr);
+    renderer_device.queue_families.resize(family_count);
+    get_queue_families(physical_device, &family_count, renderer_device.queue_families.data());
+    if (device_data->pipeline_cache) renderer_device.pipeline_cache = device_data->pipeline_cache->handle();
+
+    device_data->text_renderer = TextRenderer::Create(renderer_device, *pCreateInfo);
+    LogOverlay("vkCreateDevice", device_data->text_renderer ? "Font atlas uploaded, text overlay drawn at present"
+                                                            : "Text overlay off: renderer setup failed");
+}
+
+void OverlaySwapchainCreated(DeviceData* device_data, const VkSwapchainCreateInfoKHR* pCreateInfo,
+                             VkSwapchainKHR swapchain) {
+    if (device_data->text_renderer && !device_data->text_renderer->AddSwapchain(swapchain, *pCreateInfo)) {
+        LogOverlay("vkCreateSwapchainKHR", "Swapchain presents without the text overlay");
+    }
+}
+
+void OverlaySwapchainDestroyed(DeviceData* device_data, VkSwapchainKHR swapchain) {
+    if (device_data->text_renderer) device_data->text_renderer->RemoveSwapchain(swapchain);
+}
+
+// Present count and a smoothed frame time, as the first overlay line
+static void UpdateStatusLine(DeviceData* device_data) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (device_data->present_count > 0) {
+        double frame_ms = std::chrono::duration<double, std::milli>(now - device_data->last_present).count();
+        device_data->frame_time_ms = device_data->present_count == 1
+            ? frame_ms
+            : device_data->frame_time_ms * 0.9 + frame_ms * 0.1;
+    }
+    device_data->last_present = now;
+    device_data->present_count++;
+
+    char status[96];
+    snprintf(status, sizeof(status), "%s  frame %llu  %.2f ms", LAYER_NAME,
+             static_cast<unsigned long long>(device_data->present_count), device_data->frame_time_ms);
+    device_data->text_lines[0].assign(status);
+}
+
+void OverlayPresent(DeviceData* device_data, VkQueue queue, VkPresentInfoKHR* present_info) {
+    if (!device_data->text_renderer) return;
+
+    std::lock_guard<std::mutex> lock(device_data->text_mutex);
+    UpdateStatusLine(device_data);
+    bool drawn = device_data->text_renderer->Draw(queue, device_data->text_lines, present_info);
+
+    if (device_data->present_count % 60 == 0) {
+        LogOverlay("vkQueuePresentKHR", device_data->text_lines[0] + (drawn ? "" : " (overlay skipped)"));
+    }
+}
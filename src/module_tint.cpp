@@ -0,0 +1,75 @@
+#include "combined_layer.h"
+#include <string>
+
+// Green tint module: the VK_LAYER_green_tint effects, run from the combined
+// layer's hooks.
+
+static void LogTint(const char* function_name, const std::string& details) {
+    LogLayerMessage("GREEN_TINT_MODULE", function_name, details.c_str());
+}
+
+void TintDeviceCreated(DeviceData* device_data, VkPhysicalDevice physical_device,
+                       const VkDeviceCreateInfo* pCreateInfo, PFN_vkGetInstanceProcAddr gipa) {
+    PFN_vkSetDeviceLoaderData set_device_loader_data = FindDeviceLoaderDataCallback(pCreateInfo);
+    VkInstance instance = device_data->instance_data ? device_data->instance_data->instance : VK_NULL_HANDLE;
+    auto get_queue_families = reinterpret_cast<PFN_vkGetPhysicalDeviceQueueFamilyProperties>(
+        gipa(instance, "vkGetPhysicalDeviceQueueFamilyProperties"));
+    auto get_memory_properties = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties>(
+        gipa(instance, "vkGetPhysicalDeviceMemoryProperties"));
+    if (!set_device_loader_data || !get_queue_families || !get_memory_properties) {
+        LogTint("vkCreateDevice", "Tint off: no loader callback or physical device queries");
+        return;
+    }
+
+    TintPassDevice pass_device;
+    pass_device.device = device_data->device;
+    pass_device.physical_device = physical_device;
+    pass_device.set_device_loader_data = set_device_loader_data;
+    pass_device.get_format_properties = reinterpret_cast<PFN_vkGetPhysicalDeviceFormatProperties>(
+        gipa(instance, "vkGetPhysicalDeviceFormatProperties"));
+    pass_device.get_surface_capabilities = reinterpret_cast<PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR>(
+        gipa(instance, "vkGetPhysicalDeviceSurfaceCapabilitiesKHR"));
+    LoadTintPassDispatch(&pass_device.vk, device_data->device, device_data->vtable.GetDeviceProcAddr);
+    get_memory_properties(physical_device, &pass_device.memory_properties);
+    uint32_t family_count = 0;
+    get_queue_families(physical_device, &family_count, nullptr);
+    pass_device.queue_families.resize(family_count);
+    get_queue_families(physical_device, &family_count, pass_device.queue_families.data());
+    if (device_data->pipeline_cache) pass_device.pipeline_cache = device_data->pipeline_cache->handle();
+
+    device_data->tint_pass = TintPass::Create(pass_device, *pCreateInfo);
+    LogTint("vkCreateDevice", device_data->tint_pass ? "Tint pipeline built, swapchain images tinted at present"
+                                                     : "Tint off: pipeline setup failed");
+}
+
+void TintPrepareSwapchain(DeviceData* device_data, VkSwapchainCreateInfoKHR* create_info) {
+    if (device_data->tint_pass && !device_data->tint_pass->PrepareSwapchain(create_info)) {
+        LogTint("vkCreateSwapchainKHR", "Swapchain presents untinted: format " +
+                std::to_string(create_info->imageFormat) + " can't be tinted on this surface");
+    }
+}
+
+void TintSwapchainCreated(DeviceData* device_data, const VkSwapchainCreateInfoKHR* pCreateInfo,
+                          VkSwapchainKHR swapchain) {
+    // Swapchains TintPrepareSwapchain turned down lack the usage and are
+    // refused here without another message
+    if (device_data->tint_pass && TintPass::IsPrepared(*pCreateInfo) &&
+        !device_data->tint_pass->AddSwapchain(swapchain, *pCreateInfo)) {
+        LogTint("vkCreateSwapchainKHR", "Swapchain presents untinted: tint setup failed");
+    }
+}
+
+void TintSwapchainDestroyed(DeviceData* device_data, VkSwapchainKHR swapchain) {
+    if (device_data->tint_pass) device_data->tint_pass->RemoveSwapchain(swapchain);
+}
+
+void TintPresent(DeviceData* device_data, VkQueue queue, VkPresentInfoKHR* present_info) {
+    if (!device_data->tint_pass) return;
+
+    bool tinted = device_data->tint_pass->Draw(queue, present_info);
+
+    uint64_t frame_count = ++device_data->tint_present_count;
+    if (frame_count % 60 == 0) {
+        LogTint("vkQueuePresentKHR", "Frame " + std::to_string(frame_count) + (tinted ? " tinted" : " presented untinted"));
+    }
+}
@@ -0,0 +1,298 @@
+#include "optical_flow.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OPTICAL_FLOW_USE_SSE2 1
+#endif
+
+// Cost per pixel of distance from the predicted vector, so flat regions keep
+// the prediction instead of wandering to whichever offset is marginally best
+static constexpr uint32_t kLambda = 4;
+
+static int Clamp(int value, int low, int high) {
+    return std::min(std::max(value, low), high);
+}
+
+// BT.601 luma in 8.8 fixed point; `red_weight`/`blue_weight` are for bytes 0
+// and 2 of each pixel, so one routine covers RGBA and BGRA
+static void LumaRow(const uint8_t* src, uint8_t* dst, uint32_t width, int red_weight, int blue_weight) {
+    uint32_t x = 0;
+#ifdef OPTICAL_FLOW_USE_SSE2
+    // Eight pixels per step: widen to 16 bits, pmaddwd gives (c0*w0 + c1*w1)
+    // and (c2*w2) per pixel, and the two halves are summed in 32 bits
+    const __m128i weights = _mm_setr_epi16(static_cast<short>(red_weight), 150, static_cast<short>(blue_weight), 0,
+                                           static_cast<short>(red_weight), 150, static_cast<short>(blue_weight), 0);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(128);
+    auto four_pixels = [&](__m128i pixels) {
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights);
+        lo = _mm_shuffle_epi32(_mm_add_epi32(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 3, 2, 0));
+        hi = _mm_shuffle_epi32(_mm_add_epi32(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 3, 2, 0));
+        return _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi64(lo, hi), rounding), 8);
+    };
+    for (; x + 8 <= width; x += 8) {
+        __m128i first = four_pixels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4)));
+        __m128i second = four_pixels(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4 + 16)));
+        __m128i words = _mm_packs_epi32(first, second);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(words, words));
+    }
+#endif
+    for (; x < width; x++) {
+        const uint8_t* p = src + x * 4;
+        dst[x] = static_cast<uint8_t>((red_weight * p[0] + 150 * p[1] + blue_weight * p[2] + 128) >> 8);
+    }
+}
+
+// 2x2 reduction as a rounded average of the vertical averages, which is
+// what pavgb computes; `width` is the output width
+static void DownsampleRow(const uint8_t* row0, const uint8_t* row1, uint8_t* dst, uint32_t width) {
+    uint32_t x = 0;
+#ifdef OPTICAL_FLOW_USE_SSE2
+    const __m128i even_mask = _mm_set1_epi16(0x00ff);
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x)));
+        __m128i b = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 2 * x + 16)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 2 * x + 16)));
+        __m128i a_pairs = _mm_avg_epu16(_mm_and_si128(a, even_mask), _mm_srli_epi16(a, 8));
+        __m128i b_pairs = _mm_avg_epu16(_mm_and_si128(b, even_mask), _mm_srli_epi16(b, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(a_pairs, b_pairs));
+    }
+#endif
+    for (; x < width; x++) {
+        int left = (row0[2 * x] + row1[2 * x] + 1) >> 1;
+        int right = (row0[2 * x + 1] + row1[2 * x + 1] + 1) >> 1;
+        dst[x] = static_cast<uint8_t>((left + right + 1) >> 1);
+    }
+}
+
+OpticalFlowEngine::OpticalFlowEngine(ThreadPool* pool, uint32_t threads, const SadKernels& kernels)
+    : owned_pool_(pool ? nullptr : new ThreadPool(threads)), pool_(pool ? pool : owned_pool_.get()),
+      kernels_(kernels) {}
+
+std::unique_ptr<OpticalFlowEngine> OpticalFlowEngine::Create(uint32_t width, uint32_t height,
+                                                             const OpticalFlowOptions& options) {
+    if (width < kBlockSize || height < kBlockSize) return nullptr;
+
+    std::unique_ptr<OpticalFlowEngine> engine(
+        new OpticalFlowEngine(options.pool, options.threads, options.kernels ? *options.kernels : BestSadKernels()));
+    // Halve until another level would be under two blocks across
+    engine->levels_.reserve(kMaxLevels);
+    uint32_t level_width = width;
+    uint32_t level_height = height;
+    do {
+        Level level;
+        level.width = level_width;
+        level.height = level_height;
+        level.grid_width = (level_width + kBlockSize - 1) / kBlockSize;
+        level.grid_height = (level_height + kBlockSize - 1) / kBlockSize;
+        level.vectors.assign(static_cast<size_t>(level.grid_width) * level.grid_height * 2, 0);
+        for (Plane& plane : level.planes) {
+            // 16 bytes of slack: run kernels load a full register per row
+            plane.stride = static_cast<ptrdiff_t>((level_width + 2 * kPadding + 15) & ~15u);
+            plane.storage.assign(static_cast<size_t>(plane.stride) * (level_height + 2 * kPadding) + 16, 0);
+            plane.origin = plane.storage.data() + kPadding * plane.stride + kPadding;
+        }
+        engine->levels_.push_back(std::move(level));
+
+        level_width = (level_width + 1) / 2;
+        level_height = (level_height + 1) / 2;
+    } while (engine->levels_.size() < kMaxLevels && level_width >= 2 * kBlockSize && level_height >= 2 * kBlockSize);
+
+    return engine;
+}
+
+bool OpticalFlowEngine::Dispatch(const uint8_t* pixels, size_t row_pitch, PixelOrder order) {
+    current_ ^= 1;
+    BuildPyramid(pixels, row_pitch, order);
+
+    if (!has_previous_) {
+        has_previous_ = true;
+        return false;
+    }
+
+    uint32_t top = LevelCount() - 1;
+    pool_->ParallelFor(levels_[top].grid_height, [this, top](uint32_t by) { SearchBlockRow(top, by); });
+    for (uint32_t level = top; level-- > 0;) {
+        pool_->ParallelFor(levels_[level].grid_height, [this, level](uint32_t by) { RefineBlockRow(level, by); });
+    }
+    return true;
+}
+
+void OpticalFlowEngine::BuildPyramid(const uint8_t* pixels, size_t row_pitch, PixelOrder order) {
+    Level& base = levels_[0];
+    Plane& base_plane = base.planes[current_];
+    const int byte0_weight = order == PixelOrder::RGBA ? 77 : 29;
+    const int byte2_weight = order == PixelOrder::RGBA ? 29 : 77;
+    pool_->ParallelFor(base.height, [&](uint32_t y) {
+        LumaRow(pixels + y * row_pitch, base_plane.origin + y * base_plane.stride, base.width, byte0_weight, byte2_weight);
+        PadRow(base, base_plane, y);
+    });
+    PadTopBottom(base, base_plane);
+
+    // Odd edges read the replicated border
+    for (size_t i = 1; i < levels_.size(); i++) {
+        Level& level = levels_[i];
+        Plane& plane = level.planes[current_];
+        const Plane& source = levels_[i - 1].planes[current_];
+        pool_->ParallelFor(level.height, [&](uint32_t y) {
+            const uint8_t* row0 = source.origin + 2 * y * source.stride;
+            DownsampleRow(row0, row0 + source.stride, plane.origin + y * plane.stride, level.width);
+            PadRow(level, plane, y);
+        });
+        PadTopBottom(level, plane);
+    }
+}
+
+void OpticalFlowEngine::PadRow(const Level& level, Plane& plane, uint32_t y) {
+    uint8_t* row = plane.origin + y * plane.stride;
+    std::memset(row - kPadding, row[0], kPadding);
+    std::memset(row + level.width, row[level.width - 1], kPadding);
+}
+
+// Once every row is padded, the first and last rows (borders included) fill
+// the top and bottom borders
+void OpticalFlowEngine::PadTopBottom(const Level& level, Plane& plane) {
+    const uint8_t* top = plane.origin - kPadding;
+    const uint8_t* bottom = plane.origin + (level.height - 1) * plane.stride - kPadding;
+    size_t bytes = level.width + 2 * kPadding;
+    for (int i = 1; i <= kPadding; i++) {
+        std::memcpy(plane.origin - i * plane.stride - kPadding, top, bytes);
+        std::memcpy(plane.origin + (level.height - 1 + i) * plane.stride - kPadding, bottom, bytes);
+    }
+}
+
+// Coarsest level: every offset within kSearchRadius, eight at a time
+void OpticalFlowEngine::SearchBlockRow(uint32_t level_index, uint32_t by) {
+    Level& level = levels_[level_index];
+    const Plane& current = level.planes[current_];
+    const Plane& previous = level.planes[current_ ^ 1];
+    const ptrdiff_t stride = current.stride;
+    const int window = 2 * kSearchRadius + 1;
+
+    for (uint32_t bx = 0; bx < level.grid_width; bx++) {
+        const int x0 = static_cast<int>(bx * kBlockSize);
+        const int y0 = static_cast<int>(by * kBlockSize);
+        const uint8_t* block = current.origin + y0 * stride + x0;
+
+        uint32_t best_cost = UINT32_MAX;
+        int best_x = 0;
+        int best_y = 0;
+        for (int dy = -kSearchRadius; dy <= kSearchRadius; dy++) {
+            const uint8_t* row = previous.origin + (y0 + dy) * stride + x0 - kSearchRadius;
+            for (int start = 0; start < window; start += 8) {
+                uint16_t sads[8];
+                kernels_.sad8x8_run8(block, stride, row + start, stride, sads);
+                for (int i = 0; i < 8 && start + i < window; i++) {
+                    int dx = start + i - kSearchRadius;
+                    uint32_t cost = sads[i] + kLambda * static_cast<uint32_t>(std::abs(dx) + std::abs(dy));
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_x = dx;
+                        best_y = dy;
+                    }
+                }
+            }
+        }
+
+        int16_t* vector = &level.vectors[(by * level.grid_width + bx) * 2];
+        vector[0] = static_cast<int16_t>(best_x);
+        vector[1] = static_cast<int16_t>(best_y);
+    }
+}
+
+// Finer levels: best of the doubled parent vector, its four neighbours and
+// zero, then every offset within kRefineRadius of that
+void OpticalFlowEngine::RefineBlockRow(uint32_t level_index, uint32_t by) {
+    Level& level = levels_[level_index];
+    const Level& parent = levels_[level_index + 1];
+    const Plane& current = level.planes[current_];
+    const Plane& previous = level.planes[current_ ^ 1];
+    const ptrdiff_t stride = current.stride;
+
+    const int parent_y = static_cast<int>(std::min(by / 2, parent.grid_height - 1));
+    const int y0 = static_cast<int>(by * kBlockSize);
+    // Keeps every read of the refinement window inside the padded plane; a
+    // run reads 15 bytes per row from x - kRefineRadius
+    const int min_y = -kPadding + kRefineRadius - y0;
+    const int max_y = static_cast<int>(level.height) + kPadding - 1 - (kBlockSize - 1) - kRefineRadius - y0;
+
+    for (uint32_t bx = 0; bx < level.grid_width; bx++) {
+        const int parent_x = static_cast<int>(std::min(bx / 2, parent.grid_width - 1));
+        const int x0 = static_cast<int>(bx * kBlockSize);
+        const int min_x = -kPadding + kRefineRadius - x0;
+        const int max_x = static_cast<int>(level.width) + kPadding - 15 + kRefineRadius - x0;
+        const uint8_t* block = current.origin + y0 * stride + x0;
+
+        auto parent_vector = [&](int px, int py, int* x, int* y) {
+            const int16_t* v = &parent.vectors[(py * parent.grid_width + px) * 2];
+            *x = Clamp(v[0] * 2, min_x, max_x);
+            *y = Clamp(v[1] * 2, min_y, max_y);
+        };
+
+        int predicted_x, predicted_y;
+        parent_vector(parent_x, parent_y, &predicted_x, &predicted_y);
+        auto cost_of = [&](uint32_t sad, int x, int y) {
+            return sad + kLambda * static_cast<uint32_t>(std::abs(x - predicted_x) + std::abs(y - predicted_y));
+        };
+
+        int candidates[5][2];
+        int candidate_count = 0;
+        const int neighbours[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+        for (const auto& neighbour : neighbours) {
+            int px = parent_x + neighbour[0];
+            int py = parent_y + neighbour[1];
+            if (px >= 0 && py >= 0 && px < static_cast<int>(parent.grid_width) && py < static_cast<int>(parent.grid_height)) {
+                parent_vector(px, py, &candidates[candidate_count][0], &candidates[candidate_count][1]);
+                candidate_count++;
+            }
+        }
+        candidates[candidate_count][0] = Clamp(0, min_x, max_x);
+        candidates[candidate_count][1] = Clamp(0, min_y, max_y);
+        candidate_count++;
+
+        int center_x = predicted_x;
+        int center_y = predicted_y;
+        uint32_t best_cost = kernels_.sad8x8(block, stride, previous.origin + (y0 + center_y) * stride + x0 + center_x, stride);
+        for (int n = 0; n < candidate_count; n++) {
+            int x = candidates[n][0];
+            int y = candidates[n][1];
+            if (x == center_x && y == center_y) continue;
+            uint32_t cost = cost_of(kernels_.sad8x8(block, stride, previous.origin + (y0 + y) * stride + x0 + x, stride), x, y);
+            if (cost < best_cost) {
+                best_cost = cost;
+                center_x = x;
+                center_y = y;
+            }
+        }
+
+        // One run covers x - 2 .. x + 5; the first five lanes are the window
+        int best_x = center_x;
+        int best_y = center_y;
+        for (int dy = -kRefineRadius; dy <= kRefineRadius; dy++) {
+            uint16_t sads[8];
+            kernels_.sad8x8_run8(block, stride,
+                                 previous.origin + (y0 + center_y + dy) * stride + x0 + center_x - kRefineRadius,
+                                 stride, sads);
+            for (int i = 0; i <= 2 * kRefineRadius; i++) {
+                int x = center_x + i - kRefineRadius;
+                int y = center_y + dy;
+                uint32_t cost = cost_of(sads[i], x, y);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_x = x;
+                    best_y = y;
+                }
+            }
+        }
+
+        int16_t* vector = &level.vectors[(by * level.grid_width + bx) * 2];
+        vector[0] = static_cast<int16_t>(best_x);
+        vector[1] = static_cast<int16_t>(best_y);
+    }
+}
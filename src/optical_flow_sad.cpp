@@ -0,0 +1,124 @@
+#include "optical_flow.h"
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define OPTICAL_FLOW_X86 1
+#endif
+
+static uint32_t Sad8x8Scalar(const uint8_t* current, ptrdiff_t current_stride,
+                             const uint8_t* reference, ptrdiff_t reference_stride) {
+    uint32_t sad = 0;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            sad += static_cast<uint32_t>(std::abs(current[x] - reference[x]));
+        }
+        current += current_stride;
+        reference += reference_stride;
+    }
+    return sad;
+}
+
+static void Sad8x8Run8Scalar(const uint8_t* current, ptrdiff_t current_stride,
+                             const uint8_t* reference, ptrdiff_t reference_stride, uint16_t sads[8]) {
+    for (int offset = 0; offset < 8; offset++) {
+        sads[offset] = static_cast<uint16_t>(Sad8x8Scalar(current, current_stride, reference + offset, reference_stride));
+    }
+}
+
+#ifdef OPTICAL_FLOW_X86
+
+// Two 8-byte rows per 16-byte register; psadbw leaves a sum in each half
+__attribute__((target("sse2")))
+static uint32_t Sad8x8Sse2(const uint8_t* current, ptrdiff_t current_stride,
+                           const uint8_t* reference, ptrdiff_t reference_stride) {
+    __m128i sum = _mm_setzero_si128();
+    for (int y = 0; y < 8; y += 2) {
+        __m128i cur = _mm_unpacklo_epi64(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(current + y * current_stride)),
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(current + (y + 1) * current_stride)));
+        __m128i ref = _mm_unpacklo_epi64(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(reference + y * reference_stride)),
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(reference + (y + 1) * reference_stride)));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(cur, ref));
+    }
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+}
+
+// mpsadbw gives eight 4-byte SADs at consecutive reference offsets: one call
+// for bytes 0-3 of the current row, one for bytes 4-7 against the reference
+// shifted by 4, and the two add up to the 8-wide row SAD for x = 0..7
+__attribute__((target("sse4.1")))
+static void Sad8x8Run8Sse41(const uint8_t* current, ptrdiff_t current_stride,
+                            const uint8_t* reference, ptrdiff_t reference_stride, uint16_t sads[8]) {
+    __m128i sum = _mm_setzero_si128();
+    for (int y = 0; y < 8; y++) {
+        __m128i cur = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(current + y * current_stride));
+        __m128i ref = _mm_loadu_si128(reinterpret_cast<const __m128i*>(reference + y * reference_stride));
+        sum = _mm_add_epi16(sum, _mm_mpsadbw_epu8(ref, cur, 0));
+        sum = _mm_add_epi16(sum, _mm_mpsadbw_epu8(ref, cur, 5));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sads), sum);
+}
+
+// As the SSE4.1 kernel with two rows at once, one per 128-bit lane
+__attribute__((target("avx2")))
+static void Sad8x8Run8Avx2(const uint8_t* current, ptrdiff_t current_stride,
+                           const uint8_t* reference, ptrdiff_t reference_stride, uint16_t sads[8]) {
+    __m256i sum = _mm256_setzero_si256();
+    for (int y = 0; y < 8; y += 2) {
+        __m256i cur = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(current + y * current_stride))),
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(current + (y + 1) * current_stride)), 1);
+        __m256i ref = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(reference + y * reference_stride))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(reference + (y + 1) * reference_stride)), 1);
+        sum = _mm256_add_epi16(sum, _mm256_mpsadbw_epu8(ref, cur, 0x00));
+        sum = _mm256_add_epi16(sum, _mm256_mpsadbw_epu8(ref, cur, 0x2D));
+    }
+    __m128i total = _mm_add_epi16(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sads), total);
+}
+
+#endif
+
+bool SadKernelsSupported(SadKernelSet set) {
+    switch (set) {
+    case SadKernelSet::Scalar:
+        return true;
+#ifdef OPTICAL_FLOW_X86
+    case SadKernelSet::Sse41:
+        return __builtin_cpu_supports("sse4.1");
+    case SadKernelSet::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+SadKernels GetSadKernels(SadKernelSet set) {
+    if (!SadKernelsSupported(set)) set = SadKernelSet::Scalar;
+    switch (set) {
+#ifdef OPTICAL_FLOW_X86
+    case SadKernelSet::Sse41:
+        return {Sad8x8Sse2, Sad8x8Run8Sse41, set, "sse4.1"};
+    case SadKernelSet::Avx2:
+        return {Sad8x8Sse2, Sad8x8Run8Avx2, set, "avx2"};
+#endif
+    default:
+        return {Sad8x8Scalar, Sad8x8Run8Scalar, SadKernelSet::Scalar, "scalar"};
+    }
+}
+
+SadKernels BestSadKernels() {
+    static const SadKernels kernels = [] {
+        const char* forced = std::getenv("OPTICAL_FLOW_KERNELS");
+        if (forced && std::strcmp(forced, "scalar") == 0) return GetSadKernels(SadKernelSet::Scalar);
+        if (forced && std::strcmp(forced, "sse41") == 0) return GetSadKernels(SadKernelSet::Sse41);
+        if (SadKernelsSupported(SadKernelSet::Avx2)) return GetSadKernels(SadKernelSet::Avx2);
+        return GetSadKernels(SadKernelSet::Sse41);
+    }();
+    return kernels;
+}
@@ -0,0 +1,34 @@
+#include "render_pass_attachments.h"
+
+RenderPassAttachments RenderPassAttachments::FromCreateInfo(const VkRenderPassCreateInfo& create_info) {
+    RenderPassAttachments attachments;
+    attachments.attachment_count = create_info.attachmentCount;
+
+    auto mark_color = [&](const VkAttachmentReference* references, uint32_t count) {
+        if (!references) return;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t index = references[i].attachment;
+            if (index != VK_ATTACHMENT_UNUSED && index < 64 && index < create_info.attachmentCount) {
+                attachments.color_mask |= uint64_t(1) << index;
+            }
+        }
+    };
+    for (uint32_t i = 0; i < create_info.subpassCount; i++) {
+        const VkSubpassDescription& subpass = create_info.pSubpasses[i];
+        mark_color(subpass.pColorAttachments, subpass.colorAttachmentCount);
+        mark_color(subpass.pResolveAttachments, subpass.colorAttachmentCount);
+    }
+
+    for (uint32_t i = 0; i < create_info.attachmentCount && i < 64; i++) {
+        if (attachments.IsColor(i) && create_info.pAttachments[i].loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR) {
+            attachments.color_clear_mask |= uint64_t(1) << i;
+        }
+    }
+    return attachments;
+}
+
+uint32_t RenderPassAttachments::ColorClearCount(uint32_t clear_value_count) const {
+    uint64_t mask = color_clear_mask;
+    if (clear_value_count < 64) mask &= (uint64_t(1) << clear_value_count) - 1;
+    return static_cast<uint32_t>(__builtin_popcountll(mask));
+}
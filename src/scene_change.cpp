@@ -0,0 +1,121 @@
+#include "scene_change.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCENE_CHANGE_USE_SSE2 1
+#endif
+
+// Four interleaved copies of the histogram, so consecutive samples that
+// land in the same bin don't wait on each other's increments
+using SubHistograms = uint32_t[4][SceneChangeDetector::kBins];
+
+// Luma of one pixel in 8.8 fixed point, as OpticalFlowEngine computes it,
+// reduced to a bin. 10:10:10:2 pixels use the top 8 bits of each field.
+static uint32_t LumaBin(const uint8_t* pixel, bool packed, int weight0, int weight2) {
+    uint32_t c0 = pixel[0];
+    uint32_t c1 = pixel[1];
+    uint32_t c2 = pixel[2];
+    if (packed) {
+        uint32_t v;
+        std::memcpy(&v, pixel, 4);
+        c0 = (v >> 2) & 0xff;
+        c1 = (v >> 12) & 0xff;
+        c2 = (v >> 22) & 0xff;
+    }
+    return ((weight0 * c0 + 150 * c1 + weight2 * c2 + 128) >> 8) >> 2;
+}
+
+static void HistogramRow(const uint8_t* row, uint32_t width, bool packed, int weight0, int weight2,
+                         SubHistograms& bins) {
+    constexpr uint32_t kStep = SceneChangeDetector::kSampleStepX;
+    uint32_t x = 0;
+#ifdef SCENE_CHANGE_USE_SSE2
+    // Four samples per step, one 32-bit load each, then the two-pass
+    // pmaddwd luma of LumaRow in optical_flow.cpp
+    const __m128i weights = _mm_setr_epi16(static_cast<short>(weight0), 150, static_cast<short>(weight2), 0,
+                                           static_cast<short>(weight0), 150, static_cast<short>(weight2), 0);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi32(128);
+    const __m128i byte_mask = _mm_set1_epi32(0xff);
+    alignas(16) uint32_t sample_bins[4];
+    auto load = [](const uint8_t* pixel) {
+        int32_t v;
+        std::memcpy(&v, pixel, 4);
+        return _mm_cvtsi32_si128(v);
+    };
+    for (; x + 3 * kStep < width; x += 4 * kStep) {
+        const uint8_t* p = row + x * 4;
+        __m128i samples = _mm_unpacklo_epi64(_mm_unpacklo_epi32(load(p), load(p + kStep * 4)),
+                                             _mm_unpacklo_epi32(load(p + 2 * kStep * 4), load(p + 3 * kStep * 4)));
+        if (packed) {
+            samples = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(samples, 2), byte_mask),
+                                                _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(samples, 12), byte_mask), 8)),
+                                   _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(samples, 22), byte_mask), 16));
+        }
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(samples, zero), weights);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(samples, zero), weights);
+        lo = _mm_shuffle_epi32(_mm_add_epi32(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 3, 2, 0));
+        hi = _mm_shuffle_epi32(_mm_add_epi32(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 3, 2, 0));
+        __m128i luma_bins = _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi64(lo, hi), rounding), 10);
+        _mm_store_si128(reinterpret_cast<__m128i*>(sample_bins), luma_bins);
+        bins[0][sample_bins[0]]++;
+        bins[1][sample_bins[1]]++;
+        bins[2][sample_bins[2]]++;
+        bins[3][sample_bins[3]]++;
+    }
+#endif
+    for (; x < width; x += kStep) {
+        bins[(x / kStep) & 3][LumaBin(row + x * 4, packed, weight0, weight2)]++;
+    }
+}
+
+SceneChangeDetector::SceneChangeDetector(uint32_t width, uint32_t height, SoftwareFormat format)
+    : width_(width), height_(height), format_(format), threshold_(CutThreshold(width, height)) {}
+
+uint32_t SceneChangeDetector::SampleCount(uint32_t width, uint32_t height) {
+    return ((width + kSampleStepX - 1) / kSampleStepX) * ((height + kSampleStepY - 1) / kSampleStepY);
+}
+
+uint32_t SceneChangeDetector::CutThreshold(uint32_t width, uint32_t height) {
+    return kCutShift * SampleCount(width, height);
+}
+
+void SceneChangeDetector::BuildHistogram(const uint8_t* pixels, size_t row_pitch, uint32_t width, uint32_t height,
+                                         SoftwareFormat format, Histogram* histogram) {
+    bool packed = format == SoftwareFormat::Rgb10A2 || format == SoftwareFormat::Bgr10A2;
+    bool blue_first = format == SoftwareFormat::Bgra8 || format == SoftwareFormat::Bgr10A2;
+    int weight0 = blue_first ? 29 : 77;
+    int weight2 = blue_first ? 77 : 29;
+
+    SubHistograms bins = {};
+    for (uint32_t y = 0; y < height; y += kSampleStepY) {
+        HistogramRow(pixels + y * row_pitch, width, packed, weight0, weight2, bins);
+    }
+    for (uint32_t i = 0; i < kBins; i++) {
+        (*histogram)[i] = bins[0][i] + bins[1][i] + bins[2][i] + bins[3][i];
+    }
+}
+
+bool SceneChangeDetector::AddFrame(const uint8_t* pixels, size_t row_pitch) {
+    current_ ^= 1;
+    const Histogram& current = histograms_[current_];
+    const Histogram& previous = histograms_[current_ ^ 1];
+    BuildHistogram(pixels, row_pitch, width_, height_, format_, &histograms_[current_]);
+
+    bool compare = has_previous_;
+    has_previous_ = true;
+    if (!compare) {
+        last_distance_ = 0;
+        return false;
+    }
+
+    int32_t cumulative = 0;
+    uint32_t distance = 0;
+    for (uint32_t i = 0; i < kBins; i++) {
+        cumulative += static_cast<int32_t>(current[i]) - static_cast<int32_t>(previous[i]);
+        distance += static_cast<uint32_t>(cumulative < 0 ? -cumulative : cumulative);
+    }
+    last_distance_ = distance;
+    return distance > threshold_;
+}
@@ -0,0 +1,209 @@
+#include "software_interpolation.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTWARE_INTERP_USE_SSE2 1
+#endif
+
+// 8-bit channels, any order: pavgb on four pixels at a time
+static void AverageBytes(const uint8_t* a, const uint8_t* b, uint8_t* out, uint32_t count) {
+    uint32_t i = 0;
+#ifdef SOFTWARE_INTERP_USE_SSE2
+    for (; i + 4 <= count; i += 4) {
+        __m128i average = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i * 4)),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i * 4)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), average);
+    }
+#endif
+    for (uint32_t byte = i * 4; byte < count * 4; byte++) {
+        out[byte] = static_cast<uint8_t>((a[byte] + b[byte] + 1) >> 1);
+    }
+}
+
+// 10:10:10:2 fields, either order. Per field, (a | b) - ((a ^ b) >> 1) is
+// the rounded-up average; clearing each field's low bit of a ^ b before the
+// shift keeps it from landing in the field below, and the subtraction never
+// borrows across fields.
+static constexpr uint32_t kFieldLowBits = (1u << 10) | (1u << 20) | (1u << 30);
+
+static void AveragePacked1010102(const uint8_t* a, const uint8_t* b, uint8_t* out, uint32_t count) {
+    uint32_t i = 0;
+#ifdef SOFTWARE_INTERP_USE_SSE2
+    const __m128i keep = _mm_set1_epi32(static_cast<int>(~kFieldLowBits));
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i * 4));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i * 4));
+        __m128i half_difference = _mm_srli_epi32(_mm_and_si128(_mm_xor_si128(x, y), keep), 1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 4), _mm_sub_epi32(_mm_or_si128(x, y), half_difference));
+    }
+#endif
+    for (; i < count; i++) {
+        uint32_t x, y;
+        std::memcpy(&x, a + i * 4, 4);
+        std::memcpy(&y, b + i * 4, 4);
+        uint32_t average = (x | y) - (((x ^ y) & ~kFieldLowBits) >> 1);
+        std::memcpy(out + i * 4, &average, 4);
+    }
+}
+
+// Top eight bits of the three 10-bit fields, alpha opaque, for the flow
+static void Packed1010102ToBytesRow(const uint8_t* src, uint8_t* dst, uint32_t width) {
+    uint32_t x = 0;
+#ifdef SOFTWARE_INTERP_USE_SSE2
+    const __m128i first = _mm_set1_epi32(0x000000ff);
+    const __m128i second = _mm_set1_epi32(0x0000ff00);
+    const __m128i third = _mm_set1_epi32(0x00ff0000);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000u));
+    for (; x + 4 <= width; x += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        __m128i bytes = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 2), first),
+                                                  _mm_and_si128(_mm_srli_epi32(v, 4), second)),
+                                     _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 6), third), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), bytes);
+    }
+#endif
+    for (; x < width; x++) {
+        uint32_t v;
+        std::memcpy(&v, src + x * 4, 4);
+        uint32_t bytes = ((v >> 2) & 0xffu) | ((v >> 4) & 0xff00u) | ((v >> 6) & 0xff0000u) | 0xff000000u;
+        std::memcpy(dst + x * 4, &bytes, 4);
+    }
+}
+
+static bool IsPacked1010102(SoftwareFormat format) {
+    return format == SoftwareFormat::Rgb10A2 || format == SoftwareFormat::Bgr10A2;
+}
+
+SoftwareInterpolator::SoftwareInterpolator(uint32_t width, uint32_t height, SoftwareFormat format,
+                                           const SoftwareInterpolatorOptions& options)
+    : width_(width), height_(height), format_(format), mode_(options.mode),
+      average_(IsPacked1010102(format) ? AveragePacked1010102 : AverageBytes),
+      tiles_x_((width + kTileSize - 1) / kTileSize), tiles_y_((height + kTileSize - 1) / kTileSize),
+      pool_(options.threads) {}
+
+std::unique_ptr<SoftwareInterpolator> SoftwareInterpolator::Create(uint32_t width, uint32_t height,
+                                                                   SoftwareFormat format,
+                                                                   const SoftwareInterpolatorOptions& options) {
+    if (width == 0 || height == 0) return nullptr;
+    std::unique_ptr<SoftwareInterpolator> interpolator(new SoftwareInterpolator(width, height, format, options));
+
+    if (options.mode == SoftwareInterpolationMode::Warp) {
+        OpticalFlowOptions flow_options;
+        flow_options.pool = &interpolator->pool_;
+        // Frames under one block have no motion to follow; they blend
+        interpolator->flow_ = OpticalFlowEngine::Create(width, height, flow_options);
+        if (interpolator->flow_ && IsPacked1010102(format)) {
+            interpolator->flow_source_.resize(static_cast<size_t>(width) * height * 4);
+        }
+    }
+    return interpolator;
+}
+
+void SoftwareInterpolator::AddFrame(const uint8_t* pixels, size_t row_pitch) {
+    if (!flow_) return;
+
+    if (IsPacked1010102(format_)) {
+        size_t source_pitch = static_cast<size_t>(width_) * 4;
+        pool_.ParallelFor(height_, [&](uint32_t y) {
+            Packed1010102ToBytesRow(pixels + y * row_pitch, &flow_source_[y * source_pitch], width_);
+        });
+        pixels = flow_source_.data();
+        row_pitch = source_pitch;
+    }
+
+    bool blue_first = format_ == SoftwareFormat::Bgra8 || format_ == SoftwareFormat::Bgr10A2;
+    has_flow_ = flow_->Dispatch(pixels, row_pitch, blue_first ? PixelOrder::BGRA : PixelOrder::RGBA);
+}
+
+void SoftwareInterpolator::Reset() {
+    if (flow_) flow_->Reset();
+    has_flow_ = false;
+}
+
+void SoftwareInterpolator::Interpolate(const uint8_t* previous, const uint8_t* current, uint8_t* output,
+                                       size_t row_pitch) {
+    if (mode_ == SoftwareInterpolationMode::Previous) {
+        Repeat(previous, output, row_pitch);
+        return;
+    }
+
+    bool warp = mode_ == SoftwareInterpolationMode::Warp && has_flow_;
+    pool_.ParallelFor(tiles_x_ * tiles_y_, [&](uint32_t tile) {
+        if (warp) {
+            WarpTile(previous, current, output, row_pitch, tile);
+        } else {
+            BlendTile(previous, current, output, row_pitch, tile);
+        }
+    });
+}
+
+void SoftwareInterpolator::Repeat(const uint8_t* previous, uint8_t* output, size_t row_pitch) {
+    pool_.ParallelFor(height_, [&](uint32_t y) {
+        std::memcpy(output + y * row_pitch, previous + y * row_pitch, static_cast<size_t>(width_) * 4);
+    });
+}
+
+void SoftwareInterpolator::BlendTile(const uint8_t* previous, const uint8_t* current, uint8_t* output,
+                                     size_t row_pitch, uint32_t tile) {
+    uint32_t x0 = (tile % tiles_x_) * kTileSize;
+    uint32_t y0 = (tile / tiles_x_) * kTileSize;
+    uint32_t tile_width = std::min(kTileSize, width_ - x0);
+    uint32_t y_end = std::min(y0 + kTileSize, height_);
+    for (uint32_t y = y0; y < y_end; y++) {
+        size_t offset = y * row_pitch + x0 * 4;
+        average_(previous + offset, current + offset, output + offset, tile_width);
+    }
+}
+
+// The block at p in the middle frame is taken from p + (v - v/2) in the
+// previous frame and p - v/2 in the current one, v being the flow of the
+// block at p in the current frame; reads past the edge clamp to it
+void SoftwareInterpolator::WarpTile(const uint8_t* previous, const uint8_t* current, uint8_t* output,
+                                    size_t row_pitch, uint32_t tile) {
+    constexpr uint32_t kBlock = OpticalFlowEngine::kBlockSize;
+    const int16_t* vectors = flow_->Vectors();
+    uint32_t grid_width = flow_->GridWidth();
+    int width = static_cast<int>(width_);
+    int height = static_cast<int>(height_);
+
+    uint32_t x0 = (tile % tiles_x_) * kTileSize;
+    uint32_t y0 = (tile / tiles_x_) * kTileSize;
+    uint32_t x_end = std::min(x0 + kTileSize, width_);
+    uint32_t y_end = std::min(y0 + kTileSize, height_);
+
+    for (uint32_t block_y = y0; block_y < y_end; block_y += kBlock) {
+        for (uint32_t block_x = x0; block_x < x_end; block_x += kBlock) {
+            const int16_t* v = &vectors[((block_y / kBlock) * grid_width + block_x / kBlock) * 2];
+            int current_dx = -(v[0] >> 1);
+            int current_dy = -(v[1] >> 1);
+            int previous_dx = v[0] + current_dx;
+            int previous_dy = v[1] + current_dy;
+
+            uint32_t count = std::min(kBlock, x_end - block_x);
+            int px = static_cast<int>(block_x) + previous_dx;
+            int cx = static_cast<int>(block_x) + current_dx;
+            bool inside = px >= 0 && px + static_cast<int>(count) <= width &&
+                          cx >= 0 && cx + static_cast<int>(count) <= width;
+
+            for (uint32_t y = block_y; y < std::min(block_y + kBlock, y_end); y++) {
+                const uint8_t* previous_row =
+                    previous + std::min(std::max(static_cast<int>(y) + previous_dy, 0), height - 1) * row_pitch;
+                const uint8_t* current_row =
+                    current + std::min(std::max(static_cast<int>(y) + current_dy, 0), height - 1) * row_pitch;
+                uint8_t* output_row = output + y * row_pitch;
+
+                if (inside) {
+                    average_(previous_row + px * 4, current_row + cx * 4, output_row + block_x * 4, count);
+                    continue;
+                }
+                for (uint32_t i = 0; i < count; i++) {
+                    int sx = std::min(std::max(px + static_cast<int>(i), 0), width - 1);
+                    int tx = std::min(std::max(cx + static_cast<int>(i), 0), width - 1);
+                    average_(previous_row + sx * 4, current_row + tx * 4, output_row + (block_x + i) * 4, 1);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,150 @@
+#include "telemetry_writer.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+
+TelemetryWriter::TelemetryWriter(const std::string& path) : path_(path) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::cout << "[FRAME_INTERP] Failed to open telemetry file " << path << std::endl;
+    } else {
+        TelemetryFileHeader header = {kTelemetryMagic, kTelemetryVersion};
+        WriteAll(&header, sizeof(header));
+    }
+
+    frameNumbers_.reserve(kBlockRecords);
+    frametimes_.reserve(kBlockRecords);
+    imageIndices_.reserve(kBlockRecords);
+    presentModes_.reserve(kBlockRecords);
+    flags_.reserve(kBlockRecords);
+    lastSync_ = std::chrono::steady_clock::now();
+
+    thread_ = std::thread(&TelemetryWriter::Run, this);
+}
+
+TelemetryWriter::~TelemetryWriter() {
+    stop_.store(true, std::memory_order_release);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    if (fd_ >= 0) {
+        ::fsync(fd_);
+        ::close(fd_);
+    }
+
+    std::cout << "[FRAME_INTERP] Telemetry: " << written_ << " frames written to " << path_
+              << ", " << Dropped() << " dropped" << std::endl;
+}
+
+void TelemetryWriter::Push(const TelemetrySample& sample) {
+    if (!queue_.TryPush(sample)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void TelemetryWriter::PushReport(const FrameStatsReport& report) {
+    // Reports are periodic; if several pile up only the oldest are kept
+    reports_.TryPush(report);
+}
+
+void TelemetryWriter::Run() {
+    while (!stop_.load(std::memory_order_acquire)) {
+        Drain();
+
+        auto now = std::chrono::steady_clock::now();
+        if (dirty_ && now - lastSync_ >= kSyncInterval) {
+            FlushBlock();
+            if (fd_ >= 0) {
+                ::fsync(fd_);
+            }
+            dirty_ = false;
+            lastSync_ = now;
+        }
+
+        std::this_thread::sleep_for(kPollInterval);
+    }
+
+    // Producer is gone by now; pick up whatever it left behind
+    Drain();
+    FlushBlock();
+}
+
+void TelemetryWriter::Drain() {
+    TelemetrySample sample;
+    while (queue_.TryPop(sample)) {
+        Append(sample);
+
+        if (sample.logToConsole) {
+            std::cout << "[FRAME_INTERP] Frame " << sample.frameNumber
+                     << ": " << std::fixed << std::setprecision(2) << sample.frametime_ms << "ms"
+                     << " (FPS: " << (1000.0 / sample.frametime_ms) << ")"
+                     << " Present Mode: " << sample.presentMode
+                     << " Image Index: " << sample.imageIndex
+                     << ((sample.flags & kTelemetryFlagSceneChange) ? " Scene cut" : "")
+                     << " Min/Avg/Max: " << sample.hudStats.min << "/" << sample.hudStats.avg
+                     << "/" << sample.hudStats.max << "ms" << std::endl;
+        }
+    }
+
+    FrameStatsReport report;
+    while (reports_.TryPop(report)) {
+        PrintFrameStatsReport(std::cout, report, "periodic");
+    }
+}
+
+void TelemetryWriter::Append(const TelemetrySample& sample) {
+    frameNumbers_.push_back(sample.frameNumber);
+    frametimes_.push_back(sample.frametime_ms);
+    imageIndices_.push_back(sample.imageIndex);
+    presentModes_.push_back(sample.presentMode);
+    flags_.push_back(sample.flags);
+    dirty_ = true;
+
+    if (frameNumbers_.size() == kBlockRecords) {
+        FlushBlock();
+    }
+}
+
+void TelemetryWriter::FlushBlock() {
+    size_t count = frameNumbers_.size();
+    if (count == 0) return;
+
+    TelemetryBlockHeader header = {};
+    header.count = static_cast<uint32_t>(count);
+    header.droppedTotal = Dropped();
+
+    WriteAll(&header, sizeof(header));
+    WriteAll(frameNumbers_.data(), count * sizeof(uint64_t));
+    WriteAll(frametimes_.data(), count * sizeof(float));
+    WriteAll(imageIndices_.data(), count * sizeof(uint32_t));
+    WriteAll(presentModes_.data(), count * sizeof(uint32_t));
+    WriteAll(flags_.data(), count * sizeof(uint32_t));
+    written_ += count;
+
+    frameNumbers_.clear();
+    frametimes_.clear();
+    imageIndices_.clear();
+    presentModes_.clear();
+    flags_.clear();
+}
+
+void TelemetryWriter::WriteAll(const void* data, size_t size) {
+    if (fd_ < 0) return;
+
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::write(fd_, bytes, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cout << "[FRAME_INTERP] Telemetry write failed, closing " << path_ << std::endl;
+            ::close(fd_);
+            fd_ = -1;
+            return;
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+}
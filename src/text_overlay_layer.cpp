@@ -1,13 +1,13 @@
 #include "text_overlay_layer.h"
+#include <cstdio>
 #include <vector>
 #include <string>
-#include <sstream>
-#include <iomanip>
 
 // Global state
-std::map<VkInstance, InstanceData*> instance_map;
-std::map<VkDevice, DeviceData*> device_map;
-std::mutex global_mutex;
+DispatchMap<InstanceData> instance_map;
+DispatchMap<DeviceData> device_map;
+DispatchMap<PhysicalDeviceData> physical_device_map;
+DispatchMap<QueueData> queue_map;
 
 // Layer properties
 static const VkLayerProperties layer_props = {
@@ -30,91 +30,88 @@ static const char* lorem_ipsum =
 
 // Helper functions
 InstanceData* GetInstanceData(VkInstance instance) {
-    std::lock_guard<std::mutex> lock(global_mutex);
-    auto it = instance_map.find(instance);
-    return (it != instance_map.end()) ? it->second : nullptr;
+    return instance_map.Get(GetDispatchKey(instance));
 }
 
 DeviceData* GetDeviceData(VkDevice device) {
-    std::lock_guard<std::mutex> lock(global_mutex);
-    auto it = device_map.find(device);
-    return (it != device_map.end()) ? it->second : nullptr;
+    return device_map.Get(GetDispatchKey(device));
+}
+
+InstanceData* GetInstanceData(VkPhysicalDevice physicalDevice) {
+    PhysicalDeviceData* physical_device_data = physical_device_map.Get(physicalDevice);
+    if (physical_device_data) return physical_device_data->instance_data;
+    // Not enumerated through this layer; a physical device shares its
+    // instance's dispatch key
+    return instance_map.Get(GetDispatchKey(physicalDevice));
+}
+
+DeviceData* GetDeviceData(VkQueue queue) {
+    QueueData* queue_data = queue_map.Get(queue);
+    return queue_data ? queue_data->device_data : nullptr;
 }
 
 void LogAPICall(const char* function_name, const char* message) {
-    auto now = std::chrono::high_resolution_clock::now();
-    auto time_t = std::chrono::high_resolution_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
-    
-    struct tm* timeinfo = localtime(&time_t);
-    
-    std::cout << "[" << std::setfill('0') << std::setw(2) << timeinfo->tm_hour << ":"
-              << std::setfill('0') << std::setw(2) << timeinfo->tm_min << ":"
-              << std::setfill('0') << std::setw(2) << timeinfo->tm_sec << "."
-              << std::setfill('0') << std::setw(3) << ms.count() << "] "
-              << "TEXT_OVERLAY_LAYER: " << function_name;
-    if (message) {
-        std::cout << " - " << message;
-    }
-    std::cout << std::endl;
+    LogLayerMessage("TEXT_OVERLAY_LAYER", function_name, message);
 }
 
-// Simple bitmap font data for basic characters (8x8 pixel font)
-static const uint8_t font_data[95][8] = {
-    // Space (32)
-    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
-    // ! (33)
-    {0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00},
-    // " (34)
-    {0x66, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00},
-    // ... (we'll just include a few letters for demo)
-    // L (76)
-    {0x60, 0x60, 0x60, 0x60, 0x60, 0x62, 0x7E, 0x00},
-    // O (79)
-    {0x3C, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3C, 0x00},
-    // R (82)  
-    {0x7C, 0x66, 0x66, 0x7C, 0x78, 0x6C, 0x66, 0x00},
-    // E (69)
-    {0x7E, 0x60, 0x60, 0x78, 0x60, 0x60, 0x7E, 0x00},
-    // M (77)
-    {0x63, 0x77, 0x7F, 0x6B, 0x63, 0x63, 0x63, 0x00},
-};
+// Lorem Ipsum wrapped to this many columns, below a status line
+static constexpr size_t kTextColumns = 64;
+
+// Builds the renderer from the physical device's memory and queue families.
+// Without one, presents pass through untouched.
+static void InitializeTextOverlay(DeviceData* device_data, const VkDeviceCreateInfo* pCreateInfo) {
+    device_data->text_lines = WrapText(lorem_ipsum, kTextColumns);
+    device_data->text_lines.insert(device_data->text_lines.begin(), std::string());
+    device_data->present_count = 0;
+    device_data->frame_time_ms = 0.0;
 
-// Simple text renderer that modifies clear values to show overlay effect
-void RenderTextOverlay(VkCommandBuffer commandBuffer, DeviceData* device_data) {
-    if (!device_data || !device_data->text_overlay_initialized) {
+    InstanceData* instance_data = GetInstanceData(device_data->physical_device);
+    PFN_vkSetDeviceLoaderData set_device_loader_data = FindDeviceLoaderDataCallback(pCreateInfo);
+    if (!instance_data || !set_device_loader_data) {
+        LogAPICall("InitializeTextOverlay", "Text overlay off: no instance or loader callback");
         return;
     }
-    
-    static int frame_count = 0;
-    frame_count++;
-    
-    if (frame_count % 60 == 0) { // Log every 60 frames
-        LogAPICall("RenderTextOverlay", "Lorem Ipsum text overlay active - bitmap style");
-    }
-    
-    // For this simple demo, we'll just log that text overlay is active
-    // Real implementation would need to:
-    // 1. Create vertex buffer with character quad data
-    // 2. Use the bitmap font data above to generate texture coordinates
-    // 3. Render character quads with proper shaders
-    // 4. Blend the text over the existing framebuffer
+
+    TextRendererDevice renderer_device;
+    renderer_device.device = device_data->device;
+    renderer_device.set_device_loader_data = set_device_loader_data;
+    LoadTextRendererDispatch(&renderer_device.vk, device_data->device, device_data->GetDeviceProcAddr);
+    instance_data->vtable.GetPhysicalDeviceMemoryProperties(device_data->physical_device,
+                                                            &renderer_device.memory_properties);
+    uint32_t family_count = 0;
+    instance_data->vtable.GetPhysicalDeviceQueueFamilyProperties(device_data->physical_device, &family_count, nullptr);
+    renderer_device.queue_families.resize(family_count);
+    instance_data->vtable.GetPhysicalDeviceQueueFamilyProperties(device_data->physical_device, &family_count,
+                                                                 renderer_device.queue_families.data());
+
+    VkPhysicalDeviceProperties properties;
+    instance_data->vtable.GetPhysicalDeviceProperties(device_data->physical_device, &properties);
+    device_data->pipeline_cache = PipelineDiskCache::Create(DiskCache::Shared(), LAYER_NAME, device_data->device,
+                                                            properties, device_data->GetDeviceProcAddr);
+    if (device_data->pipeline_cache) renderer_device.pipeline_cache = device_data->pipeline_cache->handle();
+
+    device_data->text_renderer = TextRenderer::Create(renderer_device, *pCreateInfo);
+    LogAPICall("InitializeTextOverlay", device_data->text_renderer
+                   ? "Font atlas uploaded, text overlay drawn at present"
+                   : "Text overlay off: renderer setup failed");
 }
 
-// Initialize text overlay resources
-void InitializeTextOverlay(DeviceData* device_data) {
-    if (!device_data || device_data->text_overlay_initialized) {
-        return;
-    }
-    
-    LogAPICall("InitializeTextOverlay", "Setting up text overlay resources");
-    
-    // For simplicity, we'll just mark as initialized
-    // In a real implementation, this would create buffers, textures, and pipelines
-    device_data->text_overlay_initialized = true;
-    
-    LogAPICall("InitializeTextOverlay", "Text overlay resources created successfully");
+// Present count and a smoothed frame time, as the first overlay line
+static void UpdateStatusLine(DeviceData* device_data) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (device_data->present_count > 0) {
+        double frame_ms = std::chrono::duration<double, std::milli>(now - device_data->last_present).count();
+        device_data->frame_time_ms = device_data->present_count == 1
+            ? frame_ms
+            : device_data->frame_time_ms * 0.9 + frame_ms * 0.1;
+    }
+    device_data->last_present = now;
+    device_data->present_count++;
+
+    char status[96];
+    snprintf(status, sizeof(status), "%s  frame %llu  %.2f ms", LAYER_NAME,
+             static_cast<unsigned long long>(device_data->present_count), device_data->frame_time_ms);
+    device_data->text_lines[0].assign(status);
 }
 
 // Instance functions
@@ -125,12 +122,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
     
     LogAPICall("vkCreateInstance", "Creating Vulkan instance with text overlay layer");
     
-    VkLayerInstanceCreateInfo* chain_info = (VkLayerInstanceCreateInfo*)pCreateInfo->pNext;
-    
-    while (chain_info && !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_INSTANCE_CREATE_INFO &&
-                           chain_info->function == VK_LAYER_LINK_INFO)) {
-        chain_info = (VkLayerInstanceCreateInfo*)chain_info->pNext;
-    }
+    VkLayerInstanceCreateInfo* chain_info = FindInstanceLinkInfo(pCreateInfo);
     
     if (!chain_info) {
         return VK_ERROR_INITIALIZATION_FAILED;
@@ -158,14 +150,15 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateInstance(
     instance_data->vtable.GetInstanceProcAddr = fpGetInstanceProcAddr;
     instance_data->vtable.DestroyInstance = (PFN_vkDestroyInstance)fpGetInstanceProcAddr(*pInstance, "vkDestroyInstance");
     instance_data->vtable.EnumeratePhysicalDevices = (PFN_vkEnumeratePhysicalDevices)fpGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDevices");
+    instance_data->vtable.EnumeratePhysicalDeviceGroups = (PFN_vkEnumeratePhysicalDeviceGroups)fpGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDeviceGroups");
+    instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR = (PFN_vkEnumeratePhysicalDeviceGroupsKHR)fpGetInstanceProcAddr(*pInstance, "vkEnumeratePhysicalDeviceGroupsKHR");
     instance_data->vtable.GetPhysicalDeviceProperties = (PFN_vkGetPhysicalDeviceProperties)fpGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceProperties");
+    instance_data->vtable.GetPhysicalDeviceMemoryProperties = (PFN_vkGetPhysicalDeviceMemoryProperties)fpGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceMemoryProperties");
+    instance_data->vtable.GetPhysicalDeviceQueueFamilyProperties = (PFN_vkGetPhysicalDeviceQueueFamilyProperties)fpGetInstanceProcAddr(*pInstance, "vkGetPhysicalDeviceQueueFamilyProperties");
     instance_data->vtable.CreateDevice = (PFN_vkCreateDevice)fpGetInstanceProcAddr(*pInstance, "vkCreateDevice");
     instance_data->vtable.EnumerateDeviceExtensionProperties = (PFN_vkEnumerateDeviceExtensionProperties)fpGetInstanceProcAddr(*pInstance, "vkEnumerateDeviceExtensionProperties");
     
-    {
-        std::lock_guard<std::mutex> lock(global_mutex);
-        instance_map[*pInstance] = instance_data;
-    }
+    instance_map.Insert(GetDispatchKey(*pInstance), instance_data);
     
     LogAPICall("vkCreateInstance", "Instance created successfully");
     return VK_SUCCESS;
@@ -177,12 +170,13 @@ VKAPI_ATTR void VKAPI_CALL vkDestroyInstance(
     
     LogAPICall("vkDestroyInstance", "Destroying instance");
     
-    InstanceData* instance_data = GetInstanceData(instance);
+    void* key = GetDispatchKey(instance);
+    InstanceData* instance_data = instance_map.Get(key);
     if (instance_data && instance_data->vtable.DestroyInstance) {
         instance_data->vtable.DestroyInstance(instance, pAllocator);
         
-        std::lock_guard<std::mutex> lock(global_mutex);
-        instance_map.erase(instance);
+        instance_map.Erase(key);
+        ReleasePhysicalDevices(physical_device_map, instance_data);
         delete instance_data;
     }
 }
@@ -195,12 +189,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(
     
     LogAPICall("vkCreateDevice", "Creating logical device");
     
-    VkLayerDeviceCreateInfo* chain_info = (VkLayerDeviceCreateInfo*)pCreateInfo->pNext;
-    
-    while (chain_info && !(chain_info->sType == VK_STRUCTURE_TYPE_LOADER_DEVICE_CREATE_INFO &&
-                           chain_info->function == VK_LAYER_LINK_INFO)) {
-        chain_info = (VkLayerDeviceCreateInfo*)chain_info->pNext;
-    }
+    VkLayerDeviceCreateInfo* chain_info = FindDeviceLinkInfo(pCreateInfo);
     
     if (!chain_info) {
         return VK_ERROR_INITIALIZATION_FAILED;
@@ -225,35 +214,20 @@ VKAPI_ATTR VkResult VKAPI_CALL vkCreateDevice(
     device_data->device = *pDevice;
     device_data->physical_device = physicalDevice;
     device_data->GetDeviceProcAddr = fpGetDeviceProcAddr;
-    device_data->text_overlay_initialized = false;
-    
-    // Initialize device resources for text overlay
-    device_data->text_buffer = VK_NULL_HANDLE;
-    device_data->text_buffer_memory = VK_NULL_HANDLE;
-    device_data->descriptor_set_layout = VK_NULL_HANDLE;
-    device_data->descriptor_pool = VK_NULL_HANDLE;
-    device_data->descriptor_set = VK_NULL_HANDLE;
-    device_data->pipeline_layout = VK_NULL_HANDLE;
-    device_data->text_pipeline = VK_NULL_HANDLE;
     
     // Load device dispatch table
     device_data->vtable.GetDeviceProcAddr = fpGetDeviceProcAddr;
     device_data->vtable.DestroyDevice = (PFN_vkDestroyDevice)fpGetDeviceProcAddr(*pDevice, "vkDestroyDevice");
-    device_data->vtable.CmdBeginRenderPass = (PFN_vkCmdBeginRenderPass)fpGetDeviceProcAddr(*pDevice, "vkCmdBeginRenderPass");
-    device_data->vtable.CmdEndRenderPass = (PFN_vkCmdEndRenderPass)fpGetDeviceProcAddr(*pDevice, "vkCmdEndRenderPass");
-    device_data->vtable.CmdDraw = (PFN_vkCmdDraw)fpGetDeviceProcAddr(*pDevice, "vkCmdDraw");
-    device_data->vtable.CmdDrawIndexed = (PFN_vkCmdDrawIndexed)fpGetDeviceProcAddr(*pDevice, "vkCmdDrawIndexed");
-    device_data->vtable.CmdSetViewport = (PFN_vkCmdSetViewport)fpGetDeviceProcAddr(*pDevice, "vkCmdSetViewport");
-    device_data->vtable.CmdSetScissor = (PFN_vkCmdSetScissor)fpGetDeviceProcAddr(*pDevice, "vkCmdSetScissor");
+    device_data->vtable.GetDeviceQueue = (PFN_vkGetDeviceQueue)fpGetDeviceProcAddr(*pDevice, "vkGetDeviceQueue");
+    device_data->vtable.GetDeviceQueue2 = (PFN_vkGetDeviceQueue2)fpGetDeviceProcAddr(*pDevice, "vkGetDeviceQueue2");
+    device_data->vtable.CreateSwapchainKHR = (PFN_vkCreateSwapchainKHR)fpGetDeviceProcAddr(*pDevice, "vkCreateSwapchainKHR");
+    device_data->vtable.DestroySwapchainKHR = (PFN_vkDestroySwapchainKHR)fpGetDeviceProcAddr(*pDevice, "vkDestroySwapchainKHR");
     device_data->vtable.QueuePresentKHR = (PFN_vkQueuePresentKHR)fpGetDeviceProcAddr(*pDevice, "vkQueuePresentKHR");
     
-    {
-        std::lock_guard<std::mutex> lock(global_mutex);
-        device_map[*pDevice] = device_data;
-    }
+    device_map.Insert(GetDispatchKey(*pDevice), device_data);
     
     // Initialize text overlay resources
-    InitializeTextOverlay(device_data);
+    InitializeTextOverlay(device_data, pCreateInfo);
     
     LogAPICall("vkCreateDevice", "Device created successfully");
     return VK_SUCCESS;
@@ -265,236 +239,81 @@ VKAPI_ATTR void VKAPI_CALL vkDestroyDevice(
     
     LogAPICall("vkDestroyDevice", "Destroying device");
     
-    DeviceData* device_data = GetDeviceData(device);
+    void* key = GetDispatchKey(device);
+    DeviceData* device_data = device_map.Get(key);
     if (device_data && device_data->vtable.DestroyDevice) {
+        // Waits for in-flight overlays
+        device_data->text_renderer.reset();
+        device_data->pipeline_cache.reset();
         device_data->vtable.DestroyDevice(device, pAllocator);
         
-        std::lock_guard<std::mutex> lock(global_mutex);
-        device_map.erase(device);
+        device_map.Erase(key);
+        ReleaseQueues(queue_map, device_data);
         delete device_data;
     }
 }
 
-VKAPI_ATTR void VKAPI_CALL vkCmdBeginRenderPass(
-    VkCommandBuffer commandBuffer,
-    const VkRenderPassBeginInfo* pRenderPassBegin,
-    VkSubpassContents contents) {
-    
-    static int render_pass_count = 0;
-    render_pass_count++;
-    
-    // Create a modified render pass begin info to add text overlay effect
-    VkRenderPassBeginInfo modifiedRenderPassBegin = *pRenderPassBegin;
-    std::vector<VkClearValue> modifiedClearValues;
-    
-    // Copy original clear values
-    if (pRenderPassBegin->clearValueCount > 0 && pRenderPassBegin->pClearValues) {
-        modifiedClearValues.resize(pRenderPassBegin->clearValueCount);
-        for (uint32_t i = 0; i < pRenderPassBegin->clearValueCount; i++) {
-            modifiedClearValues[i] = pRenderPassBegin->pClearValues[i];
-        }
-        
-        // Modify the first clear value (usually the color buffer) to add a subtle tint
-        // This creates a visible effect showing the text overlay layer is active
-        if (modifiedClearValues.size() > 0) {
-            // Add a very subtle green tint to indicate Lorem Ipsum overlay is active
-            modifiedClearValues[0].color.float32[1] += 0.05f; // Slight green boost
-            
-            // Clamp to valid range
-            if (modifiedClearValues[0].color.float32[1] > 1.0f) {
-                modifiedClearValues[0].color.float32[1] = 1.0f;
-            }
-        }
-        
-        modifiedRenderPassBegin.pClearValues = modifiedClearValues.data();
-    }
-    
-    if (render_pass_count % 100 == 0) {
-        LogAPICall("vkCmdBeginRenderPass", "Applying Lorem Ipsum overlay effect (subtle green tint)");
-    }
+VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue(
+    VkDevice device,
+    uint32_t queueFamilyIndex,
+    uint32_t queueIndex,
+    VkQueue* pQueue) {
     
-    // Find the device for this command buffer
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdBeginRenderPass) {
-            device_data->vtable.CmdBeginRenderPass(commandBuffer, &modifiedRenderPassBegin, contents);
-            return;
-        }
+    DeviceData* device_data = GetDeviceData(device);
+    if (device_data && device_data->vtable.GetDeviceQueue) {
+        device_data->vtable.GetDeviceQueue(device, queueFamilyIndex, queueIndex, pQueue);
+        TrackQueue(queue_map, device_data, *pQueue, queueFamilyIndex, queueIndex);
     }
 }
 
-VKAPI_ATTR void VKAPI_CALL vkCmdEndRenderPass(
-    VkCommandBuffer commandBuffer) {
-    
-    static int end_render_pass_count = 0;
-    end_render_pass_count++;
-    
-    // Find the device for this command buffer and render text overlay
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdEndRenderPass) {
-            // Render text overlay before ending the render pass
-            RenderTextOverlay(commandBuffer, device_data);
-            
-            device_data->vtable.CmdEndRenderPass(commandBuffer);
-            
-            if (end_render_pass_count % 100 == 0) {
-                LogAPICall("vkCmdEndRenderPass", "Text overlay rendered before ending render pass");
-            }
-            return;
-        }
+VKAPI_ATTR void VKAPI_CALL vkGetDeviceQueue2(
+    VkDevice device,
+    const VkDeviceQueueInfo2* pQueueInfo,
+    VkQueue* pQueue) {
+    
+    DeviceData* device_data = GetDeviceData(device);
+    if (device_data && device_data->vtable.GetDeviceQueue2) {
+        device_data->vtable.GetDeviceQueue2(device, pQueueInfo, pQueue);
+        TrackQueue(queue_map, device_data, *pQueue, pQueueInfo->queueFamilyIndex, pQueueInfo->queueIndex);
     }
 }
 
-VKAPI_ATTR void VKAPI_CALL vkCmdDraw(
-    VkCommandBuffer commandBuffer,
-    uint32_t vertexCount,
-    uint32_t instanceCount,
-    uint32_t firstVertex,
-    uint32_t firstInstance) {
-    
-    static int draw_call_count = 0;
-    draw_call_count++;
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateSwapchainKHR(
+    VkDevice device,
+    const VkSwapchainCreateInfoKHR* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator,
+    VkSwapchainKHR* pSwapchain) {
     
-    if (draw_call_count % 100 == 0) {
-        std::stringstream ss;
-        ss << "Draw call #" << draw_call_count << " (vertices: " << vertexCount << ")";
-        LogAPICall("vkCmdDraw", ss.str().c_str());
+    DeviceData* device_data = GetDeviceData(device);
+    if (!device_data || !device_data->vtable.CreateSwapchainKHR) {
+        return VK_ERROR_INITIALIZATION_FAILED;
     }
     
-    // Find the device for this command buffer
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdDraw) {
-            device_data->vtable.CmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
-            return;
-        }
-    }
-}
-
-VKAPI_ATTR void VKAPI_CALL vkCmdDrawIndexed(
-    VkCommandBuffer commandBuffer,
-    uint32_t indexCount,
-    uint32_t instanceCount,
-    uint32_t firstIndex,
-    int32_t vertexOffset,
-    uint32_t firstInstance) {
-    
-    // Forward to the original function
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdDrawIndexed) {
-            device_data->vtable.CmdDrawIndexed(commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
-            return;
-        }
-    }
-}
-
-VKAPI_ATTR void VKAPI_CALL vkCmdSetViewport(
-    VkCommandBuffer commandBuffer,
-    uint32_t firstViewport,
-    uint32_t viewportCount,
-    const VkViewport* pViewports) {
-    
-    static int viewport_call_count = 0;
-    viewport_call_count++;
-    
-    // Create modified viewports that show text overlay effect
-    std::vector<VkViewport> modified_viewports;
-    if (pViewports && viewportCount > 0) {
-        modified_viewports.resize(viewportCount);
-        for (uint32_t i = 0; i < viewportCount; i++) {
-            modified_viewports[i] = pViewports[i];
-            
-            // Every few seconds, slightly modify the viewport to create a "text box" effect
-            if ((viewport_call_count / 180) % 3 == 1) {
-                // Create a smaller viewport that represents a "text overlay area"
-                float text_box_width = modified_viewports[i].width * 0.7f;
-                float text_box_height = modified_viewports[i].height * 0.1f;
-                
-                modified_viewports[i].x += (modified_viewports[i].width - text_box_width) / 2;
-                modified_viewports[i].y += 20; // Offset from top
-                modified_viewports[i].width = text_box_width;
-                modified_viewports[i].height = text_box_height;
-                
-                if (viewport_call_count % 180 == 0) {
-                    LogAPICall("vkCmdSetViewport", "Modified viewport for LOREM IPSUM text box overlay");
-                }
-            }
-        }
+    // The overlay draws into the swapchain images as color attachments
+    VkSwapchainCreateInfoKHR create_info = *pCreateInfo;
+    if (device_data->text_renderer) {
+        TextRenderer::PrepareSwapchain(&create_info);
     }
     
-    // Forward to the original function
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdSetViewport) {
-            if (!modified_viewports.empty() && (viewport_call_count / 180) % 3 == 1) {
-                device_data->vtable.CmdSetViewport(commandBuffer, firstViewport, viewportCount, modified_viewports.data());
-            } else {
-                device_data->vtable.CmdSetViewport(commandBuffer, firstViewport, viewportCount, pViewports);
-            }
-            return;
-        }
+    VkResult result = device_data->vtable.CreateSwapchainKHR(device, &create_info, pAllocator, pSwapchain);
+    if (result == VK_SUCCESS && device_data->text_renderer &&
+        !device_data->text_renderer->AddSwapchain(*pSwapchain, create_info)) {
+        LogAPICall("vkCreateSwapchainKHR", "Swapchain presents without the text overlay");
     }
+    return result;
 }
 
-VKAPI_ATTR void VKAPI_CALL vkCmdSetScissor(
-    VkCommandBuffer commandBuffer,
-    uint32_t firstScissor,
-    uint32_t scissorCount,
-    const VkRect2D* pScissors) {
-    
-    // Modify scissor to create visible text overlay areas
-    static int scissor_call_count = 0;
-    scissor_call_count++;
-    
-    // Create modified scissor rectangles that show "text overlay" areas
-    std::vector<VkRect2D> modified_scissors;
-    if (pScissors && scissorCount > 0) {
-        modified_scissors.resize(scissorCount);
-        for (uint32_t i = 0; i < scissorCount; i++) {
-            modified_scissors[i] = pScissors[i];
-            
-            // Every 120 frames, modify the scissor to show text overlay rectangles
-            if ((scissor_call_count / 120) % 4 == 0) {
-                // Create small rectangles that represent "LOREM IPSUM" text
-                int char_width = 8;
-                int char_height = 12;
-                int text_x = 50;  // Start position
-                int text_y = 50;
-                
-                // Modify scissor to only show small rectangular areas for text
-                if (i == 0) {
-                    modified_scissors[i].offset.x = text_x;
-                    modified_scissors[i].offset.y = text_y;
-                    modified_scissors[i].extent.width = char_width * 11; // "LOREM IPSUM" length
-                    modified_scissors[i].extent.height = char_height;
-                }
-            }
-        }
-        
-        if ((scissor_call_count / 120) % 4 == 0 && scissor_call_count % 120 == 0) {
-            LogAPICall("vkCmdSetScissor", "Modified scissor for LOREM IPSUM text overlay effect");
-        }
-    }
+VKAPI_ATTR void VKAPI_CALL vkDestroySwapchainKHR(
+    VkDevice device,
+    VkSwapchainKHR swapchain,
+    const VkAllocationCallbacks* pAllocator) {
     
-    // Forward to the original function with potentially modified scissors
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.CmdSetScissor) {
-            if (!modified_scissors.empty() && (scissor_call_count / 120) % 4 == 0) {
-                device_data->vtable.CmdSetScissor(commandBuffer, firstScissor, scissorCount, modified_scissors.data());
-            } else {
-                device_data->vtable.CmdSetScissor(commandBuffer, firstScissor, scissorCount, pScissors);
-            }
-            return;
+    DeviceData* device_data = GetDeviceData(device);
+    if (device_data && device_data->vtable.DestroySwapchainKHR) {
+        if (device_data->text_renderer) {
+            device_data->text_renderer->RemoveSwapchain(swapchain);
         }
+        device_data->vtable.DestroySwapchainKHR(device, swapchain, pAllocator);
     }
 }
 
@@ -502,26 +321,27 @@ VKAPI_ATTR VkResult VKAPI_CALL vkQueuePresentKHR(
     VkQueue queue,
     const VkPresentInfoKHR* pPresentInfo) {
     
-    static int present_count = 0;
-    present_count++;
-    
-    if (present_count % 60 == 0) {
-        std::stringstream ss;
-        ss << "Frame #" << present_count << " - Lorem Ipsum overlay active: '" 
-           << std::string(lorem_ipsum).substr(0, 60) << "...'";
-        LogAPICall("vkQueuePresentKHR", ss.str().c_str());
+    // Find the device for this queue
+    DeviceData* device_data = GetDeviceData(queue);
+    if (!device_data || !device_data->vtable.QueuePresentKHR) {
+        return VK_ERROR_INITIALIZATION_FAILED;
     }
     
-    // Find the device for this queue
-    std::lock_guard<std::mutex> lock(global_mutex);
-    for (auto& pair : device_map) {
-        DeviceData* device_data = pair.second;
-        if (device_data && device_data->vtable.QueuePresentKHR) {
-            return device_data->vtable.QueuePresentKHR(queue, pPresentInfo);
+    // The overlay waits for the application's semaphores and the present
+    // waits for the overlay
+    VkPresentInfoKHR present_info = *pPresentInfo;
+    if (device_data->text_renderer) {
+        std::lock_guard<std::mutex> lock(device_data->text_mutex);
+        UpdateStatusLine(device_data);
+        bool drawn = device_data->text_renderer->Draw(queue, device_data->text_lines, &present_info);
+        
+        if (device_data->present_count % 60 == 0) {
+            std::string message = device_data->text_lines[0] + (drawn ? "" : " (overlay skipped)");
+            LogAPICall("vkQueuePresentKHR", message.c_str());
         }
     }
     
-    return VK_ERROR_INITIALIZATION_FAILED;
+    return device_data->vtable.QueuePresentKHR(queue, &present_info);
 }
 
 // Implementation of remaining functions (similar to previous layers)
@@ -532,7 +352,11 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(
     
     InstanceData* instance_data = GetInstanceData(instance);
     if (instance_data && instance_data->vtable.EnumeratePhysicalDevices) {
-        return instance_data->vtable.EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
+        VkResult result = instance_data->vtable.EnumeratePhysicalDevices(instance, pPhysicalDeviceCount, pPhysicalDevices);
+        if ((result == VK_SUCCESS || result == VK_INCOMPLETE) && pPhysicalDevices) {
+            TrackPhysicalDevices(physical_device_map, instance_data, *pPhysicalDeviceCount, pPhysicalDevices);
+        }
+        return result;
     }
     
     PFN_vkEnumeratePhysicalDevices fpEnumerate = (PFN_vkEnumeratePhysicalDevices)vkGetInstanceProcAddr(instance, "vkEnumeratePhysicalDevices");
@@ -543,36 +367,89 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDevices(
     return VK_ERROR_INITIALIZATION_FAILED;
 }
 
+// Devices in a group are tracked like individually enumerated ones
+static VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroups(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    
+    LogAPICall("vkEnumeratePhysicalDeviceGroups", "Enumerating physical device groups");
+    
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->vtable.EnumeratePhysicalDeviceGroups) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    
+    VkResult result = instance_data->vtable.EnumeratePhysicalDeviceGroups(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    return result;
+}
+
+static VKAPI_ATTR VkResult VKAPI_CALL vkEnumeratePhysicalDeviceGroupsKHR(
+    VkInstance instance,
+    uint32_t* pPhysicalDeviceGroupCount,
+    VkPhysicalDeviceGroupProperties* pPhysicalDeviceGroupProperties) {
+    
+    LogAPICall("vkEnumeratePhysicalDeviceGroupsKHR", "Enumerating physical device groups");
+    
+    InstanceData* instance_data = GetInstanceData(instance);
+    if (!instance_data || !instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    
+    VkResult result = instance_data->vtable.EnumeratePhysicalDeviceGroupsKHR(
+        instance, pPhysicalDeviceGroupCount, pPhysicalDeviceGroupProperties);
+    TrackPhysicalDeviceGroups(physical_device_map, instance_data, result, *pPhysicalDeviceGroupCount,
+                              pPhysicalDeviceGroupProperties);
+    return result;
+}
+
 VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(
     VkPhysicalDevice physicalDevice,
     VkPhysicalDeviceProperties* pProperties) {
     
-    std::lock_guard<std::mutex> lock(global_mutex);
-    if (!instance_map.empty()) {
-        InstanceData* instance_data = instance_map.begin()->second;
-        if (instance_data && instance_data->vtable.GetPhysicalDeviceProperties) {
-            instance_data->vtable.GetPhysicalDeviceProperties(physicalDevice, pProperties);
-            return;
-        }
+    InstanceData* instance_data = GetInstanceData(physicalDevice);
+    if (instance_data && instance_data->vtable.GetPhysicalDeviceProperties) {
+        instance_data->vtable.GetPhysicalDeviceProperties(physicalDevice, pProperties);
     }
 }
 
+// Entry points this layer intercepts
+#define TEXT_OVERLAY_INSTANCE_PROCS(X) \
+    X(vkCreateInstance, vkCreateInstance) \
+    X(vkDestroyInstance, vkDestroyInstance) \
+    X(vkEnumeratePhysicalDevices, vkEnumeratePhysicalDevices) \
+    X(vkEnumeratePhysicalDeviceGroups, vkEnumeratePhysicalDeviceGroups) \
+    X(vkEnumeratePhysicalDeviceGroupsKHR, vkEnumeratePhysicalDeviceGroupsKHR) \
+    X(vkGetPhysicalDeviceProperties, vkGetPhysicalDeviceProperties) \
+    X(vkCreateDevice, vkCreateDevice) \
+    X(vkGetInstanceProcAddr, vkGetInstanceProcAddr) \
+    X(vkGetDeviceProcAddr, vkGetDeviceProcAddr) \
+    X(vkEnumerateInstanceLayerProperties, vkEnumerateInstanceLayerProperties) \
+    X(vkEnumerateInstanceExtensionProperties, vkEnumerateInstanceExtensionProperties) \
+    X(vkEnumerateDeviceLayerProperties, vkEnumerateDeviceLayerProperties) \
+    X(vkEnumerateDeviceExtensionProperties, vkEnumerateDeviceExtensionProperties)
+
+#define TEXT_OVERLAY_DEVICE_PROCS(X) \
+    X(vkDestroyDevice, vkDestroyDevice) \
+    X(vkGetDeviceQueue, vkGetDeviceQueue) \
+    X(vkGetDeviceQueue2, vkGetDeviceQueue2) \
+    X(vkCreateSwapchainKHR, vkCreateSwapchainKHR) \
+    X(vkDestroySwapchainKHR, vkDestroySwapchainKHR) \
+    X(vkQueuePresentKHR, vkQueuePresentKHR) \
+    X(vkGetDeviceProcAddr, vkGetDeviceProcAddr)
+
+DECLARE_PROC_TABLE(instance_procs, TEXT_OVERLAY_INSTANCE_PROCS);
+DECLARE_PROC_TABLE(device_procs, TEXT_OVERLAY_DEVICE_PROCS);
+
 VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(
     VkInstance instance,
     const char* pName) {
     
     // Return our layer's functions
-    if (strcmp(pName, "vkCreateInstance") == 0) return (PFN_vkVoidFunction)vkCreateInstance;
-    if (strcmp(pName, "vkDestroyInstance") == 0) return (PFN_vkVoidFunction)vkDestroyInstance;
-    if (strcmp(pName, "vkEnumeratePhysicalDevices") == 0) return (PFN_vkVoidFunction)vkEnumeratePhysicalDevices;
-    if (strcmp(pName, "vkGetPhysicalDeviceProperties") == 0) return (PFN_vkVoidFunction)vkGetPhysicalDeviceProperties;
-    if (strcmp(pName, "vkCreateDevice") == 0) return (PFN_vkVoidFunction)vkCreateDevice;
-    if (strcmp(pName, "vkGetInstanceProcAddr") == 0) return (PFN_vkVoidFunction)vkGetInstanceProcAddr;
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) return (PFN_vkVoidFunction)vkGetDeviceProcAddr;
-    if (strcmp(pName, "vkEnumerateInstanceLayerProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateInstanceLayerProperties;
-    if (strcmp(pName, "vkEnumerateInstanceExtensionProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateInstanceExtensionProperties;
-    if (strcmp(pName, "vkEnumerateDeviceLayerProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateDeviceLayerProperties;
-    if (strcmp(pName, "vkEnumerateDeviceExtensionProperties") == 0) return (PFN_vkVoidFunction)vkEnumerateDeviceExtensionProperties;
+    if (PFN_vkVoidFunction function = instance_procs.Find(pName)) return function;
     
     if (instance) {
         InstanceData* instance_data = GetInstanceData(instance);
@@ -589,15 +466,7 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetDeviceProcAddr(
     const char* pName) {
     
     // Return our layer's functions
-    if (strcmp(pName, "vkDestroyDevice") == 0) return (PFN_vkVoidFunction)vkDestroyDevice;
-    if (strcmp(pName, "vkCmdBeginRenderPass") == 0) return (PFN_vkVoidFunction)vkCmdBeginRenderPass;
-    if (strcmp(pName, "vkCmdEndRenderPass") == 0) return (PFN_vkVoidFunction)vkCmdEndRenderPass;
-    if (strcmp(pName, "vkCmdDraw") == 0) return (PFN_vkVoidFunction)vkCmdDraw;
-    if (strcmp(pName, "vkCmdDrawIndexed") == 0) return (PFN_vkVoidFunction)vkCmdDrawIndexed;
-    if (strcmp(pName, "vkCmdSetViewport") == 0) return (PFN_vkVoidFunction)vkCmdSetViewport;
-    if (strcmp(pName, "vkCmdSetScissor") == 0) return (PFN_vkVoidFunction)vkCmdSetScissor;
-    if (strcmp(pName, "vkQueuePresentKHR") == 0) return (PFN_vkVoidFunction)vkQueuePresentKHR;
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) return (PFN_vkVoidFunction)vkGetDeviceProcAddr;
+    if (PFN_vkVoidFunction function = device_procs.Find(pName)) return function;
     
     if (device) {
         DeviceData* device_data = GetDeviceData(device);
@@ -613,18 +482,7 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceLayerProperties(
     uint32_t* pPropertyCount,
     VkLayerProperties* pProperties) {
     
-    if (pProperties == nullptr) {
-        *pPropertyCount = 1;
-        return VK_SUCCESS;
-    }
-    
-    if (*pPropertyCount >= 1) {
-        memcpy(pProperties, &layer_props, sizeof(VkLayerProperties));
-        *pPropertyCount = 1;
-        return VK_SUCCESS;
-    }
-    
-    return VK_INCOMPLETE;
+    return EnumerateLayerProperties(layer_props, pPropertyCount, pProperties);
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateInstanceExtensionProperties(
@@ -661,16 +519,13 @@ VKAPI_ATTR VkResult VKAPI_CALL vkEnumerateDeviceExtensionProperties(
     }
     
     // Forward to next layer/driver for extension enumeration
-    std::lock_guard<std::mutex> lock(global_mutex);
-    if (!instance_map.empty()) {
-        InstanceData* instance_data = instance_map.begin()->second;
-        if (instance_data && instance_data->vtable.GetInstanceProcAddr) {
-            PFN_vkEnumerateDeviceExtensionProperties fpEnumerate = 
-                (PFN_vkEnumerateDeviceExtensionProperties)instance_data->vtable.GetInstanceProcAddr(
-                    instance_data->instance, "vkEnumerateDeviceExtensionProperties");
-            if (fpEnumerate) {
-                return fpEnumerate(physicalDevice, pLayerName, pPropertyCount, pProperties);
-            }
+    InstanceData* instance_data = GetInstanceData(physicalDevice);
+    if (instance_data && instance_data->vtable.GetInstanceProcAddr) {
+        PFN_vkEnumerateDeviceExtensionProperties fpEnumerate = 
+            (PFN_vkEnumerateDeviceExtensionProperties)instance_data->vtable.GetInstanceProcAddr(
+                instance_data->instance, "vkEnumerateDeviceExtensionProperties");
+        if (fpEnumerate) {
+            return fpEnumerate(physicalDevice, pLayerName, pPropertyCount, pProperties);
         }
     }
     
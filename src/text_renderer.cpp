@@ -0,0 +1,820 @@
+#include "text_renderer.h"
+#include "bitmap_font.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+// Compiled from shaders/text_overlay.* at build time
+static const uint32_t kTextOverlayVertSpirv[] = {
+#include "text_overlay.vert.spv.inc"
+};
+static const uint32_t kTextOverlayFragSpirv[] = {
+#include "text_overlay.frag.spv.inc"
+};
+
+// The atlas holds the 95 glyphs in font order, 16 cells to a row, then a
+// solid cell that background panels stretch across
+static constexpr uint32_t kAtlasColumns = 16;
+static constexpr uint32_t kAtlasWidth = kAtlasColumns * 8;
+static constexpr uint32_t kAtlasHeight = 6 * 8;
+static constexpr uint32_t kSolidGlyph = 95;
+
+// RGBA8, red in the low byte
+static constexpr uint32_t kTextColor = 0xFFFFFFFFu;
+static constexpr uint32_t kPanelColor = 0xA0000000u;
+
+struct TextParams {
+    float pixel_to_ndc[2];
+    float scale;
+};
+
+static uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties& memory, uint32_t type_bits,
+                               VkMemoryPropertyFlags flags) {
+    for (uint32_t i = 0; i < memory.memoryTypeCount; i++) {
+        if ((type_bits & (1u << i)) && (memory.memoryTypes[i].propertyFlags & flags) == flags) return i;
+    }
+    return UINT32_MAX;
+}
+
+void LoadTextRendererDispatch(TextRendererDispatch* dispatch, VkDevice device, PFN_vkGetDeviceProcAddr gdpa) {
+#define TEXT_RENDERER_LOAD(name) dispatch->name = reinterpret_cast<PFN_vk##name>(gdpa(device, "vk" #name));
+    TEXT_RENDERER_DEVICE_FUNCTIONS(TEXT_RENDERER_LOAD)
+#undef TEXT_RENDERER_LOAD
+}
+
+std::vector<std::string> WrapText(const std::string& text, size_t columns) {
+    std::vector<std::string> lines;
+    std::string line;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(' ', start);
+        if (end == std::string::npos) end = text.size();
+        std::string word = text.substr(start, end - start);
+        start = end + 1;
+        if (word.empty()) continue;
+
+        if (!line.empty() && line.size() + 1 + word.size() > columns) {
+            lines.push_back(line);
+            line.clear();
+        }
+        while (word.size() > columns) {
+            lines.push_back(word.substr(0, columns));
+            word.erase(0, columns);
+        }
+        if (!line.empty()) line += ' ';
+        line += word;
+    }
+    if (!line.empty()) lines.push_back(line);
+    return lines;
+}
+
+void TextRenderer::PrepareSwapchain(VkSwapchainCreateInfoKHR* create_info) {
+    create_info->imageUsage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+}
+
+TextRenderer::TextRenderer(const TextRendererDevice& device) : device_(device) {}
+
+std::unique_ptr<TextRenderer> TextRenderer::Create(const TextRendererDevice& device,
+                                                   const VkDeviceCreateInfo& create_info) {
+    if (!device.set_device_loader_data) return nullptr;
+    std::unique_ptr<TextRenderer> renderer(new TextRenderer(device));
+
+    // Queues created with flags can only be fetched with vkGetDeviceQueue2
+    // and never get the overlay. The atlas is uploaded on the first
+    // graphics queue.
+    VkQueue upload_queue = VK_NULL_HANDLE;
+    uint32_t upload_family = 0;
+    for (uint32_t i = 0; i < create_info.queueCreateInfoCount; i++) {
+        const VkDeviceQueueCreateInfo& queue_info = create_info.pQueueCreateInfos[i];
+        if (queue_info.flags != 0) continue;
+
+        uint32_t family = queue_info.queueFamilyIndex;
+        for (uint32_t index = 0; index < queue_info.queueCount; index++) {
+            VkQueue queue = VK_NULL_HANDLE;
+            device.vk.GetDeviceQueue(device.device, family, index, &queue);
+            if (queue == VK_NULL_HANDLE) continue;
+            renderer->queue_families_[queue] = family;
+
+            bool graphics = family < device.queue_families.size() &&
+                            (device.queue_families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT);
+            if (graphics && upload_queue == VK_NULL_HANDLE) {
+                upload_queue = queue;
+                upload_family = family;
+            }
+        }
+    }
+    if (upload_queue == VK_NULL_HANDLE) return nullptr;
+
+    // The queue hasn't been through the loader's trampoline yet
+    if (device.set_device_loader_data(device.device, upload_queue) != VK_SUCCESS) return nullptr;
+
+    if (!renderer->CreateAtlas() || !renderer->UploadAtlas(upload_queue, upload_family) ||
+        !renderer->CreatePipelineLayout()) {
+        return nullptr;
+    }
+    return renderer;
+}
+
+TextRenderer::~TextRenderer() {
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    for (auto& entry : targets_) {
+        DestroyTarget(entry.second.get());
+    }
+
+    vk.DestroyDescriptorPool(device, descriptor_pool_, nullptr);
+    vk.DestroyPipelineLayout(device, pipeline_layout_, nullptr);
+    vk.DestroyDescriptorSetLayout(device, set_layout_, nullptr);
+    vk.DestroyShaderModule(device, vertex_shader_, nullptr);
+    vk.DestroyShaderModule(device, fragment_shader_, nullptr);
+    vk.DestroySampler(device, sampler_, nullptr);
+    vk.DestroyImageView(device, atlas_view_, nullptr);
+    vk.DestroyImage(device, atlas_, nullptr);
+    vk.FreeMemory(device, atlas_memory_, nullptr);
+}
+
+bool TextRenderer::CreateMappedBuffer(MappedBuffer* mapped_buffer, VkDeviceSize size, VkBufferUsageFlags usage) {
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = size;
+    buffer_info.usage = usage;
+    buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vk.CreateBuffer(device, &buffer_info, nullptr, &mapped_buffer->buffer) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vk.GetBufferMemoryRequirements(device, mapped_buffer->buffer, &requirements);
+
+    // Written once per frame and read once by the GPU, so coherent memory
+    // saves the flush
+    const VkPhysicalDeviceMemoryProperties& memory = device_.memory_properties;
+    uint32_t memory_type = FindMemoryType(memory, requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if (memory_type == UINT32_MAX) {
+        memory_type = FindMemoryType(memory, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    }
+    if (memory_type == UINT32_MAX) return false;
+    mapped_buffer->coherent =
+        (memory.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    if (vk.AllocateMemory(device, &allocate_info, nullptr, &mapped_buffer->memory) != VK_SUCCESS) return false;
+    if (vk.BindBufferMemory(device, mapped_buffer->buffer, mapped_buffer->memory, 0) != VK_SUCCESS) return false;
+
+    void* mapped = nullptr;
+    if (vk.MapMemory(device, mapped_buffer->memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) return false;
+    mapped_buffer->mapped = static_cast<uint8_t*>(mapped);
+    return true;
+}
+
+void TextRenderer::DestroyMappedBuffer(MappedBuffer* mapped_buffer) {
+    // Freeing the memory unmaps it
+    device_.vk.DestroyBuffer(device_.device, mapped_buffer->buffer, nullptr);
+    device_.vk.FreeMemory(device_.device, mapped_buffer->memory, nullptr);
+    *mapped_buffer = MappedBuffer{};
+}
+
+bool TextRenderer::CreateAtlas() {
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    // Shared by every queue family the application draws from, so the
+    // atlas never needs an ownership transfer
+    std::vector<uint32_t> families;
+    for (const auto& entry : queue_families_) {
+        if (std::find(families.begin(), families.end(), entry.second) == families.end()) {
+            families.push_back(entry.second);
+        }
+    }
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R8_UNORM;
+    image_info.extent = {kAtlasWidth, kAtlasHeight, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (families.size() > 1) {
+        image_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        image_info.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        image_info.pQueueFamilyIndices = families.data();
+    } else {
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+    if (vk.CreateImage(device, &image_info, nullptr, &atlas_) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vk.GetImageMemoryRequirements(device, atlas_, &requirements);
+    uint32_t memory_type = FindMemoryType(device_.memory_properties, requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (memory_type == UINT32_MAX) {
+        memory_type = FindMemoryType(device_.memory_properties, requirements.memoryTypeBits, 0);
+    }
+    if (memory_type == UINT32_MAX) return false;
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    if (vk.AllocateMemory(device, &allocate_info, nullptr, &atlas_memory_) != VK_SUCCESS) return false;
+    if (vk.BindImageMemory(device, atlas_, atlas_memory_, 0) != VK_SUCCESS) return false;
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = atlas_;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = VK_FORMAT_R8_UNORM;
+    view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    if (vk.CreateImageView(device, &view_info, nullptr, &atlas_view_) != VK_SUCCESS) return false;
+
+    // The shader only uses texelFetch; the sampler is there for the
+    // descriptor type
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_NEAREST;
+    sampler_info.minFilter = VK_FILTER_NEAREST;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    return vk.CreateSampler(device, &sampler_info, nullptr, &sampler_) == VK_SUCCESS;
+}
+
+bool TextRenderer::UploadAtlas(VkQueue queue, uint32_t queue_family) {
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    MappedBuffer staging;
+    if (!CreateMappedBuffer(&staging, kAtlasWidth * kAtlasHeight, VK_BUFFER_USAGE_TRANSFER_SRC_BIT)) {
+        DestroyMappedBuffer(&staging);
+        return false;
+    }
+
+    // One byte per texel: 255 where the font has a bit set
+    for (uint32_t glyph = 0; glyph <= kSolidGlyph; glyph++) {
+        uint32_t cell_x = (glyph % kAtlasColumns) * 8;
+        uint32_t cell_y = (glyph / kAtlasColumns) * 8;
+        for (uint32_t y = 0; y < 8; y++) {
+            uint8_t bits = glyph == kSolidGlyph ? 0xFF : kBitmapFont[glyph][y];
+            uint8_t* row = staging.mapped + (cell_y + y) * kAtlasWidth + cell_x;
+            for (uint32_t x = 0; x < 8; x++) {
+                row[x] = (bits & (0x80u >> x)) ? 0xFF : 0x00;
+            }
+        }
+    }
+    if (!staging.coherent) {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = staging.memory;
+        range.size = VK_WHOLE_SIZE;
+        vk.FlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    VkCommandPool pool = VK_NULL_HANDLE;
+    VkCommandBuffer commands = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    auto upload = [&]() {
+        VkCommandPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        pool_info.queueFamilyIndex = queue_family;
+        if (vk.CreateCommandPool(device, &pool_info, nullptr, &pool) != VK_SUCCESS) return false;
+
+        VkCommandBufferAllocateInfo allocate_info{};
+        allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocate_info.commandPool = pool;
+        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocate_info.commandBufferCount = 1;
+        if (vk.AllocateCommandBuffers(device, &allocate_info, &commands) != VK_SUCCESS) return false;
+        if (device_.set_device_loader_data(device, commands) != VK_SUCCESS) return false;
+
+        VkFenceCreateInfo fence_info{};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vk.CreateFence(device, &fence_info, nullptr, &fence) != VK_SUCCESS) return false;
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vk.BeginCommandBuffer(commands, &begin_info);
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = atlas_;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                              0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent = {kAtlasWidth, kAtlasHeight, 1};
+        vk.CmdCopyBufferToImage(commands, staging.buffer, atlas_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                              0, nullptr, 0, nullptr, 1, &barrier);
+
+        if (vk.EndCommandBuffer(commands) != VK_SUCCESS) return false;
+
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &commands;
+        if (vk.QueueSubmit(queue, 1, &submit_info, fence) != VK_SUCCESS) return false;
+
+        // The only wait the renderer ever does, while vkCreateDevice still
+        // owns every queue
+        return vk.WaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+    };
+    bool uploaded = upload();
+
+    vk.DestroyFence(device, fence, nullptr);
+    vk.DestroyCommandPool(device, pool, nullptr);
+    DestroyMappedBuffer(&staging);
+    return uploaded;
+}
+
+bool TextRenderer::CreatePipelineLayout() {
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    auto create_shader = [&](const uint32_t* code, size_t code_size, VkShaderModule* shader) {
+        VkShaderModuleCreateInfo shader_info{};
+        shader_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        shader_info.codeSize = code_size;
+        shader_info.pCode = code;
+        return vk.CreateShaderModule(device, &shader_info, nullptr, shader) == VK_SUCCESS;
+    };
+    if (!create_shader(kTextOverlayVertSpirv, sizeof(kTextOverlayVertSpirv), &vertex_shader_) ||
+        !create_shader(kTextOverlayFragSpirv, sizeof(kTextOverlayFragSpirv), &fragment_shader_)) {
+        return false;
+    }
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    VkDescriptorSetLayoutCreateInfo set_layout_info{};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.bindingCount = 1;
+    set_layout_info.pBindings = &binding;
+    if (vk.CreateDescriptorSetLayout(device, &set_layout_info, nullptr, &set_layout_) != VK_SUCCESS) return false;
+
+    VkPushConstantRange push_range = {VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(TextParams)};
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &set_layout_;
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_range;
+    if (vk.CreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS) return false;
+
+    VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1};
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.maxSets = 1;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    if (vk.CreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool_) != VK_SUCCESS) return false;
+
+    VkDescriptorSetAllocateInfo set_info{};
+    set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    set_info.descriptorPool = descriptor_pool_;
+    set_info.descriptorSetCount = 1;
+    set_info.pSetLayouts = &set_layout_;
+    if (vk.AllocateDescriptorSets(device, &set_info, &descriptor_set_) != VK_SUCCESS) return false;
+
+    // The atlas never changes, so neither does the set
+    VkDescriptorImageInfo image_info = {sampler_, atlas_view_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptor_set_;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &image_info;
+    vk.UpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    return true;
+}
+
+bool TextRenderer::CreateTargetPipeline(Target* target, VkFormat format) {
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    // Draws over the presentable image in place: no clear, and it starts
+    // and ends in the present layout
+    VkAttachmentDescription attachment{};
+    attachment.format = format;
+    attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachment.initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VkAttachmentReference color_reference = {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_reference;
+
+    // The application's writes are made visible by the semaphores the
+    // overlay waits on at this stage
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.srcAccessMask = 0;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    VkRenderPassCreateInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = 1;
+    render_pass_info.pAttachments = &attachment;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+    render_pass_info.dependencyCount = 1;
+    render_pass_info.pDependencies = &dependency;
+    if (vk.CreateRenderPass(device, &render_pass_info, nullptr, &target->render_pass) != VK_SUCCESS) return false;
+
+    std::array<VkPipelineShaderStageCreateInfo, 2> stages{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = vertex_shader_;
+    stages[0].pName = "main";
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = fragment_shader_;
+    stages[1].pName = "main";
+
+    // One GlyphInstance per instance; the quad's corners come from the
+    // vertex index
+    VkVertexInputBindingDescription binding = {0, sizeof(GlyphInstance), VK_VERTEX_INPUT_RATE_INSTANCE};
+    std::array<VkVertexInputAttributeDescription, 3> attributes = {{
+        {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(GlyphInstance, x)},
+        {1, 0, VK_FORMAT_R32_UINT, offsetof(GlyphInstance, glyph_columns)},
+        {2, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(GlyphInstance, color)},
+    }};
+    VkPipelineVertexInputStateCreateInfo vertex_input{};
+    vertex_input.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertex_input.vertexBindingDescriptionCount = 1;
+    vertex_input.pVertexBindingDescriptions = &binding;
+    vertex_input.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+    vertex_input.pVertexAttributeDescriptions = attributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo input_assembly{};
+    input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+
+    // The swapchain's extent is fixed, so the viewport is baked in
+    VkViewport viewport = {0.0f, 0.0f, static_cast<float>(target->extent.width),
+                           static_cast<float>(target->extent.height), 0.0f, 1.0f};
+    VkRect2D scissor = {{0, 0}, target->extent};
+    VkPipelineViewportStateCreateInfo viewport_state{};
+    viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewport_state.viewportCount = 1;
+    viewport_state.pViewports = &viewport;
+    viewport_state.scissorCount = 1;
+    viewport_state.pScissors = &scissor;
+
+    VkPipelineRasterizationStateCreateInfo rasterization{};
+    rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterization.cullMode = VK_CULL_MODE_NONE;
+    rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterization.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisample{};
+    multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // Alpha blended over the image; its own alpha is left alone for the
+    // compositor
+    VkPipelineColorBlendAttachmentState blend_attachment{};
+    blend_attachment.blendEnable = VK_TRUE;
+    blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+    blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT;
+    VkPipelineColorBlendStateCreateInfo blend{};
+    blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    blend.attachmentCount = 1;
+    blend.pAttachments = &blend_attachment;
+
+    VkGraphicsPipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipeline_info.stageCount = static_cast<uint32_t>(stages.size());
+    pipeline_info.pStages = stages.data();
+    pipeline_info.pVertexInputState = &vertex_input;
+    pipeline_info.pInputAssemblyState = &input_assembly;
+    pipeline_info.pViewportState = &viewport_state;
+    pipeline_info.pRasterizationState = &rasterization;
+    pipeline_info.pMultisampleState = &multisample;
+    pipeline_info.pColorBlendState = &blend;
+    pipeline_info.layout = pipeline_layout_;
+    pipeline_info.renderPass = target->render_pass;
+    pipeline_info.subpass = 0;
+    return vk.CreateGraphicsPipelines(device, device_.pipeline_cache, 1, &pipeline_info, nullptr, &target->pipeline) ==
+           VK_SUCCESS;
+}
+
+bool TextRenderer::AddSwapchain(VkSwapchainKHR swapchain, const VkSwapchainCreateInfoKHR& create_info) {
+    if (create_info.imageArrayLayers != 1 || !(create_info.imageUsage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)) {
+        return false;
+    }
+
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    std::unique_ptr<Target> target(new Target());
+    target->extent = create_info.imageExtent;
+    // Whole font texels, so glyphs stay sharp: 8 px cells up to 720p
+    target->scale = target->extent.height >= 1440 ? 3.0f : target->extent.height >= 720 ? 2.0f : 1.0f;
+
+    auto create = [&]() {
+        uint32_t image_count = 0;
+        if (vk.GetSwapchainImagesKHR(device, swapchain, &image_count, nullptr) != VK_SUCCESS) return false;
+        std::vector<VkImage> images(image_count);
+        if (vk.GetSwapchainImagesKHR(device, swapchain, &image_count, images.data()) != VK_SUCCESS) return false;
+
+        if (!CreateTargetPipeline(target.get(), create_info.imageFormat)) return false;
+
+        for (VkImage image : images) {
+            VkImageViewCreateInfo view_info{};
+            view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            view_info.image = image;
+            view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            view_info.format = create_info.imageFormat;
+            view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            VkImageView view = VK_NULL_HANDLE;
+            if (vk.CreateImageView(device, &view_info, nullptr, &view) != VK_SUCCESS) return false;
+            target->views.push_back(view);
+
+            VkFramebufferCreateInfo framebuffer_info{};
+            framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebuffer_info.renderPass = target->render_pass;
+            framebuffer_info.attachmentCount = 1;
+            framebuffer_info.pAttachments = &view;
+            framebuffer_info.width = target->extent.width;
+            framebuffer_info.height = target->extent.height;
+            framebuffer_info.layers = 1;
+            VkFramebuffer framebuffer = VK_NULL_HANDLE;
+            if (vk.CreateFramebuffer(device, &framebuffer_info, nullptr, &framebuffer) != VK_SUCCESS) return false;
+            target->framebuffers.push_back(framebuffer);
+        }
+
+        if (!CreateMappedBuffer(&target->glyphs, kSlotCount * kMaxGlyphs * sizeof(GlyphInstance),
+                                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)) {
+            return false;
+        }
+
+        VkFenceCreateInfo fence_info{};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        VkSemaphoreCreateInfo semaphore_info{};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        for (Slot& slot : target->slots) {
+            if (vk.CreateFence(device, &fence_info, nullptr, &slot.fence) != VK_SUCCESS ||
+                vk.CreateSemaphore(device, &semaphore_info, nullptr, &slot.rendered) != VK_SUCCESS) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!create()) {
+        DestroyTarget(target.get());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(targets_mutex_);
+    targets_[swapchain] = std::move(target);
+    return true;
+}
+
+void TextRenderer::RemoveSwapchain(VkSwapchainKHR swapchain) {
+    std::unique_ptr<Target> target;
+    {
+        std::lock_guard<std::mutex> lock(targets_mutex_);
+        auto it = targets_.find(swapchain);
+        if (it == targets_.end()) return;
+        target = std::move(it->second);
+        targets_.erase(it);
+    }
+    DestroyTarget(target.get());
+}
+
+void TextRenderer::DestroyTarget(Target* target) {
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    // Let in-flight overlays finish before their framebuffers go away
+    std::array<VkFence, kSlotCount> fences;
+    uint32_t fence_count = 0;
+    for (const Slot& slot : target->slots) {
+        if (slot.fence != VK_NULL_HANDLE) fences[fence_count++] = slot.fence;
+    }
+    if (fence_count > 0) {
+        vk.WaitForFences(device, fence_count, fences.data(), VK_TRUE, UINT64_MAX);
+    }
+
+    for (Slot& slot : target->slots) {
+        vk.DestroyFence(device, slot.fence, nullptr);
+        vk.DestroySemaphore(device, slot.rendered, nullptr);
+    }
+    vk.DestroyCommandPool(device, target->command_pool, nullptr);
+    DestroyMappedBuffer(&target->glyphs);
+
+    for (VkFramebuffer framebuffer : target->framebuffers) {
+        vk.DestroyFramebuffer(device, framebuffer, nullptr);
+    }
+    for (VkImageView view : target->views) {
+        vk.DestroyImageView(device, view, nullptr);
+    }
+    vk.DestroyPipeline(device, target->pipeline, nullptr);
+    vk.DestroyRenderPass(device, target->render_pass, nullptr);
+}
+
+bool TextRenderer::EnsureCommandBuffers(Target* target, uint32_t queue_family) {
+    if (target->command_pool != VK_NULL_HANDLE) {
+        return queue_family == target->queue_family;
+    }
+    if (queue_family >= device_.queue_families.size() ||
+        !(device_.queue_families[queue_family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+        return false;
+    }
+
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = queue_family;
+    if (vk.CreateCommandPool(device, &pool_info, nullptr, &target->command_pool) != VK_SUCCESS) return false;
+
+    std::array<VkCommandBuffer, kSlotCount> command_buffers{};
+    VkCommandBufferAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.commandPool = target->command_pool;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = kSlotCount;
+    if (vk.AllocateCommandBuffers(device, &allocate_info, command_buffers.data()) != VK_SUCCESS) return false;
+
+    for (uint32_t i = 0; i < kSlotCount; i++) {
+        // Command buffers made below the loader need its dispatch pointer
+        if (device_.set_device_loader_data(device, command_buffers[i]) != VK_SUCCESS) return false;
+        target->slots[i].commands = command_buffers[i];
+    }
+
+    target->queue_family = queue_family;
+    return true;
+}
+
+uint32_t TextRenderer::LayoutText(const Target& target, const std::vector<std::string>& lines,
+                                  GlyphInstance* glyphs) const {
+    // One cell of margin; each line gets a panel half a cell wider than its
+    // text on either side, drawn before the text it sits behind
+    const float cell = 8.0f * target.scale;
+    const float width = static_cast<float>(target.extent.width);
+    const float height = static_cast<float>(target.extent.height);
+    if (width < 3.0f * cell) return 0;
+    const size_t max_columns = static_cast<size_t>((width - 2.0f * cell) / cell);
+
+    uint32_t count = 0;
+    float y = cell;
+    for (const std::string& line : lines) {
+        if (y + cell > height) break;
+
+        uint32_t columns = static_cast<uint32_t>(std::min(line.size(), max_columns));
+        if (columns == 0 || count + columns + 1 > kMaxGlyphs) {
+            y += cell;
+            continue;
+        }
+
+        glyphs[count++] = {cell * 0.5f, y, kSolidGlyph | ((columns + 1) << 8), kPanelColor};
+        for (uint32_t i = 0; i < columns; i++) {
+            unsigned char c = static_cast<unsigned char>(line[i]);
+            if (c == ' ') continue;
+            uint32_t glyph = (c > ' ' && c < 127) ? c - ' ' : '?' - ' ';
+            glyphs[count++] = {cell * (i + 1), y, glyph | (1u << 8), kTextColor};
+        }
+        y += cell;
+    }
+    return count;
+}
+
+bool TextRenderer::Draw(VkQueue queue, const std::vector<std::string>& lines, VkPresentInfoKHR* present_info) {
+    if (present_info->swapchainCount != 1) return false;
+
+    // Filled in at creation and read-only since
+    auto family = queue_families_.find(queue);
+    if (family == queue_families_.end()) return false;
+
+    Target* target = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(targets_mutex_);
+        auto it = targets_.find(present_info->pSwapchains[0]);
+        if (it != targets_.end()) target = it->second.get();
+    }
+    if (!target) return false;
+
+    VkDevice device = device_.device;
+    const TextRendererDispatch& vk = device_.vk;
+
+    // Never wait on the GPU here: a busy slot costs this frame its overlay
+    uint32_t image_index = present_info->pImageIndices[0];
+    uint32_t slot_index = target->next_slot;
+    Slot& slot = target->slots[slot_index];
+    if (image_index >= target->framebuffers.size() || !EnsureCommandBuffers(target, family->second) ||
+        vk.GetFenceStatus(device, slot.fence) != VK_SUCCESS) {
+        return false;
+    }
+
+    // The slot's part of the ring is free once its fence has signalled
+    VkDeviceSize ring_offset = static_cast<VkDeviceSize>(slot_index) * kMaxGlyphs * sizeof(GlyphInstance);
+    GlyphInstance* glyphs = reinterpret_cast<GlyphInstance*>(target->glyphs.mapped + ring_offset);
+    uint32_t glyph_count = LayoutText(*target, lines, glyphs);
+    if (glyph_count == 0) return false;
+    if (!target->glyphs.coherent) {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = target->glyphs.memory;
+        range.size = VK_WHOLE_SIZE;
+        vk.FlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vk.BeginCommandBuffer(slot.commands, &begin_info);
+
+    VkRenderPassBeginInfo render_pass_begin{};
+    render_pass_begin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_begin.renderPass = target->render_pass;
+    render_pass_begin.framebuffer = target->framebuffers[image_index];
+    render_pass_begin.renderArea = {{0, 0}, target->extent};
+    vk.CmdBeginRenderPass(slot.commands, &render_pass_begin, VK_SUBPASS_CONTENTS_INLINE);
+
+    TextParams params = {{2.0f / target->extent.width, 2.0f / target->extent.height}, target->scale};
+    vk.CmdBindPipeline(slot.commands, VK_PIPELINE_BIND_POINT_GRAPHICS, target->pipeline);
+    vk.CmdBindDescriptorSets(slot.commands, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_, 0, 1,
+                             &descriptor_set_, 0, nullptr);
+    vk.CmdBindVertexBuffers(slot.commands, 0, 1, &target->glyphs.buffer, &ring_offset);
+    vk.CmdPushConstants(slot.commands, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(params), &params);
+    vk.CmdDraw(slot.commands, 4, glyph_count, 0, 0);
+
+    vk.CmdEndRenderPass(slot.commands);
+    if (vk.EndCommandBuffer(slot.commands) != VK_SUCCESS) return false;
+
+    // Wait for whatever the application's present waited for
+    target->wait_stages.assign(present_info->waitSemaphoreCount, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = present_info->waitSemaphoreCount;
+    submit_info.pWaitSemaphores = present_info->pWaitSemaphores;
+    submit_info.pWaitDstStageMask = target->wait_stages.data();
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &slot.commands;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &slot.rendered;
+
+    vk.ResetFences(device, 1, &slot.fence);
+    if (vk.QueueSubmit(queue, 1, &submit_info, slot.fence) != VK_SUCCESS) {
+        // The slot's fence was reset for this submit; an empty one signals
+        // it, or the slot and DestroyTarget would wait on it forever
+        VkSubmitInfo empty_submit{};
+        empty_submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        vk.QueueSubmit(queue, 1, &empty_submit, slot.fence);
+        return false;
+    }
+
+    target->next_slot = (slot_index + 1) % kSlotCount;
+    present_info->waitSemaphoreCount = 1;
+    present_info->pWaitSemaphores = &slot.rendered;
+    return true;
+}
@@ -0,0 +1,121 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+static uint64_t PackRange(uint32_t begin, uint32_t end) {
+    return static_cast<uint64_t>(end) << 32 | begin;
+}
+
+ThreadPool::ThreadPool(uint32_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    shares_.reset(new Share[threads]);
+    workers_.reserve(threads - 1);
+    for (uint32_t i = 1; i < threads; i++) {
+        workers_.emplace_back([this, i] { Worker(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& fn) {
+    if (count == 0) return;
+    if (workers_.empty() || count == 1) {
+        for (uint32_t i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> caller_lock(caller_mutex_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn_ = &fn;
+        // Contiguous shares, the first `count % threads` one index longer
+        uint32_t threads = ThreadCount();
+        uint32_t begin = 0;
+        for (uint32_t i = 0; i < threads; i++) {
+            uint32_t end = begin + count / threads + (i < count % threads ? 1 : 0);
+            shares_[i].range.store(PackRange(begin, end), std::memory_order_relaxed);
+            begin = end;
+        }
+        busy_workers_ = static_cast<uint32_t>(workers_.size());
+        generation_++;
+    }
+    work_ready_.notify_all();
+
+    RunIndices(0);
+
+    // Workers still hold fn_ until they check in
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_done_.wait(lock, [this] { return busy_workers_ == 0; });
+    fn_ = nullptr;
+}
+
+void ThreadPool::Worker(uint32_t self) {
+    uint64_t seen_generation = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_ready_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+        if (stopping_) return;
+        seen_generation = generation_;
+
+        lock.unlock();
+        RunIndices(self);
+        lock.lock();
+
+        if (--busy_workers_ == 0) work_done_.notify_one();
+    }
+}
+
+void ThreadPool::RunIndices(uint32_t self) {
+    while (true) {
+        uint32_t index;
+        if (TakeIndex(self, &index)) {
+            (*fn_)(index);
+        } else if (!Steal(self)) {
+            // Every share is empty; what is still running belongs to others
+            return;
+        }
+    }
+}
+
+bool ThreadPool::TakeIndex(uint32_t self, uint32_t* index) {
+    std::atomic<uint64_t>& range = shares_[self].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t begin = static_cast<uint32_t>(current);
+        uint32_t end = static_cast<uint32_t>(current >> 32);
+        if (begin >= end) return false;
+        if (range.compare_exchange_weak(current, PackRange(begin + 1, end), std::memory_order_acq_rel)) {
+            *index = begin;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::Steal(uint32_t self) {
+    // Indices only ever leave a share, and a share is refilled only by its
+    // owner once it is empty, so a stale range can never compare equal
+    uint32_t threads = ThreadCount();
+    for (uint32_t i = 1; i < threads; i++) {
+        std::atomic<uint64_t>& victim = shares_[(self + i) % threads].range;
+        uint64_t current = victim.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t begin = static_cast<uint32_t>(current);
+            uint32_t end = static_cast<uint32_t>(current >> 32);
+            if (begin >= end) break;
+            uint32_t split = end - (end - begin + 1) / 2;
+            if (victim.compare_exchange_weak(current, PackRange(begin, split), std::memory_order_acq_rel)) {
+                shares_[self].range.store(PackRange(split, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
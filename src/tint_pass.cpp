@@ -0,0 +1,519 @@
+#include "tint_pass.h"
+#include <array>
+
+// Compiled from shaders/green_tint.comp at build time
+static const uint32_t kGreenTintSpirv[] = {
+#include "green_tint.comp.spv.inc"
+};
+
+// Matches the shader's workgroup
+static constexpr uint32_t kGroupSize = 8;
+
+void LoadTintPassDispatch(TintPassDispatch* dispatch, VkDevice device, PFN_vkGetDeviceProcAddr gdpa) {
+#define TINT_PASS_LOAD(name) dispatch->name = reinterpret_cast<PFN_vk##name>(gdpa(device, "vk" #name));
+    TINT_PASS_DEVICE_FUNCTIONS(TINT_PASS_LOAD)
+#undef TINT_PASS_LOAD
+}
+
+static VkImageMemoryBarrier ImageBarrier(VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+                                         VkAccessFlags src_access, VkAccessFlags dst_access) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = src_access;
+    barrier.dstAccessMask = dst_access;
+    barrier.oldLayout = old_layout;
+    barrier.newLayout = new_layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    return barrier;
+}
+
+// The format of the shader's rgba8 storage image. B8G8R8A8_UNORM swapchains
+// go through a staging image of this format: a copy moves texels as stored
+// and the shader scales red and blue alike, so the swapped channels come back
+// right. sRGB and wider formats rarely allow storage use anyway.
+static constexpr VkFormat kStorageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+static bool IsTintFormat(VkFormat format) {
+    return format == kStorageFormat || format == VK_FORMAT_B8G8R8A8_UNORM;
+}
+
+// Swapchain usage the tint needs for a format
+static VkImageUsageFlags TintUsage(VkFormat format) {
+    return format == kStorageFormat ? VK_IMAGE_USAGE_STORAGE_BIT
+                                    : VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+}
+
+static uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties& memory, uint32_t type_bits,
+                               VkMemoryPropertyFlags flags) {
+    for (uint32_t i = 0; i < memory.memoryTypeCount; i++) {
+        if ((type_bits & (1u << i)) && (memory.memoryTypes[i].propertyFlags & flags) == flags) return i;
+    }
+    return UINT32_MAX;
+}
+
+TintPass::TintPass(const TintPassDevice& device) : device_(device) {}
+
+std::unique_ptr<TintPass> TintPass::Create(const TintPassDevice& device, const VkDeviceCreateInfo& create_info) {
+    if (!device.set_device_loader_data || !device.get_format_properties || !device.get_surface_capabilities) {
+        return nullptr;
+    }
+    std::unique_ptr<TintPass> pass(new TintPass(device));
+
+    // Queues created with flags can only be fetched with vkGetDeviceQueue2
+    // and never get the tint
+    for (uint32_t i = 0; i < create_info.queueCreateInfoCount; i++) {
+        const VkDeviceQueueCreateInfo& queue_info = create_info.pQueueCreateInfos[i];
+        if (queue_info.flags != 0) continue;
+
+        for (uint32_t index = 0; index < queue_info.queueCount; index++) {
+            VkQueue queue = VK_NULL_HANDLE;
+            device.vk.GetDeviceQueue(device.device, queue_info.queueFamilyIndex, index, &queue);
+            if (queue != VK_NULL_HANDLE) pass->queue_families_[queue] = queue_info.queueFamilyIndex;
+        }
+    }
+
+    if (!pass->CreatePipeline()) return nullptr;
+    return pass;
+}
+
+TintPass::~TintPass() {
+    VkDevice device = device_.device;
+    const TintPassDispatch& vk = device_.vk;
+
+    for (auto& entry : targets_) {
+        DestroyTarget(entry.second.get());
+    }
+
+    vk.DestroyPipeline(device, pipeline_, nullptr);
+    vk.DestroyPipelineLayout(device, pipeline_layout_, nullptr);
+    vk.DestroyDescriptorSetLayout(device, set_layout_, nullptr);
+    vk.DestroyShaderModule(device, shader_, nullptr);
+}
+
+bool TintPass::CreatePipeline() {
+    VkDevice device = device_.device;
+    const TintPassDispatch& vk = device_.vk;
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    VkDescriptorSetLayoutCreateInfo set_layout_info{};
+    set_layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    set_layout_info.bindingCount = 1;
+    set_layout_info.pBindings = &binding;
+    if (vk.CreateDescriptorSetLayout(device, &set_layout_info, nullptr, &set_layout_) != VK_SUCCESS) return false;
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &set_layout_;
+    if (vk.CreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS) return false;
+
+    VkShaderModuleCreateInfo shader_info{};
+    shader_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_info.codeSize = sizeof(kGreenTintSpirv);
+    shader_info.pCode = kGreenTintSpirv;
+    if (vk.CreateShaderModule(device, &shader_info, nullptr, &shader_) != VK_SUCCESS) return false;
+
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.module = shader_;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.layout = pipeline_layout_;
+    return vk.CreateComputePipelines(device, device_.pipeline_cache, 1, &pipeline_info, nullptr, &pipeline_) == VK_SUCCESS;
+}
+
+bool TintPass::PrepareSwapchain(VkSwapchainCreateInfoKHR* create_info) const {
+    if (!IsTintFormat(create_info->imageFormat) || create_info->imageArrayLayers != 1) return false;
+    VkImageUsageFlags usage = TintUsage(create_info->imageFormat);
+
+    VkSurfaceCapabilitiesKHR capabilities{};
+    if (device_.get_surface_capabilities(device_.physical_device, create_info->surface, &capabilities) != VK_SUCCESS ||
+        (capabilities.supportedUsageFlags & usage) != usage) {
+        return false;
+    }
+
+    // The storage image is the swapchain's own or the staging image; either
+    // way it is R8G8B8A8_UNORM
+    VkFormatProperties format_properties{};
+    device_.get_format_properties(device_.physical_device, kStorageFormat, &format_properties);
+    if (!(format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) return false;
+
+    create_info->imageUsage |= usage;
+    return true;
+}
+
+bool TintPass::IsPrepared(const VkSwapchainCreateInfoKHR& create_info) {
+    VkImageUsageFlags usage = TintUsage(create_info.imageFormat);
+    return IsTintFormat(create_info.imageFormat) && create_info.imageArrayLayers == 1 &&
+           (create_info.imageUsage & usage) == usage;
+}
+
+bool TintPass::CreateStagingImage(Target* target) {
+    VkDevice device = device_.device;
+    const TintPassDispatch& vk = device_.vk;
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = kStorageFormat;
+    image_info.extent = {target->extent.width, target->extent.height, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vk.CreateImage(device, &image_info, nullptr, &target->staging_image) != VK_SUCCESS) return false;
+
+    VkMemoryRequirements requirements;
+    vk.GetImageMemoryRequirements(device, target->staging_image, &requirements);
+    uint32_t memory_type = FindMemoryType(device_.memory_properties, requirements.memoryTypeBits,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (memory_type == UINT32_MAX) return false;
+
+    VkMemoryAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize = requirements.size;
+    allocate_info.memoryTypeIndex = memory_type;
+    if (vk.AllocateMemory(device, &allocate_info, nullptr, &target->staging_memory) != VK_SUCCESS) return false;
+    if (vk.BindImageMemory(device, target->staging_image, target->staging_memory, 0) != VK_SUCCESS) return false;
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = target->staging_image;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = kStorageFormat;
+    view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    return vk.CreateImageView(device, &view_info, nullptr, &target->staging_view) == VK_SUCCESS;
+}
+
+bool TintPass::AddSwapchain(VkSwapchainKHR swapchain, const VkSwapchainCreateInfoKHR& create_info) {
+    if (!IsPrepared(create_info)) return false;
+
+    VkDevice device = device_.device;
+    const TintPassDispatch& vk = device_.vk;
+
+    std::unique_ptr<Target> target(new Target());
+    target->extent = create_info.imageExtent;
+
+    auto create = [&]() {
+        uint32_t image_count = 0;
+        if (vk.GetSwapchainImagesKHR(device, swapchain, &image_count, nullptr) != VK_SUCCESS) return false;
+        std::vector<VkImage> images(image_count);
+        if (vk.GetSwapchainImagesKHR(device, swapchain, &image_count, images.data()) != VK_SUCCESS) return false;
+        if (image_count == 0) return false;
+        target->images.resize(image_count);
+        if (create_info.imageFormat != kStorageFormat && !CreateStagingImage(target.get())) return false;
+
+        VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, image_count};
+        VkDescriptorPoolCreateInfo pool_info{};
+        pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        pool_info.maxSets = image_count;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes = &pool_size;
+        if (vk.CreateDescriptorPool(device, &pool_info, nullptr, &target->descriptor_pool) != VK_SUCCESS) {
+            return false;
+        }
+
+        std::vector<VkDescriptorSetLayout> set_layouts(image_count, set_layout_);
+        std::vector<VkDescriptorSet> sets(image_count);
+        VkDescriptorSetAllocateInfo set_info{};
+        set_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        set_info.descriptorPool = target->descriptor_pool;
+        set_info.descriptorSetCount = image_count;
+        set_info.pSetLayouts = set_layouts.data();
+        if (vk.AllocateDescriptorSets(device, &set_info, sets.data()) != VK_SUCCESS) return false;
+
+        VkFenceCreateInfo fence_info{};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        VkSemaphoreCreateInfo semaphore_info{};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        for (uint32_t i = 0; i < image_count; i++) {
+            ImageTint& image_tint = target->images[i];
+            image_tint.image = images[i];
+            image_tint.descriptor_set = sets[i];
+
+            if (target->staging_image == VK_NULL_HANDLE) {
+                VkImageViewCreateInfo view_info{};
+                view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                view_info.image = images[i];
+                view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                view_info.format = create_info.imageFormat;
+                view_info.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+                if (vk.CreateImageView(device, &view_info, nullptr, &image_tint.view) != VK_SUCCESS) return false;
+            }
+
+            if (vk.CreateFence(device, &fence_info, nullptr, &image_tint.fence) != VK_SUCCESS ||
+                vk.CreateSemaphore(device, &semaphore_info, nullptr, &image_tint.tinted) != VK_SUCCESS) {
+                return false;
+            }
+
+            // Each set only ever names its own image (or the staging image),
+            // so it is written once
+            VkImageView view = image_tint.view != VK_NULL_HANDLE ? image_tint.view : target->staging_view;
+            VkDescriptorImageInfo image_info = {VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_GENERAL};
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = image_tint.descriptor_set;
+            write.dstBinding = 0;
+            write.descriptorCount = 1;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            write.pImageInfo = &image_info;
+            vk.UpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        }
+        return true;
+    };
+    if (!create()) {
+        DestroyTarget(target.get());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(targets_mutex_);
+    targets_[swapchain] = std::move(target);
+    return true;
+}
+
+void TintPass::RemoveSwapchain(VkSwapchainKHR swapchain) {
+    std::unique_ptr<Target> target;
+    {
+        std::lock_guard<std::mutex> lock(targets_mutex_);
+        auto it = targets_.find(swapchain);
+        if (it == targets_.end()) return;
+        target = std::move(it->second);
+        targets_.erase(it);
+    }
+    DestroyTarget(target.get());
+}
+
+void TintPass::DestroyTarget(Target* target) {
+    VkDevice device = device_.device;
+    const TintPassDispatch& vk = device_.vk;
+
+    // Let in-flight tints finish before their views go away
+    std::vector<VkFence> fences;
+    for (const ImageTint& image_tint : target->images) {
+        if (image_tint.fence != VK_NULL_HANDLE) fences.push_back(image_tint.fence);
+    }
+    if (!fences.empty()) {
+        vk.WaitForFences(device, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+    }
+
+    for (ImageTint& image_tint : target->images) {
+        vk.DestroyFence(device, image_tint.fence, nullptr);
+        vk.DestroySemaphore(device, image_tint.tinted, nullptr);
+        vk.DestroyImageView(device, image_tint.view, nullptr);
+    }
+    vk.DestroyImageView(device, target->staging_view, nullptr);
+    vk.DestroyImage(device, target->staging_image, nullptr);
+    vk.FreeMemory(device, target->staging_memory, nullptr);
+    vk.DestroyCommandPool(device, target->command_pool, nullptr);
+    vk.DestroyDescriptorPool(device, target->descriptor_pool, nullptr);
+}
+
+bool TintPass::EnsureCommandBuffers(Target* target, uint32_t queue_family) {
+    if (target->command_pool != VK_NULL_HANDLE) {
+        return queue_family == target->queue_family;
+    }
+    if (queue_family >= device_.queue_families.size() ||
+        !(device_.queue_families[queue_family].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+        return false;
+    }
+
+    VkDevice device = device_.device;
+    const TintPassDispatch& vk = device_.vk;
+
+    // Recorded once and never reset
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.queueFamilyIndex = queue_family;
+    if (vk.CreateCommandPool(device, &pool_info, nullptr, &target->command_pool) != VK_SUCCESS) return false;
+
+    uint32_t image_count = static_cast<uint32_t>(target->images.size());
+    std::vector<VkCommandBuffer> command_buffers(image_count);
+    VkCommandBufferAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.commandPool = target->command_pool;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = image_count;
+    if (vk.AllocateCommandBuffers(device, &allocate_info, command_buffers.data()) != VK_SUCCESS) return false;
+
+    for (uint32_t i = 0; i < image_count; i++) {
+        // Command buffers made below the loader need its dispatch pointer
+        if (device_.set_device_loader_data(device, command_buffers[i]) != VK_SUCCESS) return false;
+        target->images[i].commands = command_buffers[i];
+        Record(*target, target->images[i]);
+    }
+
+    target->queue_family = queue_family;
+    return true;
+}
+
+void TintPass::Record(const Target& target, const ImageTint& image_tint) {
+    const TintPassDispatch& vk = device_.vk;
+    VkCommandBuffer commands = image_tint.commands;
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    vk.BeginCommandBuffer(commands, &begin_info);
+
+    if (target.staging_image != VK_NULL_HANDLE) {
+        RecordStaged(target, image_tint);
+        vk.EndCommandBuffer(commands);
+        return;
+    }
+
+    // The application's writes are made visible by the semaphores the
+    // submit waits on at the compute stage; its contents are kept
+    VkImageMemoryBarrier barrier = ImageBarrier(image_tint.image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                                VK_IMAGE_LAYOUT_GENERAL, 0,
+                                                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                          0, nullptr, 0, nullptr, 1, &barrier);
+
+    vk.CmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+    vk.CmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1,
+                             &image_tint.descriptor_set, 0, nullptr);
+    vk.CmdDispatch(commands, (target.extent.width + kGroupSize - 1) / kGroupSize,
+                   (target.extent.height + kGroupSize - 1) / kGroupSize, 1);
+
+    // The present's semaphore wait covers visibility to the presentation
+    // engine
+    barrier = ImageBarrier(image_tint.image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                           VK_ACCESS_SHADER_WRITE_BIT, 0);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                          0, nullptr, 0, nullptr, 1, &barrier);
+
+    vk.EndCommandBuffer(commands);
+}
+
+void TintPass::RecordStaged(const Target& target, const ImageTint& image_tint) {
+    const TintPassDispatch& vk = device_.vk;
+    VkCommandBuffer commands = image_tint.commands;
+
+    // The semaphores the submit waits on at the transfer stage make the
+    // application's writes visible. The staging image is overwritten whole,
+    // so its contents never need keeping; the last tint's copy out only has
+    // to finish first.
+    std::array<VkImageMemoryBarrier, 2> barriers = {
+        ImageBarrier(image_tint.image, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     0, VK_ACCESS_TRANSFER_READ_BIT),
+        ImageBarrier(target.staging_image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     0, VK_ACCESS_TRANSFER_WRITE_BIT),
+    };
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                          0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.extent = {target.extent.width, target.extent.height, 1};
+    vk.CmdCopyImage(commands, image_tint.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target.staging_image,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    barriers[0] = ImageBarrier(target.staging_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL,
+                               VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                          0, nullptr, 0, nullptr, 1, barriers.data());
+
+    vk.CmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+    vk.CmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1,
+                             &image_tint.descriptor_set, 0, nullptr);
+    vk.CmdDispatch(commands, (target.extent.width + kGroupSize - 1) / kGroupSize,
+                   (target.extent.height + kGroupSize - 1) / kGroupSize, 1);
+
+    barriers = {
+        ImageBarrier(target.staging_image, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT),
+        ImageBarrier(image_tint.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                     0, VK_ACCESS_TRANSFER_WRITE_BIT),
+    };
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                          VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+                          static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    vk.CmdCopyImage(commands, target.staging_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image_tint.image,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    // The present's semaphore wait covers visibility to the presentation
+    // engine
+    barriers[0] = ImageBarrier(image_tint.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+    vk.CmdPipelineBarrier(commands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                          0, nullptr, 0, nullptr, 1, barriers.data());
+}
+
+bool TintPass::Draw(VkQueue queue, VkPresentInfoKHR* present_info) {
+    if (present_info->swapchainCount != 1) return false;
+
+    // Filled in at creation and read-only since
+    auto family = queue_families_.find(queue);
+    if (family == queue_families_.end()) return false;
+
+    Target* target = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(targets_mutex_);
+        auto it = targets_.find(present_info->pSwapchains[0]);
+        if (it != targets_.end()) target = it->second.get();
+    }
+    if (!target) return false;
+
+    VkDevice device = device_.device;
+    const TintPassDispatch& vk = device_.vk;
+
+    // Never wait on the GPU here. The image was acquired again, so its last
+    // present, and the tint that present waited for, should be done.
+    uint32_t image_index = present_info->pImageIndices[0];
+    if (image_index >= target->images.size() || !EnsureCommandBuffers(target, family->second)) return false;
+    ImageTint& image_tint = target->images[image_index];
+    if (vk.GetFenceStatus(device, image_tint.fence) != VK_SUCCESS) return false;
+
+    // The staging image is shared by every image of the swapchain; only the
+    // recorded barriers order its use, and they don't reach across queues
+    bool staged = target->staging_image != VK_NULL_HANDLE;
+    if (staged && target->last_queue != VK_NULL_HANDLE && target->last_queue != queue &&
+        vk.GetFenceStatus(device, target->images[target->last_image].fence) != VK_SUCCESS) {
+        return false;
+    }
+
+    // Wait for whatever the application's present waited for
+    target->wait_stages.assign(present_info->waitSemaphoreCount,
+                               staged ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = present_info->waitSemaphoreCount;
+    submit_info.pWaitSemaphores = present_info->pWaitSemaphores;
+    submit_info.pWaitDstStageMask = target->wait_stages.data();
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &image_tint.commands;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &image_tint.tinted;
+
+    vk.ResetFences(device, 1, &image_tint.fence);
+    if (vk.QueueSubmit(queue, 1, &submit_info, image_tint.fence) != VK_SUCCESS) {
+        // Nothing was submitted to signal the reset fence; an empty submit
+        // does, or the next tint of this image and DestroyTarget would wait
+        // on it forever
+        VkSubmitInfo empty_submit{};
+        empty_submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        vk.QueueSubmit(queue, 1, &empty_submit, image_tint.fence);
+        return false;
+    }
+    target->last_queue = queue;
+    target->last_image = image_index;
+
+    present_info->waitSemaphoreCount = 1;
+    present_info->pWaitSemaphores = &image_tint.tinted;
+    return true;
+}
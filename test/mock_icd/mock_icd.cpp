@@ -0,0 +1,1143 @@
+#include <vulkan/vulkan.h>
+#include <vulkan/vk_icd.h>
+#include "virtual_display.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Headless mock ICD (VK_ICD_mock) for driving layers without a GPU or a
+// window system. One virtual GPU with one queue family of kQueueCount
+// queues, so each application thread can have its own; work completes the
+// moment it is submitted and commands are recorded as no-ops, so fences and
+// semaphores are signalled by the submit itself. Presentation goes through
+// VK_EXT_headless_surface to the virtual display in virtual_display.h, and
+// VK_GOOGLE_display_timing reports when each present reached the screen.
+//
+// Memory is real host memory, allocated on first map. Entry points cover
+// what the layers in this repository and a minimal render pass and
+// swapchain application use; anything else is absent from vkGet*ProcAddr.
+
+namespace {
+
+constexpr uint32_t kQueueFamilyCount = 1;
+constexpr uint32_t kQueueCount = 16;
+
+const VkExtensionProperties kInstanceExtensions[] = {
+    {"VK_KHR_surface", 25},
+    {"VK_EXT_headless_surface", 1},
+    {"VK_KHR_get_physical_device_properties2", 2},
+};
+
+const VkExtensionProperties kDeviceExtensions[] = {
+    {"VK_KHR_swapchain", 70},
+    {"VK_KHR_timeline_semaphore", 2},
+    {"VK_GOOGLE_display_timing", 1},
+};
+
+struct MockInstance;
+
+struct MockPhysicalDevice {
+    VK_LOADER_DATA loader_data;
+    MockInstance* instance;
+};
+
+struct MockInstance {
+    VK_LOADER_DATA loader_data;
+    MockPhysicalDevice physical_device;
+    VirtualDisplayConfig config;
+};
+
+struct MockDevice;
+
+struct MockQueue {
+    VK_LOADER_DATA loader_data;
+    MockDevice* device;
+};
+
+struct MockDevice {
+    VK_LOADER_DATA loader_data;
+    VirtualDisplayConfig config;
+    VblankClock clock;
+    MockQueue queues[kQueueCount];
+
+    // Timeline values; host waits block on the condition variable
+    std::mutex semaphore_mutex;
+    std::condition_variable semaphore_signalled;
+
+    // For MOCK_ICD_FAIL_SUBMITS
+    std::atomic<uint64_t> command_submits{0};
+
+    explicit MockDevice(const VirtualDisplayConfig& display_config) : config(display_config), clock(config) {}
+};
+
+struct MockCommandBuffer {
+    VK_LOADER_DATA loader_data;
+};
+
+struct MockCommandPool {
+    std::vector<MockCommandBuffer*> command_buffers;
+};
+
+struct MockSurface {};
+
+struct MockImage {
+    VkDeviceSize size;
+};
+
+struct MockSwapchain {
+    std::mutex mutex;
+    std::unique_ptr<PresentationEngine> engine;
+    std::vector<MockImage> images;
+};
+
+struct MockSemaphore {
+    bool timeline;
+    uint64_t value;   // Guarded by MockDevice::semaphore_mutex
+};
+
+struct MockFence {
+    std::atomic<bool> signalled;
+};
+
+struct MockMemory {
+    VkDeviceSize size;
+    std::unique_ptr<uint8_t[]> data;
+};
+
+struct MockBuffer {
+    VkDeviceSize size;
+};
+
+std::atomic<uintptr_t> g_next_handle{0x10000};
+
+// Objects with nothing to track get a unique, never dereferenced handle
+template <typename Handle>
+Handle NewHandle() {
+    return reinterpret_cast<Handle>(g_next_handle.fetch_add(16));
+}
+
+template <typename Handle, typename Object>
+Handle ToHandle(Object* object) {
+    return reinterpret_cast<Handle>(object);
+}
+
+template <typename Object, typename Handle>
+Object* FromHandle(Handle handle) {
+    return reinterpret_cast<Object*>(handle);
+}
+
+// The loader overwrites this with its dispatch table
+template <typename Object>
+void InitLoaderData(Object* object) {
+    set_loader_magic_value(object);
+}
+
+template <typename T>
+VkResult FillArray(const T* source, uint32_t source_count, uint32_t* count, T* out) {
+    if (!out) {
+        *count = source_count;
+        return VK_SUCCESS;
+    }
+    uint32_t written = std::min(*count, source_count);
+    std::copy(source, source + written, out);
+    *count = written;
+    return written < source_count ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+template <typename Struct>
+const Struct* FindInChain(const void* next, VkStructureType type) {
+    for (auto* base = static_cast<const VkBaseInStructure*>(next); base; base = base->pNext) {
+        if (base->sType == type) return reinterpret_cast<const Struct*>(base);
+    }
+    return nullptr;
+}
+
+// Instance and physical device
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkEnumerateInstanceExtensionProperties(
+    const char* pLayerName, uint32_t* pPropertyCount, VkExtensionProperties* pProperties) {
+    if (pLayerName) return VK_ERROR_LAYER_NOT_PRESENT;
+    return FillArray(kInstanceExtensions, static_cast<uint32_t>(std::size(kInstanceExtensions)),
+                     pPropertyCount, pProperties);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkEnumerateInstanceVersion(uint32_t* pApiVersion) {
+    *pApiVersion = VK_API_VERSION_1_2;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateInstance(
+    const VkInstanceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkInstance* pInstance) {
+    MockInstance* instance = new (std::nothrow) MockInstance();
+    if (!instance) return VK_ERROR_OUT_OF_HOST_MEMORY;
+    InitLoaderData(instance);
+    InitLoaderData(&instance->physical_device);
+    instance->physical_device.instance = instance;
+    instance->config = VirtualDisplayConfig::FromEnvironment();
+    *pInstance = reinterpret_cast<VkInstance>(instance);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyInstance(VkInstance instance, const VkAllocationCallbacks* pAllocator) {
+    delete reinterpret_cast<MockInstance*>(instance);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkEnumeratePhysicalDevices(
+    VkInstance instance, uint32_t* pPhysicalDeviceCount, VkPhysicalDevice* pPhysicalDevices) {
+    VkPhysicalDevice physical_device =
+        reinterpret_cast<VkPhysicalDevice>(&reinterpret_cast<MockInstance*>(instance)->physical_device);
+    return FillArray(&physical_device, 1, pPhysicalDeviceCount, pPhysicalDevices);
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetPhysicalDeviceProperties(
+    VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties* pProperties) {
+    *pProperties = VkPhysicalDeviceProperties{};
+    pProperties->apiVersion = VK_API_VERSION_1_2;
+    pProperties->driverVersion = 1;
+    pProperties->deviceType = VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU;
+    std::strncpy(pProperties->deviceName, "Mock virtual display", VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1);
+
+    VkPhysicalDeviceLimits& limits = pProperties->limits;
+    limits.maxImageDimension2D = 16384;
+    limits.maxImageArrayLayers = 2048;
+    limits.maxPushConstantsSize = 256;
+    limits.maxBoundDescriptorSets = 8;
+    limits.maxComputeWorkGroupCount[0] = 65535;
+    limits.maxComputeWorkGroupCount[1] = 65535;
+    limits.maxComputeWorkGroupCount[2] = 65535;
+    limits.maxComputeWorkGroupSize[0] = 1024;
+    limits.maxComputeWorkGroupSize[1] = 1024;
+    limits.maxComputeWorkGroupSize[2] = 64;
+    limits.maxComputeWorkGroupInvocations = 1024;
+    limits.timestampPeriod = 1.0f;
+    limits.minMemoryMapAlignment = 64;
+    limits.nonCoherentAtomSize = 64;
+    limits.optimalBufferCopyOffsetAlignment = 1;
+    limits.optimalBufferCopyRowPitchAlignment = 1;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetPhysicalDeviceProperties2(
+    VkPhysicalDevice physicalDevice, VkPhysicalDeviceProperties2* pProperties) {
+    mock_vkGetPhysicalDeviceProperties(physicalDevice, &pProperties->properties);
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetPhysicalDeviceFeatures(
+    VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures* pFeatures) {
+    *pFeatures = VkPhysicalDeviceFeatures{};
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetPhysicalDeviceFeatures2(
+    VkPhysicalDevice physicalDevice, VkPhysicalDeviceFeatures2* pFeatures) {
+    mock_vkGetPhysicalDeviceFeatures(physicalDevice, &pFeatures->features);
+    for (auto* base = static_cast<VkBaseOutStructure*>(pFeatures->pNext); base; base = base->pNext) {
+        if (base->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES) {
+            reinterpret_cast<VkPhysicalDeviceTimelineSemaphoreFeatures*>(base)->timelineSemaphore = VK_TRUE;
+        } else if (base->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES) {
+            reinterpret_cast<VkPhysicalDeviceVulkan12Features*>(base)->timelineSemaphore = VK_TRUE;
+        }
+    }
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetPhysicalDeviceQueueFamilyProperties(
+    VkPhysicalDevice physicalDevice, uint32_t* pQueueFamilyPropertyCount, VkQueueFamilyProperties* pQueueFamilyProperties) {
+    VkQueueFamilyProperties family{};
+    family.queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+    family.queueCount = kQueueCount;
+    family.timestampValidBits = 64;
+    family.minImageTransferGranularity = {1, 1, 1};
+    FillArray(&family, kQueueFamilyCount, pQueueFamilyPropertyCount, pQueueFamilyProperties);
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetPhysicalDeviceMemoryProperties(
+    VkPhysicalDevice physicalDevice, VkPhysicalDeviceMemoryProperties* pMemoryProperties) {
+    *pMemoryProperties = VkPhysicalDeviceMemoryProperties{};
+    pMemoryProperties->memoryHeapCount = 2;
+    pMemoryProperties->memoryHeaps[0] = {VkDeviceSize(8) << 30, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT};
+    pMemoryProperties->memoryHeaps[1] = {VkDeviceSize(8) << 30, 0};
+    pMemoryProperties->memoryTypeCount = 3;
+    pMemoryProperties->memoryTypes[0] = {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0};
+    pMemoryProperties->memoryTypes[1] = {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1};
+    pMemoryProperties->memoryTypes[2] = {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, 1};
+}
+
+// Every format supports everything
+VKAPI_ATTR void VKAPI_CALL mock_vkGetPhysicalDeviceFormatProperties(
+    VkPhysicalDevice physicalDevice, VkFormat format, VkFormatProperties* pFormatProperties) {
+    pFormatProperties->linearTilingFeatures = ~VkFormatFeatureFlags(0);
+    pFormatProperties->optimalTilingFeatures = ~VkFormatFeatureFlags(0);
+    pFormatProperties->bufferFeatures = ~VkFormatFeatureFlags(0);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetPhysicalDeviceImageFormatProperties(
+    VkPhysicalDevice physicalDevice, VkFormat format, VkImageType type, VkImageTiling tiling,
+    VkImageUsageFlags usage, VkImageCreateFlags flags, VkImageFormatProperties* pImageFormatProperties) {
+    pImageFormatProperties->maxExtent = {16384, 16384, 2048};
+    pImageFormatProperties->maxMipLevels = 15;
+    pImageFormatProperties->maxArrayLayers = 2048;
+    pImageFormatProperties->sampleCounts = VK_SAMPLE_COUNT_1_BIT;
+    pImageFormatProperties->maxResourceSize = VkDeviceSize(1) << 32;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkEnumerateDeviceExtensionProperties(
+    VkPhysicalDevice physicalDevice, const char* pLayerName, uint32_t* pPropertyCount, VkExtensionProperties* pProperties) {
+    if (pLayerName) return VK_ERROR_LAYER_NOT_PRESENT;
+    return FillArray(kDeviceExtensions, static_cast<uint32_t>(std::size(kDeviceExtensions)),
+                     pPropertyCount, pProperties);
+}
+
+// Headless surfaces
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateHeadlessSurfaceEXT(
+    VkInstance instance, const VkHeadlessSurfaceCreateInfoEXT* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator, VkSurfaceKHR* pSurface) {
+    *pSurface = ToHandle<VkSurfaceKHR>(new MockSurface());
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroySurfaceKHR(
+    VkInstance instance, VkSurfaceKHR surface, const VkAllocationCallbacks* pAllocator) {
+    delete FromHandle<MockSurface>(surface);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetPhysicalDeviceSurfaceSupportKHR(
+    VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkSurfaceKHR surface, VkBool32* pSupported) {
+    *pSupported = queueFamilyIndex < kQueueFamilyCount ? VK_TRUE : VK_FALSE;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+    VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkSurfaceCapabilitiesKHR* pSurfaceCapabilities) {
+    const VirtualDisplayConfig& config = reinterpret_cast<MockPhysicalDevice*>(physicalDevice)->instance->config;
+    *pSurfaceCapabilities = VkSurfaceCapabilitiesKHR{};
+    pSurfaceCapabilities->minImageCount = 2;
+    pSurfaceCapabilities->maxImageCount = 8;
+    pSurfaceCapabilities->currentExtent = config.extent;
+    pSurfaceCapabilities->minImageExtent = config.extent;
+    pSurfaceCapabilities->maxImageExtent = config.extent;
+    pSurfaceCapabilities->maxImageArrayLayers = 1;
+    pSurfaceCapabilities->supportedTransforms = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    pSurfaceCapabilities->currentTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    pSurfaceCapabilities->supportedCompositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    pSurfaceCapabilities->supportedUsageFlags = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                                VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+                                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetPhysicalDeviceSurfaceFormatsKHR(
+    VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, uint32_t* pSurfaceFormatCount, VkSurfaceFormatKHR* pSurfaceFormats) {
+    static const VkSurfaceFormatKHR formats[] = {
+        {VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR},
+        {VK_FORMAT_B8G8R8A8_SRGB, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR},
+        {VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR},
+    };
+    return FillArray(formats, static_cast<uint32_t>(std::size(formats)), pSurfaceFormatCount, pSurfaceFormats);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetPhysicalDeviceSurfacePresentModesKHR(
+    VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, uint32_t* pPresentModeCount, VkPresentModeKHR* pPresentModes) {
+    const VirtualDisplayConfig& config = reinterpret_cast<MockPhysicalDevice*>(physicalDevice)->instance->config;
+    return FillArray(config.present_modes.data(), static_cast<uint32_t>(config.present_modes.size()),
+                     pPresentModeCount, pPresentModes);
+}
+
+// Device and queue
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateDevice(
+    VkPhysicalDevice physicalDevice, const VkDeviceCreateInfo* pCreateInfo,
+    const VkAllocationCallbacks* pAllocator, VkDevice* pDevice) {
+    const VirtualDisplayConfig& config = reinterpret_cast<MockPhysicalDevice*>(physicalDevice)->instance->config;
+    MockDevice* device = new (std::nothrow) MockDevice(config);
+    if (!device) return VK_ERROR_OUT_OF_HOST_MEMORY;
+    InitLoaderData(device);
+    for (MockQueue& queue : device->queues) {
+        InitLoaderData(&queue);
+        queue.device = device;
+    }
+    *pDevice = reinterpret_cast<VkDevice>(device);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyDevice(VkDevice device, const VkAllocationCallbacks* pAllocator) {
+    delete reinterpret_cast<MockDevice*>(device);
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetDeviceQueue(
+    VkDevice device, uint32_t queueFamilyIndex, uint32_t queueIndex, VkQueue* pQueue) {
+    *pQueue = reinterpret_cast<VkQueue>(&reinterpret_cast<MockDevice*>(device)->queues[queueIndex % kQueueCount]);
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetDeviceQueue2(
+    VkDevice device, const VkDeviceQueueInfo2* pQueueInfo, VkQueue* pQueue) {
+    mock_vkGetDeviceQueue(device, pQueueInfo->queueFamilyIndex, pQueueInfo->queueIndex, pQueue);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkDeviceWaitIdle(VkDevice device) {
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkQueueWaitIdle(VkQueue queue) {
+    return VK_SUCCESS;
+}
+
+// Work is done on submission: timeline signals land and the fence signals.
+// A failed submit changes nothing.
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkQueueSubmit(
+    VkQueue queue, uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence) {
+    MockDevice* device = reinterpret_cast<MockQueue*>(queue)->device;
+    bool has_commands = false;
+    for (uint32_t i = 0; i < submitCount; i++) has_commands = has_commands || pSubmits[i].commandBufferCount > 0;
+    if (has_commands && !device->config.fail_submits.empty()) {
+        uint64_t submit = ++device->command_submits;
+        if (std::binary_search(device->config.fail_submits.begin(), device->config.fail_submits.end(), submit)) {
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(device->semaphore_mutex);
+        for (uint32_t i = 0; i < submitCount; i++) {
+            const VkSubmitInfo& submit = pSubmits[i];
+            auto* timeline_info = FindInChain<VkTimelineSemaphoreSubmitInfo>(
+                submit.pNext, VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO);
+            for (uint32_t j = 0; j < submit.signalSemaphoreCount; j++) {
+                MockSemaphore* semaphore = FromHandle<MockSemaphore>(submit.pSignalSemaphores[j]);
+                if (semaphore->timeline && timeline_info && j < timeline_info->signalSemaphoreValueCount) {
+                    semaphore->value = std::max(semaphore->value, timeline_info->pSignalSemaphoreValues[j]);
+                }
+            }
+        }
+    }
+    device->semaphore_signalled.notify_all();
+    if (fence != VK_NULL_HANDLE) FromHandle<MockFence>(fence)->signalled.store(true);
+    return VK_SUCCESS;
+}
+
+// Memory
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkAllocateMemory(
+    VkDevice device, const VkMemoryAllocateInfo* pAllocateInfo,
+    const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory) {
+    MockMemory* memory = new MockMemory();
+    memory->size = pAllocateInfo->allocationSize;
+    *pMemory = ToHandle<VkDeviceMemory>(memory);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkFreeMemory(
+    VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator) {
+    delete FromHandle<MockMemory>(memory);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkMapMemory(
+    VkDevice device, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize size,
+    VkMemoryMapFlags flags, void** ppData) {
+    MockMemory* mock_memory = FromHandle<MockMemory>(memory);
+    if (!mock_memory->data) {
+        mock_memory->data.reset(new (std::nothrow) uint8_t[mock_memory->size]());
+        if (!mock_memory->data) return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+    *ppData = mock_memory->data.get() + offset;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkUnmapMemory(VkDevice device, VkDeviceMemory memory) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkFlushMappedMemoryRanges(
+    VkDevice device, uint32_t memoryRangeCount, const VkMappedMemoryRange* pMemoryRanges) {
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkInvalidateMappedMemoryRanges(
+    VkDevice device, uint32_t memoryRangeCount, const VkMappedMemoryRange* pMemoryRanges) {
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateBuffer(
+    VkDevice device, const VkBufferCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkBuffer* pBuffer) {
+    *pBuffer = ToHandle<VkBuffer>(new MockBuffer{pCreateInfo->size});
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyBuffer(VkDevice device, VkBuffer buffer, const VkAllocationCallbacks* pAllocator) {
+    delete FromHandle<MockBuffer>(buffer);
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetBufferMemoryRequirements(
+    VkDevice device, VkBuffer buffer, VkMemoryRequirements* pMemoryRequirements) {
+    pMemoryRequirements->size = FromHandle<MockBuffer>(buffer)->size;
+    pMemoryRequirements->alignment = 256;
+    pMemoryRequirements->memoryTypeBits = 0x7;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkBindBufferMemory(
+    VkDevice device, VkBuffer buffer, VkDeviceMemory memory, VkDeviceSize memoryOffset) {
+    return VK_SUCCESS;
+}
+
+// 16 bytes per texel covers every color format
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateImage(
+    VkDevice device, const VkImageCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkImage* pImage) {
+    VkDeviceSize size = VkDeviceSize(pCreateInfo->extent.width) * pCreateInfo->extent.height *
+                        pCreateInfo->extent.depth * pCreateInfo->arrayLayers * 16;
+    *pImage = ToHandle<VkImage>(new MockImage{size});
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyImage(VkDevice device, VkImage image, const VkAllocationCallbacks* pAllocator) {
+    delete FromHandle<MockImage>(image);
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkGetImageMemoryRequirements(
+    VkDevice device, VkImage image, VkMemoryRequirements* pMemoryRequirements) {
+    pMemoryRequirements->size = FromHandle<MockImage>(image)->size;
+    pMemoryRequirements->alignment = 256;
+    pMemoryRequirements->memoryTypeBits = 0x7;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkBindImageMemory(
+    VkDevice device, VkImage image, VkDeviceMemory memory, VkDeviceSize memoryOffset) {
+    return VK_SUCCESS;
+}
+
+// Objects without state
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateImageView(
+    VkDevice device, const VkImageViewCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkImageView* pView) {
+    *pView = NewHandle<VkImageView>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyImageView(VkDevice device, VkImageView imageView, const VkAllocationCallbacks* pAllocator) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateShaderModule(
+    VkDevice device, const VkShaderModuleCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkShaderModule* pShaderModule) {
+    *pShaderModule = NewHandle<VkShaderModule>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyShaderModule(
+    VkDevice device, VkShaderModule shaderModule, const VkAllocationCallbacks* pAllocator) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateDescriptorSetLayout(
+    VkDevice device, const VkDescriptorSetLayoutCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkDescriptorSetLayout* pSetLayout) {
+    *pSetLayout = NewHandle<VkDescriptorSetLayout>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyDescriptorSetLayout(
+    VkDevice device, VkDescriptorSetLayout descriptorSetLayout, const VkAllocationCallbacks* pAllocator) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreatePipelineLayout(
+    VkDevice device, const VkPipelineLayoutCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkPipelineLayout* pPipelineLayout) {
+    *pPipelineLayout = NewHandle<VkPipelineLayout>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyPipelineLayout(
+    VkDevice device, VkPipelineLayout pipelineLayout, const VkAllocationCallbacks* pAllocator) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreatePipelineCache(
+    VkDevice device, const VkPipelineCacheCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkPipelineCache* pPipelineCache) {
+    *pPipelineCache = NewHandle<VkPipelineCache>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyPipelineCache(
+    VkDevice device, VkPipelineCache pipelineCache, const VkAllocationCallbacks* pAllocator) {}
+
+// Nothing is compiled, so every cache holds just its header
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetPipelineCacheData(
+    VkDevice device, VkPipelineCache pipelineCache, size_t* pDataSize, void* pData) {
+    VkPipelineCacheHeaderVersionOne header{};
+    header.headerSize = sizeof(header);
+    header.headerVersion = VK_PIPELINE_CACHE_HEADER_VERSION_ONE;
+    if (!pData) {
+        *pDataSize = sizeof(header);
+        return VK_SUCCESS;
+    }
+    if (*pDataSize < sizeof(header)) {
+        *pDataSize = 0;
+        return VK_INCOMPLETE;
+    }
+    std::memcpy(pData, &header, sizeof(header));
+    *pDataSize = sizeof(header);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateComputePipelines(
+    VkDevice device, VkPipelineCache pipelineCache, uint32_t createInfoCount,
+    const VkComputePipelineCreateInfo* pCreateInfos, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines) {
+    for (uint32_t i = 0; i < createInfoCount; i++) pPipelines[i] = NewHandle<VkPipeline>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateGraphicsPipelines(
+    VkDevice device, VkPipelineCache pipelineCache, uint32_t createInfoCount,
+    const VkGraphicsPipelineCreateInfo* pCreateInfos, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines) {
+    for (uint32_t i = 0; i < createInfoCount; i++) pPipelines[i] = NewHandle<VkPipeline>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyPipeline(VkDevice device, VkPipeline pipeline, const VkAllocationCallbacks* pAllocator) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateSampler(
+    VkDevice device, const VkSamplerCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkSampler* pSampler) {
+    *pSampler = NewHandle<VkSampler>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroySampler(VkDevice device, VkSampler sampler, const VkAllocationCallbacks* pAllocator) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateQueryPool(
+    VkDevice device, const VkQueryPoolCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkQueryPool* pQueryPool) {
+    *pQueryPool = NewHandle<VkQueryPool>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyQueryPool(VkDevice device, VkQueryPool queryPool, const VkAllocationCallbacks* pAllocator) {}
+
+// Nothing executes, so every timestamp reads as zero
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetQueryPoolResults(
+    VkDevice device, VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount, size_t dataSize, void* pData,
+    VkDeviceSize stride, VkQueryResultFlags flags) {
+    std::memset(pData, 0, dataSize);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateDescriptorPool(
+    VkDevice device, const VkDescriptorPoolCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkDescriptorPool* pDescriptorPool) {
+    *pDescriptorPool = NewHandle<VkDescriptorPool>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyDescriptorPool(
+    VkDevice device, VkDescriptorPool descriptorPool, const VkAllocationCallbacks* pAllocator) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkResetDescriptorPool(
+    VkDevice device, VkDescriptorPool descriptorPool, VkDescriptorPoolResetFlags flags) {
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkAllocateDescriptorSets(
+    VkDevice device, const VkDescriptorSetAllocateInfo* pAllocateInfo, VkDescriptorSet* pDescriptorSets) {
+    for (uint32_t i = 0; i < pAllocateInfo->descriptorSetCount; i++) pDescriptorSets[i] = NewHandle<VkDescriptorSet>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkFreeDescriptorSets(
+    VkDevice device, VkDescriptorPool descriptorPool, uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets) {
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkUpdateDescriptorSets(
+    VkDevice device, uint32_t descriptorWriteCount, const VkWriteDescriptorSet* pDescriptorWrites,
+    uint32_t descriptorCopyCount, const VkCopyDescriptorSet* pDescriptorCopies) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateRenderPass(
+    VkDevice device, const VkRenderPassCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkRenderPass* pRenderPass) {
+    *pRenderPass = NewHandle<VkRenderPass>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyRenderPass(
+    VkDevice device, VkRenderPass renderPass, const VkAllocationCallbacks* pAllocator) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateFramebuffer(
+    VkDevice device, const VkFramebufferCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkFramebuffer* pFramebuffer) {
+    *pFramebuffer = NewHandle<VkFramebuffer>();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyFramebuffer(
+    VkDevice device, VkFramebuffer framebuffer, const VkAllocationCallbacks* pAllocator) {}
+
+// Command pools and buffers; recording is a no-op
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateCommandPool(
+    VkDevice device, const VkCommandPoolCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkCommandPool* pCommandPool) {
+    *pCommandPool = ToHandle<VkCommandPool>(new MockCommandPool());
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyCommandPool(
+    VkDevice device, VkCommandPool commandPool, const VkAllocationCallbacks* pAllocator) {
+    MockCommandPool* pool = FromHandle<MockCommandPool>(commandPool);
+    if (!pool) return;
+    for (MockCommandBuffer* command_buffer : pool->command_buffers) delete command_buffer;
+    delete pool;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkResetCommandPool(
+    VkDevice device, VkCommandPool commandPool, VkCommandPoolResetFlags flags) {
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkAllocateCommandBuffers(
+    VkDevice device, const VkCommandBufferAllocateInfo* pAllocateInfo, VkCommandBuffer* pCommandBuffers) {
+    MockCommandPool* pool = FromHandle<MockCommandPool>(pAllocateInfo->commandPool);
+    for (uint32_t i = 0; i < pAllocateInfo->commandBufferCount; i++) {
+        MockCommandBuffer* command_buffer = new MockCommandBuffer();
+        InitLoaderData(command_buffer);
+        pool->command_buffers.push_back(command_buffer);
+        pCommandBuffers[i] = reinterpret_cast<VkCommandBuffer>(command_buffer);
+    }
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkFreeCommandBuffers(
+    VkDevice device, VkCommandPool commandPool, uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers) {
+    MockCommandPool* pool = FromHandle<MockCommandPool>(commandPool);
+    for (uint32_t i = 0; i < commandBufferCount; i++) {
+        MockCommandBuffer* command_buffer = reinterpret_cast<MockCommandBuffer*>(pCommandBuffers[i]);
+        if (!command_buffer) continue;
+        pool->command_buffers.erase(
+            std::remove(pool->command_buffers.begin(), pool->command_buffers.end(), command_buffer),
+            pool->command_buffers.end());
+        delete command_buffer;
+    }
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkBeginCommandBuffer(
+    VkCommandBuffer commandBuffer, const VkCommandBufferBeginInfo* pBeginInfo) {
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkEndCommandBuffer(VkCommandBuffer commandBuffer) {
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkResetCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferResetFlags flags) {
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdPipelineBarrier(
+    VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask,
+    VkDependencyFlags dependencyFlags, uint32_t memoryBarrierCount, const VkMemoryBarrier* pMemoryBarriers,
+    uint32_t bufferMemoryBarrierCount, const VkBufferMemoryBarrier* pBufferMemoryBarriers,
+    uint32_t imageMemoryBarrierCount, const VkImageMemoryBarrier* pImageMemoryBarriers) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdCopyBuffer(
+    VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t regionCount,
+    const VkBufferCopy* pRegions) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdCopyImage(
+    VkCommandBuffer commandBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkImage dstImage,
+    VkImageLayout dstImageLayout, uint32_t regionCount, const VkImageCopy* pRegions) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdCopyImageToBuffer(
+    VkCommandBuffer commandBuffer, VkImage srcImage, VkImageLayout srcImageLayout, VkBuffer dstBuffer,
+    uint32_t regionCount, const VkBufferImageCopy* pRegions) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdCopyBufferToImage(
+    VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkImage dstImage, VkImageLayout dstImageLayout,
+    uint32_t regionCount, const VkBufferImageCopy* pRegions) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdBindPipeline(
+    VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipeline pipeline) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdBindDescriptorSets(
+    VkCommandBuffer commandBuffer, VkPipelineBindPoint pipelineBindPoint, VkPipelineLayout layout,
+    uint32_t firstSet, uint32_t descriptorSetCount, const VkDescriptorSet* pDescriptorSets,
+    uint32_t dynamicOffsetCount, const uint32_t* pDynamicOffsets) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdBindVertexBuffers(
+    VkCommandBuffer commandBuffer, uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* pBuffers,
+    const VkDeviceSize* pOffsets) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdPushConstants(
+    VkCommandBuffer commandBuffer, VkPipelineLayout layout, VkShaderStageFlags stageFlags, uint32_t offset,
+    uint32_t size, const void* pValues) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdDispatch(
+    VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdResetQueryPool(
+    VkCommandBuffer commandBuffer, VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdWriteTimestamp(
+    VkCommandBuffer commandBuffer, VkPipelineStageFlagBits pipelineStage, VkQueryPool queryPool, uint32_t query) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdBeginRenderPass(
+    VkCommandBuffer commandBuffer, const VkRenderPassBeginInfo* pRenderPassBegin, VkSubpassContents contents) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdEndRenderPass(VkCommandBuffer commandBuffer) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdSetViewport(
+    VkCommandBuffer commandBuffer, uint32_t firstViewport, uint32_t viewportCount, const VkViewport* pViewports) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdSetScissor(
+    VkCommandBuffer commandBuffer, uint32_t firstScissor, uint32_t scissorCount, const VkRect2D* pScissors) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdDraw(
+    VkCommandBuffer commandBuffer, uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex,
+    uint32_t firstInstance) {}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkCmdDrawIndexed(
+    VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex,
+    int32_t vertexOffset, uint32_t firstInstance) {}
+
+// Fences and semaphores
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateFence(
+    VkDevice device, const VkFenceCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkFence* pFence) {
+    MockFence* fence = new MockFence();
+    fence->signalled.store((pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT) != 0);
+    *pFence = ToHandle<VkFence>(fence);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroyFence(VkDevice device, VkFence fence, const VkAllocationCallbacks* pAllocator) {
+    delete FromHandle<MockFence>(fence);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkResetFences(VkDevice device, uint32_t fenceCount, const VkFence* pFences) {
+    for (uint32_t i = 0; i < fenceCount; i++) FromHandle<MockFence>(pFences[i])->signalled.store(false);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetFenceStatus(VkDevice device, VkFence fence) {
+    return FromHandle<MockFence>(fence)->signalled.load() ? VK_SUCCESS : VK_NOT_READY;
+}
+
+// Nothing is ever in flight, so an unsignalled fence would wait forever. A
+// wait without a timeout on one is a hang on a real driver; it aborts here
+// so a test sees it.
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkWaitForFences(
+    VkDevice device, uint32_t fenceCount, const VkFence* pFences, VkBool32 waitAll, uint64_t timeout) {
+    uint32_t signalled = 0;
+    for (uint32_t i = 0; i < fenceCount; i++) {
+        if (FromHandle<MockFence>(pFences[i])->signalled.load()) signalled++;
+    }
+    bool done = waitAll ? signalled == fenceCount : signalled > 0;
+    if (!done && timeout == UINT64_MAX) {
+        std::fprintf(stderr, "mock ICD: vkWaitForFences without a timeout on a fence nothing will signal\n");
+        std::abort();
+    }
+    return done ? VK_SUCCESS : VK_TIMEOUT;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateSemaphore(
+    VkDevice device, const VkSemaphoreCreateInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkSemaphore* pSemaphore) {
+    auto* type_info = FindInChain<VkSemaphoreTypeCreateInfo>(
+        pCreateInfo->pNext, VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO);
+    MockSemaphore* semaphore = new MockSemaphore();
+    semaphore->timeline = type_info && type_info->semaphoreType == VK_SEMAPHORE_TYPE_TIMELINE;
+    semaphore->value = semaphore->timeline ? type_info->initialValue : 0;
+    *pSemaphore = ToHandle<VkSemaphore>(semaphore);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroySemaphore(
+    VkDevice device, VkSemaphore semaphore, const VkAllocationCallbacks* pAllocator) {
+    delete FromHandle<MockSemaphore>(semaphore);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetSemaphoreCounterValue(VkDevice device, VkSemaphore semaphore, uint64_t* pValue) {
+    MockDevice* mock_device = reinterpret_cast<MockDevice*>(device);
+    std::lock_guard<std::mutex> lock(mock_device->semaphore_mutex);
+    *pValue = FromHandle<MockSemaphore>(semaphore)->value;
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkSignalSemaphore(VkDevice device, const VkSemaphoreSignalInfo* pSignalInfo) {
+    MockDevice* mock_device = reinterpret_cast<MockDevice*>(device);
+    {
+        std::lock_guard<std::mutex> lock(mock_device->semaphore_mutex);
+        MockSemaphore* semaphore = FromHandle<MockSemaphore>(pSignalInfo->semaphore);
+        semaphore->value = std::max(semaphore->value, pSignalInfo->value);
+    }
+    mock_device->semaphore_signalled.notify_all();
+    return VK_SUCCESS;
+}
+
+// Host waits on real time: only a host signal from another thread can end one
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkWaitSemaphores(
+    VkDevice device, const VkSemaphoreWaitInfo* pWaitInfo, uint64_t timeout) {
+    MockDevice* mock_device = reinterpret_cast<MockDevice*>(device);
+    bool wait_any = (pWaitInfo->flags & VK_SEMAPHORE_WAIT_ANY_BIT) != 0;
+    auto reached = [pWaitInfo, wait_any]() {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < pWaitInfo->semaphoreCount; i++) {
+            if (FromHandle<MockSemaphore>(pWaitInfo->pSemaphores[i])->value >= pWaitInfo->pValues[i]) count++;
+        }
+        return wait_any ? count > 0 : count == pWaitInfo->semaphoreCount;
+    };
+
+    std::unique_lock<std::mutex> lock(mock_device->semaphore_mutex);
+    if (timeout == UINT64_MAX) {
+        mock_device->semaphore_signalled.wait(lock, reached);
+        return VK_SUCCESS;
+    }
+    return mock_device->semaphore_signalled.wait_for(lock, std::chrono::nanoseconds(timeout), reached)
+        ? VK_SUCCESS : VK_TIMEOUT;
+}
+
+// Swapchains
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkCreateSwapchainKHR(
+    VkDevice device, const VkSwapchainCreateInfoKHR* pCreateInfo, const VkAllocationCallbacks* pAllocator,
+    VkSwapchainKHR* pSwapchain) {
+    MockDevice* mock_device = reinterpret_cast<MockDevice*>(device);
+    uint32_t image_count = std::max(pCreateInfo->minImageCount, 2u);
+    VkDeviceSize image_size = VkDeviceSize(pCreateInfo->imageExtent.width) * pCreateInfo->imageExtent.height * 16;
+
+    MockSwapchain* swapchain = new MockSwapchain();
+    swapchain->engine.reset(new PresentationEngine(mock_device->clock, mock_device->config,
+                                                   pCreateInfo->presentMode, image_count));
+    swapchain->images.assign(image_count, MockImage{image_size});
+    *pSwapchain = ToHandle<VkSwapchainKHR>(swapchain);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL mock_vkDestroySwapchainKHR(
+    VkDevice device, VkSwapchainKHR swapchain, const VkAllocationCallbacks* pAllocator) {
+    delete FromHandle<MockSwapchain>(swapchain);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetSwapchainImagesKHR(
+    VkDevice device, VkSwapchainKHR swapchain, uint32_t* pSwapchainImageCount, VkImage* pSwapchainImages) {
+    MockSwapchain* mock_swapchain = FromHandle<MockSwapchain>(swapchain);
+    std::vector<VkImage> images;
+    for (MockImage& image : mock_swapchain->images) images.push_back(ToHandle<VkImage>(&image));
+    return FillArray(images.data(), static_cast<uint32_t>(images.size()), pSwapchainImageCount, pSwapchainImages);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkAcquireNextImageKHR(
+    VkDevice device, VkSwapchainKHR swapchain, uint64_t timeout, VkSemaphore semaphore, VkFence fence,
+    uint32_t* pImageIndex) {
+    MockSwapchain* mock_swapchain = FromHandle<MockSwapchain>(swapchain);
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> lock(mock_swapchain->mutex);
+        result = mock_swapchain->engine->Acquire(timeout, pImageIndex);
+    }
+    if (result == VK_SUCCESS && fence != VK_NULL_HANDLE) FromHandle<MockFence>(fence)->signalled.store(true);
+    return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR* pPresentInfo) {
+    auto* times_info = FindInChain<VkPresentTimesInfoGOOGLE>(
+        pPresentInfo->pNext, VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE);
+
+    VkResult overall = VK_SUCCESS;
+    for (uint32_t i = 0; i < pPresentInfo->swapchainCount; i++) {
+        uint32_t present_id = 0;
+        uint64_t desired_ns = 0;
+        if (times_info && times_info->pTimes && i < times_info->swapchainCount) {
+            present_id = times_info->pTimes[i].presentID;
+            desired_ns = times_info->pTimes[i].desiredPresentTime;
+        }
+
+        MockSwapchain* swapchain = FromHandle<MockSwapchain>(pPresentInfo->pSwapchains[i]);
+        VkResult result;
+        {
+            std::lock_guard<std::mutex> lock(swapchain->mutex);
+            result = swapchain->engine->Present(pPresentInfo->pImageIndices[i], present_id, desired_ns);
+        }
+        if (pPresentInfo->pResults) pPresentInfo->pResults[i] = result;
+        if (overall == VK_SUCCESS) overall = result;
+    }
+    return overall;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetRefreshCycleDurationGOOGLE(
+    VkDevice device, VkSwapchainKHR swapchain, VkRefreshCycleDurationGOOGLE* pDisplayTimingProperties) {
+    pDisplayTimingProperties->refreshDuration = reinterpret_cast<MockDevice*>(device)->clock.Period();
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL mock_vkGetPastPresentationTimingGOOGLE(
+    VkDevice device, VkSwapchainKHR swapchain, uint32_t* pPresentationTimingCount,
+    VkPastPresentationTimingGOOGLE* pPresentationTimings) {
+    MockSwapchain* mock_swapchain = FromHandle<MockSwapchain>(swapchain);
+    std::lock_guard<std::mutex> lock(mock_swapchain->mutex);
+    return mock_swapchain->engine->PastPresentationTiming(pPresentationTimingCount, pPresentationTimings);
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL mock_vkGetDeviceProcAddr(VkDevice device, const char* pName);
+
+// Every entry point, under its core name and any extension alias
+const std::unordered_map<std::string, PFN_vkVoidFunction>& EntryPoints() {
+#define MOCK_ENTRY(name) {"vk" #name, reinterpret_cast<PFN_vkVoidFunction>(mock_vk##name)}
+#define MOCK_ALIAS(alias, name) {"vk" #alias, reinterpret_cast<PFN_vkVoidFunction>(mock_vk##name)}
+    static const std::unordered_map<std::string, PFN_vkVoidFunction> entry_points = {
+        MOCK_ENTRY(EnumerateInstanceExtensionProperties),
+        MOCK_ENTRY(EnumerateInstanceVersion),
+        MOCK_ENTRY(CreateInstance),
+        MOCK_ENTRY(DestroyInstance),
+        MOCK_ENTRY(EnumeratePhysicalDevices),
+        MOCK_ENTRY(GetPhysicalDeviceProperties),
+        MOCK_ENTRY(GetPhysicalDeviceProperties2),
+        MOCK_ALIAS(GetPhysicalDeviceProperties2KHR, GetPhysicalDeviceProperties2),
+        MOCK_ENTRY(GetPhysicalDeviceFeatures),
+        MOCK_ENTRY(GetPhysicalDeviceFeatures2),
+        MOCK_ALIAS(GetPhysicalDeviceFeatures2KHR, GetPhysicalDeviceFeatures2),
+        MOCK_ENTRY(GetPhysicalDeviceQueueFamilyProperties),
+        MOCK_ENTRY(GetPhysicalDeviceMemoryProperties),
+        MOCK_ENTRY(GetPhysicalDeviceFormatProperties),
+        MOCK_ENTRY(GetPhysicalDeviceImageFormatProperties),
+        MOCK_ENTRY(EnumerateDeviceExtensionProperties),
+        MOCK_ENTRY(CreateHeadlessSurfaceEXT),
+        MOCK_ENTRY(DestroySurfaceKHR),
+        MOCK_ENTRY(GetPhysicalDeviceSurfaceSupportKHR),
+        MOCK_ENTRY(GetPhysicalDeviceSurfaceCapabilitiesKHR),
+        MOCK_ENTRY(GetPhysicalDeviceSurfaceFormatsKHR),
+        MOCK_ENTRY(GetPhysicalDeviceSurfacePresentModesKHR),
+        MOCK_ENTRY(CreateDevice),
+        MOCK_ENTRY(GetDeviceProcAddr),
+        MOCK_ENTRY(DestroyDevice),
+        MOCK_ENTRY(GetDeviceQueue),
+        MOCK_ENTRY(GetDeviceQueue2),
+        MOCK_ENTRY(DeviceWaitIdle),
+        MOCK_ENTRY(QueueWaitIdle),
+        MOCK_ENTRY(QueueSubmit),
+        MOCK_ENTRY(AllocateMemory),
+        MOCK_ENTRY(FreeMemory),
+        MOCK_ENTRY(MapMemory),
+        MOCK_ENTRY(UnmapMemory),
+        MOCK_ENTRY(FlushMappedMemoryRanges),
+        MOCK_ENTRY(InvalidateMappedMemoryRanges),
+        MOCK_ENTRY(CreateBuffer),
+        MOCK_ENTRY(DestroyBuffer),
+        MOCK_ENTRY(GetBufferMemoryRequirements),
+        MOCK_ENTRY(BindBufferMemory),
+        MOCK_ENTRY(CreateImage),
+        MOCK_ENTRY(DestroyImage),
+        MOCK_ENTRY(GetImageMemoryRequirements),
+        MOCK_ENTRY(BindImageMemory),
+        MOCK_ENTRY(CreateImageView),
+        MOCK_ENTRY(DestroyImageView),
+        MOCK_ENTRY(CreateShaderModule),
+        MOCK_ENTRY(DestroyShaderModule),
+        MOCK_ENTRY(CreateDescriptorSetLayout),
+        MOCK_ENTRY(DestroyDescriptorSetLayout),
+        MOCK_ENTRY(CreatePipelineLayout),
+        MOCK_ENTRY(DestroyPipelineLayout),
+        MOCK_ENTRY(CreatePipelineCache),
+        MOCK_ENTRY(DestroyPipelineCache),
+        MOCK_ENTRY(GetPipelineCacheData),
+        MOCK_ENTRY(CreateComputePipelines),
+        MOCK_ENTRY(CreateGraphicsPipelines),
+        MOCK_ENTRY(DestroyPipeline),
+        MOCK_ENTRY(CreateSampler),
+        MOCK_ENTRY(DestroySampler),
+        MOCK_ENTRY(CreateQueryPool),
+        MOCK_ENTRY(DestroyQueryPool),
+        MOCK_ENTRY(GetQueryPoolResults),
+        MOCK_ENTRY(CreateDescriptorPool),
+        MOCK_ENTRY(DestroyDescriptorPool),
+        MOCK_ENTRY(ResetDescriptorPool),
+        MOCK_ENTRY(AllocateDescriptorSets),
+        MOCK_ENTRY(FreeDescriptorSets),
+        MOCK_ENTRY(UpdateDescriptorSets),
+        MOCK_ENTRY(CreateRenderPass),
+        MOCK_ENTRY(DestroyRenderPass),
+        MOCK_ENTRY(CreateFramebuffer),
+        MOCK_ENTRY(DestroyFramebuffer),
+        MOCK_ENTRY(CreateCommandPool),
+        MOCK_ENTRY(DestroyCommandPool),
+        MOCK_ENTRY(ResetCommandPool),
+        MOCK_ENTRY(AllocateCommandBuffers),
+        MOCK_ENTRY(FreeCommandBuffers),
+        MOCK_ENTRY(BeginCommandBuffer),
+        MOCK_ENTRY(EndCommandBuffer),
+        MOCK_ENTRY(ResetCommandBuffer),
+        MOCK_ENTRY(CmdPipelineBarrier),
+        MOCK_ENTRY(CmdCopyBuffer),
+        MOCK_ENTRY(CmdCopyImage),
+        MOCK_ENTRY(CmdCopyImageToBuffer),
+        MOCK_ENTRY(CmdCopyBufferToImage),
+        MOCK_ENTRY(CmdBindPipeline),
+        MOCK_ENTRY(CmdBindDescriptorSets),
+        MOCK_ENTRY(CmdBindVertexBuffers),
+        MOCK_ENTRY(CmdPushConstants),
+        MOCK_ENTRY(CmdDispatch),
+        MOCK_ENTRY(CmdResetQueryPool),
+        MOCK_ENTRY(CmdWriteTimestamp),
+        MOCK_ENTRY(CmdBeginRenderPass),
+        MOCK_ENTRY(CmdEndRenderPass),
+        MOCK_ENTRY(CmdSetViewport),
+        MOCK_ENTRY(CmdSetScissor),
+        MOCK_ENTRY(CmdDraw),
+        MOCK_ENTRY(CmdDrawIndexed),
+        MOCK_ENTRY(CreateFence),
+        MOCK_ENTRY(DestroyFence),
+        MOCK_ENTRY(ResetFences),
+        MOCK_ENTRY(GetFenceStatus),
+        MOCK_ENTRY(WaitForFences),
+        MOCK_ENTRY(CreateSemaphore),
+        MOCK_ENTRY(DestroySemaphore),
+        MOCK_ENTRY(GetSemaphoreCounterValue),
+        MOCK_ALIAS(GetSemaphoreCounterValueKHR, GetSemaphoreCounterValue),
+        MOCK_ENTRY(SignalSemaphore),
+        MOCK_ALIAS(SignalSemaphoreKHR, SignalSemaphore),
+        MOCK_ENTRY(WaitSemaphores),
+        MOCK_ALIAS(WaitSemaphoresKHR, WaitSemaphores),
+        MOCK_ENTRY(CreateSwapchainKHR),
+        MOCK_ENTRY(DestroySwapchainKHR),
+        MOCK_ENTRY(GetSwapchainImagesKHR),
+        MOCK_ENTRY(AcquireNextImageKHR),
+        MOCK_ENTRY(QueuePresentKHR),
+        MOCK_ENTRY(GetRefreshCycleDurationGOOGLE),
+        MOCK_ENTRY(GetPastPresentationTimingGOOGLE),
+    };
+#undef MOCK_ALIAS
+#undef MOCK_ENTRY
+    return entry_points;
+}
+
+PFN_vkVoidFunction FindEntryPoint(const char* name) {
+    auto it = EntryPoints().find(name);
+    return it != EntryPoints().end() ? it->second : nullptr;
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL mock_vkGetDeviceProcAddr(VkDevice device, const char* pName) {
+    return FindEntryPoint(pName);
+}
+
+} // namespace
+
+// Loader-ICD interface, version 5 at most: the loader hands the ICD its own
+// surfaces (3+) and asks for physical device functions separately (4+)
+extern "C" {
+
+VKAPI_ATTR VkResult VKAPI_CALL vk_icdNegotiateLoaderICDInterfaceVersion(uint32_t* pSupportedVersion) {
+    *pSupportedVersion = std::min(*pSupportedVersion, 5u);
+    return VK_SUCCESS;
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vk_icdGetInstanceProcAddr(VkInstance instance, const char* pName) {
+    return FindEntryPoint(pName);
+}
+
+VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vk_icdGetPhysicalDeviceProcAddr(VkInstance instance, const char* pName) {
+    if (std::strncmp(pName, "vkGetPhysicalDevice", 19) != 0) return nullptr;
+    return FindEntryPoint(pName);
+}
+
+} // extern "C"
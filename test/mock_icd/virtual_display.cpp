@@ -0,0 +1,234 @@
+#include "virtual_display.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+static const char* GetEnv(const char* name) {
+    const char* value = std::getenv(name);
+    return (value && *value) ? value : nullptr;
+}
+
+static bool ParsePresentMode(const std::string& name, VkPresentModeKHR* mode) {
+    if (name == "fifo") *mode = VK_PRESENT_MODE_FIFO_KHR;
+    else if (name == "fifo_relaxed") *mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    else if (name == "mailbox") *mode = VK_PRESENT_MODE_MAILBOX_KHR;
+    else if (name == "immediate") *mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    else return false;
+    return true;
+}
+
+VirtualDisplayConfig VirtualDisplayConfig::FromEnvironment() {
+    VirtualDisplayConfig config;
+
+    if (const char* value = GetEnv("MOCK_ICD_REFRESH_HZ")) {
+        double hz = std::atof(value);
+        if (hz > 0.0) config.refresh_ns = static_cast<uint64_t>(std::llround(1e9 / hz));
+    }
+    if (const char* value = GetEnv("MOCK_ICD_CLOCK")) {
+        config.realtime = std::strcmp(value, "realtime") == 0;
+    }
+    if (const char* value = GetEnv("MOCK_ICD_FRAME_US")) {
+        double us = std::atof(value);
+        if (us > 0.0) config.frame_ns = static_cast<uint64_t>(us * 1e3);
+    }
+    if (const char* value = GetEnv("MOCK_ICD_HITCHES")) {
+        const char* cursor = value;
+        while (*cursor) {
+            char* end = nullptr;
+            uint64_t present = std::strtoull(cursor, &end, 10);
+            if (end == cursor || *end != ':') break;
+            cursor = end + 1;
+            double ms = std::strtod(cursor, &end);
+            if (end == cursor) break;
+            if (present > 0 && ms > 0.0) config.hitches.emplace_back(present, static_cast<uint64_t>(ms * 1e6));
+            cursor = (*end == ',') ? end + 1 : end;
+        }
+        std::sort(config.hitches.begin(), config.hitches.end());
+    }
+    if (const char* value = GetEnv("MOCK_ICD_PRESENT_MODES")) {
+        std::string list = value;
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t comma = list.find(',', start);
+            if (comma == std::string::npos) comma = list.size();
+            VkPresentModeKHR mode;
+            if (ParsePresentMode(list.substr(start, comma - start), &mode) &&
+                std::find(config.present_modes.begin(), config.present_modes.end(), mode) ==
+                    config.present_modes.end()) {
+                config.present_modes.push_back(mode);
+            }
+            start = comma + 1;
+        }
+    }
+    if (config.present_modes.empty()) {
+        config.present_modes = {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+                                VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+    }
+    if (const char* value = GetEnv("MOCK_ICD_EXTENT")) {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        if (std::sscanf(value, "%ux%u", &width, &height) == 2 && width > 0 && height > 0) {
+            config.extent = {width, height};
+        }
+    }
+    if (const char* value = GetEnv("MOCK_ICD_FAIL_SUBMITS")) {
+        const char* cursor = value;
+        while (*cursor) {
+            char* end = nullptr;
+            uint64_t submit = std::strtoull(cursor, &end, 10);
+            if (end == cursor) break;
+            if (submit > 0) config.fail_submits.push_back(submit);
+            cursor = (*end == ',') ? end + 1 : end;
+        }
+        std::sort(config.fail_submits.begin(), config.fail_submits.end());
+    }
+    return config;
+}
+
+static uint64_t MonotonicNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+VblankClock::VblankClock(const VirtualDisplayConfig& config)
+    : period_(config.refresh_ns), realtime_(config.realtime), origin_(config.realtime ? MonotonicNs() : 0) {}
+
+uint64_t VblankClock::Now() const {
+    return realtime_ ? MonotonicNs() : virtual_now_.load();
+}
+
+void VblankClock::WaitUntil(uint64_t ns) {
+    if (realtime_) {
+        std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(ns)));
+        return;
+    }
+    uint64_t now = virtual_now_.load();
+    while (now < ns && !virtual_now_.compare_exchange_weak(now, ns)) {
+    }
+}
+
+uint64_t VblankClock::NextVblank(uint64_t ns) const {
+    if (ns < origin_) return origin_;
+    return origin_ + ((ns - origin_) / period_ + 1) * period_;
+}
+
+PresentationEngine::PresentationEngine(VblankClock& clock, const VirtualDisplayConfig& config,
+                                       VkPresentModeKHR present_mode, uint32_t image_count)
+    : clock_(clock),
+      present_mode_(present_mode),
+      frame_ns_(config.frame_ns),
+      hitches_(config.hitches),
+      images_(image_count, ImageState::Free) {}
+
+void PresentationEngine::Latch(uint64_t now) {
+    while (!queue_.empty() && queue_.front().display_ns <= now) {
+        const QueuedPresent& present = queue_.front();
+        if (scanout_image_ != UINT32_MAX) images_[scanout_image_] = ImageState::Free;
+        images_[present.image] = ImageState::Scanout;
+        scanout_image_ = present.image;
+        last_display_ns_ = present.display_ns;
+
+        // The margin is how long the image waited for its vblank
+        VkPastPresentationTimingGOOGLE timing{};
+        timing.presentID = present.present_id;
+        timing.desiredPresentTime = present.desired_ns;
+        timing.actualPresentTime = present.display_ns;
+        timing.earliestPresentTime = present.display_ns;
+        timing.presentMargin = present.display_ns - present.queued_ns;
+        if (timings_.size() == kMaxTimings) timings_.pop_front();
+        timings_.push_back(timing);
+
+        queue_.pop_front();
+    }
+}
+
+VkResult PresentationEngine::Acquire(uint64_t timeout_ns, uint32_t* image_index) {
+    Latch(clock_.Now());
+    for (;;) {
+        for (uint32_t i = 0; i < images_.size(); i++) {
+            if (images_[i] == ImageState::Free) {
+                images_[i] = ImageState::Acquired;
+                *image_index = i;
+                return VK_SUCCESS;
+            }
+        }
+
+        // With nothing queued, only the application can free an image
+        if (timeout_ns == 0) return VK_NOT_READY;
+        if (queue_.empty()) return VK_TIMEOUT;
+
+        uint64_t now = clock_.Now();
+        uint64_t latch_ns = queue_.front().display_ns;
+        if (timeout_ns != UINT64_MAX && latch_ns - now > timeout_ns) {
+            clock_.WaitUntil(now + timeout_ns);
+            return VK_TIMEOUT;
+        }
+        clock_.WaitUntil(latch_ns);
+        Latch(std::max(clock_.Now(), latch_ns));
+    }
+}
+
+VkResult PresentationEngine::Present(uint32_t image_index, uint32_t present_id, uint64_t desired_ns) {
+    // Presenting an image the application does not hold
+    if (image_index >= images_.size() || images_[image_index] != ImageState::Acquired) {
+        return VK_ERROR_DEVICE_LOST;
+    }
+
+    // The application's own time for this frame, and any injected hitch
+    present_count_++;
+    uint64_t stall_ns = frame_ns_;
+    while (next_hitch_ < hitches_.size() && hitches_[next_hitch_].first <= present_count_) {
+        if (hitches_[next_hitch_].first == present_count_) stall_ns += hitches_[next_hitch_].second;
+        next_hitch_++;
+    }
+    if (stall_ns > 0) clock_.WaitUntil(clock_.Now() + stall_ns);
+
+    uint64_t now = clock_.Now();
+    Latch(now);
+
+    QueuedPresent present{image_index, present_id, desired_ns, now, now};
+    switch (present_mode_) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        break;
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        if (!queue_.empty()) {
+            images_[queue_.back().image] = ImageState::Free;
+            queue_.pop_back();
+        }
+        present.display_ns = clock_.NextVblank(now);
+        break;
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        if (queue_.empty() && scanout_image_ != UINT32_MAX && clock_.NextVblank(last_display_ns_) <= now) {
+            break;
+        }
+        // fall through
+    default:
+        present.display_ns = clock_.NextVblank(queue_.empty() ? now : std::max(now, queue_.back().display_ns));
+        if (desired_ns > present.display_ns) present.display_ns = clock_.NextVblank(desired_ns - 1);
+        break;
+    }
+
+    images_[image_index] = ImageState::Queued;
+    queue_.push_back(present);
+    Latch(now);
+    return VK_SUCCESS;
+}
+
+VkResult PresentationEngine::PastPresentationTiming(uint32_t* count, VkPastPresentationTimingGOOGLE* timings) {
+    Latch(clock_.Now());
+    if (!timings) {
+        *count = static_cast<uint32_t>(timings_.size());
+        return VK_SUCCESS;
+    }
+    size_t available = timings_.size();
+    uint32_t written = static_cast<uint32_t>(std::min<size_t>(*count, available));
+    std::copy(timings_.begin(), timings_.begin() + written, timings);
+    timings_.erase(timings_.begin(), timings_.begin() + written);
+    *count = written;
+    return written < available ? VK_INCOMPLETE : VK_SUCCESS;
+}
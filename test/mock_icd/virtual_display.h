@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// The mock ICD's display: a vblank clock shared by a device's swapchains
+// and a presentation engine per swapchain that latches presented images on
+// it. Times are nanoseconds; vblank k is at origin + k * period.
+//
+// The clock is virtual by default: it starts at 0 and only moves when the
+// device would have waited (for a vblank to free an image, or through an
+// injected stall), and the wait itself returns at once. Every timestamp is
+// then an exact function of the configuration and the call sequence, and a
+// test can push thousands of frames a second through a layer. With
+// MOCK_ICD_CLOCK=realtime the clock is CLOCK_MONOTONIC and waits really
+// sleep, for code that times frames itself.
+
+// Read from the environment when an instance is created; its devices and
+// surfaces keep that configuration:
+//   MOCK_ICD_REFRESH_HZ     refresh rate (default 60)
+//   MOCK_ICD_CLOCK          virtual (default) or realtime
+//   MOCK_ICD_FRAME_US       time the application spends on each present
+//   MOCK_ICD_HITCHES        extra stalls, "present:ms[,present:ms...]" with
+//                           presents counted from 1 per swapchain
+//   MOCK_ICD_PRESENT_MODES  fifo,fifo_relaxed,mailbox,immediate (default all)
+//   MOCK_ICD_EXTENT         surface size, WxH (default 1280x720)
+//   MOCK_ICD_FAIL_SUBMITS   vkQueueSubmit calls that fail with
+//                           VK_ERROR_OUT_OF_DEVICE_MEMORY, "n[,n...]" with
+//                           calls counted from 1 per device; only calls
+//                           carrying command buffers count, so this hits
+//                           a layer's own work, not an application's
+//                           empty submits
+struct VirtualDisplayConfig {
+    uint64_t refresh_ns = 16666667;
+    bool realtime = false;
+    uint64_t frame_ns = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> hitches;   // (present number, stall ns), sorted
+    std::vector<VkPresentModeKHR> present_modes;
+    VkExtent2D extent = {1280, 720};
+    std::vector<uint64_t> fail_submits;   // Sorted
+
+    static VirtualDisplayConfig FromEnvironment();
+};
+
+class VblankClock {
+public:
+    explicit VblankClock(const VirtualDisplayConfig& config);
+
+    uint64_t Now() const;
+
+    // Virtual: moves the clock forward to `ns`. Realtime: sleeps until then.
+    void WaitUntil(uint64_t ns);
+
+    // The first vblank strictly after `ns`
+    uint64_t NextVblank(uint64_t ns) const;
+
+    uint64_t Period() const { return period_; }
+
+private:
+    uint64_t period_;
+    bool realtime_;
+    uint64_t origin_;
+    std::atomic<uint64_t> virtual_now_{0};
+};
+
+// Swapchain images cycle Free -> Acquired -> Queued -> Scanout -> Free. A
+// queued image is latched at its vblank, replacing the image on screen:
+//   FIFO          the first vblank after both the present and the previous
+//                 queued image, or the first at or after desiredPresentTime
+//   FIFO_RELAXED  as FIFO, but at once (tearing) when the previous image
+//                 stayed on screen past its vblank and nothing is queued
+//   MAILBOX       the next vblank; a newer present replaces an unlatched one
+//   IMMEDIATE     at once
+// Acquire waits on the clock for the next latch while no image is free.
+// Not thread-safe; the ICD serialises calls per swapchain.
+class PresentationEngine {
+public:
+    PresentationEngine(VblankClock& clock, const VirtualDisplayConfig& config, VkPresentModeKHR present_mode,
+                       uint32_t image_count);
+
+    VkResult Acquire(uint64_t timeout_ns, uint32_t* image_index);
+
+    // present_id and desired_ns come from VkPresentTimesInfoGOOGLE (0 if absent)
+    VkResult Present(uint32_t image_index, uint32_t present_id, uint64_t desired_ns);
+
+    // vkGetPastPresentationTimingGOOGLE: latched presents, oldest first;
+    // those returned are removed
+    VkResult PastPresentationTiming(uint32_t* count, VkPastPresentationTimingGOOGLE* timings);
+
+private:
+    static constexpr size_t kMaxTimings = 4096;
+
+    enum class ImageState : uint8_t { Free, Acquired, Queued, Scanout };
+
+    struct QueuedPresent {
+        uint32_t image;
+        uint32_t present_id;
+        uint64_t desired_ns;
+        uint64_t queued_ns;
+        uint64_t display_ns;
+    };
+
+    // Latches every queued present whose vblank is not after `now`
+    void Latch(uint64_t now);
+
+    VblankClock& clock_;
+    VkPresentModeKHR present_mode_;
+    uint64_t frame_ns_;
+    std::vector<std::pair<uint64_t, uint64_t>> hitches_;
+    size_t next_hitch_ = 0;
+
+    std::vector<ImageState> images_;
+    std::deque<QueuedPresent> queue_;
+    std::deque<VkPastPresentationTimingGOOGLE> timings_;
+    uint32_t scanout_image_ = UINT32_MAX;
+    uint64_t last_display_ns_ = 0;
+    uint64_t present_count_ = 0;
+};
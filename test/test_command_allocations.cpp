@@ -0,0 +1,333 @@
+// Counts heap allocations on the command-recording path through whatever
+// layer the loader enables (ctest runs it once per layer, and the logger
+// layers once more writing a binary trace). Replaces the global operator
+// new, which every C++ layer, the mock ICD and the standard library
+// allocate through, and counts what the recording thread allocates; the
+// trace's drain thread may allocate as it likes.
+//
+// Records a command buffer that touches the commands the layers hook and a
+// few they only log: begin, a render pass with a color and a depth clear,
+// viewports, scissors, draws, a barrier, a copy, a dispatch, push
+// constants, end and reset. Two recordings warm up first: per-thread trace
+// rings and the C library's one-time state. Then --iterations
+// recordings must not allocate at all.
+//
+// Layer text output goes to /dev/null while recording.
+//
+// Usage: command_allocation_test [--iterations N]
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <string>
+#include <unistd.h>
+
+static thread_local bool counting = false;
+static std::atomic<uint64_t> allocations{0};
+
+static void* CountedAllocate(size_t size) {
+    if (counting) allocations.fetch_add(1, std::memory_order_relaxed);
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+static void* CountedAllocate(size_t size, std::align_val_t alignment) {
+    if (counting) allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (!pointer) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try { return CountedAllocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try { return CountedAllocate(size); } catch (...) { return nullptr; }
+}
+void* operator new(size_t size, std::align_val_t alignment) { return CountedAllocate(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return CountedAllocate(size, alignment); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { std::free(pointer); }
+
+static int Fail(const char* message) {
+    std::fprintf(stderr, "FAIL: %s\n", message);
+    return 1;
+}
+
+// Device functions, taken from vkGetDeviceProcAddr so calls reach the
+// layer's hooks without the loader's trampolines
+struct Commands {
+    PFN_vkBeginCommandBuffer BeginCommandBuffer;
+    PFN_vkEndCommandBuffer EndCommandBuffer;
+    PFN_vkResetCommandBuffer ResetCommandBuffer;
+    PFN_vkCmdBeginRenderPass CmdBeginRenderPass;
+    PFN_vkCmdEndRenderPass CmdEndRenderPass;
+    PFN_vkCmdSetViewport CmdSetViewport;
+    PFN_vkCmdSetScissor CmdSetScissor;
+    PFN_vkCmdDraw CmdDraw;
+    PFN_vkCmdDrawIndexed CmdDrawIndexed;
+    PFN_vkCmdPipelineBarrier CmdPipelineBarrier;
+    PFN_vkCmdCopyBuffer CmdCopyBuffer;
+    PFN_vkCmdDispatch CmdDispatch;
+    PFN_vkCmdPushConstants CmdPushConstants;
+
+    bool Load(VkDevice device) {
+        auto load = [device](const char* name) { return vkGetDeviceProcAddr(device, name); };
+        BeginCommandBuffer = reinterpret_cast<PFN_vkBeginCommandBuffer>(load("vkBeginCommandBuffer"));
+        EndCommandBuffer = reinterpret_cast<PFN_vkEndCommandBuffer>(load("vkEndCommandBuffer"));
+        ResetCommandBuffer = reinterpret_cast<PFN_vkResetCommandBuffer>(load("vkResetCommandBuffer"));
+        CmdBeginRenderPass = reinterpret_cast<PFN_vkCmdBeginRenderPass>(load("vkCmdBeginRenderPass"));
+        CmdEndRenderPass = reinterpret_cast<PFN_vkCmdEndRenderPass>(load("vkCmdEndRenderPass"));
+        CmdSetViewport = reinterpret_cast<PFN_vkCmdSetViewport>(load("vkCmdSetViewport"));
+        CmdSetScissor = reinterpret_cast<PFN_vkCmdSetScissor>(load("vkCmdSetScissor"));
+        CmdDraw = reinterpret_cast<PFN_vkCmdDraw>(load("vkCmdDraw"));
+        CmdDrawIndexed = reinterpret_cast<PFN_vkCmdDrawIndexed>(load("vkCmdDrawIndexed"));
+        CmdPipelineBarrier = reinterpret_cast<PFN_vkCmdPipelineBarrier>(load("vkCmdPipelineBarrier"));
+        CmdCopyBuffer = reinterpret_cast<PFN_vkCmdCopyBuffer>(load("vkCmdCopyBuffer"));
+        CmdDispatch = reinterpret_cast<PFN_vkCmdDispatch>(load("vkCmdDispatch"));
+        CmdPushConstants = reinterpret_cast<PFN_vkCmdPushConstants>(load("vkCmdPushConstants"));
+        return BeginCommandBuffer && EndCommandBuffer && ResetCommandBuffer && CmdBeginRenderPass &&
+               CmdEndRenderPass && CmdSetViewport && CmdSetScissor && CmdDraw && CmdDrawIndexed &&
+               CmdPipelineBarrier && CmdCopyBuffer && CmdDispatch && CmdPushConstants;
+    }
+};
+
+struct Recording {
+    VkCommandBuffer command_buffer;
+    VkRenderPass render_pass;
+    VkFramebuffer framebuffer;
+    VkBuffer buffer;
+    VkPipelineLayout pipeline_layout;
+};
+
+static bool Record(const Commands& vk, const Recording& recording) {
+    VkCommandBuffer command_buffer = recording.command_buffer;
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vk.BeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) return false;
+
+    VkClearValue clear_values[2] = {};
+    clear_values[0].color = {{0.1f, 0.2f, 0.3f, 1.0f}};
+    clear_values[1].depthStencil = {1.0f, 0};
+    VkRenderPassBeginInfo render_pass_begin{};
+    render_pass_begin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    render_pass_begin.renderPass = recording.render_pass;
+    render_pass_begin.framebuffer = recording.framebuffer;
+    render_pass_begin.renderArea.extent = {1280, 720};
+    render_pass_begin.clearValueCount = 2;
+    render_pass_begin.pClearValues = clear_values;
+
+    const VkViewport viewports[2] = {{0, 0, 640, 720, 0, 1}, {640, 0, 640, 720, 0, 1}};
+    const VkRect2D scissors[2] = {{{0, 0}, {640, 720}}, {{640, 0}, {640, 720}}};
+    for (int pass = 0; pass < 4; pass++) {
+        vk.CmdBeginRenderPass(command_buffer, &render_pass_begin, VK_SUBPASS_CONTENTS_INLINE);
+        vk.CmdSetViewport(command_buffer, 0, 2, viewports);
+        vk.CmdSetScissor(command_buffer, 0, 2, scissors);
+        for (int draw = 0; draw < 16; draw++) {
+            vk.CmdDraw(command_buffer, 3, 1, 0, 0);
+            vk.CmdDrawIndexed(command_buffer, 6, 1, 0, 0, 0);
+        }
+        vk.CmdEndRenderPass(command_buffer);
+    }
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vk.CmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                          1, &barrier, 0, nullptr, 0, nullptr);
+    VkBufferCopy region{0, 256, 256};
+    vk.CmdCopyBuffer(command_buffer, recording.buffer, recording.buffer, 1, &region);
+    const uint32_t constants[4] = {1, 2, 3, 4};
+    vk.CmdPushConstants(command_buffer, recording.pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants),
+                        constants);
+    vk.CmdDispatch(command_buffer, 8, 8, 1);
+
+    if (vk.EndCommandBuffer(command_buffer) != VK_SUCCESS) return false;
+    return vk.ResetCommandBuffer(command_buffer, 0) == VK_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+    uint64_t iterations = 1000;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Command Allocation Test";
+    app_info.apiVersion = VK_API_VERSION_1_2;
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+    VkInstance instance;
+    if (vkCreateInstance(&instance_info, nullptr, &instance) != VK_SUCCESS) {
+        return Fail("vkCreateInstance (is VK_ICD_FILENAMES pointing at VK_ICD_mock.json?)");
+    }
+
+    uint32_t device_count = 1;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    vkEnumeratePhysicalDevices(instance, &device_count, &physical_device);
+    if (device_count == 0) return Fail("no physical device");
+
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = 0;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &priority;
+    const char* device_extensions[] = {"VK_KHR_swapchain"};
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.enabledExtensionCount = 1;
+    device_info.ppEnabledExtensionNames = device_extensions;
+
+    // The same counter must see allocations made inside shared objects,
+    // or a zero below would prove nothing
+    counting = true;
+    VkDevice device;
+    VkResult device_result = vkCreateDevice(physical_device, &device_info, nullptr, &device);
+    counting = false;
+    if (device_result != VK_SUCCESS) return Fail("vkCreateDevice");
+    if (allocations.exchange(0) == 0) return Fail("operator new replacement doesn't reach the ICD or layers");
+
+    Commands vk{};
+    if (!vk.Load(device)) return Fail("missing device functions");
+    auto device_function = [device](const char* name) { return vkGetDeviceProcAddr(device, name); };
+
+    // A color attachment and a depth attachment, both cleared
+    VkAttachmentDescription attachments[2] = {};
+    attachments[0].format = VK_FORMAT_B8G8R8A8_UNORM;
+    attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    attachments[1].format = VK_FORMAT_D32_SFLOAT;
+    attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    VkAttachmentReference color_reference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    VkAttachmentReference depth_reference{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &color_reference;
+    subpass.pDepthStencilAttachment = &depth_reference;
+    VkRenderPassCreateInfo render_pass_info{};
+    render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    render_pass_info.attachmentCount = 2;
+    render_pass_info.pAttachments = attachments;
+    render_pass_info.subpassCount = 1;
+    render_pass_info.pSubpasses = &subpass;
+
+    Recording recording{};
+    auto create_render_pass = reinterpret_cast<PFN_vkCreateRenderPass>(device_function("vkCreateRenderPass"));
+    if (create_render_pass(device, &render_pass_info, nullptr, &recording.render_pass) != VK_SUCCESS) {
+        return Fail("vkCreateRenderPass");
+    }
+
+    VkFramebufferCreateInfo framebuffer_info{};
+    framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_info.renderPass = recording.render_pass;
+    framebuffer_info.width = 1280;
+    framebuffer_info.height = 720;
+    framebuffer_info.layers = 1;
+    auto create_framebuffer = reinterpret_cast<PFN_vkCreateFramebuffer>(device_function("vkCreateFramebuffer"));
+    if (create_framebuffer(device, &framebuffer_info, nullptr, &recording.framebuffer) != VK_SUCCESS) {
+        return Fail("vkCreateFramebuffer");
+    }
+
+    VkBufferCreateInfo buffer_info{};
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.size = 4096;
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    auto create_buffer = reinterpret_cast<PFN_vkCreateBuffer>(device_function("vkCreateBuffer"));
+    if (create_buffer(device, &buffer_info, nullptr, &recording.buffer) != VK_SUCCESS) {
+        return Fail("vkCreateBuffer");
+    }
+
+    VkPushConstantRange push_range{VK_SHADER_STAGE_COMPUTE_BIT, 0, 16};
+    VkPipelineLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layout_info.pushConstantRangeCount = 1;
+    layout_info.pPushConstantRanges = &push_range;
+    auto create_layout = reinterpret_cast<PFN_vkCreatePipelineLayout>(device_function("vkCreatePipelineLayout"));
+    if (create_layout(device, &layout_info, nullptr, &recording.pipeline_layout) != VK_SUCCESS) {
+        return Fail("vkCreatePipelineLayout");
+    }
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    VkCommandPool command_pool;
+    auto create_pool = reinterpret_cast<PFN_vkCreateCommandPool>(device_function("vkCreateCommandPool"));
+    if (create_pool(device, &pool_info, nullptr, &command_pool) != VK_SUCCESS) return Fail("vkCreateCommandPool");
+    VkCommandBufferAllocateInfo allocate_info{};
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.commandPool = command_pool;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = 1;
+    auto allocate = reinterpret_cast<PFN_vkAllocateCommandBuffers>(device_function("vkAllocateCommandBuffers"));
+    if (allocate(device, &allocate_info, &recording.command_buffer) != VK_SUCCESS) {
+        return Fail("vkAllocateCommandBuffers");
+    }
+
+    std::fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) dup2(null_fd, STDOUT_FILENO);
+
+    bool recorded = Record(vk, recording) && Record(vk, recording);
+    counting = true;
+    for (uint64_t i = 0; recorded && i < iterations; i++) recorded = Record(vk, recording);
+    counting = false;
+
+    std::fflush(stdout);
+    if (saved_stdout >= 0) dup2(saved_stdout, STDOUT_FILENO);
+    if (null_fd >= 0) close(null_fd);
+    if (saved_stdout >= 0) close(saved_stdout);
+
+    uint64_t counted = allocations.load();
+    std::printf("%llu recordings, %llu allocations\n", static_cast<unsigned long long>(iterations),
+                static_cast<unsigned long long>(counted));
+
+    reinterpret_cast<PFN_vkDestroyCommandPool>(device_function("vkDestroyCommandPool"))(device, command_pool, nullptr);
+    reinterpret_cast<PFN_vkDestroyPipelineLayout>(device_function("vkDestroyPipelineLayout"))(
+        device, recording.pipeline_layout, nullptr);
+    reinterpret_cast<PFN_vkDestroyBuffer>(device_function("vkDestroyBuffer"))(device, recording.buffer, nullptr);
+    reinterpret_cast<PFN_vkDestroyFramebuffer>(device_function("vkDestroyFramebuffer"))(device, recording.framebuffer,
+                                                                                         nullptr);
+    reinterpret_cast<PFN_vkDestroyRenderPass>(device_function("vkDestroyRenderPass"))(device, recording.render_pass,
+                                                                                       nullptr);
+    vkDestroyDevice(device, nullptr);
+    vkDestroyInstance(instance, nullptr);
+
+    if (!recorded) return Fail("a command-buffer call failed");
+    if (counted != 0) return Fail("allocations while recording");
+    std::printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,223 @@
+// Checks the on-disk cache survives what other runs and processes leave
+// behind: a torn or short entry file reads as a miss, an index with a
+// foreign header reads as empty (and the next Store replaces it), and Store
+// calls racing from several threads and DiskCache instances, the way layers
+// in separate processes would, merge their entries instead of dropping any.
+//
+// Usage: disk_cache_test
+
+#include "disk_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static int failures = 0;
+
+static void Check(bool condition, const char* name) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+static ContentHash Key(uint64_t n) {
+    return HashBytes(&n, sizeof(n));
+}
+
+static std::vector<uint8_t> Blob(uint64_t n, size_t size) {
+    std::vector<uint8_t> blob(size);
+    for (size_t i = 0; i < size; i++) blob[i] = static_cast<uint8_t>((i + n) * 2654435761u >> 24);
+    return blob;
+}
+
+// <kind>-<key>, as disk_cache.h lays the directory out
+static std::string EntryPath(const DiskCache& disk, const ContentHash& key) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%u-%016llx%016llx", static_cast<unsigned>(DiskCacheKind::PipelineCache),
+                  static_cast<unsigned long long>(key.high), static_cast<unsigned long long>(key.low));
+    return disk.directory() + name;
+}
+
+static bool WriteFile(const std::string& path, const void* data, size_t size) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool written = ::write(fd, data, size) == static_cast<ssize_t>(size);
+    return ::close(fd) == 0 && written;
+}
+
+static void RemoveCacheDirectory(const std::string& root) {
+    std::string directory = root + "/v" + std::to_string(kDiskCacheVersion);
+    if (DIR* listing = ::opendir(directory.c_str())) {
+        while (dirent* entry = ::readdir(listing)) {
+            if (std::strcmp(entry->d_name, ".") != 0 && std::strcmp(entry->d_name, "..") != 0) {
+                ::unlink((directory + "/" + entry->d_name).c_str());
+            }
+        }
+        ::closedir(listing);
+    }
+    ::rmdir(directory.c_str());
+    ::rmdir(root.c_str());
+}
+
+static void TestTornEntries(const std::string& root) {
+    std::unique_ptr<DiskCache> disk = DiskCache::Open(root);
+    Check(disk != nullptr, "cache opens");
+    if (!disk) return;
+
+    std::vector<uint8_t> blob = Blob(1, 4096);
+    std::vector<uint8_t> loaded;
+    Check(!disk->Load(DiskCacheKind::PipelineCache, Key(1), &loaded), "empty cache misses");
+    Check(disk->Store(DiskCacheKind::PipelineCache, Key(1), blob.data(), blob.size()), "store succeeds");
+    Check(disk->Load(DiskCacheKind::PipelineCache, Key(1), &loaded) && loaded == blob, "stored entry loads");
+
+    // A write cut short: fewer bytes than the index records
+    std::string path = EntryPath(*disk, Key(1));
+    Check(WriteFile(path, blob.data(), blob.size() / 2), "entry truncated");
+    Check(!disk->Load(DiskCacheKind::PipelineCache, Key(1), &loaded) && loaded.empty(), "short entry is a miss");
+
+    // Torn in the middle: the right size with other bytes in it
+    std::vector<uint8_t> torn = blob;
+    std::memset(torn.data() + torn.size() / 2, 0, torn.size() / 2);
+    Check(WriteFile(path, torn.data(), torn.size()), "entry torn");
+    Check(!disk->Load(DiskCacheKind::PipelineCache, Key(1), &loaded) && loaded.empty(), "torn entry is a miss");
+
+    Check(WriteFile(path, nullptr, 0), "entry emptied");
+    Check(!disk->Load(DiskCacheKind::PipelineCache, Key(1), &loaded), "empty entry is a miss");
+    ::unlink(path.c_str());
+    Check(!disk->Load(DiskCacheKind::PipelineCache, Key(1), &loaded), "missing entry is a miss");
+
+    Check(disk->Store(DiskCacheKind::PipelineCache, Key(1), blob.data(), blob.size()), "store replaces a bad entry");
+    Check(disk->Load(DiskCacheKind::PipelineCache, Key(1), &loaded) && loaded == blob, "replaced entry loads");
+}
+
+static void TestForeignIndex(const std::string& root) {
+    std::string index_path = root + "/v" + std::to_string(kDiskCacheVersion) + "/index";
+    std::vector<uint8_t> blob = Blob(2, 512);
+    std::vector<uint8_t> loaded;
+
+    struct Case {
+        const char* name;
+        uint32_t magic;
+        uint32_t version;
+        int64_t count_delta;   // entryCount against the entries actually written
+    };
+    const Case cases[] = {
+        {"foreign magic reads as empty", 0x46464947, kDiskCacheVersion, 0},
+        {"other version reads as empty", kDiskCacheMagic, kDiskCacheVersion + 1, 0},
+        {"overstated entry count reads as empty", kDiskCacheMagic, kDiskCacheVersion, 1},
+    };
+    for (const Case& test : cases) {
+        {
+            std::unique_ptr<DiskCache> disk = DiskCache::Open(root);
+            if (!disk || !disk->Store(DiskCacheKind::PipelineCache, Key(2), blob.data(), blob.size())) {
+                Check(false, "store before the index is replaced");
+                return;
+            }
+        }
+
+        // The size of the real index, under a header this build won't take
+        std::vector<uint8_t> index;
+        {
+            std::unique_ptr<DiskCache> disk = DiskCache::Open(root);
+            size_t count = disk ? disk->entry_count() : 0;
+            DiskCacheIndexHeader header = {test.magic, test.version, static_cast<uint64_t>(count + test.count_delta)};
+            index.resize(sizeof(header) + count * sizeof(DiskCacheIndexEntry));
+            std::memcpy(index.data(), &header, sizeof(header));
+        }
+        Check(WriteFile(index_path, index.data(), index.size()), "index replaced");
+
+        std::unique_ptr<DiskCache> disk = DiskCache::Open(root);
+        Check(disk != nullptr, "cache opens over a foreign index");
+        if (!disk) return;
+        Check(disk->entry_count() == 0, test.name);
+        Check(!disk->Load(DiskCacheKind::PipelineCache, Key(2), &loaded), "foreign index finds nothing");
+        Check(disk->Store(DiskCacheKind::PipelineCache, Key(3), blob.data(), blob.size()) &&
+                  disk->entry_count() == 1,
+              "store replaces a foreign index");
+        Check(disk->Load(DiskCacheKind::PipelineCache, Key(3), &loaded) && loaded == blob,
+              "entry stored over a foreign index loads");
+    }
+
+    // Shorter than a header
+    Check(WriteFile(index_path, "LCDI", 4), "index truncated");
+    std::unique_ptr<DiskCache> disk = DiskCache::Open(root);
+    Check(disk && disk->entry_count() == 0, "short index reads as empty");
+}
+
+static void TestConcurrentStores(const std::string& root) {
+    constexpr int kInstances = 4;         // Each its own lock file descriptor, as processes have
+    constexpr int kThreadsPerInstance = 2;
+    constexpr int kStoresPerThread = 32;
+
+    std::vector<std::unique_ptr<DiskCache>> disks;
+    for (int i = 0; i < kInstances; i++) {
+        disks.push_back(DiskCache::Open(root));
+        if (!disks.back()) {
+            Check(false, "cache opens for each instance");
+            return;
+        }
+    }
+    size_t before = disks[0]->entry_count();
+
+    std::vector<std::thread> threads;
+    std::vector<int> stored(kInstances * kThreadsPerInstance, 0);
+    for (int t = 0; t < kInstances * kThreadsPerInstance; t++) {
+        threads.emplace_back([&, t] {
+            DiskCache* disk = disks[t % kInstances].get();
+            for (int i = 0; i < kStoresPerThread; i++) {
+                uint64_t n = 1000 + uint64_t(t) * kStoresPerThread + i;
+                std::vector<uint8_t> blob = Blob(n, 256 + i);
+                if (disk->Store(DiskCacheKind::PipelineCache, Key(n), blob.data(), blob.size())) stored[t]++;
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    bool all_stored = true;
+    for (int count : stored) all_stored = all_stored && count == kStoresPerThread;
+    Check(all_stored, "every concurrent store succeeds");
+
+    size_t expected = before + kInstances * kThreadsPerInstance * kStoresPerThread;
+    for (const std::unique_ptr<DiskCache>& disk : disks) {
+        Check(disk->entry_count() == expected, "concurrent stores merge into one index");
+    }
+
+    std::unique_ptr<DiskCache> fresh = DiskCache::Open(root);
+    bool all_load = fresh != nullptr;
+    std::vector<uint8_t> loaded;
+    for (int t = 0; all_load && t < kInstances * kThreadsPerInstance; t++) {
+        for (int i = 0; i < kStoresPerThread; i++) {
+            uint64_t n = 1000 + uint64_t(t) * kStoresPerThread + i;
+            if (!fresh->Load(DiskCacheKind::PipelineCache, Key(n), &loaded) || loaded != Blob(n, 256 + i)) {
+                all_load = false;
+                break;
+            }
+        }
+    }
+    Check(all_load, "every concurrently stored entry loads");
+}
+
+int main() {
+    char root_template[] = "/tmp/disk_cache_test.XXXXXX";
+    if (!::mkdtemp(root_template)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    std::string root = root_template;
+
+    TestTornEntries(root);
+    TestForeignIndex(root);
+    TestConcurrentStores(root);
+
+    RemoveCacheDirectory(root);
+    if (failures != 0) return 1;
+    std::printf("PASS\n");
+    return 0;
+}
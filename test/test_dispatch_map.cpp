@@ -0,0 +1,179 @@
+// Races DispatchMap readers against its writers: reader threads Get and
+// FindIf while writer threads Insert, TryInsert, Erase and EraseIf their own
+// keys, the way command recording threads look up device data while other
+// threads create and destroy devices. Every value a lookup returns must be
+// the one stored under that key, keys never erased must always be found, a
+// writer must see its own insert or erase at once, and no reader may see a
+// key's value go back to an older generation than it has already seen,
+// which a stale snapshot would show. Freed snapshots are read only if the
+// grace period is broken; build it with -fsanitize=address (or =thread for
+// the publication order) to have that reported, and pass fewer operations
+// under TSan:
+//
+//   g++ -std=c++17 -O1 -g -fsanitize=thread -Iinclude test/test_dispatch_map.cpp -o dispatch_map_test -lpthread
+//   ./dispatch_map_test 2000
+//
+// Usage: dispatch_map_test [operations_per_writer]
+
+#include "dispatch_map.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+static std::atomic<int> failures{0};
+
+static void Check(bool condition, const char* name) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+constexpr uint32_t kAlive = 0x600dda7a;
+constexpr int kStableKeys = 8;
+constexpr int kWriters = 2;
+constexpr int kKeysPerWriter = 16;
+constexpr int kReaders = 4;
+constexpr int kKeyCount = kStableKeys + kWriters * kKeysPerWriter;
+
+// Never changed once inserted; values stay allocated until the threads are
+// joined, since the map doesn't own them
+struct Value {
+    void* key;
+    int owner;             // Writer index, or -1 for the stable keys
+    uint64_t generation;   // Counts up each time the key is inserted again
+    uint32_t canary = kAlive;
+};
+
+// Stand-ins for dispatch table pointers
+static void* Key(int index) {
+    static uintptr_t tables[kKeyCount];
+    return &tables[index];
+}
+
+static bool Valid(const Value* value, void* key) {
+    return value->key == key && value->canary == kAlive;
+}
+
+static void Writer(DispatchMap<Value>& map, int writer, int operations, std::vector<std::unique_ptr<Value>>* values) {
+    std::mt19937 random(1234 + writer);
+    int first_key = kStableKeys + writer * kKeysPerWriter;
+    std::vector<Value*> present(kKeysPerWriter, nullptr);
+    std::vector<uint64_t> generation(kKeysPerWriter, 0);
+
+    for (int op = 0; op < operations; op++) {
+        int slot = static_cast<int>(random() % kKeysPerWriter);
+        void* key = Key(first_key + slot);
+
+        if (op % 16 == 15) {
+            // Drop every other key this writer holds in one snapshot
+            int parity = static_cast<int>(random() % 2);
+            std::vector<Value*> removed = map.EraseIf([&](Value* value) {
+                return value->owner == writer && (value->generation + parity) % 2 == 0;
+            });
+            for (Value* value : removed) {
+                int index = 0;
+                while (index < kKeysPerWriter && present[index] != value) index++;
+                Check(index < kKeysPerWriter, "EraseIf returned a value the writer didn't insert");
+                if (index < kKeysPerWriter) present[index] = nullptr;
+            }
+            for (int i = 0; i < kKeysPerWriter; i++) {
+                Check(map.Get(Key(first_key + i)) == present[i], "writer sees its EraseIf at once");
+            }
+        } else if (present[slot]) {
+            if (op % 4 == 0) {
+                Check(!map.TryInsert(key, present[slot]), "TryInsert over a present key refused");
+            }
+            Check(map.Erase(key) == present[slot], "Erase returns the inserted value");
+            present[slot] = nullptr;
+            Check(map.Get(key) == nullptr, "writer sees its Erase at once");
+        } else {
+            values->push_back(std::unique_ptr<Value>(new Value{key, writer, ++generation[slot]}));
+            Value* value = values->back().get();
+            bool inserted = true;
+            if (op % 2 == 0) {
+                map.Insert(key, value);
+            } else {
+                inserted = map.TryInsert(key, value);
+                Check(inserted, "TryInsert of an absent key succeeds");
+            }
+            if (inserted) present[slot] = value;
+            Check(map.Get(key) == present[slot], "writer sees its Insert at once");
+        }
+    }
+}
+
+static void Reader(const DispatchMap<Value>& map, int reader, const std::atomic<bool>& writing,
+                   uint64_t* lookups) {
+    std::mt19937 random(5678 + reader);
+    std::vector<uint64_t> seen(kKeyCount, 0);   // Newest generation seen per key
+    uint64_t count = 0;
+
+    while (writing.load() || count < 1000) {
+        int index = static_cast<int>(random() % kKeyCount);
+        void* key = Key(index);
+        const Value* value = count % 4 == 3 ? map.FindIf([key](Value* candidate) { return candidate->key == key; })
+                                            : map.Get(key);
+        count++;
+        if (index < kStableKeys) {
+            Check(value != nullptr, "key never erased is found");
+        }
+        if (!value) continue;
+        Check(Valid(value, key), "lookup returns the value stored under its key");
+        Check(value->generation >= seen[index], "lookup returns an older value than one already seen");
+        seen[index] = value->generation;
+
+        size_t size = map.Size();
+        Check(size >= kStableKeys && size <= kKeyCount, "Size within the keys that exist");
+    }
+    *lookups = count;
+}
+
+int main(int argc, char** argv) {
+    int operations = argc > 1 ? std::atoi(argv[1]) : 20000;
+    if (operations <= 0) {
+        std::fprintf(stderr, "Usage: %s [operations_per_writer]\n", argv[0]);
+        return 2;
+    }
+
+    DispatchMap<Value> map;
+    std::vector<std::unique_ptr<Value>> stable;
+    for (int i = 0; i < kStableKeys; i++) {
+        stable.push_back(std::unique_ptr<Value>(new Value{Key(i), -1, 1}));
+        map.Insert(Key(i), stable.back().get());
+    }
+
+    std::atomic<bool> writing{true};
+    std::vector<uint64_t> lookups(kReaders, 0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < kReaders; r++) {
+        readers.emplace_back(Reader, std::cref(map), r, std::cref(writing), &lookups[r]);
+    }
+
+    std::vector<std::vector<std::unique_ptr<Value>>> values(kWriters);
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; w++) {
+        writers.emplace_back(Writer, std::ref(map), w, operations, &values[w]);
+    }
+    for (std::thread& thread : writers) thread.join();
+    writing = false;
+    for (std::thread& thread : readers) thread.join();
+
+    for (int i = 0; i < kStableKeys; i++) {
+        Check(map.Get(Key(i)) == stable[i].get(), "stable keys survive the writers");
+    }
+    uint64_t total = 0;
+    for (uint64_t count : lookups) total += count;
+    std::printf("%d writers x %d operations, %llu lookups\n", kWriters, operations,
+                static_cast<unsigned long long>(total));
+
+    if (failures != 0) return 1;
+    std::printf("PASS\n");
+    return 0;
+}
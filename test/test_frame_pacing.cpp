@@ -0,0 +1,142 @@
+// Drives FramePacer::OnFrame with made-up arrival times: no synthetic frame
+// until kWarmupFrames intervals are in, then a steady application is held
+// back half an interval with its synthetic frame midway between the real
+// presents; a hitch is presented at once without one and leaves the
+// average alone, and a second consecutive hitch takes the new rate as the
+// average, warming up again from it.
+//
+// Usage: frame_pacing_test
+
+#include "frame_pacing.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using Clock = FramePacer::Clock;
+
+static int failures = 0;
+
+static void Check(bool condition, const char* name) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+static double Ms(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static bool Near(double value, double expected) {
+    return std::fabs(value - expected) < 0.01;
+}
+
+// Arrival times, each the given interval after the last
+class Application {
+public:
+    PacingDecision Present(FramePacer& pacer, double interval_ms) {
+        now_ += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(interval_ms));
+        return pacer.OnFrame(now_);
+    }
+    Clock::time_point now() const { return now_; }
+
+private:
+    Clock::time_point now_ = Clock::time_point() + std::chrono::seconds(1);
+};
+
+// The next present, shown as it arrives with no synthetic frame
+static bool PresentedAtOnce(FramePacer& pacer, Application& app, double interval_ms) {
+    PacingDecision decision = app.Present(pacer, interval_ms);
+    return !decision.generate && decision.real_at == app.now() && decision.synthetic_at == app.now();
+}
+
+static void TestWarmup() {
+    FramePacer pacer;
+    Application app;
+    Check(PresentedAtOnce(pacer, app, 0.0), "first frame presented at once");
+    for (size_t i = 1; i < FramePacer::kWarmupFrames; i++) {
+        Check(PresentedAtOnce(pacer, app, 25.0), "warmup frame presented at once");
+    }
+    PacingDecision decision = app.Present(pacer, 25.0);
+    Check(decision.generate, "pacing starts once warmed up");
+    Check(Near(pacer.NominalIntervalMs(), 25.0), "nominal interval is the warmup average");
+    Check(pacer.Hitches() == 0, "warmup is not a hitch");
+}
+
+static void TestSteady() {
+    FramePacer pacer;
+    Application app;
+    app.Present(pacer, 0.0);
+    for (size_t i = 1; i < FramePacer::kWarmupFrames; i++) app.Present(pacer, 25.0);
+
+    // The first paced frame's midpoint is before it arrived
+    PacingDecision first = app.Present(pacer, 25.0);
+    Check(first.synthetic_at == app.now(), "first synthetic frame not before its real frame arrives");
+    Clock::time_point last_real_at = first.real_at;
+
+    for (int i = 0; i < 32; i++) {
+        PacingDecision decision = app.Present(pacer, 25.0);
+        // Constant intervals leave no spread to cover: half an interval late,
+        // with the synthetic frame midway from the previous real present
+        Check(decision.generate, "steady frame paced");
+        Check(Near(Ms(decision.real_at - app.now()), 12.5), "steady frame held back half an interval");
+        Check(Near(Ms(decision.synthetic_at - last_real_at), Ms(decision.real_at - decision.synthetic_at)),
+              "synthetic frame midway between real presents");
+        Check(decision.synthetic_at >= app.now(), "synthetic frame not before its real frame arrives");
+        last_real_at = decision.real_at;
+    }
+}
+
+static void TestHitch() {
+    FramePacer pacer;
+    Application app;
+    app.Present(pacer, 0.0);
+    for (int i = 0; i < 8; i++) app.Present(pacer, 25.0);
+
+    Check(PresentedAtOnce(pacer, app, 100.0), "hitch presented at once without a synthetic frame");
+    Clock::time_point hitch_at = app.now();
+    Check(pacer.Hitches() == 1, "hitch counted");
+    Check(Near(pacer.NominalIntervalMs(), 25.0), "one hitch leaves the average alone");
+
+    // Pacing restarts from the hitched frame, which went out at once: the
+    // midpoint from it is before the next frame arrives
+    PacingDecision next = app.Present(pacer, 25.0);
+    Check(next.generate, "frame after a hitch paced again");
+    Check(hitch_at + (next.real_at - hitch_at) / 2 < app.now() && next.synthetic_at == app.now(),
+          "synthetic frame after a hitch goes out as its real frame arrives");
+    Check(Near(Ms(next.real_at - app.now()), 12.5), "frame after a hitch held back half an interval");
+    Check(pacer.Hitches() == 1, "frame after a hitch is not a hitch");
+}
+
+static void TestConsecutiveHitches() {
+    FramePacer pacer;
+    Application app;
+    app.Present(pacer, 0.0);
+    for (int i = 0; i < 8; i++) app.Present(pacer, 25.0);
+
+    Check(PresentedAtOnce(pacer, app, 100.0), "first hitch presented at once");
+    Check(PresentedAtOnce(pacer, app, 100.0), "second hitch presented at once");
+    Check(pacer.Hitches() == 2, "both hitches counted");
+    Check(Near(pacer.NominalIntervalMs(), 100.0), "second hitch restarts the average at the new rate");
+
+    // The new rate warms up from the second hitch's interval
+    for (size_t i = 1; i < FramePacer::kWarmupFrames - 1; i++) {
+        Check(PresentedAtOnce(pacer, app, 100.0), "new rate warming up presented at once");
+    }
+    PacingDecision decision = app.Present(pacer, 100.0);
+    Check(decision.generate, "new rate paced once warmed up");
+    Check(Near(Ms(decision.real_at - app.now()), 50.0), "new rate held back half its interval");
+    Check(pacer.Hitches() == 2, "the new rate is not a hitch");
+}
+
+int main() {
+    TestWarmup();
+    TestSteady();
+    TestHitch();
+    TestConsecutiveHitches();
+
+    if (failures != 0) return 1;
+    std::printf("PASS\n");
+    return 0;
+}
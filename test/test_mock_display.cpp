@@ -0,0 +1,514 @@
+// Drives a swapchain on the mock ICD's virtual display, through whatever
+// layers the loader enables (ctest enables VK_LAYER_frame_interpolation),
+// and checks the display timestamps VK_GOOGLE_display_timing reports
+// against the virtual vblank clock:
+//   fifo, fifo_relaxed  present N is shown at exactly N refresh periods;
+//                       an injected hitch opens a gap at that present only,
+//                       then presents follow every vblank again
+//   mailbox             one newer present per vblank, every vblank while
+//                       the application outpaces the display
+//   immediate           present N is shown at exactly N * --frame-us, plus
+//                       the hitch from its present on
+// With --telemetry it also reads the layer's frame_timing_<swapchain>.bin
+// and checks it holds one sample per frame after the first, in order.
+//
+// Frame generation paces on the host clock and leaves presents carrying
+// extension structs alone, so --generate runs the display on the real
+// clock and presents without present IDs; the application presents every
+// --frame-us on the host clock itself, and --hitch delays its present
+// instead of stalling the display. It checks that more frames reached the
+// display than the application presented, that (immediate only, mailbox
+// rounds to vblanks) the display shows a frame every half interval once
+// pacing has settled, so synthetic frames land midway between real ones,
+// and that the hitched present is shown at once with no synthetic frame
+// before it.
+//
+// --fail-submits N[,N...] makes those of the layer's submits fail (see
+// MOCK_ICD_FAIL_SUBMITS). A present may then report the failure; the run
+// must still finish, without a wait on a fence that never signals, and
+// with generation carrying on past the failures.
+//
+// Usage: mock_display_test [--mode fifo|fifo_relaxed|mailbox|immediate]
+//                          [--frames N] [--refresh HZ] [--frame-us US]
+//                          [--hitch PRESENT:MS] [--telemetry] [--generate]
+//                          [--fail-submits N[,N...]]
+
+#include <vulkan/vulkan.h>
+#include "telemetry_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Options {
+    VkPresentModeKHR mode = VK_PRESENT_MODE_FIFO_KHR;
+    const char* mode_name = "fifo";
+    uint32_t frames = 2000;
+    double refresh_hz = 60.0;
+    double frame_us = 0.0;
+    uint32_t hitch_present = 0;
+    double hitch_ms = 0.0;
+    bool telemetry = false;
+    bool generate = false;
+    std::string fail_submits;
+};
+
+static int Fail(const char* message) {
+    std::fprintf(stderr, "FAIL: %s\n", message);
+    return 1;
+}
+
+static bool ParseOptions(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--mode" && has_value) {
+            options->mode_name = argv[++i];
+            std::string mode = options->mode_name;
+            if (mode == "fifo") options->mode = VK_PRESENT_MODE_FIFO_KHR;
+            else if (mode == "fifo_relaxed") options->mode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            else if (mode == "mailbox") options->mode = VK_PRESENT_MODE_MAILBOX_KHR;
+            else if (mode == "immediate") options->mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            else return false;
+        } else if (arg == "--frames" && has_value) {
+            options->frames = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--refresh" && has_value) {
+            options->refresh_hz = std::atof(argv[++i]);
+        } else if (arg == "--frame-us" && has_value) {
+            options->frame_us = std::atof(argv[++i]);
+        } else if (arg == "--hitch" && has_value) {
+            if (std::sscanf(argv[++i], "%u:%lf", &options->hitch_present, &options->hitch_ms) != 2) return false;
+        } else if (arg == "--telemetry") {
+            options->telemetry = true;
+        } else if (arg == "--generate") {
+            options->generate = true;
+        } else if (arg == "--fail-submits" && has_value) {
+            options->fail_submits = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return options->frames >= 8 && options->refresh_hz > 0.0;
+}
+
+// Configures the mock ICD; read when the instance is created
+static void ConfigureDisplay(const Options& options) {
+    setenv("MOCK_ICD_CLOCK", options.generate ? "realtime" : "virtual", 1);
+    setenv("MOCK_ICD_REFRESH_HZ", std::to_string(options.refresh_hz).c_str(), 1);
+    // With --generate the application keeps its own time (see main)
+    setenv("MOCK_ICD_FRAME_US", std::to_string(options.generate ? 0.0 : options.frame_us).c_str(), 1);
+    std::string hitches;
+    if (options.hitch_present > 0 && !options.generate) {
+        hitches = std::to_string(options.hitch_present) + ":" + std::to_string(options.hitch_ms);
+    }
+    setenv("MOCK_ICD_HITCHES", hitches.c_str(), 1);
+    setenv("MOCK_ICD_FAIL_SUBMITS", options.fail_submits.c_str(), 1);
+    unsetenv("MOCK_ICD_PRESENT_MODES");
+}
+
+static bool HasExtension(const std::vector<VkExtensionProperties>& extensions, const char* name) {
+    for (const VkExtensionProperties& extension : extensions) {
+        if (std::strcmp(extension.extensionName, name) == 0) return true;
+    }
+    return false;
+}
+
+static int CheckTimings(const Options& options, uint64_t period_ns,
+                        const std::vector<VkPastPresentationTimingGOOGLE>& timings) {
+    // Synthetic frames a layer inserts carry no present ID
+    std::vector<VkPastPresentationTimingGOOGLE> shown;
+    for (const VkPastPresentationTimingGOOGLE& timing : timings) {
+        if (timing.presentID != 0) shown.push_back(timing);
+    }
+    uint64_t frame_ns = static_cast<uint64_t>(options.frame_us * 1e3);
+    uint64_t hitch_ns = static_cast<uint64_t>(options.hitch_ms * 1e6);
+
+    // Mailbox shows at most one present per vblank, none during a hitch
+    uint64_t expected = options.frames;
+    if (options.mode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        expected = std::min<uint64_t>(expected, options.frames * frame_ns / period_ns);
+    }
+    if (shown.size() + 4 < expected) return Fail("too few presents reached the display");
+
+    uint32_t irregular_gaps = 0;
+    for (size_t i = 0; i < shown.size(); i++) {
+        const VkPastPresentationTimingGOOGLE& timing = shown[i];
+        bool vblank_aligned = timing.actualPresentTime % period_ns == 0;
+        uint64_t gap = i > 0 ? timing.actualPresentTime - shown[i - 1].actualPresentTime : 0;
+
+        switch (options.mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: {
+            uint64_t expected = timing.presentID * frame_ns;
+            if (options.hitch_present > 0 && timing.presentID >= options.hitch_present) expected += hitch_ns;
+            if (timing.actualPresentTime != expected) {
+                std::fprintf(stderr, "present %u shown at %llu ns, expected %llu\n", timing.presentID,
+                             static_cast<unsigned long long>(timing.actualPresentTime),
+                             static_cast<unsigned long long>(expected));
+                return Fail("immediate present not shown when presented");
+            }
+            break;
+        }
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            if (!vblank_aligned) return Fail("mailbox present not on a vblank");
+            if (i > 0 && timing.presentID <= shown[i - 1].presentID) return Fail("mailbox showed an older present");
+            if (i > 0 && gap != period_ns && (frame_ns < period_ns || gap == 0)) {
+                bool at_hitch = options.hitch_present > 0 && timing.presentID >= options.hitch_present &&
+                                shown[i - 1].presentID < options.hitch_present;
+                if (!at_hitch) return Fail("mailbox missed a vblank");
+            }
+            break;
+        default: {
+            // FIFO_RELAXED shows a late present at once, off the vblank, and
+            // goes back to the vblank with the next one
+            bool relaxed = options.mode == VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            bool at_hitch = options.hitch_present > 0 && (timing.presentID == options.hitch_present ||
+                                                          (relaxed && timing.presentID == options.hitch_present + 1));
+            if (!vblank_aligned && !(relaxed && at_hitch)) return Fail("fifo present not on a vblank");
+            if (i > 0 && timing.presentID != shown[i - 1].presentID + 1) return Fail("fifo skipped a present");
+            if (options.hitch_present == 0 && timing.actualPresentTime != timing.presentID * period_ns) {
+                std::fprintf(stderr, "present %u shown at %llu ns, expected %llu\n", timing.presentID,
+                             static_cast<unsigned long long>(timing.actualPresentTime),
+                             static_cast<unsigned long long>(timing.presentID * period_ns));
+                return Fail("fifo present not shown at its vblank");
+            }
+            if (i > 0 && gap != period_ns) {
+                if (!at_hitch) return Fail("fifo gap away from the hitch");
+                irregular_gaps++;
+            }
+            break;
+        }
+        }
+    }
+
+    if (options.hitch_present > 0 && options.mode != VK_PRESENT_MODE_IMMEDIATE_KHR &&
+        options.mode != VK_PRESENT_MODE_MAILBOX_KHR && irregular_gaps == 0) {
+        return Fail("hitch did not show up on the display");
+    }
+    return 0;
+}
+
+// On the real clock, against the host times the application presented at
+// (nanoseconds, as the display reports): synthetic frames the layer inserted
+// reached the display beside the application's, halving the gaps between
+// shown frames, and the hitched frame went out at once on its own
+static int CheckGeneration(const Options& options, uint64_t period_ns,
+                           const std::vector<VkPastPresentationTimingGOOGLE>& timings,
+                           const std::vector<uint64_t>& present_calls) {
+    if (options.mode == VK_PRESENT_MODE_FIFO_KHR || options.mode == VK_PRESENT_MODE_FIFO_RELAXED_KHR) {
+        return Fail("--generate needs a mailbox or immediate swapchain");
+    }
+    if (timings.size() <= options.frames) return Fail("no synthetic frames reached the display");
+    std::printf("generation: %zu presents shown for %u application frames\n", timings.size(), options.frames);
+
+    uint64_t frame_ns = static_cast<uint64_t>(options.frame_us * 1e3);
+    uint64_t latch_ns = options.mode == VK_PRESENT_MODE_MAILBOX_KHR ? period_ns : 0;   // To the next vblank
+    auto first_shown_from = [&](uint64_t ns) {
+        return std::find_if(timings.begin(), timings.end(),
+                            [ns](const VkPastPresentationTimingGOOGLE& timing) { return timing.actualPresentTime >= ns; });
+    };
+
+    // The previous frame went out at most an interval after it was
+    // presented, which is when the hitched one was due; nothing is shown
+    // through the rest of the hitch. The hitched frame is then shown at once
+    // and alone: the next synthetic frame needs the application's next one.
+    uint32_t hitch = options.hitch_present;
+    if (hitch > 1 && hitch < present_calls.size()) {
+        uint64_t presented = present_calls[hitch - 1];
+        uint64_t hitch_ns = static_cast<uint64_t>(options.hitch_ms * 1e6);
+        auto shown = first_shown_from(presented);
+        if (shown == timings.end() || shown->actualPresentTime > presented + latch_ns + frame_ns / 4) {
+            return Fail("hitched frame not shown at once");
+        }
+        uint64_t quiet_from = presented - hitch_ns + frame_ns / 4 + latch_ns;
+        if (shown != timings.begin() && (shown - 1)->actualPresentTime > quiet_from) {
+            std::fprintf(stderr, "frame shown %.1f ms before the hitched one, after a %.1f ms hitch\n",
+                         (presented - (shown - 1)->actualPresentTime) / 1e6, options.hitch_ms);
+            return Fail("frame shown during the hitch");
+        }
+        if (first_shown_from(present_calls[hitch]) - shown != 1) {
+            return Fail("synthetic frame shown beside the hitched frame");
+        }
+    }
+
+    // Gaps between shown frames, past the pacer's warmup and clear of the
+    // hitch: a synthetic frame midway through each interval halves them, so
+    // the middle half of them sit near half an interval
+    if (options.mode != VK_PRESENT_MODE_IMMEDIATE_KHR) return 0;
+    auto steady = [&](uint64_t ns) {
+        if (ns < present_calls[8] || ns > present_calls.back()) return false;
+        if (hitch > 1 && hitch <= present_calls.size()) {
+            uint64_t settled = present_calls[std::min<size_t>(hitch + 8, present_calls.size()) - 1];
+            if (ns >= present_calls[hitch - 2] && ns < settled) return false;
+        }
+        return true;
+    };
+    std::vector<uint64_t> gaps;
+    for (size_t i = 1; i < timings.size(); i++) {
+        if (steady(timings[i - 1].actualPresentTime) && steady(timings[i].actualPresentTime)) {
+            gaps.push_back(timings[i].actualPresentTime - timings[i - 1].actualPresentTime);
+        }
+    }
+    if (gaps.size() < options.frames / 2) return Fail("too few frames shown while pacing was steady");
+    std::sort(gaps.begin(), gaps.end());
+    uint64_t low_gap = gaps[gaps.size() / 4];
+    uint64_t high_gap = gaps[gaps.size() * 3 / 4];
+    std::printf("generation: middle half of gaps between shown frames %.2f-%.2f ms, %.2f ms between application "
+                "frames\n", low_gap / 1e6, high_gap / 1e6, frame_ns / 1e6);
+    if (low_gap < frame_ns * 3 / 8 || high_gap > frame_ns * 5 / 8) {
+        return Fail("synthetic frames not shown midway between application frames");
+    }
+    return 0;
+}
+
+// One sample per acquire after the first, numbered in order
+static int CheckTelemetry(const Options& options, VkSwapchainKHR swapchain) {
+    std::string path = "frame_timing_" + std::to_string(reinterpret_cast<uintptr_t>(swapchain)) + ".bin";
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return Fail("layer telemetry file missing");
+
+    TelemetryFileHeader header = {};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != kTelemetryMagic || header.version != kTelemetryVersion) {
+        return Fail("layer telemetry header invalid");
+    }
+
+    uint64_t samples = 0;
+    uint64_t dropped = 0;
+    uint64_t expected_frame = 1;
+    TelemetryBlockHeader block = {};
+    while (in.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+        std::vector<uint64_t> frame_numbers(block.count);
+        in.read(reinterpret_cast<char*>(frame_numbers.data()), block.count * sizeof(uint64_t));
+        in.seekg(block.count * (sizeof(float) + 3 * sizeof(uint32_t)), std::ios::cur);
+        if (!in) return Fail("layer telemetry truncated");
+        dropped = block.droppedTotal;
+        for (uint64_t frame_number : frame_numbers) {
+            if (dropped == 0 && frame_number != expected_frame) return Fail("layer telemetry out of order");
+            expected_frame = frame_number + 1;
+            samples++;
+        }
+    }
+    in.close();
+    std::remove(path.c_str());
+
+    std::printf("telemetry: %llu samples, %llu dropped\n", static_cast<unsigned long long>(samples),
+                static_cast<unsigned long long>(dropped));
+    if (samples + dropped != options.frames - 1) return Fail("layer telemetry sample count wrong");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        std::fprintf(stderr,
+                     "Usage: %s [--mode fifo|fifo_relaxed|mailbox|immediate] [--frames N] [--refresh HZ]\n"
+                     "          [--frame-us US] [--hitch PRESENT:MS] [--telemetry] [--generate]\n"
+                     "          [--fail-submits N[,N...]]\n", argv[0]);
+        return 2;
+    }
+    if ((options.mode == VK_PRESENT_MODE_MAILBOX_KHR || options.mode == VK_PRESENT_MODE_IMMEDIATE_KHR) &&
+        options.frame_us <= 0.0) {
+        return Fail("mailbox and immediate need --frame-us for the virtual clock to move");
+    }
+    ConfigureDisplay(options);
+
+    const char* instance_extensions[] = {"VK_KHR_surface", "VK_EXT_headless_surface"};
+    VkApplicationInfo app_info{};
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pApplicationName = "Mock Display Test";
+    app_info.apiVersion = VK_API_VERSION_1_2;
+
+    VkInstanceCreateInfo instance_info{};
+    instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instance_info.pApplicationInfo = &app_info;
+    instance_info.enabledExtensionCount = 2;
+    instance_info.ppEnabledExtensionNames = instance_extensions;
+
+    VkInstance instance;
+    if (vkCreateInstance(&instance_info, nullptr, &instance) != VK_SUCCESS) {
+        return Fail("vkCreateInstance (is VK_ICD_FILENAMES pointing at VK_ICD_mock.json?)");
+    }
+
+    uint32_t device_count = 1;
+    VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+    vkEnumeratePhysicalDevices(instance, &device_count, &physical_device);
+    if (device_count == 0) return Fail("no physical device");
+
+    uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+    std::vector<VkExtensionProperties> extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, extensions.data());
+    if (!HasExtension(extensions, "VK_GOOGLE_display_timing")) return Fail("VK_GOOGLE_display_timing missing");
+
+    auto create_headless_surface = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(
+        vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT"));
+    VkHeadlessSurfaceCreateInfoEXT surface_info{};
+    surface_info.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+    VkSurfaceKHR surface;
+    if (!create_headless_surface || create_headless_surface(instance, &surface_info, nullptr, &surface) != VK_SUCCESS) {
+        return Fail("vkCreateHeadlessSurfaceEXT");
+    }
+
+    const char* device_extensions[] = {"VK_KHR_swapchain", "VK_GOOGLE_display_timing"};
+    float priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info{};
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.queueFamilyIndex = 0;
+    queue_info.queueCount = 1;
+    queue_info.pQueuePriorities = &priority;
+
+    VkDeviceCreateInfo device_info{};
+    device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_info.queueCreateInfoCount = 1;
+    device_info.pQueueCreateInfos = &queue_info;
+    device_info.enabledExtensionCount = 2;
+    device_info.ppEnabledExtensionNames = device_extensions;
+
+    VkDevice device;
+    if (vkCreateDevice(physical_device, &device_info, nullptr, &device) != VK_SUCCESS) {
+        return Fail("vkCreateDevice");
+    }
+    VkQueue queue;
+    vkGetDeviceQueue(device, 0, 0, &queue);
+
+    auto get_refresh_cycle = reinterpret_cast<PFN_vkGetRefreshCycleDurationGOOGLE>(
+        vkGetDeviceProcAddr(device, "vkGetRefreshCycleDurationGOOGLE"));
+    auto get_past_timing = reinterpret_cast<PFN_vkGetPastPresentationTimingGOOGLE>(
+        vkGetDeviceProcAddr(device, "vkGetPastPresentationTimingGOOGLE"));
+    if (!get_refresh_cycle || !get_past_timing) return Fail("VK_GOOGLE_display_timing entry points");
+
+    VkSurfaceCapabilitiesKHR capabilities;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physical_device, surface, &capabilities);
+
+    VkSwapchainCreateInfoKHR swapchain_info{};
+    swapchain_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    swapchain_info.surface = surface;
+    swapchain_info.minImageCount = 3;
+    swapchain_info.imageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    swapchain_info.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    swapchain_info.imageExtent = capabilities.currentExtent;
+    swapchain_info.imageArrayLayers = 1;
+    swapchain_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    swapchain_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    swapchain_info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    swapchain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    swapchain_info.presentMode = options.mode;
+    swapchain_info.clipped = VK_TRUE;
+
+    VkSwapchainKHR swapchain;
+    if (vkCreateSwapchainKHR(device, &swapchain_info, nullptr, &swapchain) != VK_SUCCESS) {
+        return Fail("vkCreateSwapchainKHR");
+    }
+
+    VkRefreshCycleDurationGOOGLE refresh_cycle{};
+    get_refresh_cycle(device, swapchain, &refresh_cycle);
+    uint64_t period_ns = static_cast<uint64_t>(std::llround(1e9 / options.refresh_hz));
+    if (refresh_cycle.refreshDuration != period_ns) return Fail("refresh cycle does not match MOCK_ICD_REFRESH_HZ");
+
+    // Two frames in flight, each with its acquire and render semaphores
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    VkSemaphore acquired[2];
+    VkSemaphore rendered[2];
+    for (int i = 0; i < 2; i++) {
+        vkCreateSemaphore(device, &semaphore_info, nullptr, &acquired[i]);
+        vkCreateSemaphore(device, &semaphore_info, nullptr, &rendered[i]);
+    }
+
+    std::vector<VkPastPresentationTimingGOOGLE> timings;
+    auto collect_timings = [&]() {
+        uint32_t count = 0;
+        get_past_timing(device, swapchain, &count, nullptr);
+        size_t offset = timings.size();
+        timings.resize(offset + count);
+        get_past_timing(device, swapchain, &count, timings.data() + offset);
+        timings.resize(offset + count);
+    };
+
+    uint32_t failed_presents = 0;
+    std::vector<uint64_t> present_calls;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        uint32_t slot = frame % 2;
+        uint32_t image_index;
+        if (vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, acquired[slot], VK_NULL_HANDLE, &image_index) !=
+            VK_SUCCESS) {
+            return Fail("vkAcquireNextImageKHR");
+        }
+
+        VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        VkSubmitInfo submit_info{};
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.waitSemaphoreCount = 1;
+        submit_info.pWaitSemaphores = &acquired[slot];
+        submit_info.pWaitDstStageMask = &wait_stage;
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &rendered[slot];
+        if (vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) return Fail("vkQueueSubmit");
+
+        VkPresentTimeGOOGLE present_time{};
+        present_time.presentID = frame + 1;
+        VkPresentTimesInfoGOOGLE present_times{};
+        present_times.sType = VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE;
+        present_times.swapchainCount = 1;
+        present_times.pTimes = &present_time;
+
+        VkPresentInfoKHR present_info{};
+        present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        present_info.pNext = options.generate ? nullptr : &present_times;
+        present_info.waitSemaphoreCount = 1;
+        present_info.pWaitSemaphores = &rendered[slot];
+        present_info.swapchainCount = 1;
+        present_info.pSwapchains = &swapchain;
+        present_info.pImageIndices = &image_index;
+        if (options.generate) {
+            // The application's own frame time, on the clock the display uses
+            std::chrono::steady_clock::time_point due =
+                start + std::chrono::microseconds(static_cast<int64_t>(options.frame_us * (frame + 1)));
+            if (options.hitch_present > 0 && frame + 1 >= options.hitch_present) {
+                due += std::chrono::microseconds(static_cast<int64_t>(options.hitch_ms * 1e3));
+            }
+            std::this_thread::sleep_until(due);
+            present_calls.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+        VkResult presented = vkQueuePresentKHR(queue, &present_info);
+        if (presented == VK_ERROR_OUT_OF_DEVICE_MEMORY && !options.fail_submits.empty()) {
+            failed_presents++;
+        } else if (presented != VK_SUCCESS) {
+            return Fail("vkQueuePresentKHR");
+        }
+
+        if (frame % 64 == 63) collect_timings();
+    }
+    collect_timings();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("%s: %u frames in %.3f s (%.0f fps), %zu presents reported by the display\n", options.mode_name,
+                options.frames, seconds, options.frames / seconds, timings.size());
+    if (!options.fail_submits.empty()) std::printf("%u presents reported a failed submit\n", failed_presents);
+    int result = options.generate ? CheckGeneration(options, period_ns, timings, present_calls)
+                                  : CheckTimings(options, period_ns, timings);
+
+    vkDeviceWaitIdle(device);
+    for (int i = 0; i < 2; i++) {
+        vkDestroySemaphore(device, acquired[i], nullptr);
+        vkDestroySemaphore(device, rendered[i], nullptr);
+    }
+    vkDestroySwapchainKHR(device, swapchain, nullptr);
+    if (result == 0 && options.telemetry) result = CheckTelemetry(options, swapchain);
+
+    vkDestroyDevice(device, nullptr);
+    vkDestroySurfaceKHR(instance, surface, nullptr);
+    vkDestroyInstance(instance, nullptr);
+
+    if (result == 0) std::printf("PASS\n");
+    return result;
+}
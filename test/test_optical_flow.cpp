@@ -0,0 +1,168 @@
+// Checks every SAD kernel set the CPU supports against the scalar one: the
+// single-block and run-of-8 kernels on random and extreme blocks at odd,
+// unaligned strides, then whole OpticalFlowEngine runs, whose vectors must
+// match the scalar engine's exactly (optical_flow.h promises identical
+// vectors) and follow the motion put into the frames.
+//
+// Usage: optical_flow_test
+
+#include "optical_flow.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static int failures = 0;
+
+static void Check(bool condition, const char* name) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+static const SadKernelSet kSets[] = {SadKernelSet::Sse41, SadKernelSet::Avx2};
+
+// Random blocks, then all-0 against all-255 (the largest SAD) and equal ones
+static void TestKernels(const SadKernels& kernels, const SadKernels& scalar) {
+    std::mt19937 random(42);
+    const ptrdiff_t strides[] = {15, 17, 33, 103, 1281};
+    bool sad_matches = true;
+    bool run_matches = true;
+
+    for (ptrdiff_t current_stride : strides) {
+        for (ptrdiff_t reference_stride : strides) {
+            // Odd offsets keep the rows off any alignment
+            std::vector<uint8_t> current(3 + 8 * current_stride);
+            std::vector<uint8_t> reference(5 + 8 * reference_stride + 16);
+            for (int pattern = 0; pattern < 12; pattern++) {
+                for (uint8_t& byte : current) byte = static_cast<uint8_t>(random());
+                for (uint8_t& byte : reference) byte = static_cast<uint8_t>(random());
+                if (pattern == 1) {
+                    std::memset(current.data(), 0, current.size());
+                    std::memset(reference.data(), 255, reference.size());
+                } else if (pattern == 2) {
+                    std::memset(current.data(), 255, current.size());
+                    std::memset(reference.data(), 0, reference.size());
+                } else if (pattern == 3) {
+                    std::memset(current.data(), 77, current.size());
+                    std::memset(reference.data(), 77, reference.size());
+                }
+                const uint8_t* cur = current.data() + 3;
+                const uint8_t* ref = reference.data() + 5;
+
+                sad_matches = sad_matches && kernels.sad8x8(cur, current_stride, ref, reference_stride) ==
+                                                 scalar.sad8x8(cur, current_stride, ref, reference_stride);
+                uint16_t sads[8];
+                uint16_t expected[8];
+                kernels.sad8x8_run8(cur, current_stride, ref, reference_stride, sads);
+                scalar.sad8x8_run8(cur, current_stride, ref, reference_stride, expected);
+                run_matches = run_matches && std::memcmp(sads, expected, sizeof(sads)) == 0;
+            }
+        }
+    }
+    Check(sad_matches, kernels.set == SadKernelSet::Avx2 ? "avx2 sad8x8 matches scalar" : "sse4.1 sad8x8 matches scalar");
+    Check(run_matches,
+          kernels.set == SadKernelSet::Avx2 ? "avx2 sad8x8_run8 matches scalar" : "sse4.1 sad8x8_run8 matches scalar");
+}
+
+// Smoothed noise, so the coarse levels of the pyramid still have detail to match
+static std::vector<uint8_t> Texture(uint32_t width, uint32_t height) {
+    std::mt19937 random(7);
+    std::vector<uint8_t> noise(width * height);
+    for (uint8_t& value : noise) value = static_cast<uint8_t>(random());
+    std::vector<uint8_t> texture(width * height);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t sum = 0;
+            for (uint32_t dy = 0; dy < 3; dy++) {
+                for (uint32_t dx = 0; dx < 3; dx++) {
+                    sum += noise[((y + dy) % height) * width + (x + dx) % width];
+                }
+            }
+            texture[y * width + x] = static_cast<uint8_t>(sum / 9);
+        }
+    }
+    return texture;
+}
+
+// The texture moved by (dx, dy), as RGBA rows with some padding past each
+static std::vector<uint8_t> Frame(const std::vector<uint8_t>& texture, uint32_t texture_width,
+                                  uint32_t width, uint32_t height, size_t row_pitch, int dx, int dy) {
+    std::vector<uint8_t> frame(row_pitch * height, 0xcd);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint8_t value = texture[(y + 16 - dy) * texture_width + (x + 16 - dx)];
+            uint8_t* pixel = &frame[y * row_pitch + x * 4];
+            pixel[0] = value;
+            pixel[1] = static_cast<uint8_t>(255 - value);
+            pixel[2] = static_cast<uint8_t>(value / 2);
+            pixel[3] = 255;
+        }
+    }
+    return frame;
+}
+
+// Two frames through an engine on `kernels`; the vectors of the second
+static std::vector<int16_t> Flow(const SadKernels& kernels, const std::vector<uint8_t>& first,
+                                 const std::vector<uint8_t>& second, uint32_t width, uint32_t height,
+                                 size_t row_pitch) {
+    OpticalFlowOptions options;
+    options.threads = 2;
+    options.kernels = &kernels;
+    std::unique_ptr<OpticalFlowEngine> engine = OpticalFlowEngine::Create(width, height, options);
+    if (!engine) return {};
+    engine->Dispatch(first.data(), row_pitch, PixelOrder::RGBA);
+    if (!engine->Dispatch(second.data(), row_pitch, PixelOrder::RGBA)) return {};
+    const int16_t* vectors = engine->Vectors();
+    return std::vector<int16_t>(vectors, vectors + 2 * engine->GridWidth() * engine->GridHeight());
+}
+
+static void TestEngine(const std::vector<SadKernels>& kernel_sets) {
+    // Odd sizes leave partial blocks at the right and bottom edges
+    const uint32_t width = 203;
+    const uint32_t height = 117;
+    const size_t row_pitch = width * 4 + 12;
+    const int dx = 5;
+    const int dy = -3;
+    const uint32_t texture_width = width + 32;
+    std::vector<uint8_t> texture = Texture(texture_width, height + 32);
+    std::vector<uint8_t> first = Frame(texture, texture_width, width, height, row_pitch, 0, 0);
+    std::vector<uint8_t> second = Frame(texture, texture_width, width, height, row_pitch, dx, dy);
+
+    std::vector<int16_t> expected = Flow(kernel_sets[0], first, second, width, height, row_pitch);
+    Check(!expected.empty(), "scalar engine produces vectors");
+    if (expected.empty()) return;
+
+    // Content at x in the second frame was at x - dx in the first
+    size_t following = 0;
+    for (size_t i = 0; i < expected.size(); i += 2) {
+        if (expected[i] == -dx && expected[i + 1] == -dy) following++;
+    }
+    Check(following * 4 >= (expected.size() / 2) * 3, "scalar engine follows the motion in most blocks");
+
+    for (size_t i = 1; i < kernel_sets.size(); i++) {
+        std::vector<int16_t> vectors = Flow(kernel_sets[i], first, second, width, height, row_pitch);
+        Check(vectors == expected, kernel_sets[i].set == SadKernelSet::Avx2 ? "avx2 engine vectors match scalar"
+                                                                             : "sse4.1 engine vectors match scalar");
+    }
+}
+
+int main() {
+    SadKernels scalar = GetSadKernels(SadKernelSet::Scalar);
+    std::vector<SadKernels> kernel_sets = {scalar};
+    for (SadKernelSet set : kSets) {
+        if (!SadKernelsSupported(set)) {
+            std::printf("%s kernels not supported here, skipped\n", set == SadKernelSet::Avx2 ? "avx2" : "sse4.1");
+            continue;
+        }
+        kernel_sets.push_back(GetSadKernels(set));
+        TestKernels(kernel_sets.back(), scalar);
+    }
+    TestEngine(kernel_sets);
+
+    if (failures != 0) return 1;
+    std::printf("PASS\n");
+    return 0;
+}
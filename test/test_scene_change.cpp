@@ -0,0 +1,138 @@
+// Checks SceneChangeDetector::BuildHistogram, SSE2 where the build has it,
+// against a per-sample scalar reference of the grid and luma scene_change.h
+// describes: random frames in every SoftwareFormat, at widths that end the
+// SIMD loop at each possible tail length and row pitches with padding. Then
+// AddFrame on frames that match or are cuts.
+//
+// Usage: scene_change_test
+
+#include "scene_change.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static int failures = 0;
+
+static void Check(bool condition, const char* name) {
+    if (!condition) {
+        std::fprintf(stderr, "FAIL: %s\n", name);
+        failures++;
+    }
+}
+
+static const SoftwareFormat kFormats[] = {SoftwareFormat::Rgba8, SoftwareFormat::Bgra8, SoftwareFormat::Rgb10A2,
+                                          SoftwareFormat::Bgr10A2};
+
+static const char* FormatName(SoftwareFormat format) {
+    switch (format) {
+    case SoftwareFormat::Rgba8: return "rgba8";
+    case SoftwareFormat::Bgra8: return "bgra8";
+    case SoftwareFormat::Rgb10A2: return "rgb10a2";
+    default: return "bgr10a2";
+    }
+}
+
+// BT.601 luma of one pixel in 8.8 fixed point, top 8 bits of 10-bit fields
+static uint32_t ReferenceBin(const uint8_t* pixel, SoftwareFormat format) {
+    uint32_t r, g, b;
+    if (format == SoftwareFormat::Rgb10A2 || format == SoftwareFormat::Bgr10A2) {
+        uint32_t v = pixel[0] | pixel[1] << 8 | pixel[2] << 16 | static_cast<uint32_t>(pixel[3]) << 24;
+        uint32_t low = (v >> 2) & 0xff;
+        uint32_t high = (v >> 22) & 0xff;
+        g = (v >> 12) & 0xff;
+        r = format == SoftwareFormat::Rgb10A2 ? low : high;
+        b = format == SoftwareFormat::Rgb10A2 ? high : low;
+    } else {
+        r = format == SoftwareFormat::Rgba8 ? pixel[0] : pixel[2];
+        g = pixel[1];
+        b = format == SoftwareFormat::Rgba8 ? pixel[2] : pixel[0];
+    }
+    return ((77 * r + 150 * g + 29 * b + 128) >> 8) >> 2;
+}
+
+static SceneChangeDetector::Histogram ReferenceHistogram(const uint8_t* pixels, size_t row_pitch, uint32_t width,
+                                                         uint32_t height, SoftwareFormat format) {
+    SceneChangeDetector::Histogram histogram{};
+    for (uint32_t y = 0; y < height; y += SceneChangeDetector::kSampleStepY) {
+        for (uint32_t x = 0; x < width; x += SceneChangeDetector::kSampleStepX) {
+            histogram[ReferenceBin(pixels + y * row_pitch + x * 4, format)]++;
+        }
+    }
+    return histogram;
+}
+
+static std::vector<uint8_t> RandomFrame(std::mt19937& random, size_t row_pitch, uint32_t height) {
+    std::vector<uint8_t> frame(row_pitch * height);
+    for (uint8_t& byte : frame) byte = static_cast<uint8_t>(random());
+    return frame;
+}
+
+static void TestHistograms() {
+    std::mt19937 random(99);
+    // Samples per row of 1 to 9, so the four-sample SIMD loop ends at every
+    // tail length, and a wide row
+    const uint32_t widths[] = {1, 7, 8, 9, 17, 25, 31, 33, 41, 57, 65, 203, 1281};
+    const uint32_t heights[] = {1, 16, 17, 33};
+
+    for (SoftwareFormat format : kFormats) {
+        bool matches = true;
+        for (uint32_t width : widths) {
+            for (uint32_t height : heights) {
+                size_t row_pitch = width * 4 + 4 * (width % 3);
+                std::vector<uint8_t> frame = RandomFrame(random, row_pitch, height);
+                SceneChangeDetector::Histogram histogram;
+                SceneChangeDetector::BuildHistogram(frame.data(), row_pitch, width, height, format, &histogram);
+                if (histogram != ReferenceHistogram(frame.data(), row_pitch, width, height, format)) {
+                    std::fprintf(stderr, "%s %ux%u histogram differs\n", FormatName(format), width, height);
+                    matches = false;
+                }
+            }
+        }
+        Check(matches, "histogram matches the scalar reference");
+    }
+
+    // The extremes land in the first and last bins
+    for (SoftwareFormat format : kFormats) {
+        const uint32_t width = 64;
+        const uint32_t height = 32;
+        std::vector<uint8_t> frame(width * 4 * height, 0xff);
+        SceneChangeDetector::Histogram histogram;
+        SceneChangeDetector::BuildHistogram(frame.data(), width * 4, width, height, format, &histogram);
+        Check(histogram[SceneChangeDetector::kBins - 1] == SceneChangeDetector::SampleCount(width, height),
+              "white samples land in the last bin");
+        std::memset(frame.data(), 0, frame.size());
+        SceneChangeDetector::BuildHistogram(frame.data(), width * 4, width, height, format, &histogram);
+        Check(histogram[0] == SceneChangeDetector::SampleCount(width, height), "black samples land in the first bin");
+    }
+}
+
+static void TestCuts() {
+    std::mt19937 random(5);
+    const uint32_t width = 203;
+    const uint32_t height = 117;
+    const size_t row_pitch = width * 4;
+    std::vector<uint8_t> frame = RandomFrame(random, row_pitch, height);
+    std::vector<uint8_t> inverted = frame;
+    for (uint8_t& byte : inverted) byte = static_cast<uint8_t>(~byte);
+    std::vector<uint8_t> dark(frame.size());
+    for (size_t i = 0; i < dark.size(); i++) dark[i] = static_cast<uint8_t>(frame[i] / 8);
+
+    SceneChangeDetector detector(width, height, SoftwareFormat::Rgba8);
+    Check(!detector.AddFrame(frame.data(), row_pitch), "first frame is never a cut");
+    Check(!detector.AddFrame(frame.data(), row_pitch) && detector.LastDistance() == 0, "same frame is no cut");
+    Check(!detector.AddFrame(inverted.data(), row_pitch), "inverted noise keeps its histogram, no cut");
+    Check(detector.AddFrame(dark.data(), row_pitch), "dark frame after a bright one is a cut");
+    detector.Reset();
+    Check(!detector.AddFrame(frame.data(), row_pitch), "first frame after Reset is never a cut");
+}
+
+int main() {
+    TestHistograms();
+    TestCuts();
+
+    if (failures != 0) return 1;
+    std::printf("PASS\n");
+    return 0;
+}
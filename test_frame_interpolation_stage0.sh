@@ -57,6 +57,10 @@ fi
 # Test 5: CSV File Generation
 echo
 echo "Test 5: CSV File Generation"
+# The layer writes binary telemetry; convert it to the CSV format
+for bin in frame_timing_*.bin; do
+    [ -f "$bin" ] && ./build/telemetry_to_csv "$bin" "${bin%.bin}.csv" 2>/dev/null
+done
 csv_files=$(ls frame_timing_*.csv 2>/dev/null | wc -l)
 if [ $csv_files -gt 0 ]; then
     echo "✅ CSV file(s) generated: $csv_files"
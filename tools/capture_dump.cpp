@@ -0,0 +1,93 @@
+// Reads a frame_capture_*.cap file written by the frame interpolation layer
+// (FRAME_INTERP_CAPTURE=1). Lists the frame index, or writes one frame as a
+// binary PPM with 8 bits per channel (10-bit captures keep their top bits).
+//
+// Usage: capture_dump <input.cap>                  (list frames)
+//        capture_dump <input.cap> <frame> <out.ppm>
+
+#include "capture_file.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " <input.cap> [<frame> <out.ppm>]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    CaptureFileHeader header = {};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != kCaptureMagic) {
+        std::cerr << argv[1] << " is not a capture file" << std::endl;
+        return 1;
+    }
+    if (header.version != kCaptureVersion) {
+        std::cerr << "Unsupported capture version " << header.version << std::endl;
+        return 1;
+    }
+
+    std::vector<CaptureIndexEntry> index(header.frameCount);
+    in.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(CaptureIndexEntry));
+    if (!in) {
+        std::cerr << "Truncated frame index" << std::endl;
+        return 1;
+    }
+
+    if (argc == 2) {
+        std::cout << header.width << "x" << header.height << " format " << header.vkFormat << ", "
+                  << header.frameCount << " of " << header.frameCapacity << " frames\n";
+        std::cout << "Frame,PresentNumber,TimestampMs\n";
+        for (uint32_t i = 0; i < header.frameCount; i++) {
+            std::cout << i << "," << index[i].presentNumber << ","
+                      << (index[i].timestampNs - index[0].timestampNs) / 1e6 << "\n";
+        }
+        return 0;
+    }
+
+    uint32_t frame = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+    if (frame >= header.frameCount) {
+        std::cerr << "Frame " << frame << " out of range (" << header.frameCount << " frames)" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint32_t> texels(static_cast<size_t>(header.width) * header.height);
+    in.seekg(static_cast<std::streamoff>(header.framesOffset + frame * header.frameStride));
+    in.read(reinterpret_cast<char*>(texels.data()), texels.size() * sizeof(uint32_t));
+    if (!in) {
+        std::cerr << "Truncated frame " << frame << std::endl;
+        return 1;
+    }
+
+    CaptureLayout layout = static_cast<CaptureLayout>(header.layout);
+    bool packed = layout == CaptureLayout::Rgb10A2 || layout == CaptureLayout::Bgr10A2;
+    bool blue_first = layout == CaptureLayout::Bgra8 || layout == CaptureLayout::Bgr10A2;
+    std::vector<uint8_t> rgb(texels.size() * 3);
+    for (size_t i = 0; i < texels.size(); i++) {
+        uint32_t v = texels[i];
+        uint8_t c0 = static_cast<uint8_t>(packed ? v >> 2 : v);
+        uint8_t c1 = static_cast<uint8_t>(packed ? v >> 12 : v >> 8);
+        uint8_t c2 = static_cast<uint8_t>(packed ? v >> 22 : v >> 16);
+        rgb[i * 3 + 0] = blue_first ? c2 : c0;
+        rgb[i * 3 + 1] = c1;
+        rgb[i * 3 + 2] = blue_first ? c0 : c2;
+    }
+
+    std::ofstream out(argv[3], std::ios::binary);
+    out << "P6\n" << header.width << " " << header.height << "\n255\n";
+    out.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    if (!out) {
+        std::cerr << "Cannot write " << argv[3] << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,513 @@
+#!/usr/bin/env python3
+"""Generates VK_LAYER_logger's dispatch tables and hooks from the Vulkan registry.
+
+Usage: gen_logger_hooks.py <vk.xml> <output dir>
+
+Writes logger_hooks.h and logger_hooks.cpp:
+  - LayerInstanceDispatchTable / LayerDeviceDispatchTable with every
+    instance- and device-level command, and loaders for them
+  - a hook for every command the logger does not implement by hand, which
+    logs the call and, in trace mode, captures its arguments without
+    allocating (scalars and handles by value, the scalar members of input
+    structs, the sTypes on their pNext chains and returned handles/counts)
+  - perfect-hash lookup tables from command name to hook
+  - the trace schema (function names and argument labels) that ApiTrace
+    writes at the start of every trace file
+
+The registry must match the Vulkan headers the layer is compiled against;
+CMake points this at the vk.xml shipped with the SDK headers.
+"""
+
+import os
+import sys
+import xml.etree.ElementTree as ET
+
+# Implemented in logger_layer.cpp: layer/chain plumbing and the calls that
+# track instances, physical devices and devices
+MANUAL = {
+    "vkCreateInstance",
+    "vkDestroyInstance",
+    "vkEnumeratePhysicalDevices",
+    "vkEnumeratePhysicalDeviceGroups",
+    "vkEnumeratePhysicalDeviceGroupsKHR",
+    "vkGetInstanceProcAddr",
+    "vkGetDeviceProcAddr",
+    "vkCreateDevice",
+    "vkDestroyDevice",
+    "vkEnumerateInstanceExtensionProperties",
+    "vkEnumerateInstanceLayerProperties",
+    "vkEnumerateDeviceExtensionProperties",
+    "vkEnumerateDeviceLayerProperties",
+}
+
+INSTANCE_HANDLES = {"VkInstance", "VkPhysicalDevice"}
+DEVICE_HANDLES = {"VkDevice", "VkQueue", "VkCommandBuffer"}
+
+MAX_ARGS = 48           # kMaxTraceArgs in api_trace.h
+MAX_STRUCT_VALUES = 8   # Scalar members captured per input struct
+CHAIN_DEPTH = 2         # pNext sTypes captured per input struct
+
+SIGNED_TYPES = {"int8_t", "int16_t", "int32_t", "int64_t", "int"}
+
+
+def is_vulkan_api(api_list):
+    # "vulkansc" is Vulkan SC only; newer registries also tag "vulkanbase"
+    return any(api in ("vulkan", "vulkanbase") for api in api_list.split(","))
+
+
+def api_matches(element):
+    api = element.get("api")
+    return api is None or is_vulkan_api(api)
+
+
+def text_of(element):
+    """Declaration text of a <param>/<member>, without <comment> children."""
+    parts = [element.text or ""]
+    for child in element:
+        if child.tag != "comment":
+            parts.append("".join(child.itertext()))
+        parts.append(child.tail or "")
+    return " ".join("".join(parts).split())
+
+
+class Decl:
+    """One parameter or struct member."""
+
+    def __init__(self, element):
+        self.type = element.find("type").text
+        self.name = element.find("name").text
+        self.text = text_of(element)
+        before, after = [element.text or ""], []
+        target = before
+        for child in element:
+            if child.tag == "name":
+                target = after
+            elif child.tag != "comment":
+                target.append("".join(child.itertext()))
+            target.append(child.tail or "")
+        before, after = "".join(before), "".join(after)
+        self.is_array = "[" in after
+        self.is_bitfield = ":" in after
+        self.pointers = before.count("*")
+        self.is_const = before.lstrip().startswith("const")
+        self.len = element.get("len")
+
+
+class Registry:
+    def __init__(self, path):
+        root = ET.parse(path).getroot()
+
+        self.protect = {p.get("name"): p.get("protect") for p in root.iter("platform")}
+        self.categories = {}
+        self.type_alias = {}
+        self.structs = {}
+        self.basetype_scalar = set()
+        for t in root.find("types"):
+            if t.tag != "type" or not api_matches(t):
+                continue
+            name = t.get("name") or (t.find("name").text if t.find("name") is not None else None)
+            if name is None:
+                continue
+            if t.get("alias"):
+                self.type_alias[name] = t.get("alias")
+                continue
+            category = t.get("category")
+            self.categories[name] = category
+            if category in ("struct", "union"):
+                self.structs[name] = [Decl(m) for m in t.findall("member") if api_matches(m)]
+            elif category == "basetype" and t.find("type") is not None:
+                self.basetype_scalar.add(name)
+
+        self.commands = {}
+        aliases = {}
+        for c in root.find("commands"):
+            if not api_matches(c):
+                continue
+            if c.get("alias"):
+                aliases[c.get("name")] = c.get("alias")
+                continue
+            proto = c.find("proto")
+            name = proto.find("name").text
+            self.commands[name] = (proto.find("type").text,
+                                   [Decl(p) for p in c.findall("param") if api_matches(p)])
+        for name, target in aliases.items():
+            if target in self.commands:
+                self.commands[name] = self.commands[target]
+
+        # Command -> set of guard macros; an empty set means always compiled
+        self.required = {}
+        order = []
+
+        def require(block_parent, guard):
+            for req in block_parent.findall("require"):
+                if not api_matches(req):
+                    continue
+                for cmd in req.findall("command"):
+                    name = cmd.get("name")
+                    if name not in self.required:
+                        order.append(name)
+                        self.required[name] = set(guard) if guard else set()
+                    elif not guard:
+                        self.required[name] = set()
+                    elif self.required[name]:
+                        self.required[name] |= set(guard)
+
+        for feature in root.findall("feature"):
+            if is_vulkan_api(feature.get("api", "vulkan")):
+                require(feature, None)
+        for ext in root.find("extensions"):
+            if not is_vulkan_api(ext.get("supported", "vulkan")):
+                continue
+            guard = []
+            if ext.get("platform"):
+                guard.append(self.protect[ext.get("platform")])
+            if ext.get("provisional") == "true":
+                guard.append("VK_ENABLE_BETA_EXTENSIONS")
+            require(ext, guard)
+
+        self.order = [n for n in order if n in self.commands]
+
+    def resolve(self, type_name):
+        while type_name in self.type_alias:
+            type_name = self.type_alias[type_name]
+        return type_name
+
+    def kind(self, type_name):
+        category = self.categories.get(self.resolve(type_name))
+        if category == "handle":
+            return "handle"
+        if category in ("struct", "union"):
+            return category
+        if category in ("enum", "bitmask") or type_name in self.basetype_scalar:
+            return "scalar"
+        if type_name in ("float", "double", "size_t", "char", "uint8_t", "uint16_t",
+                         "uint32_t", "uint64_t") or type_name in SIGNED_TYPES:
+            return "scalar"
+        if type_name == "void":
+            return "void"
+        if type_name.startswith("StdVideo"):
+            return "video"  # Codec headers: enums, but also structs
+        return "opaque"     # Platform types: integers or pointers
+
+    def suffix(self, type_name, pointer=False):
+        if pointer:
+            return ":x"
+        kind = self.kind(type_name)
+        if kind in ("handle", "opaque"):
+            return ":x"
+        if type_name == "float":
+            return ":f"
+        if type_name == "double":
+            return ":d"
+        if type_name in SIGNED_TYPES or self.categories.get(self.resolve(type_name)) == "enum":
+            return ":i"
+        return ""
+
+    def struct_values(self, struct_name, access, label, depth=0):
+        """(expression, label) for the scalar members of a struct, one level of
+        nested structs flattened. `access` is e.g. "pInfo->" or "pInfos[0]."."""
+        values = []
+        for m in self.structs.get(self.resolve(struct_name), []):
+            if m.name in ("sType", "pNext") or m.is_bitfield or m.is_array or m.pointers:
+                continue
+            kind = self.kind(m.type)
+            if kind == "struct" and depth == 0:
+                values += self.struct_values(m.type, access + m.name + ".", label + "." + m.name, 1)
+            elif kind in ("scalar", "handle", "opaque"):
+                values.append((access + m.name, label + "." + m.name + self.suffix(m.type)))
+        return values[:MAX_STRUCT_VALUES]
+
+    def has_pnext(self, struct_name):
+        return any(m.name == "pNext" for m in self.structs.get(self.resolve(struct_name), []))
+
+
+def dispatch_level(registry, name):
+    params = registry.commands[name][1]
+    first = params[0].type if params else None
+    if first in INSTANCE_HANDLES:
+        return "instance"
+    if first in DEVICE_HANDLES:
+        return "device"
+    return "global"
+
+
+def guard_open(guards):
+    if not guards:
+        return ""
+    return "#if " + " || ".join("defined(%s)" % g for g in sorted(guards)) + "\n"
+
+
+def guard_close(guards):
+    return "#endif\n" if guards else ""
+
+
+class Capture:
+    """Statements and labels for a command's argument capture."""
+
+    def __init__(self, registry, params):
+        self.inputs = []    # C++ statements before the call
+        self.outputs = []   # C++ statements after a successful call
+        self.input_labels = []
+        self.output_labels = []
+        self.count = 0
+        names = {p.name: p for p in params}
+
+        for p in params:
+            if p.type == "VkAllocationCallbacks":
+                continue
+            kind = registry.kind(p.type)
+
+            if p.pointers == 0 and not p.is_array:
+                if kind not in ("struct", "union"):
+                    self.add_input("trace.Arg(%s);" % p.name, p.name + registry.suffix(p.type))
+                continue
+
+            if p.is_array or (p.type == "char" and p.pointers == 1) or kind in ("void", "opaque"):
+                if p.is_const or p.is_array:
+                    self.add_input("trace.Arg(%s);" % p.name, p.name + ":x")
+                elif p.pointers == 2 and kind == "void":
+                    self.add_output("if (%s) trace.Arg(*%s);" % (p.name, p.name), "*" + p.name + ":x")
+                continue
+
+            if p.pointers != 1:
+                continue
+
+            # Arrays: only the first element, and only when its count is known
+            first = None
+            if p.len:
+                count = p.len.split(",")[0].replace("::", "->")
+                if count in names and names[count].pointers == 1:
+                    # In/out count: enumerations fill it in
+                    first = "%s && %s && *%s > 0" % (p.name, count, count)
+                elif count in names and names[count].pointers == 0:
+                    first = "%s && %s > 0" % (p.name, count)
+                elif "->" in count and count.split("->")[0] in names:
+                    first = "%s && %s && %s > 0" % (p.name, count.split("->")[0], count)
+                else:
+                    continue
+            element = p.name + "[0]" if p.len else "*" + p.name
+            access = p.name + "[0]." if p.len else p.name + "->"
+            label = p.name + "[0]" if p.len else p.name
+
+            if p.is_const and kind in ("struct", "union"):
+                if kind == "union":
+                    continue
+                values = registry.struct_values(p.type, access, label)
+                chain = registry.has_pnext(p.type)
+                width = len(values) + (CHAIN_DEPTH if chain else 0)
+                if width == 0 or self.count + width > MAX_ARGS:
+                    continue
+                body = ["trace.Arg(%s);" % expr for expr, _ in values]
+                if chain:
+                    body.append("trace.Chain(%spNext, %d);" % (access, CHAIN_DEPTH))
+                self.inputs.append("if (%s) {" % (first or p.name))
+                self.inputs += ["    " + line for line in body]
+                self.inputs.append("} else {")
+                self.inputs.append("    trace.Skip(%d);" % width)
+                self.inputs.append("}")
+                self.input_labels += [lbl for _, lbl in values]
+                self.input_labels += ["%s.pNext[%d].sType" % (label, i) for i in range(CHAIN_DEPTH if chain else 0)]
+                self.count += width
+            elif p.is_const and kind in ("scalar", "handle"):
+                self.add_input("trace.Arg(%s ? %s : 0);" % (first or p.name, element),
+                               label + registry.suffix(p.type))
+            elif not p.is_const and kind in ("scalar", "handle"):
+                # Created handles and returned counts
+                self.add_output("trace.Arg(%s ? %s : 0);" % (first or p.name, element),
+                                label + registry.suffix(p.type))
+
+    @property
+    def labels(self):
+        # Outputs are recorded after the call, so they come last (and are
+        # missing from records of failed calls)
+        return self.input_labels + self.output_labels
+
+    def add_input(self, statement, label):
+        if self.count < MAX_ARGS:
+            self.inputs.append(statement)
+            self.input_labels.append(label)
+            self.count += 1
+
+    def add_output(self, statement, label):
+        if self.count < MAX_ARGS:
+            self.outputs.append(statement)
+            self.output_labels.append(label)
+            self.count += 1
+
+
+def generate(registry, out_dir):
+    commands = registry.order
+    levels = {name: dispatch_level(registry, name) for name in commands}
+    guards = {name: registry.required[name] for name in commands}
+    captures = {name: Capture(registry, registry.commands[name][1]) for name in commands}
+
+    def params_decl(name):
+        return ", ".join(p.text for p in registry.commands[name][1])
+
+    def params_call(name):
+        return ", ".join(p.name for p in registry.commands[name][1])
+
+    h = []
+    h.append("// Generated by tools/gen_logger_hooks.py from vk.xml. Do not edit.\n")
+    h.append("#pragma once\n\n")
+    h.append("#include <vulkan/vulkan.h>\n#include \"api_trace.h\"\n\n")
+
+    h.append("// Trace function ids; kLoggerTraceSchema lists them in the same order\n")
+    h.append("enum class LoggerFunction : uint16_t {\n")
+    for name in commands:
+        h.append(guard_open(guards[name]) + "    %s,\n" % name + guard_close(guards[name]))
+    h.append("    Count\n};\n\n")
+    h.append("extern const char kLoggerTraceSchema[];\n\n")
+
+    for level, struct in (("instance", "LayerInstanceDispatchTable"), ("device", "LayerDeviceDispatchTable")):
+        h.append("struct %s {\n" % struct)
+        for name in commands:
+            if levels[name] == level:
+                h.append(guard_open(guards[name]) + "    PFN_%s %s;\n" % (name, name[2:]) + guard_close(guards[name]))
+        h.append("};\n\n")
+
+    h.append("void LoadInstanceDispatchTable(LayerInstanceDispatchTable* table, PFN_vkGetInstanceProcAddr gpa, VkInstance instance);\n")
+    h.append("void LoadDeviceDispatchTable(LayerDeviceDispatchTable* table, PFN_vkGetDeviceProcAddr gpa, VkDevice device);\n\n")
+    h.append("// Generated hook for `name`, or nullptr if there is none or `table` (when\n")
+    h.append("// given) has no next-layer function for it\n")
+    h.append("PFN_vkVoidFunction FindInstanceHook(const char* name, const LayerInstanceDispatchTable* table);\n")
+    h.append("PFN_vkVoidFunction FindDeviceHook(const char* name, const LayerDeviceDispatchTable* table);\n\n")
+
+    h.append("// Argument capture for the hooks written by hand in logger_layer.cpp\n")
+    for name in commands:
+        if name in MANUAL:
+            decl = "ApiTraceScope& trace, " + params_decl(name)
+            h.append(guard_open(guards[name]))
+            h.append("void CaptureInputs_%s(%s);\n" % (name, decl))
+            h.append("void CaptureOutputs_%s(%s);\n" % (name, decl))
+            h.append(guard_close(guards[name]))
+
+    c = []
+    c.append("// Generated by tools/gen_logger_hooks.py from vk.xml. Do not edit.\n\n")
+    c.append("#include \"logger_layer.h\"\n\n")
+
+    c.append("const char kLoggerTraceSchema[] =\n")
+    for name in commands:
+        line = " ".join([name] + captures[name].labels)
+        c.append(guard_open(guards[name]) + "    \"%s\\n\"\n" % line + guard_close(guards[name]))
+    c.append("    \"\";\n\n")
+
+    for level, struct, gpa, handle in (
+            ("instance", "LayerInstanceDispatchTable", "PFN_vkGetInstanceProcAddr", "VkInstance instance"),
+            ("device", "LayerDeviceDispatchTable", "PFN_vkGetDeviceProcAddr", "VkDevice device")):
+        loader = "LoadInstanceDispatchTable" if level == "instance" else "LoadDeviceDispatchTable"
+        arg = handle.split()[1]
+        c.append("void %s(%s* table, %s gpa, %s) {\n" % (loader, struct, gpa, handle))
+        for name in commands:
+            if levels[name] == level:
+                c.append(guard_open(guards[name]))
+                c.append("    table->%s = reinterpret_cast<PFN_%s>(gpa(%s, \"%s\"));\n" % (name[2:], name, arg, name))
+                c.append(guard_close(guards[name]))
+        c.append("}\n\n")
+
+    for name in commands:
+        capture = captures[name]
+        ret, params = registry.commands[name]
+        g = guards[name]
+        c.append(guard_open(g))
+
+        visibility = "" if name in MANUAL else "static "
+        decl = "ApiTraceScope& trace, " + params_decl(name)
+        for kind, lines in (("Inputs", capture.inputs), ("Outputs", capture.outputs)):
+            if name not in MANUAL and not lines:
+                continue
+            c.append("%svoid Capture%s_%s(%s) {\n" % (visibility, kind, name, decl))
+            c += ["    %s\n" % line for line in lines]
+            if not lines:
+                c.append("    (void)trace;\n")
+            c.append("}\n\n")
+
+        if name in MANUAL or levels[name] == "global":
+            c.append(guard_close(g))
+            continue
+
+        first = params[0].name
+        data = "GetDeviceData(%s)" % first if levels[name] == "device" else "GetInstanceData(%s)" % first
+        call = "%s_data->vtable.%s(%s)" % (levels[name], name[2:], params_call(name))
+        c.append("static VKAPI_ATTR %s VKAPI_CALL Hook_%s(%s) {\n" % (ret, name, params_decl(name)))
+        c.append("    ApiTraceScope trace(GetApiTrace(), LoggerFunction::%s);\n" % name)
+        c.append("    LogAPICall(\"%s\");\n" % name)
+        if capture.inputs:
+            c.append("    if (trace.Active()) CaptureInputs_%s(trace, %s);\n" % (name, params_call(name)))
+        # A handle the layer never saw created (or already destroyed) has no
+        # data to dispatch through
+        owner = "DeviceData" if levels[name] == "device" else "InstanceData"
+        c.append("    %s* %s_data = %s;\n" % (owner, levels[name], data))
+        if ret == "void":
+            c.append("    if (!%s_data) return;\n" % levels[name])
+        elif ret == "VkResult":
+            c.append("    if (!%s_data) return trace.Result(VK_ERROR_INITIALIZATION_FAILED);\n" % levels[name])
+        else:
+            c.append("    if (!%s_data) return 0;\n" % levels[name])
+        if ret == "void":
+            c.append("    %s;\n" % call)
+            if capture.outputs:
+                c.append("    if (trace.Active()) CaptureOutputs_%s(trace, %s);\n" % (name, params_call(name)))
+        else:
+            c.append("    %s result = %s;\n" % (ret, call))
+            if capture.outputs:
+                success = " && result >= VK_SUCCESS" if ret == "VkResult" else ""
+                c.append("    if (trace.Active()%s) CaptureOutputs_%s(trace, %s);\n" % (success, name, params_call(name)))
+            c.append("    return %s;\n" % ("trace.Result(result)" if ret == "VkResult" else "result"))
+        c.append("}\n\n")
+        c.append(guard_close(g))
+
+    for level, struct, finder in (("instance", "LayerInstanceDispatchTable", "FindInstanceHook"),
+                                  ("device", "LayerDeviceDispatchTable", "FindDeviceHook")):
+        hooked = [n for n in commands if levels[n] == level and n not in MANUAL]
+        prefix = "%s_hooks" % level
+        c.append("static constexpr const char* %s_names[] = {\n" % prefix)
+        for name in hooked:
+            c.append(guard_open(guards[name]) + "    \"%s\",\n" % name + guard_close(guards[name]))
+        c.append("};\n")
+        c.append("static constexpr ProcHash<std::size(%s_names)> %s_hash(%s_names);\n" % (prefix, prefix, prefix))
+        c.append("static const PFN_vkVoidFunction %s_functions[] = {\n" % prefix)
+        for name in hooked:
+            c.append(guard_open(guards[name]) + "    reinterpret_cast<PFN_vkVoidFunction>(Hook_%s),\n" % name + guard_close(guards[name]))
+        c.append("};\n")
+        c.append("static const size_t %s_offsets[] = {\n" % prefix)
+        for name in hooked:
+            c.append(guard_open(guards[name]) + "    offsetof(%s, %s),\n" % (struct, name[2:]) + guard_close(guards[name]))
+        c.append("};\n\n")
+        c.append("PFN_vkVoidFunction %s(const char* name, const %s* table) {\n" % (finder, struct))
+        c.append("    int index = %s_hash.Find(name);\n" % prefix)
+        c.append("    if (index < 0) return nullptr;\n")
+        c.append("    if (table) {\n")
+        c.append("        PFN_vkVoidFunction next;\n")
+        c.append("        std::memcpy(&next, reinterpret_cast<const char*>(table) + %s_offsets[index], sizeof(next));\n" % prefix)
+        c.append("        if (!next) return nullptr;\n")
+        c.append("    }\n")
+        c.append("    return %s_functions[index];\n" % prefix)
+        c.append("}\n\n")
+
+    write_if_changed(os.path.join(out_dir, "logger_hooks.h"), "".join(h))
+    write_if_changed(os.path.join(out_dir, "logger_hooks.cpp"), "".join(c).rstrip("\n") + "\n")
+
+
+def write_if_changed(path, content):
+    # Leave the timestamp alone when nothing changed so dependents do not rebuild
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == content:
+                return
+    with open(path, "w") as f:
+        f.write(content)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write(__doc__)
+        return 1
+    registry = Registry(sys.argv[1])
+    os.makedirs(sys.argv[2], exist_ok=True)
+    generate(registry, sys.argv[2])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
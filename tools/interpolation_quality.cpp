@@ -0,0 +1,428 @@
+// Offline interpolation quality and cost over captured frames.
+//
+// Holds out every frame N of a capture (1 .. count-2): SoftwareInterpolator
+// makes it from N-1 and N+1 and the result is scored against the real
+// frame N. For each mode reports the CPU cost per synthetic frame (AddFrame
+// of N+1 plus Interpolate, what the layer pays per application frame), the
+// throughput that allows, and PSNR and SSIM against the held-out frame.
+// Pairs that SceneChangeDetector calls a cut are repeated, as the layer
+// does, and counted.
+//
+// PSNR is over the R, G and B channels; SSIM is over BT.601 luma in 8x8
+// windows at a stride of 4. Both work on the top 8 bits of each channel, so
+// 10-bit captures score on the same scale as 8-bit ones.
+//
+// Input is a frame_capture_*.cap from FRAME_INTERP_CAPTURE=1, or with
+// --raw WxH a file of tightly packed R8G8B8A8 frames. Results go out as one
+// JSON document (stdout, or -o), with a summary on stderr.
+//
+// Usage: interpolation_quality [--raw WxH] [--modes previous,blend,warp]
+//                              [--threads N] [--frames N] [--per-frame]
+//                              [-o out.json] <input>
+
+#include "capture_file.h"
+#include "scene_change.h"
+#include "software_interpolation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef LAYER_VERSION
+#define LAYER_VERSION "unknown"
+#endif
+
+// Frames of one capture or raw file, read on demand
+class FrameSource {
+public:
+    bool Open(const std::string& path, uint32_t raw_width, uint32_t raw_height) {
+        in_.open(path, std::ios::binary);
+        if (!in_) {
+            std::cerr << "Cannot open " << path << std::endl;
+            return false;
+        }
+        if (raw_width != 0) {
+            width_ = raw_width;
+            height_ = raw_height;
+            stride_ = static_cast<uint64_t>(width_) * height_ * 4;
+            in_.seekg(0, std::ios::end);
+            count_ = static_cast<uint32_t>(static_cast<uint64_t>(in_.tellg()) / stride_);
+            return true;
+        }
+
+        CaptureFileHeader header = {};
+        in_.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!in_ || header.magic != kCaptureMagic) {
+            std::cerr << path << " is not a capture file (use --raw WxH for raw frames)" << std::endl;
+            return false;
+        }
+        if (header.version != kCaptureVersion) {
+            std::cerr << "Unsupported capture version " << header.version << std::endl;
+            return false;
+        }
+        width_ = header.width;
+        height_ = header.height;
+        count_ = header.frameCount;
+        offset_ = header.framesOffset;
+        stride_ = header.frameStride;
+        // The two enums name the same layouts in the same order
+        format_ = static_cast<SoftwareFormat>(header.layout);
+        return true;
+    }
+
+    bool Read(uint32_t frame, std::vector<uint8_t>* pixels) {
+        pixels->resize(static_cast<size_t>(width_) * height_ * 4);
+        in_.seekg(static_cast<std::streamoff>(offset_ + frame * stride_));
+        in_.read(reinterpret_cast<char*>(pixels->data()), static_cast<std::streamsize>(pixels->size()));
+        return static_cast<bool>(in_);
+    }
+
+    uint32_t Width() const { return width_; }
+    uint32_t Height() const { return height_; }
+    uint32_t Count() const { return count_; }
+    SoftwareFormat Format() const { return format_; }
+
+private:
+    std::ifstream in_;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t count_ = 0;
+    uint64_t offset_ = 0;
+    uint64_t stride_ = 0;
+    SoftwareFormat format_ = SoftwareFormat::Rgba8;
+};
+
+// Top 8 bits of R, G and B of every pixel, in that order
+static void ToRgb8(const std::vector<uint8_t>& pixels, SoftwareFormat format, std::vector<uint8_t>* rgb) {
+    bool packed = format == SoftwareFormat::Rgb10A2 || format == SoftwareFormat::Bgr10A2;
+    bool blue_first = format == SoftwareFormat::Bgra8 || format == SoftwareFormat::Bgr10A2;
+    size_t count = pixels.size() / 4;
+    rgb->resize(count * 3);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t v;
+        std::memcpy(&v, &pixels[i * 4], 4);
+        uint8_t c0 = static_cast<uint8_t>(packed ? v >> 2 : v);
+        uint8_t c1 = static_cast<uint8_t>(packed ? v >> 12 : v >> 8);
+        uint8_t c2 = static_cast<uint8_t>(packed ? v >> 22 : v >> 16);
+        (*rgb)[i * 3 + 0] = blue_first ? c2 : c0;
+        (*rgb)[i * 3 + 1] = c1;
+        (*rgb)[i * 3 + 2] = blue_first ? c0 : c2;
+    }
+}
+
+// Capped at 100 dB for identical frames, so the JSON stays numeric
+static double Psnr(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        int d = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+        sum += static_cast<uint64_t>(d * d);
+    }
+    if (sum == 0) return 100.0;
+    double mse = static_cast<double>(sum) / a.size();
+    return std::min(100.0, 10.0 * std::log10(255.0 * 255.0 / mse));
+}
+
+static void Luma(const std::vector<uint8_t>& rgb, std::vector<uint8_t>* luma) {
+    luma->resize(rgb.size() / 3);
+    for (size_t i = 0; i < luma->size(); i++) {
+        (*luma)[i] = static_cast<uint8_t>((77 * rgb[i * 3] + 150 * rgb[i * 3 + 1] + 29 * rgb[i * 3 + 2] + 128) >> 8);
+    }
+}
+
+// Mean SSIM of 8x8 windows at a stride of 4
+static double Ssim(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, uint32_t width, uint32_t height) {
+    constexpr uint32_t kWindow = 8;
+    constexpr uint32_t kStride = 4;
+    constexpr double kC1 = (0.01 * 255) * (0.01 * 255);
+    constexpr double kC2 = (0.03 * 255) * (0.03 * 255);
+    constexpr double kN = kWindow * kWindow;
+    if (width < kWindow || height < kWindow) return 1.0;
+
+    double total = 0.0;
+    uint64_t windows = 0;
+    for (uint32_t y = 0; y + kWindow <= height; y += kStride) {
+        for (uint32_t x = 0; x + kWindow <= width; x += kStride) {
+            uint32_t sum_a = 0, sum_b = 0;
+            uint64_t sum_aa = 0, sum_bb = 0, sum_ab = 0;
+            for (uint32_t j = 0; j < kWindow; j++) {
+                const uint8_t* row_a = &a[static_cast<size_t>(y + j) * width + x];
+                const uint8_t* row_b = &b[static_cast<size_t>(y + j) * width + x];
+                for (uint32_t i = 0; i < kWindow; i++) {
+                    uint32_t va = row_a[i];
+                    uint32_t vb = row_b[i];
+                    sum_a += va;
+                    sum_b += vb;
+                    sum_aa += va * va;
+                    sum_bb += vb * vb;
+                    sum_ab += va * vb;
+                }
+            }
+            double mean_a = sum_a / kN;
+            double mean_b = sum_b / kN;
+            double var_a = sum_aa / kN - mean_a * mean_a;
+            double var_b = sum_bb / kN - mean_b * mean_b;
+            double covariance = sum_ab / kN - mean_a * mean_b;
+            total += ((2 * mean_a * mean_b + kC1) * (2 * covariance + kC2)) /
+                     ((mean_a * mean_a + mean_b * mean_b + kC1) * (var_a + var_b + kC2));
+            windows++;
+        }
+    }
+    return total / windows;
+}
+
+struct FrameResult {
+    uint32_t frame;
+    double ms;
+    double psnr;
+    double ssim;
+    bool cut;
+};
+
+struct ModeResult {
+    const char* name;
+    SoftwareInterpolationMode mode;
+    uint32_t threads = 0;
+    std::vector<FrameResult> frames;
+};
+
+static std::string JsonEscape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+static const char* FormatName(SoftwareFormat format) {
+    switch (format) {
+    case SoftwareFormat::Rgba8: return "rgba8";
+    case SoftwareFormat::Bgra8: return "bgra8";
+    case SoftwareFormat::Rgb10A2: return "rgb10a2";
+    case SoftwareFormat::Bgr10A2: return "bgr10a2";
+    }
+    return "unknown";
+}
+
+static bool RunMode(FrameSource& source, uint32_t first, uint32_t last, uint32_t threads, ModeResult* result) {
+    uint32_t width = source.Width();
+    uint32_t height = source.Height();
+    size_t pitch = static_cast<size_t>(width) * 4;
+
+    SoftwareInterpolatorOptions options;
+    options.mode = result->mode;
+    options.threads = threads;
+    std::unique_ptr<SoftwareInterpolator> interpolator =
+        SoftwareInterpolator::Create(width, height, source.Format(), options);
+    if (!interpolator) return false;
+    result->threads = interpolator->ThreadCount();
+    SceneChangeDetector detector(width, height, source.Format());
+
+    std::vector<uint8_t> previous, held_out, next, output;
+    std::vector<uint8_t> rgb_real, rgb_synthetic, luma_real, luma_synthetic;
+    output.resize(pitch * height);
+    for (uint32_t n = first; n <= last; n++) {
+        if (!source.Read(n - 1, &previous) || !source.Read(n, &held_out) || !source.Read(n + 1, &next)) {
+            std::cerr << "Short read at frame " << n << std::endl;
+            return false;
+        }
+
+        // Each pair stands alone: no motion or histogram carried over from
+        // the pair before
+        interpolator->Reset();
+        interpolator->AddFrame(previous.data(), pitch);
+        detector.Reset();
+        detector.AddFrame(previous.data(), pitch);
+
+        auto start = std::chrono::steady_clock::now();
+        interpolator->AddFrame(next.data(), pitch);
+        bool cut = detector.AddFrame(next.data(), pitch);
+        if (cut) {
+            interpolator->Repeat(previous.data(), output.data(), pitch);
+        } else {
+            interpolator->Interpolate(previous.data(), next.data(), output.data(), pitch);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        ToRgb8(held_out, source.Format(), &rgb_real);
+        ToRgb8(output, source.Format(), &rgb_synthetic);
+        Luma(rgb_real, &luma_real);
+        Luma(rgb_synthetic, &luma_synthetic);
+        result->frames.push_back({n, ms, Psnr(rgb_real, rgb_synthetic),
+                                  Ssim(luma_real, luma_synthetic, width, height), cut});
+    }
+    return true;
+}
+
+struct Summary {
+    double ms_mean = 0.0;
+    double ms_p95 = 0.0;
+    double psnr_mean = 0.0;
+    double psnr_min = 0.0;
+    double ssim_mean = 0.0;
+    double ssim_min = 0.0;
+    uint32_t cuts = 0;
+};
+
+static Summary Summarize(const std::vector<FrameResult>& frames) {
+    Summary summary;
+    if (frames.empty()) return summary;
+    std::vector<double> times;
+    summary.psnr_min = frames[0].psnr;
+    summary.ssim_min = frames[0].ssim;
+    for (const FrameResult& frame : frames) {
+        times.push_back(frame.ms);
+        summary.ms_mean += frame.ms;
+        summary.psnr_mean += frame.psnr;
+        summary.ssim_mean += frame.ssim;
+        summary.psnr_min = std::min(summary.psnr_min, frame.psnr);
+        summary.ssim_min = std::min(summary.ssim_min, frame.ssim);
+        summary.cuts += frame.cut ? 1 : 0;
+    }
+    summary.ms_mean /= frames.size();
+    summary.psnr_mean /= frames.size();
+    summary.ssim_mean /= frames.size();
+    std::sort(times.begin(), times.end());
+    summary.ms_p95 = times[std::min(times.size() - 1, times.size() * 95 / 100)];
+    return summary;
+}
+
+static bool ParseModes(const char* list, std::vector<ModeResult>* modes) {
+    const struct { const char* name; SoftwareInterpolationMode mode; } known[] = {
+        {"previous", SoftwareInterpolationMode::Previous},
+        {"blend", SoftwareInterpolationMode::Blend},
+        {"warp", SoftwareInterpolationMode::Warp},
+    };
+    modes->clear();
+    std::string remaining = list;
+    while (!remaining.empty()) {
+        size_t comma = remaining.find(',');
+        std::string name = remaining.substr(0, comma);
+        remaining = comma == std::string::npos ? "" : remaining.substr(comma + 1);
+        bool found = false;
+        for (const auto& mode : known) {
+            if (name == mode.name) {
+                ModeResult result;
+                result.name = mode.name;
+                result.mode = mode.mode;
+                modes->push_back(result);
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cerr << "Unknown mode " << name << std::endl;
+            return false;
+        }
+    }
+    return !modes->empty();
+}
+
+int main(int argc, char** argv) {
+    uint32_t raw_width = 0, raw_height = 0;
+    uint32_t threads = 0;
+    uint32_t max_frames = 0;
+    bool per_frame = false;
+    std::string input, output_path;
+    std::vector<ModeResult> modes;
+    ParseModes("previous,blend,warp", &modes);
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--raw" && has_value) {
+            if (std::sscanf(argv[++i], "%ux%u", &raw_width, &raw_height) != 2 || raw_width == 0 || raw_height == 0) {
+                std::cerr << "--raw takes WIDTHxHEIGHT" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--modes" && has_value) {
+            if (!ParseModes(argv[++i], &modes)) return 1;
+        } else if (arg == "--threads" && has_value) {
+            threads = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--frames" && has_value) {
+            max_frames = static_cast<uint32_t>(std::atoi(argv[++i]));
+        } else if (arg == "--per-frame") {
+            per_frame = true;
+        } else if (arg == "-o" && has_value) {
+            output_path = argv[++i];
+        } else if (input.empty() && arg[0] != '-') {
+            input = arg;
+        } else {
+            input.clear();
+            break;
+        }
+    }
+    if (input.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--raw WxH] [--modes previous,blend,warp] [--threads N]"
+                  << " [--frames N] [--per-frame] [-o out.json] <input>" << std::endl;
+        return 1;
+    }
+
+    FrameSource source;
+    if (!source.Open(input, raw_width, raw_height)) return 1;
+    if (source.Count() < 3) {
+        std::cerr << input << " has " << source.Count() << " frames; at least 3 are needed" << std::endl;
+        return 1;
+    }
+    uint32_t first = 1;
+    uint32_t last = source.Count() - 2;
+    if (max_frames != 0) last = std::min(last, first + max_frames - 1);
+
+    for (ModeResult& mode : modes) {
+        if (!RunMode(source, first, last, threads, &mode)) return 1;
+    }
+
+    std::FILE* out = stdout;
+    if (!output_path.empty()) {
+        out = std::fopen(output_path.c_str(), "w");
+        if (!out) {
+            std::cerr << "Cannot write " << output_path << std::endl;
+            return 1;
+        }
+    }
+
+    std::fprintf(out, "{\n  \"tool\": \"interpolation_quality\",\n  \"layer_version\": \"%s\",\n", LAYER_VERSION);
+    std::fprintf(out, "  \"input\": \"%s\",\n  \"width\": %u,\n  \"height\": %u,\n  \"format\": \"%s\",\n",
+                 JsonEscape(input).c_str(), source.Width(), source.Height(), FormatName(source.Format()));
+    std::fprintf(out, "  \"held_out_frames\": %u,\n  \"modes\": [\n", last - first + 1);
+    std::fprintf(stderr, "%ux%u %s, %u held-out frames\n", source.Width(), source.Height(),
+                 FormatName(source.Format()), last - first + 1);
+    std::fprintf(stderr, "%-9s %8s %8s %9s %9s %9s %8s %8s %5s\n", "mode", "threads", "ms", "ms p95", "fps",
+                 "PSNR dB", "min dB", "SSIM", "cuts");
+    for (size_t m = 0; m < modes.size(); m++) {
+        const ModeResult& mode = modes[m];
+        Summary summary = Summarize(mode.frames);
+        double fps = summary.ms_mean > 0.0 ? 1000.0 / summary.ms_mean : 0.0;
+        std::fprintf(out, "    {\n      \"mode\": \"%s\",\n      \"threads\": %u,\n", mode.name, mode.threads);
+        std::fprintf(out, "      \"ms_per_frame\": %.4f,\n      \"ms_p95\": %.4f,\n      \"frames_per_second\": %.1f,\n",
+                     summary.ms_mean, summary.ms_p95, fps);
+        std::fprintf(out, "      \"psnr_db\": %.3f,\n      \"psnr_min_db\": %.3f,\n", summary.psnr_mean,
+                     summary.psnr_min);
+        std::fprintf(out, "      \"ssim\": %.5f,\n      \"ssim_min\": %.5f,\n      \"scene_cuts\": %u",
+                     summary.ssim_mean, summary.ssim_min, summary.cuts);
+        if (per_frame) {
+            std::fprintf(out, ",\n      \"frames\": [\n");
+            for (size_t i = 0; i < mode.frames.size(); i++) {
+                const FrameResult& frame = mode.frames[i];
+                std::fprintf(out, "        {\"frame\": %u, \"ms\": %.4f, \"psnr_db\": %.3f, \"ssim\": %.5f, \"cut\": %s}%s\n",
+                             frame.frame, frame.ms, frame.psnr, frame.ssim, frame.cut ? "true" : "false",
+                             i + 1 < mode.frames.size() ? "," : "");
+            }
+            std::fprintf(out, "      ]");
+        }
+        std::fprintf(out, "\n    }%s\n", m + 1 < modes.size() ? "," : "");
+        std::fprintf(stderr, "%-9s %8u %8.3f %9.3f %9.1f %9.2f %8.2f %8.4f %5u\n", mode.name, mode.threads,
+                     summary.ms_mean, summary.ms_p95, fps, summary.psnr_mean, summary.psnr_min, summary.ssim_mean,
+                     summary.cuts);
+    }
+    std::fprintf(out, "  ]\n}\n");
+    if (out != stdout) std::fclose(out);
+    return 0;
+}
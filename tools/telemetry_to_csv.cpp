@@ -0,0 +1,97 @@
+// Converts a frame_timing_*.bin telemetry file written by the frame
+// interpolation layer into the FrameNumber,FrametimeMs,ImageIndex,PresentMode
+// CSV produced by earlier versions of the layer. Version 2 files add a
+// SceneChange column (1 on frames after a detected scene cut).
+//
+// Usage: telemetry_to_csv <input.bin> [output.csv]
+//        (writes to stdout when no output is given)
+
+#include "telemetry_writer.h"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+template <typename T>
+static bool ReadColumn(std::ifstream& in, std::vector<T>& column, uint32_t count) {
+    column.resize(count);
+    in.read(reinterpret_cast<char*>(column.data()), count * sizeof(T));
+    return static_cast<bool>(in);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <input.bin> [output.csv]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    TelemetryFileHeader header = {};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != kTelemetryMagic) {
+        std::cerr << argv[1] << " is not a telemetry file" << std::endl;
+        return 1;
+    }
+    if (header.version < 1 || header.version > kTelemetryVersion) {
+        std::cerr << "Unsupported telemetry version " << header.version << std::endl;
+        return 1;
+    }
+
+    std::ofstream out_file;
+    if (argc > 2) {
+        out_file.open(argv[2]);
+        if (!out_file) {
+            std::cerr << "Cannot write " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = (argc > 2) ? out_file : std::cout;
+
+    bool has_flags = header.version >= 2;
+    out << "FrameNumber,FrametimeMs,ImageIndex,PresentMode" << (has_flags ? ",SceneChange\n" : "\n");
+
+    std::vector<uint64_t> frameNumbers;
+    std::vector<float> frametimes;
+    std::vector<uint32_t> imageIndices;
+    std::vector<uint32_t> presentModes;
+    std::vector<uint32_t> flags;
+    uint64_t frames = 0;
+    uint64_t dropped = 0;
+
+    TelemetryBlockHeader block = {};
+    while (in.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+        if (!ReadColumn(in, frameNumbers, block.count) ||
+            !ReadColumn(in, frametimes, block.count) ||
+            !ReadColumn(in, imageIndices, block.count) ||
+            !ReadColumn(in, presentModes, block.count) ||
+            (has_flags && !ReadColumn(in, flags, block.count))) {
+            std::cerr << "Truncated block after " << frames << " frames" << std::endl;
+            break;
+        }
+
+        for (uint32_t i = 0; i < block.count; i++) {
+            out << frameNumbers[i] << ","
+                << frametimes[i] << ","
+                << imageIndices[i] << ","
+                << presentModes[i];
+            if (has_flags) {
+                out << "," << ((flags[i] & kTelemetryFlagSceneChange) ? 1 : 0);
+            }
+            out << "\n";
+        }
+        frames += block.count;
+        dropped = block.droppedTotal;
+    }
+
+    std::cerr << frames << " frames";
+    if (dropped > 0) {
+        std::cerr << ", " << dropped << " dropped by the layer";
+    }
+    std::cerr << std::endl;
+    return 0;
+}
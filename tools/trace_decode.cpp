@@ -0,0 +1,221 @@
+// Decodes a binary API trace written by VK_LAYER_logger with
+// VK_LOGGER_TRACE=<path> into one text line per call, with its captured
+// arguments, followed by a per-function summary. Function names and argument
+// labels come from the schema at the start of the file.
+//
+// Usage: trace_decode <input.trace> [output.txt]
+//        (writes to stdout when no output is given)
+
+#include "api_trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct ArgLabel {
+    std::string name;
+    char format = 'u';      // 'x' hex, 'i' signed, 'f' float, 'd' double, 'u' unsigned
+};
+
+struct FunctionSchema {
+    std::string name;
+    std::vector<ArgLabel> args;
+};
+
+struct Call {
+    TraceRecord record;
+    size_t firstArg;        // Index into the flat argument array
+};
+
+static std::vector<FunctionSchema> ParseSchema(const std::string& text) {
+    std::vector<FunctionSchema> functions;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream words(line);
+        FunctionSchema function;
+        words >> function.name;
+        std::string word;
+        while (words >> word) {
+            ArgLabel label;
+            size_t colon = word.rfind(':');
+            if (colon != std::string::npos && colon + 2 == word.size()) {
+                label.format = word[colon + 1];
+                word.resize(colon);
+            }
+            label.name = word;
+            function.args.push_back(label);
+        }
+        functions.push_back(function);
+    }
+    return functions;
+}
+
+static void PrintValue(std::ostream& out, uint64_t value, char format) {
+    switch (format) {
+    case 'x':
+        out << "0x" << std::hex << value << std::dec;
+        break;
+    case 'i':
+        out << static_cast<int64_t>(value);
+        break;
+    case 'f': {
+        uint32_t bits = static_cast<uint32_t>(value);
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        out << f;
+        break;
+    }
+    case 'd': {
+        double d;
+        std::memcpy(&d, &value, sizeof(d));
+        out << d;
+        break;
+    }
+    default:
+        out << value;
+        break;
+    }
+}
+
+struct FunctionSummary {
+    uint64_t calls = 0;
+    double total_us = 0.0;
+    double max_us = 0.0;
+};
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <input.trace> [output.txt]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+
+    TraceFileHeader header = {};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != kTraceMagic) {
+        std::cerr << argv[1] << " is not an API trace" << std::endl;
+        return 1;
+    }
+    if (header.version != kTraceVersion) {
+        std::cerr << "Unsupported trace version " << header.version << std::endl;
+        return 1;
+    }
+
+    std::string schema_text(header.schemaSize, '\0');
+    if (!in.read(&schema_text[0], header.schemaSize)) {
+        std::cerr << "Truncated schema" << std::endl;
+        return 1;
+    }
+    std::vector<FunctionSchema> schema = ParseSchema(schema_text);
+
+    // Records are only converted once the whole file has been read, so the
+    // tick rate comes from the widest (ticks, ns) span available
+    std::vector<TraceSlot> slots;
+    TraceBlockHeader block = {};
+    TraceBlockHeader last_block = {};
+    uint64_t dropped = 0;
+    while (in.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+        size_t offset = slots.size();
+        slots.resize(offset + block.count);
+        if (!in.read(reinterpret_cast<char*>(slots.data() + offset), block.count * sizeof(TraceSlot))) {
+            slots.resize(offset);
+            std::cerr << "Truncated block after " << slots.size() << " slots" << std::endl;
+            break;
+        }
+        last_block = block;
+        dropped = block.droppedTotal;
+    }
+
+    // Each record is followed by its argument slots
+    std::vector<Call> records;
+    std::vector<uint64_t> args;
+    for (size_t i = 0; i < slots.size();) {
+        Call call;
+        std::memcpy(&call.record, &slots[i++], sizeof(call.record));
+        call.firstArg = args.size();
+        size_t arg_slots = (call.record.argCount + kTraceArgsPerSlot - 1) / kTraceArgsPerSlot;
+        if (i + arg_slots > slots.size()) break;
+        for (size_t a = 0; a < call.record.argCount; a++) {
+            args.push_back(slots[i + a / kTraceArgsPerSlot].values[a % kTraceArgsPerSlot]);
+        }
+        i += arg_slots;
+        records.push_back(call);
+    }
+
+    double ticks_per_ns = 1.0;
+    if (last_block.clockNs > header.clockNs && last_block.timestamp > header.timestamp) {
+        ticks_per_ns = static_cast<double>(last_block.timestamp - header.timestamp) /
+                       static_cast<double>(last_block.clockNs - header.clockNs);
+    }
+
+    // Each thread's ring is in order, but rings are drained one at a time
+    std::stable_sort(records.begin(), records.end(),
+                     [](const Call& a, const Call& b) { return a.record.timestamp < b.record.timestamp; });
+
+    std::ofstream out_file;
+    if (argc > 2) {
+        out_file.open(argv[2]);
+        if (!out_file) {
+            std::cerr << "Cannot write " << argv[2] << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = (argc > 2) ? out_file : std::cout;
+
+    std::vector<FunctionSummary> summaries(schema.size());
+    out << std::fixed << std::setprecision(3);
+    for (const Call& call : records) {
+        const TraceRecord& record = call.record;
+        const FunctionSchema* function = record.function < schema.size() ? &schema[record.function] : nullptr;
+        double start_us = static_cast<double>(static_cast<int64_t>(record.timestamp - header.timestamp)) /
+                          ticks_per_ns / 1000.0;
+        double duration_us = static_cast<double>(record.duration) / ticks_per_ns / 1000.0;
+
+        out << std::setw(14) << start_us << " us"
+            << "  tid " << std::setw(7) << record.threadId
+            << "  " << std::left << std::setw(40) << (function ? function->name : "<unknown>") << std::right
+            << "  result " << std::setw(4) << record.result
+            << "  " << std::setw(10) << duration_us << " us";
+        for (size_t a = 0; a < record.argCount; a++) {
+            const ArgLabel* label = (function && a < function->args.size()) ? &function->args[a] : nullptr;
+            out << "  " << (label ? label->name : "arg" + std::to_string(a)) << "=";
+            PrintValue(out, args[call.firstArg + a], label ? label->format : 'x');
+        }
+        out << "\n";
+
+        if (record.function < summaries.size()) {
+            FunctionSummary& summary = summaries[record.function];
+            summary.calls++;
+            summary.total_us += duration_us;
+            summary.max_us = std::max(summary.max_us, duration_us);
+        }
+    }
+
+    out << "\nFunction                                     Calls      Avg us      Max us\n";
+    for (size_t i = 0; i < summaries.size(); i++) {
+        const FunctionSummary& summary = summaries[i];
+        if (summary.calls == 0) continue;
+        out << std::left << std::setw(40) << schema[i].name << std::right
+            << std::setw(10) << summary.calls
+            << std::setw(12) << summary.total_us / static_cast<double>(summary.calls)
+            << std::setw(12) << summary.max_us << "\n";
+    }
+
+    std::cerr << records.size() << " calls";
+    if (dropped > 0) {
+        std::cerr << ", " << dropped << " dropped by the layer";
+    }
+    std::cerr << std::endl;
+    return 0;
+}